@@ -8,6 +8,12 @@ from . import general, scheduler
 class CpuEngine(Enum):
     BASIC = 0
     SHARED_ACC = 1
+    SIMD = 2
+    TILED = 3
+    BARNES_HUT = 4
+    FMM = 5
+    PM = 6
+    SPMD = 7
 
 
 DEFAULT_TRIALS = 1
@@ -1,8 +1,13 @@
-# /// BINARY
+# /// BINARY, version 1
 # /// - first 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
 # /// - second 4 bytes: number of bodies
 # /// - rest: (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
 # /// Everything in binary
+# ///
+# /// BINARY, version 2, little-endian, see src/core/serde.h
+# /// - header, 64 bytes: magic "TUSSBIN\0", u32 version, u32 size of floating type, u64 number of bodies,
+# ///   u32 flags (bit 0: metadata valid), u32 reserved, f64 dt, u64 iteration, f64 time, u64 reserved
+# /// - columns POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS, each zero-padded to a multiple of 64 bytes
 
 # void serialize_system_state_to_bin(std::ostream &, const SYSTEM_STATE &);
 # void serialize_system_state_to_bin(const std::string &, const SYSTEM_STATE &);
@@ -13,6 +18,17 @@ import struct
 
 from . import fileio
 
+BIN_MAGIC = b'TUSSBIN\0'
+BIN_LATEST_VERSION = 2
+BIN_HEADER_SIZE_V2 = 64
+BIN_COLUMN_ALIGNMENT = 64
+BIN_NUM_COLUMNS = 7
+BIN_HAS_METADATA_FLAG = 1
+
+
+def bin_column_stride(floating_type_size, num_bodies):
+    return (num_bodies * floating_type_size + BIN_COLUMN_ALIGNMENT - 1) // BIN_COLUMN_ALIGNMENT * BIN_COLUMN_ALIGNMENT
+
 
 def parse_body_state_from_bin(f, floating_type_size, floating_type_sym):
     '''
@@ -22,20 +38,48 @@ def parse_body_state_from_bin(f, floating_type_size, floating_type_sym):
     return struct.unpack(floating_type_sym * 7, body_state_bytes)
 
 
+def read_bin_header(f):
+    '''
+    (version, floating_type_size, num_bodies, metadata), metadata is (dt, iteration, time) or None
+    '''
+    start = f.read(8)
+    if start == BIN_MAGIC:
+        header = f.read(BIN_HEADER_SIZE_V2 - 8)
+        version, floating_type_size, num_bodies, flags, _, dt, iteration, time = struct.unpack(
+            '<IIQIIdQd', header[0:48])
+        assert version == 2
+        metadata = (dt, iteration, time) if flags & BIN_HAS_METADATA_FLAG else None
+    else:
+        version = 1
+        floating_type_size, num_bodies = struct.unpack('<ii', start)
+        metadata = None
+    assert floating_type_size == 4 or floating_type_size == 8
+    return version, floating_type_size, num_bodies, metadata
+
+
 def deserialize_system_state_from_bin(filename):
     '''
-    [(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)]
+    [(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)], from either version
     '''
     with open(filename, 'rb') as f:
-        floating_type_size = int.from_bytes(f.read(4), 'little')
-        assert floating_type_size == 4 or floating_type_size == 8
+        version, floating_type_size, num_bodies, _ = read_bin_header(f)
         floating_type_sym = 'f' if floating_type_size == 4 else 'd'
-        # print(floating_type_size, floating_type_sym)
 
-        num_bodies = int.from_bytes(f.read(4), 'little')
-        # print(num_bodies)
+        if version == 1:
+            return [parse_body_state_from_bin(f, floating_type_size, floating_type_sym) for _ in range(num_bodies)]
 
-        return [parse_body_state_from_bin(f, floating_type_size, floating_type_sym) for _ in range(num_bodies)]
+        column_stride = bin_column_stride(floating_type_size, num_bodies)
+        columns = [struct.unpack('<' + floating_type_sym * num_bodies, f.read(column_stride)[0:floating_type_size * num_bodies])
+                   for _ in range(BIN_NUM_COLUMNS)]
+        return list(zip(*columns))
+
+
+def deserialize_metadata_from_bin(filename):
+    '''
+    (dt, iteration, time) of a version 2 file, or None
+    '''
+    with open(filename, 'rb') as f:
+        return read_bin_header(f)[3]
 
 
 def write_body_state_into_bin(f, floating_type_sym, body_state):
@@ -45,22 +89,211 @@ def write_body_state_into_bin(f, floating_type_sym, body_state):
     f.write(struct.pack(floating_type_sym*7, *body_state))
 
 
-def serialize_system_state_into_bin(system_state, filename):
+def serialize_system_state_into_bin(system_state, filename, metadata=None, version=BIN_LATEST_VERSION):
     '''
-    [(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)]
+    [(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)], metadata is (dt, iteration, time), version 2 only
     '''
+    assert version == 1 or version == 2
+    assert metadata is None or version == 2
     fileio.create_file_dir_if_necessary(filename)
     with open(filename, 'wb') as f:
         floating_type_sym = 'f' if type(system_state[0][0]) is float else 'd'
         floating_type_size = 4 if floating_type_sym == 'f' else 8
-        print('Info:', "BIN file floating type size", floating_type_size)
-        f.write(floating_type_size.to_bytes(4, "little"))
-        f.write(len(system_state).to_bytes(4, 'little'))
-        for body_state in system_state:
-            write_body_state_into_bin(f, floating_type_sym, body_state)
+        num_bodies = len(system_state)
+        print('Info:', "BIN file version", version,
+              "floating type size", floating_type_size)
+        if version == 1:
+            f.write(floating_type_size.to_bytes(4, "little"))
+            f.write(num_bodies.to_bytes(4, 'little'))
+            for body_state in system_state:
+                write_body_state_into_bin(f, floating_type_sym, body_state)
+        else:
+            dt, iteration, time = metadata if metadata is not None else (
+                0, 0, 0)
+            f.write(BIN_MAGIC)
+            f.write(struct.pack('<IIQIIdQdQ', 2, floating_type_size, num_bodies,
+                                0 if metadata is None else BIN_HAS_METADATA_FLAG, 0, dt, iteration, time, 0))
+            padding = bytes(bin_column_stride(
+                floating_type_size, num_bodies) - floating_type_size * num_bodies)
+            for i_column in range(BIN_NUM_COLUMNS):
+                f.write(struct.pack('<' + floating_type_sym * num_bodies,
+                                    *(body_state[i_column] for body_state in system_state)))
+                f.write(padding)
         print('Info:', 'Wrote into', filename)
 
 
+# /// TRAJECTORY (.traj), see src/core/trajectory.h
+# /// - header, 32 bytes: magic "TUSSTRAJ", u32 version, u32 size of floating type, u64 number of bodies,
+# ///   u32 encoding (0 for RAW, 1 for COMPRESSED), u32 reserved
+# /// - RAW frame records, all of the same size: u64 frame id, then (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
+# /// - COMPRESSED: f64 position quantum, f64 velocity quantum, u32 keyframe interval, u32 bodies per chunk, MASS of each body,
+# ///   then frame records: u64 frame id, u64 size of the rest, u32 number of chunks, u32 size of each chunk, the chunks
+# /// - trailing index, written on close: u64 offset of each frame record, u64 number of frames, u64 index offset, magic "TRAJINDX"
+# /// A file without a valid index, e.g., from a crashed or running simulation, is read up to its last complete frame record.
+TRAJECTORY_MAGIC = b'TUSSTRAJ'
+TRAJECTORY_INDEX_MAGIC = b'TRAJINDX'
+TRAJECTORY_VERSION = 1
+TRAJECTORY_HEADER_SIZE = 32
+TRAJECTORY_FOOTER_SIZE = 24
+TRAJECTORY_ENCODING_RAW = 0
+TRAJECTORY_ENCODING_COMPRESSED = 1
+TRAJECTORY_COMPRESSED_BLOCK_SIZE = 32
+TRAJECTORY_COMPRESSED_COMPONENTS = 6
+
+
+def read_trajectory_compression(f, floating_type_size, num_bodies):
+    '''
+    (position quantum, velocity quantum, keyframe interval, bodies per chunk, [MASS for each body]),
+    or None if the file does not even hold one frame
+    '''
+    f.seek(TRAJECTORY_HEADER_SIZE)
+    block = f.read(24)
+    masses_bytes = f.read(floating_type_size * num_bodies)
+    if len(block) < 24 or len(masses_bytes) < floating_type_size * num_bodies:
+        return None
+    pos_quantum, vel_quantum, keyframe_interval, chunk_size = struct.unpack('<ddII', block)
+    masses = list(struct.unpack(
+        '<' + ('f' if floating_type_size == 4 else 'd') * num_bodies, masses_bytes))
+    return pos_quantum, vel_quantum, keyframe_interval, chunk_size, masses
+
+
+def read_trajectory_layout(f):
+    '''
+    (floating_type_size, num_bodies, [frame record offset for each frame], compression),
+    compression is None for RAW, see read_trajectory_compression otherwise
+    '''
+    f.seek(0, 2)
+    file_size = f.tell()
+    f.seek(0)
+    header = f.read(TRAJECTORY_HEADER_SIZE)
+    assert len(header) == TRAJECTORY_HEADER_SIZE and header[0:8] == TRAJECTORY_MAGIC
+    version, floating_type_size, num_bodies, encoding = struct.unpack(
+        '<IIQI', header[8:28])
+    assert version == TRAJECTORY_VERSION
+    assert floating_type_size == 4 or floating_type_size == 8
+    assert encoding == TRAJECTORY_ENCODING_RAW or encoding == TRAJECTORY_ENCODING_COMPRESSED
+    is_compressed = encoding == TRAJECTORY_ENCODING_COMPRESSED
+    record_size = 8 + floating_type_size * 7 * num_bodies
+
+    compression = None
+    first_record_offset = TRAJECTORY_HEADER_SIZE
+    if is_compressed:
+        compression = read_trajectory_compression(
+            f, floating_type_size, num_bodies)
+        if compression is None:
+            # Not even one frame
+            return floating_type_size, num_bodies, [], None
+        first_record_offset += 24 + floating_type_size * num_bodies
+
+    if file_size >= TRAJECTORY_HEADER_SIZE + TRAJECTORY_FOOTER_SIZE:
+        f.seek(file_size - TRAJECTORY_FOOTER_SIZE)
+        footer = f.read(TRAJECTORY_FOOTER_SIZE)
+        num_frames, index_offset = struct.unpack('<QQ', footer[0:16])
+        if footer[16:24] == TRAJECTORY_INDEX_MAGIC and \
+                (is_compressed or index_offset == TRAJECTORY_HEADER_SIZE + num_frames * record_size) and \
+                index_offset + num_frames * 8 + TRAJECTORY_FOOTER_SIZE == file_size:
+            f.seek(index_offset)
+            frame_offsets = list(struct.unpack(
+                '<' + 'Q' * num_frames, f.read(num_frames * 8)))
+            return floating_type_size, num_bodies, frame_offsets, compression
+
+    # No index, keep every complete frame record
+    if is_compressed:
+        frame_offsets = list()
+        offset = first_record_offset
+        while offset + 16 <= file_size:
+            f.seek(offset)
+            frame_id, size = struct.unpack('<QQ', f.read(16))
+            if frame_id != len(frame_offsets) or size > file_size - offset - 16:
+                break
+            frame_offsets.append(offset)
+            offset += 16 + size
+        return floating_type_size, num_bodies, frame_offsets, compression
+
+    num_frames = (file_size - TRAJECTORY_HEADER_SIZE) // record_size
+    frame_offsets = [TRAJECTORY_HEADER_SIZE + i * record_size
+                     for i in range(num_frames)]
+    return floating_type_size, num_bodies, frame_offsets, None
+
+
+def num_frames_in_trajectory(filename):
+    with open(filename, 'rb') as f:
+        return len(read_trajectory_layout(f)[2])
+
+
+def decode_trajectory_frame(f, num_bodies, chunk_size, prediction_order, quantized):
+    '''
+    Brings quantized = [[q of the last frame], [q of the frame before]] for each component to the frame at f
+    '''
+    _, size = struct.unpack('<QQ', f.read(16))
+    payload = f.read(size)
+    num_chunks = int.from_bytes(payload[0:4], 'little')
+    assert num_chunks == (num_bodies + chunk_size - 1) // chunk_size
+    offset = 4 + 4 * num_chunks
+    for i_chunk in range(num_chunks):
+        chunk_end = min((i_chunk + 1) * chunk_size, num_bodies)
+        for block_begin in range(i_chunk * chunk_size, chunk_end, TRAJECTORY_COMPRESSED_BLOCK_SIZE):
+            n = min(TRAJECTORY_COMPRESSED_BLOCK_SIZE, chunk_end - block_begin)
+            for q1, q2 in quantized:
+                width = payload[offset]
+                num_bytes = (n * width + 7) // 8
+                bits = int.from_bytes(
+                    payload[offset + 1:offset + 1 + num_bytes], 'little')
+                offset += 1 + num_bytes
+                mask = (1 << width) - 1
+                for i in range(block_begin, block_begin + n):
+                    zigzag = bits & mask
+                    bits >>= width
+                    delta = (zigzag >> 1) ^ -(zigzag & 1)
+                    prediction = 0 if prediction_order == 0 else q1[i] if prediction_order == 1 else 2 * q1[i] - q2[i]
+                    q2[i] = q1[i]
+                    q1[i] = prediction + delta
+
+
+def deserialize_system_states_from_trajectory(filename, start_frame=0, num_frames=None):
+    '''
+    [[(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)] for each frame in [start_frame, start_frame + num_frames)],
+    up to the last frame available
+    '''
+    with open(filename, 'rb') as f:
+        floating_type_size, num_bodies, frame_offsets, compression = read_trajectory_layout(
+            f)
+        floating_type_sym = 'f' if floating_type_size == 4 else 'd'
+        end_frame = len(frame_offsets) if num_frames is None else min(
+            len(frame_offsets), start_frame + num_frames)
+        system_states = list()
+        if compression is None:
+            for i in range(start_frame, end_frame):
+                f.seek(frame_offsets[i])
+                frame_id = int.from_bytes(f.read(8), 'little')
+                assert frame_id == i
+                system_states.append([parse_body_state_from_bin(f, floating_type_size, floating_type_sym)
+                                      for _ in range(num_bodies)])
+            return system_states
+
+        # Decode from the keyframe before start_frame
+        pos_quantum, vel_quantum, keyframe_interval, chunk_size, masses = compression
+        quantized = [([0] * num_bodies, [0] * num_bodies)
+                     for _ in range(TRAJECTORY_COMPRESSED_COMPONENTS)]
+        for i in range(start_frame - start_frame % keyframe_interval, end_frame):
+            f.seek(frame_offsets[i])
+            decode_trajectory_frame(f, num_bodies, chunk_size, min(
+                i % keyframe_interval, 2), quantized)
+            if i >= start_frame:
+                quanta = [pos_quantum] * 3 + [vel_quantum] * 3
+                system_states.append([tuple(q1[i_body] * quantum for (q1, _), quantum in zip(quantized, quanta)) + (masses[i_body],)
+                                      for i_body in range(num_bodies)])
+        return system_states
+
+
+def deserialize_system_state_from_trajectory(filename, i):
+    '''
+    [(POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)] of frame i, or None if not available (yet)
+    '''
+    system_states = deserialize_system_states_from_trajectory(filename, i, 1)
+    return system_states[0] if system_states else None
+
+
 def write_body_state_into_csv(f, body_state):
     '''
     (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS)
@@ -12,13 +12,13 @@ def init(parser):
 
     parser_trajectory_still = subparsers.add_parser('trajectory_still')
     parser_trajectory_still.add_argument('dir', type=str,
-                                         help='path to system_states')
+                                         help='path to system_states, a trajectory file or a directory')
     parser_trajectory_still.add_argument('--max_iterations', default=-1, type=int,
                                          help='max number of system_states to read')
 
     parser_trajectory_live = subparsers.add_parser('trajectory_live')
     parser_trajectory_live.add_argument('dir', type=str,
-                                        help='path to system_states')
+                                        help='path to system_states, a trajectory file or a directory')
     parser_trajectory_live.add_argument('--fps', default=200, type=int,
                                         help='number of iterations to plot per second')
     # Add arg to control history of trajectory to keep
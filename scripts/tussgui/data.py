@@ -5,7 +5,23 @@ import numpy as np
 from .. import core
 
 
+def trajectory_file(dir):
+    '''
+    The TRAJECTORY file of dir, which may be one itself, or None for a directory of <i>.bin files
+    '''
+    if os.path.isfile(dir):
+        return dir
+    trajectory_file_path = os.path.join(dir, 'trajectory.traj')
+    if os.path.isfile(trajectory_file_path):
+        return trajectory_file_path
+    return None
+
+
 def read_system_state(dir, i):
+    trajectory_file_path = trajectory_file(dir)
+    if trajectory_file_path is not None:
+        return core.serde.deserialize_system_state_from_trajectory(trajectory_file_path, i)
+
     system_state_bin_file = os.path.join(dir, str(i) + '.bin')
     # print('Reading', system_state_bin_file)
     if os.path.isfile(system_state_bin_file):
@@ -17,8 +33,7 @@ def read_system_state(dir, i):
 
 
 def fetch_system_state(dir, i, sleep_handler=None):
-    system_state_bin_file = os.path.join(dir, str(i) + '.bin')
-    print('Info:', 'Fetching', system_state_bin_file, 'from', dir)
+    print('Info:', 'Fetching', i, 'from', dir)
     system_state_i = None
     # Retry fetching
     retry_count = 0
@@ -54,6 +69,16 @@ def fetch_batch_system_state(dir, start_iteration, trajectory_iteration_batch_si
 
 
 def fetch_batch_system_state_all(dir, max_iterations=-1):
+    trajectory_file_path = trajectory_file(dir)
+    if trajectory_file_path is not None:
+        # One pass over the file instead of one open per frame
+        num_frames = None if max_iterations < 0 else max_iterations
+        system_state_batch = core.serde.deserialize_system_states_from_trajectory(
+            trajectory_file_path, 0, num_frames)
+        print('Info:', 'Found', len(system_state_batch),
+              'frames in', trajectory_file_path)
+        return system_state_batch
+
     num_files = len(core.fileio.files_in_dir(dir))
     print('Info:', 'Found', num_files, 'BIN files')
     if max_iterations >= 0:
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace CORE
+{
+    /// Allocator handing out memory aligned to ALIGNMENT bytes,
+    /// so that SIMD kernels can use aligned loads on the underlying buffer.
+    template <typename T, size_t ALIGNMENT = 64>
+    struct ALIGNED_ALLOCATOR
+    {
+        static_assert(ALIGNMENT >= alignof(T), "ALIGNMENT must be at least alignof(T)");
+        static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0, "ALIGNMENT must be a power of 2");
+
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = ALIGNED_ALLOCATOR<U, ALIGNMENT>;
+        };
+
+        ALIGNED_ALLOCATOR() noexcept = default;
+        template <typename U>
+        ALIGNED_ALLOCATOR(const ALIGNED_ALLOCATOR<U, ALIGNMENT> &) noexcept {}
+
+        T *allocate(size_t n)
+        {
+            // std::aligned_alloc requires the size to be a multiple of the alignment
+            const size_t n_byte = ((n * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+            void *ptr = std::aligned_alloc(ALIGNMENT, n_byte == 0 ? ALIGNMENT : n_byte);
+            if (ptr == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T *>(ptr);
+        }
+
+        void deallocate(T *ptr, size_t) noexcept
+        {
+            std::free(ptr);
+        }
+    };
+
+    template <typename T, typename U, size_t ALIGNMENT>
+    bool operator==(const ALIGNED_ALLOCATOR<T, ALIGNMENT> &, const ALIGNED_ALLOCATOR<U, ALIGNMENT> &) { return true; }
+    template <typename T, typename U, size_t ALIGNMENT>
+    bool operator!=(const ALIGNED_ALLOCATOR<T, ALIGNMENT> &, const ALIGNED_ALLOCATOR<U, ALIGNMENT> &) { return false; }
+
+    /// Use this type
+    template <typename T>
+    using ALIGNED_VECTOR = std::vector<T, ALIGNED_ALLOCATOR<T>>;
+}
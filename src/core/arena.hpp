@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "aligned_allocator.hpp"
+#include "macros.hpp"
+#include "physics.hpp"
+
+namespace CORE
+{
+    /// Bump allocator over one block, for the temporaries of an iteration.
+    /// The block is allocated and touched once, and reset() hands the same memory out again,
+    /// so that steady-state iterations neither page fault nor take the allocator lock.
+    /// Not thread-safe: carve the regions of every thread upfront, see PER_THREAD_SCRATCH.
+    class ARENA
+    {
+    public:
+        /// Every allocation starts on its own cache line
+        static constexpr size_t alignment = 64;
+
+        ARENA() = default;
+        explicit ARENA(size_t capacity) { reserve(capacity); }
+
+        /// Bytes that allocate<T>(n) takes from the arena
+        template <typename T>
+        static size_t footprint(size_t n)
+        {
+            return (n * sizeof(T) + alignment - 1) / alignment * alignment;
+        }
+
+        /// Replaces the block, which invalidates every allocation
+        void reserve(size_t capacity)
+        {
+            block_ = ALIGNED_VECTOR<std::byte>(capacity);
+            size_ = 0;
+        }
+
+        /// n default-initialized values, valid until reset() or reserve()
+        template <typename T>
+        SPAN<T> allocate(size_t n)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "ARENA never destroys what it hands out");
+            static_assert(alignof(T) <= alignment);
+            const size_t n_byte = footprint<T>(n);
+            ASSERT(size_ + n_byte <= block_.size());
+            T *data = reinterpret_cast<T *>(block_.data() + size_);
+            std::uninitialized_default_construct_n(data, n);
+            size_ += n_byte;
+            return {data, n};
+        }
+
+        /// Takes back every allocation, keeping the block
+        void reset() { size_ = 0; }
+
+        size_t size() const { return size_; }
+        size_t capacity() const { return block_.size(); }
+
+    private:
+        ALIGNED_VECTOR<std::byte> block_;
+        size_t size_ = 0;
+    };
+
+    /// One region of n values for each of n_thread threads, carved from an ARENA.
+    /// The regions start on their own cache lines, so that no two threads ever write to the same one.
+    template <typename T>
+    class PER_THREAD_SCRATCH
+    {
+    public:
+        PER_THREAD_SCRATCH() = default;
+        /// Each region is filled with value
+        PER_THREAD_SCRATCH(ARENA &arena, size_t n_thread, size_t n, const T &value = T{})
+        {
+            regions_.reserve(n_thread);
+            for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+            {
+                regions_.push_back(arena.allocate<T>(n));
+                std::fill(regions_.back().begin(), regions_.back().end(), value);
+            }
+        }
+
+        /// Bytes that n_thread regions of n values take from an ARENA
+        static size_t footprint(size_t n_thread, size_t n) { return n_thread * ARENA::footprint<T>(n); }
+
+        SPAN<T> operator[](size_t thread_id) const { return regions_[thread_id]; }
+        size_t n_thread() const { return regions_.size(); }
+
+    private:
+        std::vector<SPAN<T>> regions_;
+    };
+}
@@ -0,0 +1,82 @@
+#include "block_timestep.h"
+#include "macros.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace CORE
+{
+    template <typename T>
+    BLOCK_TIMESTEP_BASE<T>::BLOCK_TIMESTEP_BASE(T dt_max, int max_bin) : dt_max_(dt_max), max_bin_(max_bin)
+    {
+        ASSERT(max_bin_ >= 0 && max_bin_ <= max_max_bin);
+    }
+
+    template <typename T>
+    T BLOCK_TIMESTEP_BASE<T>::dt(int bin) const
+    {
+        // Exact, a power of two apart
+        return std::ldexp(dt_max_, -bin);
+    }
+
+    template <typename T>
+    int BLOCK_TIMESTEP_BASE<T>::bin_of(T dt_wanted) const
+    {
+        // Also takes NaN to the finest bin
+        if (!(dt_wanted > 0))
+        {
+            return max_bin_;
+        }
+        int bin = 0;
+        while (bin < max_bin_ && dt(bin) > dt_wanted)
+        {
+            bin++;
+        }
+        return bin;
+    }
+
+    template <typename T>
+    int BLOCK_TIMESTEP_BASE<T>::next_bin(int bin, int64_t tick, T dt_wanted) const
+    {
+        const int wanted_bin = bin_of(dt_wanted);
+        if (wanted_bin >= bin)
+        {
+            return wanted_bin;
+        }
+        // Coarser, one bin at a time, once synchronized with it
+        return is_active(bin - 1, tick) ? bin - 1 : bin;
+    }
+
+    template <typename T>
+    T aarseth_timestep(T eta, const XYZ_BASE<T> &acc, const XYZ_BASE<T> &jerk)
+    {
+        const T jerk_norm_square = jerk.norm_square();
+        if (jerk_norm_square == 0)
+        {
+            return std::numeric_limits<T>::infinity();
+        }
+        return eta * std::sqrt(acc.norm_square() / jerk_norm_square);
+    }
+
+    template <typename T>
+    T aarseth_timestep(T eta, const XYZ_BASE<T> &acc, const XYZ_BASE<T> &jerk, const XYZ_BASE<T> &snap, const XYZ_BASE<T> &crackle)
+    {
+        const T jerk_norm_square = jerk.norm_square();
+        const T snap_norm_square = snap.norm_square();
+        const T denom = std::sqrt(jerk_norm_square * crackle.norm_square()) + snap_norm_square;
+        if (denom == 0)
+        {
+            return std::numeric_limits<T>::infinity();
+        }
+        return std::sqrt(eta * (std::sqrt(acc.norm_square() * snap_norm_square) + jerk_norm_square) / denom);
+    }
+
+    template class BLOCK_TIMESTEP_BASE<float>;
+    template class BLOCK_TIMESTEP_BASE<double>;
+    template float aarseth_timestep(float, const XYZ_BASE<float> &, const XYZ_BASE<float> &);
+    template double aarseth_timestep(double, const XYZ_BASE<double> &, const XYZ_BASE<double> &);
+    template float aarseth_timestep(float, const XYZ_BASE<float> &, const XYZ_BASE<float> &, const XYZ_BASE<float> &, const XYZ_BASE<float> &);
+    template double aarseth_timestep(double, const XYZ_BASE<double> &, const XYZ_BASE<double> &, const XYZ_BASE<double> &, const XYZ_BASE<double> &);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "xyz.hpp"
+#include "universe.hpp"
+
+namespace CORE
+{
+    /// Hierarchical block time steps, so that each body takes the step it needs instead of the one of the fastest body.
+    /// Bodies are sorted into power-of-two time bins: bin k steps dt_max / 2^k, for k in [0, max_bin].
+    /// Time is counted in ticks of dt_max / 2^max_bin, and a step of bin k always begins on a multiple of its
+    /// n_tick(k) ticks, so that at the end of its step a body is synchronized with every body of a coarser bin.
+    /// One ENGINE iteration covers dt_max, i.e., n_tick() ticks, at the end of which every body is synchronized.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class BLOCK_TIMESTEP_BASE
+    {
+    public:
+        /// So that ticks fit in 32 bits
+        static constexpr int max_max_bin = 30;
+
+        BLOCK_TIMESTEP_BASE(T dt_max, int max_bin);
+
+        int max_bin() const { return max_bin_; }
+        /// Ticks of an iteration
+        int64_t n_tick() const { return int64_t{1} << max_bin_; }
+        /// Ticks of a step of bin
+        int64_t n_tick(int bin) const { return n_tick() >> bin; }
+        /// Step of bin, dt_max / 2^bin
+        T dt(int bin) const;
+
+        /// Whether a body of bin ends a step at tick, and begins the next one
+        bool is_active(int bin, int64_t tick) const { return tick % n_tick(bin) == 0; }
+        /// The first tick after tick that ends a step of bin, i.e., at which the bodies of bin or of a coarser bin are next active
+        int64_t next_tick(int bin, int64_t tick) const { return (tick / n_tick(bin) + 1) * n_tick(bin); }
+
+        /// The coarsest bin whose step is at most dt_wanted, or max_bin if none
+        int bin_of(T dt_wanted) const;
+        /// The bin of the step that a body of bin begins at tick, given the step dt_wanted it asks for:
+        /// any finer bin, but at most one bin coarser, and only if tick begins a step of that bin.
+        int next_bin(int bin, int64_t tick, T dt_wanted) const;
+
+    private:
+        T dt_max_;
+        int max_bin_;
+    };
+
+    /// Aarseth-style time step from the acceleration and its time derivative, the jerk: eta * |acc| / |jerk|,
+    /// the time over which the acceleration changes by a fraction eta of itself.
+    /// Infinite without jerk, i.e., the coarsest bin.
+    template <typename T>
+    T aarseth_timestep(T eta, const XYZ_BASE<T> &acc, const XYZ_BASE<T> &jerk);
+
+    /// The standard Aarseth criterion, from the acceleration and its first three time derivatives, as fourth-order schemes know them
+    /// (see CORE::hermite_correct()): sqrt(eta * (|acc| |snap| + |jerk|^2) / (|jerk| |crackle| + |snap|^2)).
+    /// Its eta is typically around 0.01, for a step that is a fraction sqrt(eta), rather than eta, of the time scale of the acceleration.
+    /// Infinite without any of the derivatives.
+    template <typename T>
+    T aarseth_timestep(T eta, const XYZ_BASE<T> &acc, const XYZ_BASE<T> &jerk, const XYZ_BASE<T> &snap, const XYZ_BASE<T> &crackle);
+
+    /// Use this type
+    using BLOCK_TIMESTEP = BLOCK_TIMESTEP_BASE<UNIVERSE::floating_value_type>;
+
+    extern template class BLOCK_TIMESTEP_BASE<float>;
+    extern template class BLOCK_TIMESTEP_BASE<double>;
+}
@@ -0,0 +1,197 @@
+#include "checkpoint.h"
+#include "macros.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    /// POS, VEL, MASS, ACC, before the engine values
+    constexpr size_t n_value_per_body = 10;
+    /// Bodies staged at once, which bounds the memory beyond the CHECKPOINT itself
+    constexpr size_t n_body_per_chunk = 1 << 16;
+
+    /// Lock-free, so that signal handlers may set it
+    std::atomic<int> checkpoint_request{0};
+    static_assert(std::atomic<int>::is_always_lock_free);
+
+    void handle_checkpoint_signal(int signal)
+    {
+        CORE::CHECKPOINT::request(signal == SIGTERM ? CORE::CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP
+                                                    : CORE::CHECKPOINT::REQUEST::CHECKPOINT);
+    }
+
+    template <typename T>
+    void write_as_binary(std::ostream &os, T value)
+    {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T read_as_binary(std::istream &is)
+    {
+        T value;
+        is.read(reinterpret_cast<char *>(&value), sizeof(T));
+        return value;
+    }
+
+    void write_string(std::ostream &os, const std::string &str)
+    {
+        write_as_binary(os, static_cast<uint32_t>(str.size()));
+        os.write(str.data(), str.size());
+    }
+
+    std::string read_string(std::istream &is)
+    {
+        std::string str(read_as_binary<uint32_t>(is), '\0');
+        is.read(str.data(), str.size());
+        return str;
+    }
+}
+
+namespace CORE
+{
+    namespace CHECKPOINT
+    {
+        void request(REQUEST request)
+        {
+            int pending = checkpoint_request.load();
+            while (pending < static_cast<int>(request) &&
+                   !checkpoint_request.compare_exchange_weak(pending, static_cast<int>(request)))
+            {
+            }
+        }
+
+        REQUEST take_request()
+        {
+            return static_cast<REQUEST>(checkpoint_request.exchange(static_cast<int>(REQUEST::NONE)));
+        }
+
+        void install_signal_handlers()
+        {
+            struct sigaction action = {};
+            action.sa_handler = handle_checkpoint_signal;
+            sigemptyset(&action.sa_mask);
+            // The log writer thread may be in the middle of a write
+            action.sa_flags = SA_RESTART;
+            ASSERT(sigaction(SIGTERM, &action, nullptr) == 0);
+            ASSERT(sigaction(SIGUSR1, &action, nullptr) == 0);
+        }
+    }
+
+    template <typename T>
+    void serialize_checkpoint(const std::string &checkpoint_file_path, const CHECKPOINT_BASE<T> &checkpoint)
+    {
+        const size_t n_body = checkpoint.system_state.size();
+        ASSERT(checkpoint.acc.size() == n_body);
+        ASSERT(checkpoint.engine_values.size() == n_body * checkpoint.n_engine_value);
+        const size_t n_record_value = n_value_per_body + checkpoint.n_engine_value;
+
+        const std::string tmp_file_path = checkpoint_file_path + ".tmp";
+        {
+            std::ofstream ofstream(tmp_file_path, std::ios::binary);
+            if (!ofstream.is_open())
+            {
+                std::cout << "Cannot open " << tmp_file_path << std::endl;
+                ASSERT(false);
+            }
+            ofstream.write(CHECKPOINT::magic, sizeof(CHECKPOINT::magic));
+            write_as_binary(ofstream, CHECKPOINT::version);
+            write_as_binary(ofstream, static_cast<uint32_t>(sizeof(T)));
+            write_as_binary(ofstream, static_cast<uint64_t>(n_body));
+            write_as_binary(ofstream, checkpoint.num_iterations);
+            write_as_binary(ofstream, checkpoint.num_log_frames);
+            write_as_binary(ofstream, static_cast<double>(checkpoint.dt));
+            write_string(ofstream, checkpoint.engine_name);
+            write_string(ofstream, checkpoint.engine_config);
+            write_as_binary(ofstream, checkpoint.n_engine_value);
+
+            std::vector<T> records;
+            records.reserve(n_body_per_chunk * n_record_value);
+            for (size_t chunk_begin = 0; chunk_begin < n_body; chunk_begin += n_body_per_chunk)
+            {
+                records.clear();
+                for (size_t i_body = chunk_begin; i_body < std::min(chunk_begin + n_body_per_chunk, n_body); i_body++)
+                {
+                    const auto [p, v, m] = checkpoint.system_state.body(i_body);
+                    const ACC_BASE<T> &a = checkpoint.acc[i_body];
+                    records.insert(records.end(), {p.x, p.y, p.z, v.x, v.y, v.z, m, a.x, a.y, a.z});
+                    const auto engine_values_begin = checkpoint.engine_values.begin() + i_body * checkpoint.n_engine_value;
+                    records.insert(records.end(), engine_values_begin, engine_values_begin + checkpoint.n_engine_value);
+                }
+                ofstream.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+            }
+            ofstream.close();
+            ASSERT(ofstream);
+        }
+        // The previous checkpoint stays whole until replaced at once
+        ASSERT(std::rename(tmp_file_path.c_str(), checkpoint_file_path.c_str()) == 0);
+    }
+
+    template <typename T>
+    CHECKPOINT_BASE<T> deserialize_checkpoint(const std::string &checkpoint_file_path)
+    {
+        std::ifstream ifstream(checkpoint_file_path, std::ios::binary);
+        if (!ifstream.is_open())
+        {
+            std::cout << "Cannot open " << checkpoint_file_path << std::endl;
+            ASSERT(false);
+        }
+        char magic[sizeof(CHECKPOINT::magic)];
+        ifstream.read(magic, sizeof(magic));
+        ASSERT(ifstream && std::memcmp(magic, CHECKPOINT::magic, sizeof(magic)) == 0);
+        const uint32_t version = read_as_binary<uint32_t>(ifstream);
+        ASSERT(version == 1 || version == CHECKPOINT::version);
+        const uint32_t floating_value_size = read_as_binary<uint32_t>(ifstream);
+        if (floating_value_size != sizeof(T))
+        {
+            std::cout << checkpoint_file_path << " has " << floating_value_size << "-byte floating values, "
+                      << sizeof(T) << "-byte expected" << std::endl;
+            ASSERT(false);
+        }
+
+        CHECKPOINT_BASE<T> checkpoint;
+        const uint64_t n_body = read_as_binary<uint64_t>(ifstream);
+        checkpoint.num_iterations = read_as_binary<uint64_t>(ifstream);
+        checkpoint.num_log_frames = read_as_binary<uint64_t>(ifstream);
+        checkpoint.dt = static_cast<T>(read_as_binary<double>(ifstream));
+        checkpoint.engine_name = read_string(ifstream);
+        checkpoint.engine_config = read_string(ifstream);
+        checkpoint.n_engine_value = version >= 2 ? read_as_binary<uint32_t>(ifstream) : 0;
+        ASSERT(ifstream);
+        const size_t n_record_value = n_value_per_body + checkpoint.n_engine_value;
+
+        checkpoint.system_state.resize(n_body);
+        checkpoint.acc.reserve(n_body);
+        checkpoint.engine_values.reserve(n_body * checkpoint.n_engine_value);
+        std::vector<T> records;
+        for (uint64_t chunk_begin = 0; chunk_begin < n_body; chunk_begin += n_body_per_chunk)
+        {
+            const size_t n_chunk_body = std::min<uint64_t>(n_body_per_chunk, n_body - chunk_begin);
+            records.resize(n_chunk_body * n_record_value);
+            ifstream.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(T));
+            ASSERT(ifstream);
+            for (size_t i_chunk_body = 0; i_chunk_body < n_chunk_body; i_chunk_body++)
+            {
+                const T *values = records.data() + i_chunk_body * n_record_value;
+                for (size_t i_column = 0; i_column < SOA_SYSTEM_STATE_BASE<T>::n_column; i_column++)
+                {
+                    checkpoint.system_state.column(i_column)[chunk_begin + i_chunk_body] = values[i_column];
+                }
+                checkpoint.acc.push_back({values[7], values[8], values[9]});
+                checkpoint.engine_values.insert(checkpoint.engine_values.end(), values + n_value_per_body, values + n_record_value);
+            }
+        }
+        return checkpoint;
+    }
+
+    template void serialize_checkpoint<float>(const std::string &, const CHECKPOINT_BASE<float> &);
+    template void serialize_checkpoint<double>(const std::string &, const CHECKPOINT_BASE<double> &);
+    template CHECKPOINT_BASE<float> deserialize_checkpoint<float>(const std::string &);
+    template CHECKPOINT_BASE<double> deserialize_checkpoint<double>(const std::string &);
+}
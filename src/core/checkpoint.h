@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "physics.hpp"
+
+namespace CORE
+{
+    /// CHECKPOINT (.ckpt), everything an ENGINE needs to continue a run bit-exactly, little-endian
+    /// - header:
+    ///   - 8 bytes: magic "TUSSCKPT"
+    ///   - 4 bytes: version (2)
+    ///   - 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
+    ///   - 8 bytes: number of bodies
+    ///   - 8 bytes: number of iterations since the ic
+    ///   - 8 bytes: number of frames in the SYSTEM_STATE log
+    ///   - 8 bytes: dt (double)
+    ///   - 4 bytes: length of the engine name, then the engine name
+    ///   - 4 bytes: length of the engine config, then the engine config
+    ///   - 4 bytes: number of engine values per body (since version 2, none in version 1)
+    /// - (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS, ACC.x,ACC.y,ACC.z, engine values) for each body
+    /// Version 1 files are still read.
+    namespace CHECKPOINT
+    {
+        constexpr char magic[8] = {'T', 'U', 'S', 'S', 'C', 'K', 'P', 'T'};
+        constexpr uint32_t version = 2;
+
+        enum class REQUEST : int
+        {
+            NONE = 0,
+            /// Checkpoint after the current iteration
+            CHECKPOINT,
+            /// Checkpoint after the current iteration, and stop the run
+            CHECKPOINT_AND_STOP
+        };
+
+        /// Async-signal-safe, keeps the strongest request until taken
+        void request(REQUEST request);
+        /// The pending request, NONE afterwards
+        REQUEST take_request();
+        /// SIGUSR1 requests CHECKPOINT, SIGTERM requests CHECKPOINT_AND_STOP
+        void install_signal_handlers();
+    }
+
+    /// The state of an ENGINE between two iterations.
+    /// ACC is the acceleration of the SYSTEM_STATE, which spares its computation on resume.
+    template <typename T>
+    struct CHECKPOINT_BASE
+    {
+        /// ENGINE::name(), a resumed engine must have the same
+        std::string engine_name;
+        /// Settings beyond the name which the result depends on
+        std::string engine_config;
+        T dt = 0;
+        uint64_t num_iterations = 0;
+        uint64_t num_log_frames = 0;
+        SOA_SYSTEM_STATE_BASE<T> system_state;
+        std::vector<ACC_BASE<T>> acc;
+        /// What else the engine needs per body, n_engine_value values for each body in a row,
+        /// e.g., the jerk and the time bin of block time steps
+        uint32_t n_engine_value = 0;
+        std::vector<T> engine_values;
+    };
+
+    /// Written next to checkpoint_file_path then renamed over it, so that the file is always a complete checkpoint
+    template <typename T>
+    void serialize_checkpoint(const std::string &checkpoint_file_path, const CHECKPOINT_BASE<T> &checkpoint);
+    /// The floating type of the file must be T, nothing is cast
+    template <typename T = UNIVERSE::floating_value_type>
+    CHECKPOINT_BASE<T> deserialize_checkpoint(const std::string &checkpoint_file_path);
+}
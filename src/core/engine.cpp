@@ -3,64 +3,193 @@
 
 namespace CORE
 {
-    ENGINE::ENGINE(
-        CORE::SYSTEM_STATE system_state_ic,
-        CORE::DT dt,
+    template <typename T>
+    ENGINE_BASE<T>::ENGINE_BASE(
+        system_state_type system_state_ic,
+        T dt,
         std::optional<std::string> system_state_log_dir_opt) : system_state_snapshot_(std::move(system_state_ic)),
-                                                               dt_(dt),
-                                                               system_state_log_dir_opt_(std::move(system_state_log_dir_opt))
+                                                               dt_(dt)
     {
         std::cout << "Dumping System State Logs to "
-                  << (system_state_log_dir_opt_ ? *system_state_log_dir_opt_ : std::string("null")) << std::endl;
+                  << (system_state_log_dir_opt ? *system_state_log_dir_opt : std::string("null")) << std::endl;
+        if (system_state_log_dir_opt)
+        {
+            system_state_log_writer_ = std::make_unique<SYSTEM_STATE_LOG_WRITER<T>>(std::move(*system_state_log_dir_opt));
+        }
     }
 
-    ENGINE::~ENGINE()
-    {
-        serialize_system_state_log();
-    }
+    template <typename T>
+    ENGINE_BASE<T>::~ENGINE_BASE() = default;
 
-    const CORE::SYSTEM_STATE &ENGINE::run(int n_iter)
+    template <typename T>
+    void ENGINE_BASE<T>::run(int n_iter)
     {
+        is_stopped_ = false;
         auto runner = [n_iter, this]()
         {
             std::cout << name() << ": Running " << system_state_snapshot().size() << " bodies, " << dt() << " dt, " << n_iter << " iterations" << std::endl;
             TIMER timer(name());
             return execute(n_iter, timer);
         };
-        set_system_state_snapshot(runner());
-        return system_state_snapshot();
+        std::optional<system_state_type> system_state_opt = runner();
+        is_system_state_snapshot_stale_ = !system_state_opt;
+        if (system_state_opt)
+        {
+            set_system_state_snapshot(std::move(*system_state_opt));
+        }
+        const int n_iter_done = is_stopped_ ? num_stopped_run_iterations_ : n_iter;
+        num_iterations_ += n_iter_done;
+        if (!is_counting_force_evaluations_)
+        {
+            num_force_evaluations_ += static_cast<uint64_t>(n_iter_done) * system_state_snapshot_.size();
+        }
+        resumed_acceleration_opt_.reset();
+        resumed_engine_values_opt_.reset();
+        // The log is complete once run() returns
+        if (is_system_state_logging_enabled())
+        {
+            system_state_log_writer_->flush();
+        }
     }
 
-    void ENGINE::push_system_state_to_log(CORE::SYSTEM_STATE system_state)
+    template <typename T>
+    const typename ENGINE_BASE<T>::system_state_type &ENGINE_BASE<T>::system_state()
     {
-        if (!is_system_state_logging_enabled())
+        if (is_system_state_snapshot_stale_)
         {
-            return;
+            materialize_system_state(system_state_snapshot_);
+            is_system_state_snapshot_stale_ = false;
         }
-        system_state_log_.emplace_back(std::move(system_state));
+        return system_state_snapshot_;
     }
 
-    void ENGINE::serialize_system_state_log()
+    template <typename T>
+    void ENGINE_BASE<T>::set_system_state_log_memory_budget(size_t memory_budget)
+    {
+        if (is_system_state_logging_enabled())
+        {
+            system_state_log_writer_->set_memory_budget(memory_budget);
+        }
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::set_system_state_log_compression(TRAJECTORY::COMPRESSION compression)
+    {
+        if (is_system_state_logging_enabled())
+        {
+            system_state_log_writer_->set_compression(compression);
+        }
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::set_integrator(INTEGRATOR integrator)
+    {
+        if (!supports_integrator(integrator))
+        {
+            std::cout << name() << " does not step with " << integrator.name() << std::endl;
+            ASSERT(false);
+        }
+        integrator_ = std::move(integrator);
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::set_checkpoint(std::string checkpoint_file_path, int checkpoint_interval)
+    {
+        ASSERT(checkpoint_interval >= 0);
+        checkpoint_file_path_opt_ = std::move(checkpoint_file_path);
+        checkpoint_interval_ = checkpoint_interval;
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::resume(CHECKPOINT_BASE<T> checkpoint)
+    {
+        if (checkpoint.engine_name != name())
+        {
+            std::cout << "Checkpoint of " << checkpoint.engine_name << " cannot resume " << name() << std::endl;
+            ASSERT(false);
+        }
+        ASSERT(checkpoint.dt == dt_);
+        ASSERT(checkpoint.acc.size() == system_state_snapshot_.size());
+        if (checkpoint.engine_config != config_)
+        {
+            std::cout << "Warning: checkpoint config \"" << checkpoint.engine_config << "\" differs from \"" << config_
+                      << "\", the run will not continue bit-exactly" << std::endl;
+        }
+        num_iterations_ = checkpoint.num_iterations;
+        resumed_acceleration_opt_ = std::move(checkpoint.acc);
+        ASSERT(checkpoint.engine_values.size() == checkpoint.n_engine_value * system_state_snapshot_.size());
+        resumed_engine_values_opt_ = std::move(checkpoint.engine_values);
+        if (is_system_state_logging_enabled())
+        {
+            system_state_log_writer_->keep_frames(static_cast<int>(checkpoint.num_log_frames));
+        }
+    }
+
+    template <typename T>
+    CHECKPOINT::REQUEST ENGINE_BASE<T>::take_checkpoint_request(int i_iter)
+    {
+        if (!checkpoint_file_path_opt_)
+        {
+            return CHECKPOINT::REQUEST::NONE;
+        }
+        const CHECKPOINT::REQUEST request = CHECKPOINT::take_request();
+        if (request != CHECKPOINT::REQUEST::NONE)
+        {
+            return request;
+        }
+        // Counted from the ic, so that a resumed run keeps the same checkpoints
+        const uint64_t i_iteration = num_iterations_ + i_iter + 1;
+        const bool is_due = checkpoint_interval_ > 0 && i_iteration % checkpoint_interval_ == 0;
+        return is_due ? CHECKPOINT::REQUEST::CHECKPOINT : CHECKPOINT::REQUEST::NONE;
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::write_checkpoint(int i_iter, CHECKPOINT_BASE<T> checkpoint)
+    {
+        // Every frame the checkpoint counts is on disk before it
+        if (is_system_state_logging_enabled())
+        {
+            system_state_log_writer_->flush();
+        }
+        checkpoint.engine_name = name();
+        checkpoint.engine_config = config_;
+        checkpoint.dt = dt_;
+        checkpoint.num_iterations = num_iterations_ + i_iter + 1;
+        checkpoint.num_log_frames = num_logged_iterations();
+        serialize_checkpoint(*checkpoint_file_path_opt_, checkpoint);
+        std::cout << "Checkpointed iteration " << checkpoint.num_iterations << " to " << *checkpoint_file_path_opt_ << std::endl;
+    }
+
+    template <typename T>
+    void ENGINE_BASE<T>::push_system_state_to_log(system_state_type system_state)
     {
         if (!is_system_state_logging_enabled())
         {
             return;
         }
+        // Goes through acquire_frame() for the memory budget, the recycled frame is dropped instead of system_state
+        system_state_type frame = system_state_log_writer_->acquire_frame(system_state.size());
+        std::swap(frame, system_state);
+        system_state_log_writer_->push(std::move(frame));
+    }
 
-        for (unsigned i = 0; i < system_state_log_.size(); i++)
+    template <typename T>
+    void ENGINE_BASE<T>::serialize_system_state_log()
+    {
+        if (!is_system_state_logging_enabled())
         {
-            unsigned system_state_log_id = i + num_system_state_log_popped_;
-            std::string filename = *system_state_log_dir_opt_ + "/" + std::to_string(system_state_log_id) + ".bin";
-            CORE::serialize_system_state_to_bin(filename, system_state_log_[i]);
+            return;
         }
-
-        // Clear the log
-        num_system_state_log_popped_ += system_state_log_.size();
-        system_state_log_.clear();
+        // Frames are already queued by push_system_state_to_log
+        system_state_log_writer_->check_write_failure();
     }
 
-    int ENGINE::num_logged_iterations() const
+    template <typename T>
+    int ENGINE_BASE<T>::num_logged_iterations() const
     {
-        return num_system_state_log_popped_ + system_state_log_.size();
+        return is_system_state_logging_enabled() ? system_state_log_writer_->num_pushed_frames() : 0;
     }
-}
\ No newline at end of file
+
+    template class ENGINE_BASE<float>;
+    template class ENGINE_BASE<double>;
+}
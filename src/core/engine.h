@@ -3,56 +3,200 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <memory>
+#include <type_traits>
 #include "physics.hpp"
 #include "timer.h"
+#include "system_state_log_writer.h"
+#include "checkpoint.h"
+#include "integrator.h"
 
 namespace CORE
 {
     /// Interface
-    class ENGINE
+    /// T: floating type of the SYSTEM_STATE, instantiated for float and double
+    /// SYSTEM_STATEs go in, out and to the log as SOA_SYSTEM_STATE_BASE, which engines copy column by column
+    template <typename T>
+    class ENGINE_BASE
     {
     public:
-        ENGINE(CORE::SYSTEM_STATE system_state_ic, CORE::DT dt, std::optional<std::string> system_state_log_dir_opt = {});
-        virtual ~ENGINE() = 0;
+        using system_state_type = SOA_SYSTEM_STATE_BASE<T>;
+
+        ENGINE_BASE(system_state_type system_state_ic, T dt, std::optional<std::string> system_state_log_dir_opt = {});
+        virtual ~ENGINE_BASE() = 0;
 
         /// To be defined
         virtual std::string name() = 0;
 
     protected:
         /// To be defined
-        /// Continues execution from previous SYSTEM_STATE
-        virtual CORE::SYSTEM_STATE execute(int n_iter, TIMER &timer) = 0;
+        /// Continues execution from previous SYSTEM_STATE.
+        /// Returns the SYSTEM_STATE reached, or nullopt if the engine keeps it in its own buffers (warm start):
+        /// the next execute() then continues from them, and materialize_system_state() is only called when it is read.
+        virtual std::optional<system_state_type> execute(int n_iter, TIMER &timer) = 0;
+        /// To be defined
+        /// Overwrites system_state with the SYSTEM_STATE reached by the last execute(), reusing its memory.
+        /// Only called after an execute() which returned nullopt.
+        virtual void materialize_system_state(system_state_type &system_state) = 0;
+        /// Whether execute() moves the bodies as integrator orders them.
+        /// Kick-drift-kick leapfrog only, unless overridden by an engine that steps with any CORE::INTEGRATOR
+        virtual bool supports_integrator(const INTEGRATOR &integrator) const { return integrator.scheme() == INTEGRATOR::SCHEME::LEAPFROG_KDK; }
 
     public:
         // Main entrance
-        virtual const CORE::SYSTEM_STATE &run(int n_iter) final;
+        // Warm-started engines continue where the previous run() left off, without copying the SYSTEM_STATE in or out
+        virtual void run(int n_iter) final;
+        /// The SYSTEM_STATE reached by the last run(), or the ic before any, materialized on the first read after run()
+        const system_state_type &system_state();
+
+        /// Memory for the SYSTEM_STATE log frames not yet written (see SYSTEM_STATE_LOG_WRITER)
+        void set_system_state_log_memory_budget(size_t memory_budget);
+        /// Lossy compression of the SYSTEM_STATE log, to be set before run()
+        void set_system_state_log_compression(TRAJECTORY::COMPRESSION compression);
+
+        /// How the engine moves the bodies from its accelerations, kick-drift-kick leapfrog by default.
+        /// Engines that integrate in their own way (e.g., with block time steps) only take the default, and throw on any other,
+        /// see supports_integrator(). To be set before run().
+        void set_integrator(INTEGRATOR integrator);
+        const INTEGRATOR &integrator() const { return integrator_; }
+
+        /// Settings beyond name() which the result depends on, recorded in checkpoints and compared on resume()
+        void set_config(std::string config) { config_ = std::move(config); }
+        /// Checkpoints into checkpoint_file_path every checkpoint_interval iterations (never if 0),
+        /// and whenever CHECKPOINT::request() is called, e.g., from a signal handler
+        void set_checkpoint(std::string checkpoint_file_path, int checkpoint_interval);
+        /// Continues from checkpoint instead of from the ic, as if the run that wrote it had gone on.
+        /// The engine is expected to be constructed with checkpoint.system_state as its ic, which is not read again.
+        /// The SYSTEM_STATE log, if any, goes on after the frames the checkpoint counts. To be called before run().
+        void resume(CHECKPOINT_BASE<T> checkpoint);
+
+        /// Since the ic, over every run() and the checkpoint resumed from, if any
+        uint64_t num_iterations() const { return num_iterations_; }
+        /// Accelerations of a body evaluated over every run() of this ENGINE, the ic excluded:
+        /// n_body per iteration, unless execute() counts fewer with count_force_evaluations(), e.g., with block time steps
+        uint64_t num_force_evaluations() const { return num_force_evaluations_; }
+        /// Whether the last run() stopped early on CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP,
+        /// with the SYSTEM_STATE of the iteration checkpointed
+        bool is_stopped() const { return is_stopped_; }
 
     protected:
-        const CORE::SYSTEM_STATE &system_state_snapshot() const { return system_state_snapshot_; }
-        CORE::DT dt() const { return dt_; }
+        /// The ic for the first execute(), stale afterwards for warm-started engines, which only read it once
+        const system_state_type &system_state_snapshot() const { return system_state_snapshot_; }
+        T dt() const { return dt_; }
 
-        bool is_system_state_logging_enabled() const { return system_state_log_dir_opt_.has_value(); }
-        // P signature: CORE::SYSTEM_STATE system_state_producer()
+        /// The log is written by a background SYSTEM_STATE_LOG_WRITER, frames are handed to it as they are pushed
+        bool is_system_state_logging_enabled() const { return system_state_log_writer_ != nullptr; }
+        // P signature: system_state_type system_state_producer(),
+        // or void system_state_producer(system_state_type &) to fill a recycled frame, which avoids an allocation
         template <typename P>
         void push_system_state_to_log(P system_state_producer)
         {
-            if (is_system_state_logging_enabled())
+            if (!is_system_state_logging_enabled())
+                return;
+            if constexpr (std::is_invocable_v<P, system_state_type &>)
+            {
+                system_state_type system_state = system_state_log_writer_->acquire_frame(system_state_snapshot_.size());
+                system_state_producer(system_state);
+                system_state_log_writer_->push(std::move(system_state));
+            }
+            else
+            {
                 push_system_state_to_log(system_state_producer());
+            }
         }
-        void push_system_state_to_log(CORE::SYSTEM_STATE system_state);
+        void push_system_state_to_log(system_state_type system_state);
+        /// Does not wait for the writes, only reports a failed one
         void serialize_system_state_log();
 
         int num_logged_iterations() const;
 
+        /// The acceleration of system_state_snapshot() while resuming from a checkpoint,
+        /// to be taken by execute() instead of being computed
+        const std::optional<std::vector<ACC_BASE<T>>> &resumed_acceleration() const { return resumed_acceleration_opt_; }
+        /// The CHECKPOINT_BASE::engine_values of the checkpoint resumed from, with the acceleration
+        const std::optional<std::vector<T>> &resumed_engine_values() const { return resumed_engine_values_opt_; }
+
+        /// For engines that evaluate the acceleration of only some bodies per iteration, see num_force_evaluations()
+        void count_force_evaluations(uint64_t n_body)
+        {
+            num_force_evaluations_ += n_body;
+            is_counting_force_evaluations_ = true;
+        }
+
+        bool is_checkpointing_enabled() const { return checkpoint_file_path_opt_.has_value(); }
+        /// To be called by execute() at the end of iteration i_iter, once its SYSTEM_STATE is logged.
+        /// Collective engines call it on one thread, and share the result.
+        CHECKPOINT::REQUEST take_checkpoint_request(int i_iter);
+        /// Checkpoints the end of iteration i_iter as requested,
+        /// then returns whether execute() is to stop and return the SYSTEM_STATE of iteration i_iter.
+        // P signature: void checkpoint_producer(system_state_type &system_state, std::vector<ACC_BASE<T>> &acc),
+        // or void checkpoint_producer(system_state_type &, std::vector<ACC_BASE<T>> &, std::vector<T> &engine_values)
+        // for n_engine_value values per body (see CHECKPOINT_BASE)
+        template <typename P>
+        bool checkpoint(int i_iter, CHECKPOINT::REQUEST request, P checkpoint_producer)
+        {
+            if (request == CHECKPOINT::REQUEST::NONE)
+            {
+                return false;
+            }
+            CHECKPOINT_BASE<T> checkpoint;
+            if constexpr (std::is_invocable_v<P, system_state_type &, std::vector<ACC_BASE<T>> &, std::vector<T> &>)
+            {
+                checkpoint_producer(checkpoint.system_state, checkpoint.acc, checkpoint.engine_values);
+                const size_t n_body = checkpoint.system_state.size();
+                checkpoint.n_engine_value = n_body > 0 ? static_cast<uint32_t>(checkpoint.engine_values.size() / n_body) : 0;
+            }
+            else
+            {
+                checkpoint_producer(checkpoint.system_state, checkpoint.acc);
+            }
+            write_checkpoint(i_iter, std::move(checkpoint));
+            if (request != CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP)
+            {
+                return false;
+            }
+            is_stopped_ = true;
+            num_stopped_run_iterations_ = i_iter + 1;
+            return true;
+        }
+        /// take_checkpoint_request() then checkpoint()
+        template <typename P>
+        bool checkpoint_if_due(int i_iter, P checkpoint_producer)
+        {
+            return checkpoint(i_iter, take_checkpoint_request(i_iter), std::move(checkpoint_producer));
+        }
+
     private:
-        void set_system_state_snapshot(CORE::SYSTEM_STATE system_state_snapshot) { system_state_snapshot_ = std::move(system_state_snapshot); }
+        void write_checkpoint(int i_iter, CHECKPOINT_BASE<T> checkpoint);
+        void set_system_state_snapshot(system_state_type system_state_snapshot) { system_state_snapshot_ = std::move(system_state_snapshot); }
 
     private:
-        CORE::SYSTEM_STATE system_state_snapshot_;
-        CORE::DT dt_;
+        /// The ic, then the SYSTEM_STATE of the last run(), unless stale
+        system_state_type system_state_snapshot_;
+        /// Whether the last execute() kept its SYSTEM_STATE, not yet materialized into system_state_snapshot_
+        bool is_system_state_snapshot_stale_ = false;
+        T dt_;
+
+        std::unique_ptr<SYSTEM_STATE_LOG_WRITER<T>> system_state_log_writer_;
 
-        std::optional<std::string> system_state_log_dir_opt_;
-        std::vector<CORE::SYSTEM_STATE> system_state_log_;
-        int num_system_state_log_popped_ = 0;
+        INTEGRATOR integrator_;
+        std::string config_;
+        std::optional<std::string> checkpoint_file_path_opt_;
+        int checkpoint_interval_ = 0;
+        uint64_t num_iterations_ = 0;
+        std::optional<std::vector<ACC_BASE<T>>> resumed_acceleration_opt_;
+        std::optional<std::vector<T>> resumed_engine_values_opt_;
+        uint64_t num_force_evaluations_ = 0;
+        /// Whether execute() counts its force evaluations itself
+        bool is_counting_force_evaluations_ = false;
+        bool is_stopped_ = false;
+        /// Iterations done by the last run() when stopped early
+        int num_stopped_run_iterations_ = 0;
     };
+
+    /// Use this type
+    using ENGINE = ENGINE_BASE<UNIVERSE::floating_value_type>;
+
+    extern template class ENGINE_BASE<float>;
+    extern template class ENGINE_BASE<double>;
 }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "physics.hpp"
+#include "xyz.hpp"
+
+namespace CORE
+{
+    /// The fourth-order Hermite scheme, which takes a body over a step from its acceleration and jerk at both ends,
+    /// e.g., as computed by gravity_and_jerk(): predicted to the end by its Taylor series to third order,
+    /// then corrected with the acceleration and jerk there. It is exact as long as the acceleration is a quadratic in time,
+    /// the velocity even for a cubic one, whereas leapfrog is exact for a constant acceleration only.
+
+    /// pos and vel of a body, dt after it had pos, vel, acc and jerk, to third and second order
+    template <typename T>
+    void hermite_predict(const POS_BASE<T> &pos, const VEL_BASE<T> &vel, const ACC_BASE<T> &acc, const XYZ_BASE<T> &jerk, T dt,
+                         POS_BASE<T> &pos_predicted, VEL_BASE<T> &vel_predicted)
+    {
+        const T dt2_2 = dt * dt / 2;
+        const T dt3_6 = dt2_2 * dt / 3;
+        pos_predicted = {pos + dt * vel + dt2_2 * acc + dt3_6 * jerk};
+        vel_predicted = {vel + dt * acc + dt2_2 * jerk};
+    }
+
+    /// A body at the end of a step, along with the second and third time derivatives of its acceleration there
+    template <typename T>
+    struct HERMITE_CORRECTED_BASE
+    {
+        POS_BASE<T> pos;
+        VEL_BASE<T> vel;
+        XYZ_BASE<T> snap;
+        XYZ_BASE<T> crackle;
+    };
+
+    /// The body that had pos_begin, vel_begin, acc_begin and jerk_begin, dt later, where its acceleration and jerk are acc_end and jerk_end
+    template <typename T>
+    HERMITE_CORRECTED_BASE<T> hermite_correct(const POS_BASE<T> &pos_begin, const VEL_BASE<T> &vel_begin,
+                                              const ACC_BASE<T> &acc_begin, const XYZ_BASE<T> &jerk_begin,
+                                              const ACC_BASE<T> &acc_end, const XYZ_BASE<T> &jerk_end, T dt)
+    {
+        const XYZ_BASE<T> acc_diff = acc_begin - acc_end;
+        const T dt_2 = dt / 2;
+        const T dt2_12 = dt * dt / 12;
+        HERMITE_CORRECTED_BASE<T> corrected;
+        corrected.vel = {vel_begin + dt_2 * (acc_begin + acc_end) + dt2_12 * (jerk_begin - jerk_end)};
+        corrected.pos = {pos_begin + dt_2 * (vel_begin + corrected.vel) + dt2_12 * acc_diff};
+
+        // The cubic through both ends, its snap at the beginning moved to the end
+        const T inv_dt = 1 / dt;
+        const T inv_dt2 = inv_dt * inv_dt;
+        const XYZ_BASE<T> snap_begin = -inv_dt2 * (static_cast<T>(6) * acc_diff + dt * (static_cast<T>(4) * jerk_begin + static_cast<T>(2) * jerk_end));
+        corrected.crackle = inv_dt2 * inv_dt * (static_cast<T>(12) * acc_diff + static_cast<T>(6) * dt * (jerk_begin + jerk_end));
+        corrected.snap = snap_begin + dt * corrected.crackle;
+        return corrected;
+    }
+
+    using HERMITE_CORRECTED = HERMITE_CORRECTED_BASE<UNIVERSE::floating_value_type>;
+}
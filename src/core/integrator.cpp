@@ -0,0 +1,134 @@
+#include "integrator.h"
+#include "macros.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace CORE
+{
+    namespace
+    {
+        /// Leapfrogs of weights[0] dt, weights[1] dt, ..., kick-drift-kick, with the kicks between two of them merged
+        void compose_kdk(const std::vector<double> &weights, std::vector<double> &drift_coefficients, std::vector<double> &kick_coefficients)
+        {
+            drift_coefficients = {0};
+            kick_coefficients = {weights.front() / 2};
+            for (size_t i_weight = 0; i_weight < weights.size(); i_weight++)
+            {
+                drift_coefficients.push_back(weights[i_weight]);
+                kick_coefficients.push_back((weights[i_weight] + (i_weight + 1 < weights.size() ? weights[i_weight + 1] : 0)) / 2);
+            }
+            drift_coefficients.push_back(0);
+        }
+
+        /// The same, drift-kick-drift, with the drifts between two of them merged
+        void compose_dkd(const std::vector<double> &weights, std::vector<double> &drift_coefficients, std::vector<double> &kick_coefficients)
+        {
+            drift_coefficients = {weights.front() / 2};
+            kick_coefficients.clear();
+            for (size_t i_weight = 0; i_weight < weights.size(); i_weight++)
+            {
+                kick_coefficients.push_back(weights[i_weight]);
+                drift_coefficients.push_back((weights[i_weight] + (i_weight + 1 < weights.size() ? weights[i_weight + 1] : 0)) / 2);
+            }
+        }
+
+        /// Steps of w, 1 - 2w and w, which cancel the third-order error of a symmetric second-order step
+        std::vector<double> triple_jump_weights()
+        {
+            const double w = 1 / (2 - std::cbrt(2.0));
+            return {w, 1 - 2 * w, w};
+        }
+    }
+
+    INTEGRATOR::INTEGRATOR(SCHEME scheme) : scheme_(scheme)
+    {
+        switch (scheme_)
+        {
+        case SCHEME::LEAPFROG_KDK:
+            order_ = 2;
+            compose_kdk({1}, drift_coefficients_, kick_coefficients_);
+            break;
+        case SCHEME::LEAPFROG_DKD:
+            order_ = 2;
+            compose_dkd({1}, drift_coefficients_, kick_coefficients_);
+            break;
+        case SCHEME::FOREST_RUTH:
+            order_ = 4;
+            compose_dkd(triple_jump_weights(), drift_coefficients_, kick_coefficients_);
+            break;
+        case SCHEME::YOSHIDA4:
+            order_ = 4;
+            compose_kdk(triple_jump_weights(), drift_coefficients_, kick_coefficients_);
+            break;
+        case SCHEME::YOSHIDA6:
+        {
+            // Yoshida (1990), Table 1, solution A
+            order_ = 6;
+            const double w1 = -1.17767998417887;
+            const double w2 = 0.235573213359357;
+            const double w3 = 0.784513610477560;
+            const double w0 = 1 - 2 * (w1 + w2 + w3);
+            compose_kdk({w3, w2, w1, w0, w1, w2, w3}, drift_coefficients_, kick_coefficients_);
+            break;
+        }
+        case SCHEME::PEFRL:
+        {
+            // Omelyan, Mryglod and Folk (2002), eq. (20)
+            order_ = 4;
+            const double xi = 0.1786178958448091;
+            const double lambda = -0.2123418310626054;
+            const double chi = -0.06626458266981849;
+            drift_coefficients_ = {xi, chi, 1 - 2 * (chi + xi), chi, xi};
+            kick_coefficients_ = {(1 - 2 * lambda) / 2, lambda, lambda, (1 - 2 * lambda) / 2};
+            break;
+        }
+        default:
+            ASSERT(false);
+        }
+    }
+
+    std::optional<INTEGRATOR> INTEGRATOR::from_name(const std::string &name)
+    {
+        for (const SCHEME scheme : {SCHEME::LEAPFROG_KDK, SCHEME::LEAPFROG_DKD, SCHEME::FOREST_RUTH, SCHEME::YOSHIDA4, SCHEME::YOSHIDA6, SCHEME::PEFRL})
+        {
+            if (name == to_string(scheme))
+            {
+                return INTEGRATOR(scheme);
+            }
+        }
+        return std::nullopt;
+    }
+
+    const char *INTEGRATOR::to_string(SCHEME scheme)
+    {
+        switch (scheme)
+        {
+        case SCHEME::LEAPFROG_KDK:
+            return "kdk";
+        case SCHEME::LEAPFROG_DKD:
+            return "dkd";
+        case SCHEME::FOREST_RUTH:
+            return "forest_ruth";
+        case SCHEME::YOSHIDA4:
+            return "yoshida4";
+        case SCHEME::YOSHIDA6:
+            return "yoshida6";
+        case SCHEME::PEFRL:
+            return "pefrl";
+        default:
+            return "unknown";
+        }
+    }
+
+    int INTEGRATOR::n_force_evaluation() const
+    {
+        // One after every drift but the last
+        int n = 0;
+        for (size_t i_drift = 0; i_drift + 1 < drift_coefficients_.size(); i_drift++)
+        {
+            n += drift_coefficients_[i_drift] != 0;
+        }
+        return n;
+    }
+}
@@ -0,0 +1,160 @@
+#include "mapped_bin.h"
+#include "utility.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    /// Fewer bodies per thread are not worth a thread
+    constexpr size_t min_n_body_per_thread = 1 << 16;
+
+    template <typename T>
+    T read_as_bytes(const unsigned char *bytes)
+    {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+}
+
+namespace CORE
+{
+    MAPPED_FILE::MAPPED_FILE(const std::string &file_path)
+    {
+        const int fd = open(file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cout << "Cannot open " << file_path << std::endl;
+            ASSERT(false);
+        }
+        struct stat file_stat;
+        ASSERT(fstat(fd, &file_stat) == 0);
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0)
+        {
+            void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            ASSERT(addr != MAP_FAILED);
+            // The whole payload is about to be read, by several threads
+            madvise(addr, size_, MADV_WILLNEED);
+            data_ = static_cast<const unsigned char *>(addr);
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+
+    MAPPED_FILE::~MAPPED_FILE()
+    {
+        if (data_)
+        {
+            munmap(const_cast<unsigned char *>(data_), size_);
+        }
+    }
+
+    MAPPED_FILE::MAPPED_FILE(MAPPED_FILE &&other) noexcept : data_(other.data_), size_(other.size_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    MAPPED_BIN::MAPPED_BIN(const std::string &bin_file_path) : file_(bin_file_path)
+    {
+        const unsigned char *data = file_.data();
+        ASSERT(file_.size() >= header_size_v1);
+        if (file_.size() >= BIN::header_size_v2 && std::memcmp(data, BIN::magic, sizeof(BIN::magic)) == 0)
+        {
+            version_ = read_as_bytes<uint32_t>(data + 8);
+            ASSERT(version_ == 2);
+            floating_value_size_ = static_cast<int>(read_as_bytes<uint32_t>(data + 12));
+            ASSERT(floating_value_size_ == sizeof(float) || floating_value_size_ == sizeof(double));
+            n_body_ = static_cast<size_t>(read_as_bytes<uint64_t>(data + 16));
+            if (read_as_bytes<uint32_t>(data + 24) & BIN::has_metadata_flag)
+            {
+                metadata_ = BIN::METADATA{read_as_bytes<double>(data + 32), read_as_bytes<uint64_t>(data + 40), read_as_bytes<double>(data + 48)};
+            }
+            ASSERT(file_.size() >= BIN::header_size_v2 + BIN::n_column * BIN::column_stride(floating_value_size_, n_body_));
+            return;
+        }
+
+        version_ = 1;
+        const int num_bodies = read_as_bytes<int>(data + sizeof(int));
+        floating_value_size_ = read_as_bytes<int>(data);
+        ASSERT(floating_value_size_ == sizeof(float) || floating_value_size_ == sizeof(double));
+        ASSERT(num_bodies >= 0);
+        n_body_ = static_cast<size_t>(num_bodies);
+        ASSERT(file_.size() >= header_size_v1 + n_body_ * BIN_PAYLOAD_VIEW<float>::n_value_per_body * floating_value_size_);
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> MAPPED_BIN::to_system_state(size_t n_thread) const
+    {
+        if (n_thread == 0)
+        {
+            n_thread = default_n_thread(n_body_, min_n_body_per_thread);
+        }
+        if (static_cast<int>(sizeof(T)) < floating_value_size_)
+        {
+            std::cout << "Warning: unmatched floating value sizes! Will cast!" << std::endl;
+            std::cout << "sizeof(T)=" << sizeof(T) << std::endl;
+            std::cout << "size_floating_value_type=" << floating_value_size_ << std::endl;
+        }
+
+        SYSTEM_STATE_BASE<T> system_state(n_body_);
+        auto convert = [this, n_thread, &system_state](const auto &payload)
+        {
+            parallel_chunks(n_body_, n_thread,
+                            [&payload, &system_state](size_t, size_t begin, size_t end)
+                            {
+                                for (size_t i_body = begin; i_body < end; i_body++)
+                                {
+                                    const auto body_pos = payload.pos(i_body);
+                                    const auto body_vel = payload.vel(i_body);
+                                    auto &[pos, vel, mass] = system_state[i_body];
+                                    pos = {static_cast<T>(body_pos.x), static_cast<T>(body_pos.y), static_cast<T>(body_pos.z)};
+                                    vel = {static_cast<T>(body_vel.x), static_cast<T>(body_vel.y), static_cast<T>(body_vel.z)};
+                                    mass = static_cast<T>(payload.mass(i_body));
+                                }
+                            });
+        };
+        auto convert_version = [this, &convert](auto file_floating_value)
+        {
+            using F = decltype(file_floating_value);
+            if (version_ == 1)
+            {
+                convert(view<F>());
+            }
+            else
+            {
+                convert(columns<F>());
+            }
+        };
+        if (floating_value_size_ == sizeof(double))
+        {
+            convert_version(double{});
+        }
+        else
+        {
+            convert_version(float{});
+        }
+        return system_state;
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_mapped_bin(const std::string &bin_file_path, size_t n_thread)
+    {
+        return MAPPED_BIN(bin_file_path).to_system_state<T>(n_thread);
+    }
+
+    template SYSTEM_STATE_BASE<float> MAPPED_BIN::to_system_state<float>(size_t) const;
+    template SYSTEM_STATE_BASE<double> MAPPED_BIN::to_system_state<double>(size_t) const;
+    template SYSTEM_STATE_BASE<float> deserialize_system_state_from_mapped_bin<float>(const std::string &, size_t);
+    template SYSTEM_STATE_BASE<double> deserialize_system_state_from_mapped_bin<double>(const std::string &, size_t);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <optional>
+
+#include "physics.hpp"
+#include "macros.hpp"
+#include "serde.h"
+
+namespace CORE
+{
+    /// Read-only memory map of a whole file, unmapped on destruction
+    class MAPPED_FILE
+    {
+    public:
+        explicit MAPPED_FILE(const std::string &file_path);
+        ~MAPPED_FILE();
+
+        MAPPED_FILE(MAPPED_FILE &&other) noexcept;
+        MAPPED_FILE(const MAPPED_FILE &) = delete;
+        MAPPED_FILE &operator=(const MAPPED_FILE &) = delete;
+        MAPPED_FILE &operator=(MAPPED_FILE &&) = delete;
+
+        const unsigned char *data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        const unsigned char *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    /// Typed read-only view of the version 1 BIN payload (see serde.h), straight on the mapped pages.
+    /// Body i is the 7 values (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) starting at record(i).
+    template <typename F>
+    class BIN_PAYLOAD_VIEW
+    {
+    public:
+        static constexpr size_t n_value_per_body = 7;
+
+        BIN_PAYLOAD_VIEW(const F *records, size_t n_body) : records_(records), n_body_(n_body) {}
+
+        size_t size() const { return n_body_; }
+        const F *record(size_t i_body) const { return records_ + i_body * n_value_per_body; }
+
+        POS_BASE<F> pos(size_t i_body) const { return {record(i_body)[0], record(i_body)[1], record(i_body)[2]}; }
+        VEL_BASE<F> vel(size_t i_body) const { return {record(i_body)[3], record(i_body)[4], record(i_body)[5]}; }
+        F mass(size_t i_body) const { return record(i_body)[6]; }
+
+    private:
+        const F *records_;
+        size_t n_body_;
+    };
+
+    /// Typed read-only view of the version 2 BIN columns (see serde.h), straight on the mapped pages.
+    /// Every column is 64-byte aligned, ready for aligned SIMD loads.
+    template <typename F>
+    class BIN_COLUMNS_VIEW
+    {
+    public:
+        BIN_COLUMNS_VIEW(const F *first_column, size_t column_stride, size_t n_body)
+            : first_column_(first_column), column_stride_(column_stride), n_body_(n_body) {}
+
+        size_t size() const { return n_body_; }
+        /// i_column in [0, BIN::n_column), for POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS
+        const F *column(size_t i_column) const { return first_column_ + i_column * column_stride_; }
+
+        POS_BASE<F> pos(size_t i_body) const { return {column(0)[i_body], column(1)[i_body], column(2)[i_body]}; }
+        VEL_BASE<F> vel(size_t i_body) const { return {column(3)[i_body], column(4)[i_body], column(5)[i_body]}; }
+        F mass(size_t i_body) const { return column(6)[i_body]; }
+
+    private:
+        const F *first_column_;
+        /// In values
+        size_t column_stride_;
+        size_t n_body_;
+    };
+
+    /// BIN file of either version mapped into memory, with its header validated
+    class MAPPED_BIN
+    {
+    public:
+        explicit MAPPED_BIN(const std::string &bin_file_path);
+
+        /// 1 or 2
+        uint32_t version() const { return version_; }
+        /// 4 for float, 8 for double
+        int floating_value_size() const { return floating_value_size_; }
+        size_t n_body() const { return n_body_; }
+        /// Version 2 only, if written with some
+        const std::optional<BIN::METADATA> &metadata() const { return metadata_; }
+
+        /// Version 1 only, F must match floating_value_size()
+        template <typename F>
+        BIN_PAYLOAD_VIEW<F> view() const;
+        /// Version 2 only, F must match floating_value_size()
+        template <typename F>
+        BIN_COLUMNS_VIEW<F> columns() const;
+
+        /// Copies, and converts if needed, the payload into a SYSTEM_STATE_BASE<T>,
+        /// split over n_thread threads (0 to pick one from the size and the hardware)
+        template <typename T>
+        SYSTEM_STATE_BASE<T> to_system_state(size_t n_thread = 0) const;
+
+    private:
+        /// Version 1 header: floating value size (4 bytes), number of bodies (4 bytes)
+        static constexpr size_t header_size_v1 = 8;
+
+        MAPPED_FILE file_;
+        uint32_t version_;
+        int floating_value_size_;
+        size_t n_body_;
+        std::optional<BIN::METADATA> metadata_;
+    };
+
+    /// Same result as deserialize_system_state_from_bin(const std::string &), through MAPPED_BIN
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_mapped_bin(const std::string &bin_file_path, size_t n_thread = 0);
+
+    /// Implementation
+
+    template <typename F>
+    BIN_PAYLOAD_VIEW<F> MAPPED_BIN::view() const
+    {
+        ASSERT(version_ == 1);
+        ASSERT(sizeof(F) == static_cast<size_t>(floating_value_size_));
+        // mmap returns page aligned memory, so the payload at header_size_v1 is aligned for both float and double
+        return {reinterpret_cast<const F *>(file_.data() + header_size_v1), n_body_};
+    }
+
+    template <typename F>
+    BIN_COLUMNS_VIEW<F> MAPPED_BIN::columns() const
+    {
+        ASSERT(version_ == 2);
+        ASSERT(sizeof(F) == static_cast<size_t>(floating_value_size_));
+        return {reinterpret_cast<const F *>(file_.data() + BIN::header_size_v2),
+                BIN::column_stride(floating_value_size_, n_body_) / sizeof(F), n_body_};
+    }
+}
@@ -1,125 +1,330 @@
 #pragma once
 
+#include <array>
 #include <tuple>
+#include <utility>
 #include <vector>
 #include <cmath>
 #include <iostream>
 #include "xyz.hpp"
 #include "universe.hpp"
 #include "macros.hpp"
+#include "aligned_allocator.hpp"
 
 namespace CORE
 {
     /// Basic types
+    /// Templated on the floating type T, with the aliases below fixed to UNIVERSE::floating_value_type
 
     using DT = UNIVERSE::floating_value_type;
 
     using MASS = UNIVERSE::floating_value_type;
 
-    struct ACC;
-    struct VEL;
-    struct POS;
+    template <typename T>
+    struct ACC_BASE;
+    template <typename T>
+    struct VEL_BASE;
+    template <typename T>
+    struct POS_BASE;
 
-    struct ACC : public XYZ
+    template <typename T>
+    struct ACC_BASE : public XYZ_BASE<T>
     {
-        static ACC from_gravity(const POS &p_src, MASS m_src, const POS &p_target);
+        static ACC_BASE from_gravity(const POS_BASE<T> &p_src, T m_src, const POS_BASE<T> &p_target);
     };
 
-    struct VEL : public XYZ
+    template <typename T>
+    struct VEL_BASE : public XYZ_BASE<T>
     {
-        static VEL updated(const VEL &, const ACC &, DT);
+        static VEL_BASE updated(const VEL_BASE &, const ACC_BASE<T> &, T dt);
     };
-    struct POS : public XYZ
+
+    template <typename T>
+    struct POS_BASE : public XYZ_BASE<T>
     {
-        static POS updated(const POS &, const VEL &, const ACC &, DT);
+        static POS_BASE updated(const POS_BASE &, const VEL_BASE<T> &, const ACC_BASE<T> &, T dt);
     };
 
+    using ACC = ACC_BASE<UNIVERSE::floating_value_type>;
+    using VEL = VEL_BASE<UNIVERSE::floating_value_type>;
+    using POS = POS_BASE<UNIVERSE::floating_value_type>;
+
     /// A field caused by p_src to p_target, a vector pointing from p_target to p_src
-    XYZ universal_field(const POS &p_src, const POS &p_target);
+    template <typename T>
+    XYZ_BASE<T> universal_field(const POS_BASE<T> &p_src, const POS_BASE<T> &p_target);
+
+    /// The acceleration caused by p_src to p_target, as ACC_BASE::from_gravity(), and its time derivative, the jerk,
+    /// given the velocities of both, sharing the distance and the square root
+    template <typename T>
+    std::pair<ACC_BASE<T>, XYZ_BASE<T>> gravity_and_jerk(const POS_BASE<T> &p_src, const VEL_BASE<T> &v_src, T m_src,
+                                                         const POS_BASE<T> &p_target, const VEL_BASE<T> &v_target);
 
     /// Input/output types
+    /// (POS, VEL, MASS)
+
+    template <typename T>
+    using BODY_STATE_BASE = std::tuple<POS_BASE<T>, VEL_BASE<T>, T>;
+    template <typename T>
+    using SYSTEM_STATE_BASE = std::vector<BODY_STATE_BASE<T>>;
+
+    using BODY_STATE = BODY_STATE_BASE<UNIVERSE::floating_value_type>;
+    using SYSTEM_STATE = SYSTEM_STATE_BASE<UNIVERSE::floating_value_type>;
+
+    /// Contiguous values viewed in place, as std::span of C++20
+    template <typename T>
+    class SPAN
+    {
+    public:
+        SPAN(T *data, size_t size) : data_(data), size_(size) {}
+
+        T *data() const { return data_; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        T &operator[](size_t i) const { return data_[i]; }
+        T *begin() const { return data_; }
+        T *end() const { return data_ + size_; }
+
+    private:
+        T *data_;
+        size_t size_;
+    };
+
+    /// Structure-of-arrays SYSTEM_STATE, the one ENGINEs take and give, so that SIMD kernels,
+    /// the SYSTEM_STATE log and BIN columns copy whole columns instead of converting body by body.
+    /// One 64-byte aligned column per field, in the serialization order (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS).
+    /// BODY_STATEs go in and out through body() and set_body(), and whole SYSTEM_STATEs through the AoS adapters.
+    template <typename T>
+    class SOA_SYSTEM_STATE_BASE
+    {
+    public:
+        using value_type = T;
+        static constexpr size_t n_column = 7;
+
+        SOA_SYSTEM_STATE_BASE() = default;
+        /// n_body bodies at rest at the origin, without mass
+        explicit SOA_SYSTEM_STATE_BASE(size_t n_body) { resize(n_body); }
+
+        /// AoS adapters
+        explicit SOA_SYSTEM_STATE_BASE(const SYSTEM_STATE_BASE<T> &system_state);
+        SYSTEM_STATE_BASE<T> to_aos() const;
+
+        size_t size() const { return columns_[0].size(); }
+        bool empty() const { return columns_[0].empty(); }
+        size_t capacity() const { return columns_[0].capacity(); }
+        /// New bodies are at rest at the origin, without mass
+        void resize(size_t n_body);
+        void reserve(size_t n_body);
+        void clear() { resize(0); }
+
+        /// i_column in [0, n_column), in the serialization order
+        SPAN<T> column(size_t i_column) { return {columns_[i_column].data(), size()}; }
+        SPAN<const T> column(size_t i_column) const { return {columns_[i_column].data(), size()}; }
+        SPAN<T> pos_x() { return column(0); }
+        SPAN<T> pos_y() { return column(1); }
+        SPAN<T> pos_z() { return column(2); }
+        SPAN<T> vel_x() { return column(3); }
+        SPAN<T> vel_y() { return column(4); }
+        SPAN<T> vel_z() { return column(5); }
+        SPAN<T> mass() { return column(6); }
+        SPAN<const T> pos_x() const { return column(0); }
+        SPAN<const T> pos_y() const { return column(1); }
+        SPAN<const T> pos_z() const { return column(2); }
+        SPAN<const T> vel_x() const { return column(3); }
+        SPAN<const T> vel_y() const { return column(4); }
+        SPAN<const T> vel_z() const { return column(5); }
+        SPAN<const T> mass() const { return column(6); }
 
-    using BODY_STATE = std::tuple<POS, VEL, MASS>;
-    using SYSTEM_STATE = std::vector<BODY_STATE>;
+        POS_BASE<T> pos(size_t i_body) const { return {columns_[0][i_body], columns_[1][i_body], columns_[2][i_body]}; }
+        VEL_BASE<T> vel(size_t i_body) const { return {columns_[3][i_body], columns_[4][i_body], columns_[5][i_body]}; }
+        BODY_STATE_BASE<T> body(size_t i_body) const { return {pos(i_body), vel(i_body), columns_[6][i_body]}; }
+        void set_pos(size_t i_body, const XYZ_BASE<T> &p);
+        void set_vel(size_t i_body, const XYZ_BASE<T> &v);
+        void set_body(size_t i_body, const BODY_STATE_BASE<T> &body_state);
+        void push_back(const BODY_STATE_BASE<T> &body_state);
+        void emplace_back(const POS_BASE<T> &p, const VEL_BASE<T> &v, T m) { push_back({p, v, m}); }
+
+        friend bool operator==(const SOA_SYSTEM_STATE_BASE &lhs, const SOA_SYSTEM_STATE_BASE &rhs) { return lhs.columns_ == rhs.columns_; }
+        friend bool operator!=(const SOA_SYSTEM_STATE_BASE &lhs, const SOA_SYSTEM_STATE_BASE &rhs) { return !(lhs == rhs); }
+
+    private:
+        std::array<ALIGNED_VECTOR<T>, n_column> columns_;
+    };
+
+    /// Use this type
+    using SOA_SYSTEM_STATE = SOA_SYSTEM_STATE_BASE<UNIVERSE::floating_value_type>;
 
     /// Comparison
-    bool verify(const SYSTEM_STATE &expected_state_vec, const SYSTEM_STATE &actual_state_vec);
+    template <typename T>
+    bool verify(const SYSTEM_STATE_BASE<T> &expected_state_vec, const SYSTEM_STATE_BASE<T> &actual_state_vec);
+    template <typename T>
+    bool verify(const SOA_SYSTEM_STATE_BASE<T> &expected_state, const SOA_SYSTEM_STATE_BASE<T> &actual_state);
 
     /// Implementations
 
-    inline ACC ACC::from_gravity(const POS &p_src, MASS m_src, const POS &p_target)
+    template <typename T>
+    ACC_BASE<T> ACC_BASE<T>::from_gravity(const POS_BASE<T> &p_src, T m_src, const POS_BASE<T> &p_target)
     {
         return {m_src * universal_field(p_src, p_target)};
     }
 
-    inline VEL VEL::updated(const VEL &v, const ACC &a, DT dt)
+    template <typename T>
+    VEL_BASE<T> VEL_BASE<T>::updated(const VEL_BASE &v, const ACC_BASE<T> &a, T dt)
     {
-        return {v + static_cast<UNIVERSE::floating_value_type>(0.5) * a * dt};
+        return {v + static_cast<T>(0.5) * a * dt};
     }
 
-    inline POS POS::updated(const POS &p, const VEL &v, const ACC &a, DT dt)
+    template <typename T>
+    POS_BASE<T> POS_BASE<T>::updated(const POS_BASE &p, const VEL_BASE<T> &v, const ACC_BASE<T> &a, T dt)
     {
-        return {p + v * dt + static_cast<UNIVERSE::floating_value_type>(0.5) * a * dt * dt};
+        return {p + v * dt + static_cast<T>(0.5) * a * dt * dt};
     }
 
-    inline XYZ universal_field(const POS &p_src, const POS &p_target)
+    template <typename T>
+    XYZ_BASE<T> universal_field(const POS_BASE<T> &p_src, const POS_BASE<T> &p_target)
     {
-        const XYZ displacement = p_src - p_target;
-        const UNIVERSE::floating_value_type denom_base = displacement.norm_square() + UNIVERSE::epislon_square;
+        const XYZ_BASE<T> displacement = p_src - p_target;
+        const T denom_base = displacement.norm_square() + UNIVERSE::epislon_square_v<T>;
 
         return displacement / (denom_base * std::sqrt(denom_base));
     }
 
-    inline bool verify(const SYSTEM_STATE &expected_state_vec, const SYSTEM_STATE &actual_state_vec)
+    template <typename T>
+    std::pair<ACC_BASE<T>, XYZ_BASE<T>> gravity_and_jerk(const POS_BASE<T> &p_src, const VEL_BASE<T> &v_src, T m_src,
+                                                         const POS_BASE<T> &p_target, const VEL_BASE<T> &v_target)
     {
-        ASSERT(expected_state_vec.size() == actual_state_vec.size());
-        const size_t n_body = expected_state_vec.size();
+        const XYZ_BASE<T> r = p_src - p_target;
+        const XYZ_BASE<T> v = v_src - v_target;
+        const T inv_denom_base = 1 / (r.norm_square() + UNIVERSE::epislon_square_v<T>);
+        const T m_inv_r3 = m_src * inv_denom_base * std::sqrt(inv_denom_base);
+        const T rv_inv_r2_3 = 3 * (r.x * v.x + r.y * v.y + r.z * v.z) * inv_denom_base;
+
+        // a = m r / |r|^3, j = m (v / |r|^3 - 3 (r.v) r / |r|^5)
+        return {{m_inv_r3 * r}, m_inv_r3 * (v - rv_inv_r2_3 * r)};
+    }
+
+    template <typename T>
+    SOA_SYSTEM_STATE_BASE<T>::SOA_SYSTEM_STATE_BASE(const SYSTEM_STATE_BASE<T> &system_state)
+    {
+        resize(system_state.size());
+        for (size_t i_body = 0; i_body < system_state.size(); i_body++)
+        {
+            set_body(i_body, system_state[i_body]);
+        }
+    }
 
+    template <typename T>
+    SYSTEM_STATE_BASE<T> SOA_SYSTEM_STATE_BASE<T>::to_aos() const
+    {
+        SYSTEM_STATE_BASE<T> system_state;
+        system_state.reserve(size());
+        for (size_t i_body = 0; i_body < size(); i_body++)
+        {
+            system_state.push_back(body(i_body));
+        }
+        return system_state;
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::resize(size_t n_body)
+    {
+        for (auto &column : columns_)
+        {
+            column.resize(n_body, 0);
+        }
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::reserve(size_t n_body)
+    {
+        for (auto &column : columns_)
+        {
+            column.reserve(n_body);
+        }
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::set_pos(size_t i_body, const XYZ_BASE<T> &p)
+    {
+        columns_[0][i_body] = p.x;
+        columns_[1][i_body] = p.y;
+        columns_[2][i_body] = p.z;
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::set_vel(size_t i_body, const XYZ_BASE<T> &v)
+    {
+        columns_[3][i_body] = v.x;
+        columns_[4][i_body] = v.y;
+        columns_[5][i_body] = v.z;
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::set_body(size_t i_body, const BODY_STATE_BASE<T> &body_state)
+    {
+        const auto &[p, v, m] = body_state;
+        set_pos(i_body, p);
+        set_vel(i_body, v);
+        columns_[6][i_body] = m;
+    }
+
+    template <typename T>
+    void SOA_SYSTEM_STATE_BASE<T>::push_back(const BODY_STATE_BASE<T> &body_state)
+    {
+        resize(size() + 1);
+        set_body(size() - 1, body_state);
+    }
+
+    /// BODY_STATE get_expected(i_body), BODY_STATE get_actual(i_body)
+    template <typename T, typename E, typename A>
+    bool verify_bodies(size_t n_body, E get_expected, A get_actual)
+    {
         bool is_good = true;
 
         // Sum([norm_square(expected[i_body], actual[i_body]) for i_body in range(n_body)])
-        UNIVERSE::floating_value_type total_pos_loss = 0;
-        UNIVERSE::floating_value_type total_vel_loss = 0;
+        T total_pos_loss = 0;
+        T total_vel_loss = 0;
 
-        auto compute_xyz_epislon = [](const XYZ &expected)
+        auto compute_xyz_epislon = [](const XYZ_BASE<T> &expected)
         {
-            return UNIVERSE::epislon_square * expected.norm_square();
+            return UNIVERSE::epislon_square_v<T> * expected.norm_square();
         };
 
         for (size_t i_body = 0; i_body < n_body; i_body++)
         {
+            const BODY_STATE_BASE<T> expected_body = get_expected(i_body);
+            const BODY_STATE_BASE<T> actual_body = get_actual(i_body);
             // Mass must match exactly
-            if (std::get<MASS>(expected_state_vec[i_body]) != std::get<MASS>(actual_state_vec[i_body]))
+            if (std::get<T>(expected_body) != std::get<T>(actual_body))
             {
                 std::cout << "body " << i_body << ": "
-                          << " expected_mass " << std::get<MASS>(expected_state_vec[i_body])
-                          << " does not match with actual_mass " << std::get<MASS>(actual_state_vec[i_body]) << std::endl;
+                          << " expected_mass " << std::get<T>(expected_body)
+                          << " does not match with actual_mass " << std::get<T>(actual_body) << std::endl;
                 ASSERT(false);
             }
 
-            const auto pos_err_square = (std::get<POS>(expected_state_vec[i_body]) - std::get<POS>(actual_state_vec[i_body])).norm_square();
+            const auto pos_err_square = (std::get<POS_BASE<T>>(expected_body) - std::get<POS_BASE<T>>(actual_body)).norm_square();
             total_pos_loss += pos_err_square;
-            const auto pos_epislon = compute_xyz_epislon(std::get<POS>(expected_state_vec[i_body]));
+            const auto pos_epislon = compute_xyz_epislon(std::get<POS_BASE<T>>(expected_body));
             if (is_good && pos_err_square > pos_epislon)
             {
                 std::cout << "body " << i_body << ": "
                           << "error_square of POS " << pos_err_square
                           << " is larger than acceptance " << pos_epislon << std::endl;
-                std::cout << "expected: " << std::get<POS>(expected_state_vec[i_body]) << std::endl;
-                std::cout << "actual: " << std::get<POS>(actual_state_vec[i_body]) << std::endl;
+                std::cout << "expected: " << std::get<POS_BASE<T>>(expected_body) << std::endl;
+                std::cout << "actual: " << std::get<POS_BASE<T>>(actual_body) << std::endl;
                 is_good = false;
             }
 
-            const auto vel_err_square = (std::get<VEL>(expected_state_vec[i_body]) - std::get<VEL>(actual_state_vec[i_body])).norm_square();
+            const auto vel_err_square = (std::get<VEL_BASE<T>>(expected_body) - std::get<VEL_BASE<T>>(actual_body)).norm_square();
             total_vel_loss += vel_err_square;
-            const auto vel_epislon = compute_xyz_epislon(std::get<VEL>(expected_state_vec[i_body]));
+            const auto vel_epislon = compute_xyz_epislon(std::get<VEL_BASE<T>>(expected_body));
             if (is_good && vel_err_square > vel_epislon)
             {
                 std::cout << "body " << i_body << ": "
                           << "error_square of VEL " << vel_err_square
                           << " is larger than acceptance " << vel_epislon << std::endl;
-                std::cout << "expected: " << std::get<VEL>(expected_state_vec[i_body]) << std::endl;
-                std::cout << "actual: " << std::get<VEL>(actual_state_vec[i_body]) << std::endl;
+                std::cout << "expected: " << std::get<VEL_BASE<T>>(expected_body) << std::endl;
+                std::cout << "actual: " << std::get<VEL_BASE<T>>(actual_body) << std::endl;
                 is_good = false;
             }
         }
@@ -130,4 +335,28 @@ namespace CORE
 
         return is_good;
     }
+
+    template <typename T>
+    bool verify(const SYSTEM_STATE_BASE<T> &expected_state_vec, const SYSTEM_STATE_BASE<T> &actual_state_vec)
+    {
+        ASSERT(expected_state_vec.size() == actual_state_vec.size());
+        return verify_bodies<T>(
+            expected_state_vec.size(),
+            [&](size_t i_body)
+            { return expected_state_vec[i_body]; },
+            [&](size_t i_body)
+            { return actual_state_vec[i_body]; });
+    }
+
+    template <typename T>
+    bool verify(const SOA_SYSTEM_STATE_BASE<T> &expected_state, const SOA_SYSTEM_STATE_BASE<T> &actual_state)
+    {
+        ASSERT(expected_state.size() == actual_state.size());
+        return verify_bodies<T>(
+            expected_state.size(),
+            [&](size_t i_body)
+            { return expected_state.body(i_body); },
+            [&](size_t i_body)
+            { return actual_state.body(i_body); });
+    }
 }
@@ -1,23 +1,160 @@
 #include "serde.h"
+#include "mapped_bin.h"
+#include "trajectory.h"
 #include "macros.hpp"
+#include "utility.hpp"
 
-#include <regex>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <vector>
 
 namespace
 {
-    template <typename T = CORE::XYZ::value_type>
-    T str_to_floating(const std::string &str)
+    /// Fewer CSV rows per thread are not worth a thread
+    constexpr size_t min_n_csv_row_per_thread = 1 << 14;
+    /// Rows formatted per thread before being written out, which bounds the memory of the writer
+    constexpr size_t n_csv_row_per_write = 1 << 16;
+    /// As std::fixed
+    constexpr int csv_precision = 6;
+
+    bool is_csv_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    const char *skip_csv_space(const char *first, const char *last)
     {
-        if constexpr (std::is_same_v<T, float>)
+        while (first != last && is_csv_space(*first))
         {
-            return std::stof(str);
+            first++;
         }
-        else
+        return first;
+    }
+
+    /// Parses a CSV row [first, last), without its '\n', into body_state.
+    /// Every value may be surrounded by spaces and have a leading '+', as std::stof allowed.
+    /// Returns false if the row is invalid.
+    template <typename T>
+    bool parse_csv_row(const char *first, const char *last, CORE::BODY_STATE_BASE<T> &body_state)
+    {
+        T values[7] = {};
+        for (int i_value = 0; i_value < 7; i_value++)
+        {
+            first = skip_csv_space(first, last);
+            if (first != last && *first == '+')
+            {
+                first++;
+            }
+            const auto [value_last, ec] = std::from_chars(first, last, values[i_value]);
+            if (ec != std::errc())
+            {
+                return false;
+            }
+            first = skip_csv_space(value_last, last);
+            if (i_value < 6)
+            {
+                if (first == last || *first != ',')
+                {
+                    return false;
+                }
+                first++;
+            }
+        }
+        // Optional trailing comma
+        if (first != last && *first == ',')
         {
-            return std::stod(str);
+            first = skip_csv_space(first + 1, last);
         }
+        if (first != last)
+        {
+            return false;
+        }
+
+        auto &[p, v, m] = body_state;
+        p = {values[0], values[1], values[2]};
+        v = {values[3], values[4], values[5]};
+        m = values[6];
+        return true;
+    }
+
+    /// Parses the CSV rows in [data, data + size).
+    /// The text is cut into one chunk per thread at row boundaries,
+    /// and the rows of the chunks are concatenated in order.
+    template <typename T>
+    CORE::SYSTEM_STATE_BASE<T> parse_csv(const char *data, size_t size)
+    {
+        // Rows are about 64 characters long
+        const size_t n_thread = CORE::default_n_thread(size / 64, min_n_csv_row_per_thread);
+
+        // chunk i is [chunk_offsets[i], chunk_offsets[i + 1]), each starting at a row
+        std::vector<size_t> chunk_offsets(n_thread + 1, size);
+        chunk_offsets[0] = 0;
+        for (size_t i_chunk = 1; i_chunk < n_thread; i_chunk++)
+        {
+            const size_t offset = std::max(size * i_chunk / n_thread, chunk_offsets[i_chunk - 1]);
+            const void *newline = offset < size ? std::memchr(data + offset, '\n', size - offset) : nullptr;
+            chunk_offsets[i_chunk] = newline ? static_cast<const char *>(newline) - data + 1 : size;
+        }
+
+        std::vector<CORE::SYSTEM_STATE_BASE<T>> chunk_system_states(n_thread);
+        std::vector<std::vector<std::string>> chunk_invalid_rows(n_thread);
+        CORE::parallel_chunks(n_thread, n_thread,
+                              [&](size_t i_chunk, size_t, size_t)
+                              {
+                                  const char *row_first = data + chunk_offsets[i_chunk];
+                                  const char *chunk_last = data + chunk_offsets[i_chunk + 1];
+                                  // Same rows as std::getline: no empty row after the last '\n'
+                                  while (row_first != chunk_last)
+                                  {
+                                      const void *newline = std::memchr(row_first, '\n', chunk_last - row_first);
+                                      const char *row_last = newline ? static_cast<const char *>(newline) : chunk_last;
+                                      CORE::BODY_STATE_BASE<T> body_state;
+                                      if (parse_csv_row(row_first, row_last, body_state))
+                                      {
+                                          chunk_system_states[i_chunk].push_back(body_state);
+                                      }
+                                      else
+                                      {
+                                          chunk_invalid_rows[i_chunk].emplace_back(row_first, row_last);
+                                      }
+                                      row_first = newline ? row_last + 1 : chunk_last;
+                                  }
+                              });
+
+        size_t n_body = 0;
+        for (size_t i_chunk = 0; i_chunk < n_thread; i_chunk++)
+        {
+            for (const auto &row_str : chunk_invalid_rows[i_chunk])
+            {
+                // Skip invalid row
+                std::cout << "Invalid CSV row: " << row_str << std::endl;
+            }
+            n_body += chunk_system_states[i_chunk].size();
+        }
+        CORE::SYSTEM_STATE_BASE<T> system_state = std::move(chunk_system_states[0]);
+        system_state.reserve(n_body);
+        for (size_t i_chunk = 1; i_chunk < n_thread; i_chunk++)
+        {
+            system_state.insert(system_state.end(), chunk_system_states[i_chunk].begin(), chunk_system_states[i_chunk].end());
+        }
+        return system_state;
+    }
+
+    /// Writes value into [first, last) as std::fixed prints it, and returns the end of it
+    template <typename T>
+    char *format_csv_value(char *first, char *last, T value)
+    {
+        const auto [value_last, ec] = std::to_chars(first, last, value, std::chars_format::fixed, csv_precision);
+        ASSERT(ec == std::errc());
+        return value_last;
     }
 
     template <typename T>
@@ -33,96 +170,944 @@ namespace
         is.read(reinterpret_cast<char *>(&value), sizeof(T));
         return value;
     }
-}
 
-namespace CORE
-{
-    void serialize_system_state_to_csv(std::ostream &csv_ostream, const SYSTEM_STATE &system_state)
+    /// Value i_value of POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS, the columns of BIN version 2
+    template <typename BODY_STATE>
+    auto &body_state_value(BODY_STATE &body_state, size_t i_value)
     {
-        csv_ostream << std::fixed;
-        /// (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each row
-        for (const auto &[p, v, m] : system_state)
+        auto &[body_pos, body_vel, body_mass] = body_state;
+        switch (i_value)
         {
-            csv_ostream << p.x << ",";
-            csv_ostream << p.y << ",";
-            csv_ostream << p.z << ",";
-            csv_ostream << v.x << ",";
-            csv_ostream << v.y << ",";
-            csv_ostream << v.z << ",";
-            csv_ostream << m << "\n";
+        case 0:
+            return body_pos.x;
+        case 1:
+            return body_pos.y;
+        case 2:
+            return body_pos.z;
+        case 3:
+            return body_vel.x;
+        case 4:
+            return body_vel.y;
+        case 5:
+            return body_vel.z;
+        default:
+            return body_mass;
         }
     }
 
-    void serialize_system_state_to_csv(const std::string &csv_file_path, const SYSTEM_STATE &system_state)
+    /// The same value from either SYSTEM_STATE layout
+    template <typename T>
+    T bin_value(const CORE::SYSTEM_STATE_BASE<T> &system_state, size_t i_body, size_t i_value)
     {
-        std::ofstream csv_file_ofstream(csv_file_path);
-        ASSERT(csv_file_ofstream.is_open());
-        serialize_system_state_to_csv(csv_file_ofstream, system_state);
+        return body_state_value(system_state[i_body], i_value);
     }
 
-    SYSTEM_STATE deserialize_system_state_from_csv(std::istream &csv_istream)
+    template <typename T>
+    T bin_value(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, size_t i_body, size_t i_value)
     {
-        SYSTEM_STATE system_state;
-        /// (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each row
-        const std::regex row_regex("(.*),(.*),(.*),(.*),(.*),(.*),(.*),?", std::regex::optimize);
-
-        std::string row_str;
+        return system_state.column(i_value)[i_body];
+    }
 
-        while (std::getline(csv_istream, row_str))
+    /// Column i_column of BIN version 2, padding included, staged from an AoS SYSTEM_STATE
+    template <typename T>
+    void write_bin_column(std::ostream &bin_ostream, const CORE::SYSTEM_STATE_BASE<T> &system_state, size_t i_column, std::vector<T> &staging)
+    {
+        for (size_t i_body = 0; i_body < system_state.size(); i_body++)
         {
-            std::smatch m;
-            std::regex_match(row_str, m, row_regex);
-            if (m.size() != 8)
-            {
-                // Skip invalid row
-                std::cout << "Invalid CSV row: " << row_str << std::endl;
-                continue;
-            }
-
-            POS p{str_to_floating(m[1]), str_to_floating(m[2]), str_to_floating(m[3])};
-            VEL v{str_to_floating(m[4]), str_to_floating(m[5]), str_to_floating(m[6])};
-            MASS mass{str_to_floating(m[7])};
-
-            system_state.emplace_back(p, v, mass);
+            staging[i_body] = body_state_value(system_state[i_body], i_column);
         }
-        return system_state;
+        bin_ostream.write(reinterpret_cast<const char *>(staging.data()), staging.size() * sizeof(T));
     }
 
-    SYSTEM_STATE deserialize_system_state_from_csv(const std::string &csv_file_path)
+    /// Column i_column of BIN version 2, padding included, written straight from an SoA SYSTEM_STATE
+    template <typename T>
+    void write_bin_column(std::ostream &bin_ostream, const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, size_t i_column, const std::vector<T> &staging)
     {
-        std::ifstream csv_file_ifstream(csv_file_path);
-        ASSERT(csv_file_ifstream.is_open());
-        return deserialize_system_state_from_csv(csv_file_ifstream);
+        const CORE::SPAN<const T> column = system_state.column(i_column);
+        bin_ostream.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+        bin_ostream.write(reinterpret_cast<const char *>(staging.data()), (staging.size() - column.size()) * sizeof(T));
     }
 
-    void serialize_system_state_to_bin(std::ostream &bin_ostream, const SYSTEM_STATE &system_state)
+    /// S is SYSTEM_STATE_BASE<T> or SOA_SYSTEM_STATE_BASE<T>
+    template <typename T, typename S>
+    void serialize_system_state_to_bin_v1(std::ostream &bin_ostream, const S &system_state)
     {
         // - first 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
-        const int size_floating_value_type = sizeof(UNIVERSE::floating_value_type);
+        const int size_floating_value_type = sizeof(T);
         write_as_binary(bin_ostream, size_floating_value_type);
 
         /// - second 4 bytes: number of bodies
+        ASSERT(system_state.size() <= static_cast<size_t>(std::numeric_limits<int>::max()));
         const int num_bodies = system_state.size();
         write_as_binary(bin_ostream, num_bodies);
 
         // - rest: (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
-        for (const auto &body_state : system_state)
+        for (size_t i_body = 0; i_body < system_state.size(); i_body++)
+        {
+            for (size_t i_value = 0; i_value < CORE::BIN::n_column; i_value++)
+            {
+                write_as_binary(bin_ostream, bin_value(system_state, i_body, i_value));
+            }
+        }
+    }
+
+    /// S is SYSTEM_STATE_BASE<T> or SOA_SYSTEM_STATE_BASE<T>
+    template <typename T, typename S>
+    void serialize_system_state_to_bin_v2(std::ostream &bin_ostream, const S &system_state,
+                                          const std::optional<CORE::BIN::METADATA> &metadata)
+    {
+        const uint64_t num_bodies = system_state.size();
+        bin_ostream.write(CORE::BIN::magic, sizeof(CORE::BIN::magic));
+        write_as_binary(bin_ostream, uint32_t{2});
+        write_as_binary(bin_ostream, static_cast<uint32_t>(sizeof(T)));
+        write_as_binary(bin_ostream, num_bodies);
+        write_as_binary(bin_ostream, metadata ? CORE::BIN::has_metadata_flag : uint32_t{0});
+        write_as_binary(bin_ostream, uint32_t{0});
+        const CORE::BIN::METADATA written_metadata = metadata.value_or(CORE::BIN::METADATA{});
+        write_as_binary(bin_ostream, written_metadata.dt);
+        write_as_binary(bin_ostream, written_metadata.iteration);
+        write_as_binary(bin_ostream, written_metadata.time);
+        write_as_binary(bin_ostream, uint64_t{0});
+
+        // Padding included, which stays zero
+        std::vector<T> staging(CORE::BIN::column_stride(sizeof(T), num_bodies) / sizeof(T), 0);
+        for (size_t i_column = 0; i_column < CORE::BIN::n_column; i_column++)
+        {
+            write_bin_column(bin_ostream, system_state, i_column, staging);
+        }
+    }
+
+    template <typename T, typename F>
+    void deserialize_system_state_from_bin_v2_columns(std::istream &bin_istream, CORE::SYSTEM_STATE_BASE<T> &system_state)
+    {
+        const size_t num_bodies = system_state.size();
+        std::vector<F> column(CORE::BIN::column_stride(sizeof(F), num_bodies) / sizeof(F));
+        for (size_t i_column = 0; i_column < CORE::BIN::n_column; i_column++)
+        {
+            bin_istream.read(reinterpret_cast<char *>(column.data()), column.size() * sizeof(F));
+            ASSERT(bin_istream);
+            for (size_t i_body = 0; i_body < num_bodies; i_body++)
+            {
+                body_state_value(system_state[i_body], i_column) = static_cast<T>(column[i_body]);
+            }
+        }
+    }
+
+    /// What the readers need from either BIN header
+    struct BIN_HEADER
+    {
+        uint32_t version = 1;
+        int floating_value_size = 0;
+        uint64_t n_body = 0;
+    };
+
+    /// Leaves bin_istream at the payload
+    BIN_HEADER read_bin_header(std::istream &bin_istream)
+    {
+        BIN_HEADER header;
+        // Version 1: first 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
+        // Version 2: the start of the magic
+        char magic[sizeof(CORE::BIN::magic)];
+        bin_istream.read(magic, sizeof(int));
+        std::memcpy(&header.floating_value_size, magic, sizeof(int));
+        if (header.floating_value_size == sizeof(float) || header.floating_value_size == sizeof(double))
+        {
+            /// - second 4 bytes: number of bodies
+            const auto num_bodies = read_as_binary<int>(bin_istream);
+            ASSERT(num_bodies >= 0);
+            header.n_body = static_cast<uint64_t>(num_bodies);
+        }
+        else
+        {
+            bin_istream.read(magic + sizeof(int), sizeof(magic) - sizeof(int));
+            ASSERT(std::memcmp(magic, CORE::BIN::magic, sizeof(magic)) == 0);
+            header.version = read_as_binary<uint32_t>(bin_istream);
+            ASSERT(header.version == 2);
+            header.floating_value_size = static_cast<int>(read_as_binary<uint32_t>(bin_istream));
+            ASSERT(header.floating_value_size == sizeof(float) || header.floating_value_size == sizeof(double));
+            header.n_body = read_as_binary<uint64_t>(bin_istream);
+            // Flags, metadata and reserved, see CORE::deserialize_metadata_from_bin
+            bin_istream.ignore(CORE::BIN::header_size_v2 - sizeof(magic) - 2 * sizeof(uint32_t) - sizeof(uint64_t));
+        }
+        ASSERT(bin_istream);
+        return header;
+    }
+
+    std::string file_extension(const std::string &file_path)
+    {
+        return file_path.substr(file_path.find_last_of(".") + 1);
+    }
+
+    template <typename T>
+    using CHUNK_CONSUMER = std::function<void(const CORE::SYSTEM_STATE_BASE<T> &, size_t)>;
+
+    /// Bytes of CSV read at once per body of INGESTION::chunk_size, rows of the default precision take about as many
+    constexpr size_t n_csv_byte_per_body = 64;
+
+    /// Subsamples the chunks of bodies that read_chunk(chunk) fills in file order, until it returns false,
+    /// see CORE::ingest_system_state_from_file
+    template <typename T, typename R>
+    size_t ingest_chunks(const CORE::INGESTION &ingestion, R read_chunk, const CHUNK_CONSUMER<T> &consumer)
+    {
+        CORE::SYSTEM_STATE_BASE<T> chunk;
+        CORE::SYSTEM_STATE_BASE<T> kept_chunk;
+        size_t i_body = 0;
+        size_t n_kept = 0;
+        while (n_kept < ingestion.max_n_body && read_chunk(chunk))
+        {
+            if (ingestion.stride == 1 && chunk.size() <= ingestion.max_n_body - n_kept)
+            {
+                // Everything is kept, no need for a copy
+                consumer(chunk, n_kept);
+                i_body += chunk.size();
+                n_kept += chunk.size();
+                continue;
+            }
+            kept_chunk.clear();
+            for (const auto &body_state : chunk)
+            {
+                if (i_body % ingestion.stride == 0 && n_kept + kept_chunk.size() < ingestion.max_n_body)
+                {
+                    kept_chunk.push_back(body_state);
+                }
+                i_body++;
+            }
+            if (!kept_chunk.empty())
+            {
+                consumer(kept_chunk, n_kept);
+                n_kept += kept_chunk.size();
+            }
+        }
+        return n_kept;
+    }
+    template <typename T>
+    size_t ingest_system_state_from_bin(const std::string &bin_file_path, const CORE::INGESTION &ingestion, const CHUNK_CONSUMER<T> &consumer)
+    {
+        std::ifstream bin_istream(bin_file_path, std::ios::binary);
+        if (!bin_istream.is_open())
+        {
+            std::cout << "Cannot open " << bin_file_path << std::endl;
+            ASSERT(false);
+        }
+        const BIN_HEADER header = read_bin_header(bin_istream);
+        const std::streamoff payload_offset = bin_istream.tellg();
+
+        auto ingest = [&](auto file_floating_value)
+        {
+            using F = decltype(file_floating_value);
+            constexpr size_t n_column = CORE::BIN::n_column;
+            std::vector<F> values;
+            uint64_t i_next_body = 0;
+            auto read_chunk = [&](CORE::SYSTEM_STATE_BASE<T> &chunk)
+            {
+                const size_t n_body = static_cast<size_t>(std::min<uint64_t>(ingestion.chunk_size, header.n_body - i_next_body));
+                if (n_body == 0)
+                {
+                    return false;
+                }
+                chunk.resize(n_body);
+                values.resize(n_body * n_column);
+                if (header.version == 1)
+                {
+                    // Records follow each other, from where the previous chunk stopped
+                    bin_istream.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(F));
+                    ASSERT(bin_istream);
+                    for (size_t i_body = 0; i_body < n_body; i_body++)
+                    {
+                        for (size_t i_column = 0; i_column < n_column; i_column++)
+                        {
+                            body_state_value(chunk[i_body], i_column) = static_cast<T>(values[i_body * n_column + i_column]);
+                        }
+                    }
+                }
+                else
+                {
+                    // The same range of every column
+                    const size_t column_stride = CORE::BIN::column_stride(sizeof(F), header.n_body);
+                    for (size_t i_column = 0; i_column < n_column; i_column++)
+                    {
+                        bin_istream.seekg(payload_offset + static_cast<std::streamoff>(i_column * column_stride + i_next_body * sizeof(F)));
+                        bin_istream.read(reinterpret_cast<char *>(values.data() + i_column * n_body), n_body * sizeof(F));
+                        ASSERT(bin_istream);
+                    }
+                    for (size_t i_column = 0; i_column < n_column; i_column++)
+                    {
+                        for (size_t i_body = 0; i_body < n_body; i_body++)
+                        {
+                            body_state_value(chunk[i_body], i_column) = static_cast<T>(values[i_column * n_body + i_body]);
+                        }
+                    }
+                }
+                i_next_body += n_body;
+                return true;
+            };
+            return ingest_chunks<T>(ingestion, read_chunk, consumer);
+        };
+        return header.floating_value_size == sizeof(double) ? ingest(double{}) : ingest(float{});
+    }
+
+    template <typename T>
+    size_t ingest_system_state_from_csv(const std::string &csv_file_path, const CORE::INGESTION &ingestion, const CHUNK_CONSUMER<T> &consumer)
+    {
+        std::ifstream csv_istream(csv_file_path, std::ios::binary);
+        if (!csv_istream.is_open())
+        {
+            std::cout << "Cannot open " << csv_file_path << std::endl;
+            ASSERT(false);
+        }
+        // Bytes read but not parsed yet, the start of a row
+        std::string bytes;
+        auto read_chunk = [&](CORE::SYSTEM_STATE_BASE<T> &chunk)
+        {
+            chunk.clear();
+            while (chunk.empty() && (csv_istream || !bytes.empty()))
+            {
+                const size_t n_left_byte = bytes.size();
+                const size_t n_read_byte = ingestion.chunk_size * n_csv_byte_per_body;
+                bytes.resize(n_left_byte + n_read_byte);
+                csv_istream.read(bytes.data() + n_left_byte, n_read_byte);
+                bytes.resize(n_left_byte + csv_istream.gcount());
+                // Complete rows only, until the end of the file
+                const size_t n_row_byte = csv_istream ? bytes.find_last_of('\n') + 1 : bytes.size();
+                chunk = parse_csv<T>(bytes.data(), n_row_byte);
+                bytes.erase(0, n_row_byte);
+            }
+            return !chunk.empty();
+        };
+        return ingest_chunks<T>(ingestion, read_chunk, consumer);
+    }
+
+    template <typename T>
+    size_t ingest_system_state_from_trajectory(const std::string &trajectory_file_path, const CORE::INGESTION &ingestion, const CHUNK_CONSUMER<T> &consumer)
+    {
+        const CORE::TRAJECTORY_READER trajectory_reader(trajectory_file_path);
+        ASSERT(trajectory_reader.num_frames() > 0);
+        const size_t i_frame = trajectory_reader.num_frames() - 1;
+        const size_t n_body = trajectory_reader.n_body();
+        // COMPRESSED frames only decode whole, RAW ones are read from the mapped pages
+        std::optional<CORE::SYSTEM_STATE_BASE<T>> decoded_frame;
+        if (trajectory_reader.encoding() == CORE::TRAJECTORY::ENCODING::COMPRESSED)
+        {
+            decoded_frame = trajectory_reader.read_frame<T>(i_frame);
+        }
+
+        size_t i_next_body = 0;
+        auto read_chunk = [&](CORE::SYSTEM_STATE_BASE<T> &chunk)
+        {
+            const size_t n_chunk_body = std::min(ingestion.chunk_size, n_body - i_next_body);
+            if (n_chunk_body == 0)
+            {
+                return false;
+            }
+            chunk.resize(n_chunk_body);
+            auto copy = [&](const auto &payload)
+            {
+                for (size_t i_body = 0; i_body < n_chunk_body; i_body++)
+                {
+                    const auto body_pos = payload.pos(i_next_body + i_body);
+                    const auto body_vel = payload.vel(i_next_body + i_body);
+                    auto &[pos, vel, mass] = chunk[i_body];
+                    pos = {static_cast<T>(body_pos.x), static_cast<T>(body_pos.y), static_cast<T>(body_pos.z)};
+                    vel = {static_cast<T>(body_vel.x), static_cast<T>(body_vel.y), static_cast<T>(body_vel.z)};
+                    mass = static_cast<T>(payload.mass(i_next_body + i_body));
+                }
+            };
+            if (decoded_frame)
+            {
+                std::copy_n(decoded_frame->begin() + i_next_body, n_chunk_body, chunk.begin());
+            }
+            else if (trajectory_reader.floating_value_size() == sizeof(double))
+            {
+                copy(trajectory_reader.frame_view<double>(i_frame));
+            }
+            else
+            {
+                copy(trajectory_reader.frame_view<float>(i_frame));
+            }
+            i_next_body += n_chunk_body;
+            return true;
+        };
+        return ingest_chunks<T>(ingestion, read_chunk, consumer);
+    }
+
+    /// Fewer TIPSY or GADGET particles per thread are not worth a thread
+    constexpr size_t min_n_particle_per_thread = 1 << 12;
+
+    /// Value of type F at bytes, from a file of either endianness
+    template <typename F>
+    F load_value(const unsigned char *bytes, bool is_byte_swapped)
+    {
+        static_assert(sizeof(F) == sizeof(uint32_t) || sizeof(F) == sizeof(uint64_t));
+        if constexpr (sizeof(F) == sizeof(uint32_t))
+        {
+            uint32_t bits;
+            std::memcpy(&bits, bytes, sizeof(bits));
+            bits = is_byte_swapped ? __builtin_bswap32(bits) : bits;
+            F value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        else
+        {
+            uint64_t bits;
+            std::memcpy(&bits, bytes, sizeof(bits));
+            bits = is_byte_swapped ? __builtin_bswap64(bits) : bits;
+            F value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+
+    /// Where the particles of one type lie in a mapped TIPSY or GADGET file
+    struct PARTICLE_FIELDS
+    {
+        uint64_t n_particle = 0;
+        /// Of the first particle, in bytes
+        uint64_t pos_offset = 0, vel_offset = 0, mass_offset = 0;
+        /// From a particle to the next, in bytes, no mass is stored if mass_stride is 0
+        uint64_t pos_stride = 0, vel_stride = 0, mass_stride = 0;
+        double fixed_mass = 0;
+    };
+
+    /// The particles of a TIPSY or GADGET file, by type, see CORE::TIPSY and CORE::GADGET
+    struct PARTICLE_LAYOUT
+    {
+        const char *format_name = "";
+        bool is_byte_swapped = false;
+        /// Of every stored value, 4 or 8
+        int floating_value_size = sizeof(float);
+        std::vector<PARTICLE_FIELDS> types;
+        CORE::SNAPSHOT_UNITS units;
+
+        uint64_t num_selected_particles(uint32_t body_types) const
+        {
+            uint64_t n_particle = 0;
+            for (size_t i_type = 0; i_type < types.size(); i_type++)
+            {
+                n_particle += (body_types >> i_type & 1) ? types[i_type].n_particle : 0;
+            }
+            return n_particle;
+        }
+    };
+
+    /// dKpcUnit and dMsolUnit of a TIPSY snapshot, as yt defaults them, a .param file missing or lacking them
+    constexpr double tipsy_default_kpc_unit = 1;
+    constexpr double tipsy_default_msol_unit = 1;
+
+    /// The .param file next to a TIPSY file, <name>.param for <name>.<anything> or else the only .param of the directory, if any
+    std::optional<std::filesystem::path> find_tipsy_param(const std::string &tipsy_file_path)
+    {
+        namespace fs = std::filesystem;
+        const fs::path tipsy_path(tipsy_file_path);
+        const fs::path dir = tipsy_path.has_parent_path() ? tipsy_path.parent_path() : fs::path(".");
+        const std::string file_name = tipsy_path.filename().string();
+        fs::path param_path = dir / (file_name.substr(0, file_name.find('.')) + ".param");
+        if (fs::exists(param_path))
+        {
+            return param_path;
+        }
+        param_path.clear();
+        for (const auto &entry : fs::directory_iterator(dir))
+        {
+            if (entry.path().extension() == ".param")
+            {
+                if (!param_path.empty())
+                {
+                    return std::nullopt;
+                }
+                param_path = entry.path();
+            }
+        }
+        if (param_path.empty())
+        {
+            return std::nullopt;
+        }
+        return param_path;
+    }
+
+    /// Units of a TIPSY file from dKpcUnit and dMsolUnit of its .param file, as yt reads them into pc, km/s and Msun
+    /// (see scripts/bicgen/translation.py): either one missing or invalid takes its default, G being 1 in TIPSY units
+    CORE::SNAPSHOT_UNITS read_tipsy_param_units(const std::string &tipsy_file_path)
+    {
+        double kpc_unit = tipsy_default_kpc_unit;
+        double msol_unit = tipsy_default_msol_unit;
+        const std::optional<std::filesystem::path> param_path = find_tipsy_param(tipsy_file_path);
+        if (param_path)
+        {
+            std::ifstream param_istream(*param_path);
+            ASSERT(param_istream.is_open());
+            std::string line;
+            while (std::getline(param_istream, line))
+            {
+                const std::string content = line.substr(0, line.find('#'));
+                const size_t i_equal = content.find('=');
+                if (i_equal == std::string::npos)
+                {
+                    continue;
+                }
+                std::string name = content.substr(0, i_equal);
+                name.erase(std::remove_if(name.begin(), name.end(), is_csv_space), name.end());
+                if (name != "dKpcUnit" && name != "dMsolUnit")
+                {
+                    continue;
+                }
+                const char *last = content.data() + content.size();
+                const char *first = skip_csv_space(content.data() + i_equal + 1, last);
+                double value = 0;
+                const auto [value_last, ec] = std::from_chars(first, last, value);
+                if (ec != std::errc() || skip_csv_space(value_last, last) != last || !(value > 0))
+                {
+                    // Skip invalid line
+                    std::cout << "Invalid .param line: " << line << std::endl;
+                    continue;
+                }
+                (name == "dKpcUnit" ? kpc_unit : msol_unit) = value;
+            }
+            std::cout << "TIPSY units of " << param_path->string() << ": dKpcUnit " << kpc_unit << ", dMsolUnit " << msol_unit << std::endl;
+        }
+        else
+        {
+            std::cout << "No .param file, TIPSY units of dKpcUnit " << kpc_unit << ", dMsolUnit " << msol_unit << std::endl;
+        }
+        CORE::SNAPSHOT_UNITS units;
+        units.length_in_pc = kpc_unit * 1000;
+        units.mass_in_msun = msol_unit;
+        // G = 1 in code units
+        units.velocity_in_kms = std::sqrt(CORE::G_solar_mass_parsec_kmps * units.mass_in_msun / units.length_in_pc);
+        return units;
+    }
+
+    /// The layout of a TIPSY file, if its header matches its size
+    std::optional<PARTICLE_LAYOUT> read_tipsy_layout(const unsigned char *data, size_t size)
+    {
+        constexpr uint64_t gas_record_size = 12 * sizeof(float);
+        constexpr uint64_t dark_record_size = 9 * sizeof(float);
+        constexpr uint64_t star_record_size = 11 * sizeof(float);
+        constexpr size_t unpadded_header_size = 28;
+        if (size < unpadded_header_size)
+        {
+            return std::nullopt;
+        }
+        // Big-endian first, as written through XDR
+        for (const bool is_byte_swapped : {true, false})
+        {
+            auto header_int = [&](size_t offset)
+            { return load_value<int32_t>(data + offset, is_byte_swapped); };
+            const int32_t n_body = header_int(8), n_dim = header_int(12);
+            const int32_t n_gas = header_int(16), n_dark = header_int(20), n_star = header_int(24);
+            if (n_dim != 3 || n_gas < 0 || n_dark < 0 || n_star < 0 ||
+                int64_t{n_gas} + n_dark + n_star != n_body)
+            {
+                continue;
+            }
+            const uint64_t payload_size = n_gas * gas_record_size + n_dark * dark_record_size + n_star * star_record_size;
+            const uint64_t header_size = size - std::min<uint64_t>(payload_size, size);
+            if (payload_size > size || (header_size != unpadded_header_size && header_size != unpadded_header_size + 4))
+            {
+                continue;
+            }
+
+            PARTICLE_LAYOUT layout;
+            layout.format_name = "TIPSY";
+            layout.is_byte_swapped = is_byte_swapped;
+            uint64_t record_offset = header_size;
+            for (const auto &[n_particle, record_size] : {std::pair<uint64_t, uint64_t>{n_gas, gas_record_size},
+                                                          {n_dark, dark_record_size},
+                                                          {n_star, star_record_size}})
+            {
+                PARTICLE_FIELDS fields;
+                fields.n_particle = n_particle;
+                fields.mass_offset = record_offset;
+                fields.pos_offset = record_offset + sizeof(float);
+                fields.vel_offset = record_offset + 4 * sizeof(float);
+                fields.mass_stride = fields.pos_stride = fields.vel_stride = record_size;
+                layout.types.push_back(fields);
+                record_offset += n_particle * record_size;
+            }
+            return layout;
+        }
+        return std::nullopt;
+    }
+
+    /// The layout of a GADGET-2 file, if it starts as one
+    std::optional<PARTICLE_LAYOUT> read_gadget_layout(const unsigned char *data, size_t size)
+    {
+        constexpr uint32_t label_block_size = 8;
+        if (size < sizeof(uint32_t) + sizeof(uint32_t))
+        {
+            return std::nullopt;
+        }
+        PARTICLE_LAYOUT layout;
+        layout.format_name = "GADGET";
+        bool has_labels = false;
+        const uint32_t first_marker = load_value<uint32_t>(data, false);
+        if (first_marker == CORE::GADGET::header_size || __builtin_bswap32(first_marker) == CORE::GADGET::header_size)
+        {
+            layout.is_byte_swapped = first_marker != CORE::GADGET::header_size;
+        }
+        else if ((first_marker == label_block_size || __builtin_bswap32(first_marker) == label_block_size) &&
+                 std::memcmp(data + sizeof(uint32_t), "HEAD", 4) == 0)
+        {
+            layout.is_byte_swapped = first_marker != label_block_size;
+            has_labels = true;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+
+        // Payload offset and size of the blocks in order, with their size markers checked
+        uint64_t offset = 0;
+        auto next_block = [&](const char *label) -> std::optional<std::pair<uint64_t, uint64_t>>
+        {
+            if (has_labels)
+            {
+                if (offset + label_block_size + 2 * sizeof(uint32_t) > size ||
+                    load_value<uint32_t>(data + offset, layout.is_byte_swapped) != label_block_size ||
+                    std::memcmp(data + offset + sizeof(uint32_t), label, 4) != 0)
+                {
+                    return std::nullopt;
+                }
+                offset += label_block_size + 2 * sizeof(uint32_t);
+            }
+            if (offset + sizeof(uint32_t) > size)
+            {
+                return std::nullopt;
+            }
+            const uint64_t block_size = load_value<uint32_t>(data + offset, layout.is_byte_swapped);
+            const uint64_t payload_offset = offset + sizeof(uint32_t);
+            if (payload_offset + block_size + sizeof(uint32_t) > size ||
+                load_value<uint32_t>(data + payload_offset + block_size, layout.is_byte_swapped) != block_size)
+            {
+                return std::nullopt;
+            }
+            offset = payload_offset + block_size + sizeof(uint32_t);
+            return std::pair<uint64_t, uint64_t>{payload_offset, block_size};
+        };
+
+        const auto header_block = next_block("HEAD");
+        if (!header_block || header_block->second != CORE::GADGET::header_size)
+        {
+            return std::nullopt;
+        }
+        const unsigned char *header = data + header_block->first;
+        auto header_value = [&](auto value, size_t offset)
+        { return load_value<decltype(value)>(header + offset, layout.is_byte_swapped); };
+        const int32_t num_files = header_value(int32_t{}, 124);
+        if (num_files > 1)
+        {
+            std::cout << "GADGET snapshots split into " << num_files << " files are not supported" << std::endl;
+            ASSERT(false);
+        }
+
+        uint64_t n_particle = 0;
+        uint64_t n_stored_mass = 0;
+        for (int i_type = 0; i_type < CORE::GADGET::n_body_type; i_type++)
+        {
+            PARTICLE_FIELDS fields;
+            const int32_t n_type_particle = header_value(int32_t{}, i_type * sizeof(int32_t));
+            ASSERT(n_type_particle >= 0);
+            fields.n_particle = static_cast<uint64_t>(n_type_particle);
+            fields.fixed_mass = header_value(double{}, 24 + i_type * sizeof(double));
+            // Indices for now, offsets once the value size is known
+            fields.pos_offset = fields.vel_offset = n_particle;
+            fields.mass_offset = n_stored_mass;
+            fields.mass_stride = fields.n_particle > 0 && fields.fixed_mass == 0;
+            n_particle += fields.n_particle;
+            n_stored_mass += fields.mass_stride ? fields.n_particle : 0;
+            layout.types.push_back(fields);
+        }
+
+        const auto pos_block = next_block("POS ");
+        const auto vel_block = next_block("VEL ");
+        ASSERT(pos_block && vel_block && pos_block->second == vel_block->second);
+        if (n_particle > 0)
+        {
+            ASSERT(pos_block->second == 3 * n_particle * sizeof(float) || pos_block->second == 3 * n_particle * sizeof(double));
+            layout.floating_value_size = static_cast<int>(pos_block->second / (3 * n_particle));
+        }
+        std::optional<std::pair<uint64_t, uint64_t>> mass_block;
+        if (n_stored_mass > 0)
+        {
+            ASSERT(next_block("ID  "));
+            mass_block = next_block("MASS");
+            ASSERT(mass_block && mass_block->second == n_stored_mass * layout.floating_value_size);
+        }
+        for (PARTICLE_FIELDS &fields : layout.types)
+        {
+            const uint64_t vector_size = 3 * layout.floating_value_size;
+            fields.pos_offset = pos_block->first + fields.pos_offset * vector_size;
+            fields.vel_offset = vel_block->first + fields.vel_offset * vector_size;
+            fields.pos_stride = fields.vel_stride = vector_size;
+            fields.mass_offset = mass_block ? mass_block->first + fields.mass_offset * layout.floating_value_size : 0;
+            fields.mass_stride *= layout.floating_value_size;
+        }
+
+        // Physical coordinates at the scale factor of cosmological snapshots
+        const double scale_factor = header_value(double{}, 72);
+        const double omega_0 = header_value(double{}, 136);
+        const double hubble_param = header_value(double{}, 152);
+        const bool is_cosmological = omega_0 > 0;
+        const double h = is_cosmological && hubble_param > 0 ? hubble_param : 1;
+        layout.units.length_in_pc = 1000 / h * (is_cosmological ? scale_factor : 1);
+        layout.units.velocity_in_kms = is_cosmological ? std::sqrt(scale_factor) : 1;
+        layout.units.mass_in_msun = 1e10 / h;
+        return layout;
+    }
+
+    enum class FILE_FORMAT
+    {
+        CSV,
+        BIN,
+        TRAJECTORY,
+        TIPSY,
+        GADGET
+    };
+
+    /// CSV and TRAJECTORY by extension, the others by content
+    FILE_FORMAT detect_file_format(const std::string &file_path)
+    {
+        const std::string ext = file_extension(file_path);
+        if (ext == "csv")
+        {
+            return FILE_FORMAT::CSV;
+        }
+        else if (ext == "traj")
+        {
+            return FILE_FORMAT::TRAJECTORY;
+        }
+
+        const CORE::MAPPED_FILE file(file_path);
+        if (file.size() >= sizeof(CORE::BIN::magic) && std::memcmp(file.data(), CORE::BIN::magic, sizeof(CORE::BIN::magic)) == 0)
+        {
+            return FILE_FORMAT::BIN;
+        }
+        else if (read_gadget_layout(file.data(), file.size()))
+        {
+            return FILE_FORMAT::GADGET;
+        }
+        else if (read_tipsy_layout(file.data(), file.size()))
+        {
+            return FILE_FORMAT::TIPSY;
+        }
+        // Version 1 starts with the size of its floating type
+        ASSERT(file.size() >= sizeof(uint32_t) && "Unsupported file");
+        const uint32_t floating_value_size = load_value<uint32_t>(file.data(), false);
+        ASSERT((floating_value_size == sizeof(float) || floating_value_size == sizeof(double)) && "Unsupported file");
+        return FILE_FORMAT::BIN;
+    }
+
+    /// Decodes the selected particles of a mapped TIPSY or GADGET file into TUSS units, chunk by chunk on all threads
+    template <typename T>
+    size_t ingest_particles(const std::string &file_path, const CORE::MAPPED_FILE &file, const PARTICLE_LAYOUT &layout,
+                            const CORE::INGESTION &ingestion, const CHUNK_CONSUMER<T> &consumer)
+    {
+        const CORE::SNAPSHOT_UNITS units = ingestion.units.value_or(layout.units);
+        std::cout << file_path << ": " << layout.format_name << ", particles of type";
+        for (size_t i_type = 0; i_type < layout.types.size(); i_type++)
         {
-            const auto &body_pos = std::get<POS>(body_state);
-            const auto &body_vel = std::get<VEL>(body_state);
-            const auto body_mass = std::get<MASS>(body_state);
+            std::cout << " " << i_type << ": " << layout.types[i_type].n_particle
+                      << ((ingestion.body_types >> i_type & 1) ? "" : " (skipped)");
+        }
+        std::cout << std::endl;
+
+        auto ingest = [&](auto file_floating_value)
+        {
+            using F = decltype(file_floating_value);
+            const unsigned char *data = file.data();
+            auto load_vector = [&](uint64_t offset)
+            {
+                return CORE::XYZ_BASE<double>{static_cast<double>(load_value<F>(data + offset, layout.is_byte_swapped)),
+                                        static_cast<double>(load_value<F>(data + offset + sizeof(F), layout.is_byte_swapped)),
+                                        static_cast<double>(load_value<F>(data + offset + 2 * sizeof(F), layout.is_byte_swapped))};
+            };
+            auto decode = [&](const PARTICLE_FIELDS &fields, uint64_t i_particle, CORE::BODY_STATE_BASE<T> &body_state)
+            {
+                const CORE::XYZ_BASE<double> pos = load_vector(fields.pos_offset + i_particle * fields.pos_stride) * units.length_in_pc;
+                const CORE::XYZ_BASE<double> vel = load_vector(fields.vel_offset + i_particle * fields.vel_stride) * units.velocity_in_kms;
+                const double mass = fields.mass_stride == 0
+                                        ? fields.fixed_mass
+                                        : static_cast<double>(load_value<F>(data + fields.mass_offset + i_particle * fields.mass_stride, layout.is_byte_swapped));
+                auto &[body_pos, body_vel, body_mass] = body_state;
+                body_pos = {static_cast<T>(pos.x), static_cast<T>(pos.y), static_cast<T>(pos.z)};
+                body_vel = {static_cast<T>(vel.x), static_cast<T>(vel.y), static_cast<T>(vel.z)};
+                body_mass = static_cast<T>(mass * units.mass_in_msun * CORE::G_solar_mass_parsec_kmps);
+            };
+
+            // Particles of one type that follow each other in the chunk, from chunk[i_first_body]
+            struct RANGE
+            {
+                size_t i_type;
+                uint64_t i_first_particle;
+                size_t i_first_body;
+            };
+            std::vector<RANGE> ranges;
+            size_t i_type = 0;
+            uint64_t i_next_particle = 0;
+            auto read_chunk = [&](CORE::SYSTEM_STATE_BASE<T> &chunk)
+            {
+                ranges.clear();
+                size_t n_chunk_body = 0;
+                while (n_chunk_body < ingestion.chunk_size && i_type < layout.types.size())
+                {
+                    const uint64_t n_type_particle = (ingestion.body_types >> i_type & 1) ? layout.types[i_type].n_particle : 0;
+                    if (i_next_particle == n_type_particle)
+                    {
+                        i_type++;
+                        i_next_particle = 0;
+                        continue;
+                    }
+                    const size_t n_range_body = static_cast<size_t>(std::min<uint64_t>(ingestion.chunk_size - n_chunk_body, n_type_particle - i_next_particle));
+                    ranges.push_back({i_type, i_next_particle, n_chunk_body});
+                    n_chunk_body += n_range_body;
+                    i_next_particle += n_range_body;
+                }
+                if (n_chunk_body == 0)
+                {
+                    return false;
+                }
+                chunk.resize(n_chunk_body);
+                CORE::parallel_chunks(n_chunk_body, CORE::default_n_thread(n_chunk_body, min_n_particle_per_thread),
+                                      [&](size_t, size_t begin, size_t end)
+                                      {
+                                          auto range = std::prev(std::upper_bound(ranges.begin(), ranges.end(), begin,
+                                                                                  [](size_t i_body, const RANGE &range)
+                                                                                  { return i_body < range.i_first_body; }));
+                                          for (size_t i_body = begin; i_body < end; i_body++)
+                                          {
+                                              if (std::next(range) != ranges.end() && i_body == std::next(range)->i_first_body)
+                                              {
+                                                  ++range;
+                                              }
+                                              decode(layout.types[range->i_type], range->i_first_particle + (i_body - range->i_first_body), chunk[i_body]);
+                                          }
+                                      });
+                return true;
+            };
+            return ingest_chunks<T>(ingestion, read_chunk, consumer);
+        };
+        return layout.floating_value_size == sizeof(double) ? ingest(double{}) : ingest(float{});
+    }
 
-            write_as_binary(bin_ostream, body_pos.x);
-            write_as_binary(bin_ostream, body_pos.y);
-            write_as_binary(bin_ostream, body_pos.z);
-            write_as_binary(bin_ostream, body_vel.x);
-            write_as_binary(bin_ostream, body_vel.y);
-            write_as_binary(bin_ostream, body_vel.z);
-            write_as_binary(bin_ostream, body_mass);
+    /// ingest_particles() of a TIPSY or GADGET file
+    template <typename T>
+    size_t ingest_system_state_from_snapshot(const std::string &file_path, FILE_FORMAT format, const CORE::INGESTION &ingestion,
+                                             const CHUNK_CONSUMER<T> &consumer)
+    {
+        const CORE::MAPPED_FILE file(file_path);
+        if (format == FILE_FORMAT::TIPSY)
+        {
+            PARTICLE_LAYOUT layout = read_tipsy_layout(file.data(), file.size()).value();
+            if (!ingestion.units)
+            {
+                layout.units = read_tipsy_param_units(file_path);
+            }
+            return ingest_particles<T>(file_path, file, layout, ingestion, consumer);
         }
+        return ingest_particles<T>(file_path, file, read_gadget_layout(file.data(), file.size()).value(), ingestion, consumer);
     }
+}
 
-    void serialize_system_state_to_bin(const std::string &bin_file_path, const SYSTEM_STATE &system_state, bool print_file_name)
+namespace CORE
+{
+    template <typename T>
+    void serialize_system_state_to_csv(std::ostream &csv_ostream, const SYSTEM_STATE_BASE<T> &system_state)
+    {
+        const size_t n_body = system_state.size();
+        const size_t n_thread = default_n_thread(n_body, min_n_csv_row_per_thread);
+        std::vector<std::string> chunk_texts(n_thread);
+
+        // Formats n_csv_row_per_write rows per thread at a time, then writes them out in order
+        for (size_t i_body_begin = 0; i_body_begin < n_body; i_body_begin += n_thread * n_csv_row_per_write)
+        {
+            const size_t n_batch_body = std::min(n_thread * n_csv_row_per_write, n_body - i_body_begin);
+            parallel_chunks(n_batch_body, n_thread,
+                            [&](size_t i_chunk, size_t begin, size_t end)
+                            {
+                                std::string &text = chunk_texts[i_chunk];
+                                text.clear();
+                                // Fits 7 values of the largest double in fixed notation
+                                char row[7 * 512];
+                                /// (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each row
+                                for (size_t i_body = i_body_begin + begin; i_body < i_body_begin + end; i_body++)
+                                {
+                                    const auto &[p, v, m] = system_state[i_body];
+                                    char *row_last = row;
+                                    char *const row_end = row + sizeof(row);
+                                    for (T value : {p.x, p.y, p.z, v.x, v.y, v.z})
+                                    {
+                                        row_last = format_csv_value(row_last, row_end, value);
+                                        *row_last++ = ',';
+                                    }
+                                    row_last = format_csv_value(row_last, row_end, m);
+                                    *row_last++ = '\n';
+                                    text.append(row, row_last);
+                                }
+                            });
+            for (const auto &text : chunk_texts)
+            {
+                csv_ostream.write(text.data(), text.size());
+            }
+        }
+    }
+
+    template <typename T>
+    void serialize_system_state_to_csv(const std::string &csv_file_path, const SYSTEM_STATE_BASE<T> &system_state)
+    {
+        std::ofstream csv_file_ofstream(csv_file_path);
+        ASSERT(csv_file_ofstream.is_open());
+        serialize_system_state_to_csv(csv_file_ofstream, system_state);
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv(std::istream &csv_istream)
+    {
+        const std::string csv_str(std::istreambuf_iterator<char>(csv_istream), {});
+        return parse_csv<T>(csv_str.data(), csv_str.size());
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv(const std::string &csv_file_path)
+    {
+        const MAPPED_FILE csv_file(csv_file_path);
+        return parse_csv<T>(reinterpret_cast<const char *>(csv_file.data()), csv_file.size());
+    }
+
+    template <typename T>
+    void serialize_system_state_to_bin(std::ostream &bin_ostream, const SYSTEM_STATE_BASE<T> &system_state,
+                                       const std::optional<BIN::METADATA> &metadata, uint32_t version)
+    {
+        if (version == 1)
+        {
+            ASSERT(!metadata && "BIN version 1 has no metadata");
+            serialize_system_state_to_bin_v1<T>(bin_ostream, system_state);
+        }
+        else
+        {
+            ASSERT(version == 2);
+            serialize_system_state_to_bin_v2<T>(bin_ostream, system_state, metadata);
+        }
+    }
+
+    template <typename T>
+    void serialize_system_state_to_bin(std::ostream &bin_ostream, const SOA_SYSTEM_STATE_BASE<T> &system_state,
+                                       const std::optional<BIN::METADATA> &metadata, uint32_t version)
+    {
+        if (version == 1)
+        {
+            ASSERT(!metadata && "BIN version 1 has no metadata");
+            serialize_system_state_to_bin_v1<T>(bin_ostream, system_state);
+        }
+        else
+        {
+            ASSERT(version == 2);
+            serialize_system_state_to_bin_v2<T>(bin_ostream, system_state, metadata);
+        }
+    }
+
+    template <typename T>
+    void serialize_system_state_to_bin(const std::string &bin_file_path, const SOA_SYSTEM_STATE_BASE<T> &system_state, bool print_file_name,
+                                       const std::optional<BIN::METADATA> &metadata, uint32_t version)
     {
         std::ofstream bin_file_ofstream(bin_file_path, std::ios::binary);
         if (!bin_file_ofstream.is_open())
@@ -131,90 +1116,273 @@ namespace CORE
             ASSERT(false);
         }
 
-        serialize_system_state_to_bin(bin_file_ofstream, system_state);
+        serialize_system_state_to_bin(bin_file_ofstream, system_state, metadata, version);
         if (print_file_name)
         {
             std::cout << "Successfully wrote to " << bin_file_path << std::endl;
         }
     }
 
-    SYSTEM_STATE deserialize_system_state_from_bin(std::istream &bin_istream)
+    template <typename T>
+    void serialize_system_state_to_bin(const std::string &bin_file_path, const SYSTEM_STATE_BASE<T> &system_state, bool print_file_name,
+                                       const std::optional<BIN::METADATA> &metadata, uint32_t version)
     {
-        SYSTEM_STATE system_state;
+        std::ofstream bin_file_ofstream(bin_file_path, std::ios::binary);
+        if (!bin_file_ofstream.is_open())
+        {
+            std::cout << "Cannot open " << bin_file_path << std::endl;
+            ASSERT(false);
+        }
 
-        // - first 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
-        const auto size_floating_value_type = read_as_binary<int>(bin_istream);
-        if (sizeof(UNIVERSE::floating_value_type) != size_floating_value_type)
+        serialize_system_state_to_bin(bin_file_ofstream, system_state, metadata, version);
+        if (print_file_name)
         {
-            std::cout << "Warning: unmatched floating value sizes! Will cast!" << std::endl;
-            std::cout << "sizeof(UNIVERSE::floating_value_type)=" << sizeof(UNIVERSE::floating_value_type) << std::endl;
-            std::cout << "size_floating_value_type=" << size_floating_value_type << std::endl;
-            // ASSERT(sizeof(UNIVERSE::floating_value_type) == size_floating_value_type);
+            std::cout << "Successfully wrote to " << bin_file_path << std::endl;
         }
+    }
 
-        /// - second 4 bytes: number of bodies
-        const auto num_bodies = read_as_binary<int>(bin_istream);
-        system_state.reserve(num_bodies);
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin(std::istream &bin_istream)
+    {
+        SYSTEM_STATE_BASE<T> system_state;
 
-        // - rest: (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
-        for (int count_bodies = 0; count_bodies < num_bodies; count_bodies++)
+        const BIN_HEADER header = read_bin_header(bin_istream);
+        const int size_floating_value_type = header.floating_value_size;
+        const uint32_t version = header.version;
+        const uint64_t num_bodies = header.n_body;
+        if (static_cast<int>(sizeof(T)) < size_floating_value_type)
         {
-            POS body_pos;
-            VEL body_vel;
-            MASS body_mass;
+            std::cout << "Warning: unmatched floating value sizes! Will cast!" << std::endl;
+            std::cout << "sizeof(T)=" << sizeof(T) << std::endl;
+            std::cout << "size_floating_value_type=" << size_floating_value_type << std::endl;
+        }
 
+        if (version == 2)
+        {
+            // - columns POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS
+            system_state.resize(num_bodies);
             if (size_floating_value_type == sizeof(double))
             {
-                body_pos.x = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_pos.y = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_pos.z = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_vel.x = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_vel.y = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_vel.z = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-                body_mass = static_cast<UNIVERSE::floating_value_type>(read_as_binary<double>(bin_istream));
-            }
-            else if (size_floating_value_type == sizeof(float))
-            {
-                body_pos.x = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_pos.y = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_pos.z = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_vel.x = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_vel.y = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_vel.z = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
-                body_mass = static_cast<UNIVERSE::floating_value_type>(read_as_binary<float>(bin_istream));
+                deserialize_system_state_from_bin_v2_columns<T, double>(bin_istream, system_state);
             }
             else
             {
-                ASSERT(false && "Unsupported floating value size!");
+                deserialize_system_state_from_bin_v2_columns<T, float>(bin_istream, system_state);
             }
+            return system_state;
+        }
 
+        system_state.reserve(num_bodies);
+        // - rest: (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
+        auto read_body_state = [&bin_istream, &system_state](auto file_floating_value)
+        {
+            using F = decltype(file_floating_value);
+            POS_BASE<T> body_pos;
+            VEL_BASE<T> body_vel;
+            body_pos.x = static_cast<T>(read_as_binary<F>(bin_istream));
+            body_pos.y = static_cast<T>(read_as_binary<F>(bin_istream));
+            body_pos.z = static_cast<T>(read_as_binary<F>(bin_istream));
+            body_vel.x = static_cast<T>(read_as_binary<F>(bin_istream));
+            body_vel.y = static_cast<T>(read_as_binary<F>(bin_istream));
+            body_vel.z = static_cast<T>(read_as_binary<F>(bin_istream));
+            const T body_mass = static_cast<T>(read_as_binary<F>(bin_istream));
             system_state.emplace_back(body_pos, body_vel, body_mass);
+        };
+        for (uint64_t count_bodies = 0; count_bodies < num_bodies; count_bodies++)
+        {
+            if (size_floating_value_type == sizeof(double))
+            {
+                read_body_state(double{});
+            }
+            else
+            {
+                read_body_state(float{});
+            }
         }
 
         return system_state;
     }
 
-    SYSTEM_STATE deserialize_system_state_from_bin(const std::string &bin_file_path)
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin(const std::string &bin_file_path)
     {
         std::ifstream bin_file_ifstream(bin_file_path, std::ios::binary);
         ASSERT(bin_file_ifstream.is_open());
-        return deserialize_system_state_from_bin(bin_file_ifstream);
+        return deserialize_system_state_from_bin<T>(bin_file_ifstream);
     }
 
-    SYSTEM_STATE deserialize_system_state_from_file(const std::string &file_path)
+    std::optional<BIN::METADATA> deserialize_metadata_from_bin(const std::string &bin_file_path)
     {
-        std::string ext = file_path.substr(file_path.find_last_of(".") + 1);
-        if (ext == "csv")
+        return MAPPED_BIN(bin_file_path).metadata();
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_trajectory(const std::string &trajectory_file_path, long i_frame)
+    {
+        const TRAJECTORY_READER trajectory_reader(trajectory_file_path);
+        ASSERT(trajectory_reader.num_frames() > 0);
+        if (i_frame < 0)
         {
-            return deserialize_system_state_from_csv(file_path);
+            i_frame = static_cast<long>(trajectory_reader.num_frames()) - 1;
         }
-        else if (ext == "bin")
+        return trajectory_reader.read_frame<T>(static_cast<size_t>(i_frame));
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_file(const std::string &file_path)
+    {
+        switch (detect_file_format(file_path))
         {
-            return deserialize_system_state_from_bin(file_path);
+        case FILE_FORMAT::CSV:
+            return deserialize_system_state_from_csv<T>(file_path);
+        case FILE_FORMAT::BIN:
+            return deserialize_system_state_from_mapped_bin<T>(file_path);
+        case FILE_FORMAT::TRAJECTORY:
+            return deserialize_system_state_from_trajectory<T>(file_path);
+        default:
+            return deserialize_system_state_from_file<T>(file_path, INGESTION{});
         }
-        else
+    }
+
+    template <typename T>
+    size_t ingest_system_state_from_file(const std::string &file_path, const INGESTION &ingestion,
+                                         const std::function<void(const SYSTEM_STATE_BASE<T> &, size_t)> &consumer)
+    {
+        ASSERT(ingestion.chunk_size > 0 && ingestion.stride > 0);
+        const FILE_FORMAT format = detect_file_format(file_path);
+        switch (format)
+        {
+        case FILE_FORMAT::CSV:
+            return ingest_system_state_from_csv<T>(file_path, ingestion, consumer);
+        case FILE_FORMAT::BIN:
+            return ingest_system_state_from_bin<T>(file_path, ingestion, consumer);
+        case FILE_FORMAT::TRAJECTORY:
+            return ingest_system_state_from_trajectory<T>(file_path, ingestion, consumer);
+        default:
+            return ingest_system_state_from_snapshot<T>(file_path, format, ingestion, consumer);
+        }
+    }
+
+    std::optional<size_t> num_bodies_to_ingest(const std::string &file_path, const INGESTION &ingestion)
+    {
+        ASSERT(ingestion.stride > 0);
+        size_t n_body = 0;
+        switch (detect_file_format(file_path))
+        {
+        case FILE_FORMAT::BIN:
+        {
+            std::ifstream bin_istream(file_path, std::ios::binary);
+            ASSERT(bin_istream.is_open());
+            n_body = static_cast<size_t>(read_bin_header(bin_istream).n_body);
+            break;
+        }
+        case FILE_FORMAT::TRAJECTORY:
+            n_body = TRAJECTORY_READER(file_path).n_body();
+            break;
+        case FILE_FORMAT::TIPSY:
+        {
+            const MAPPED_FILE file(file_path);
+            n_body = read_tipsy_layout(file.data(), file.size())->num_selected_particles(ingestion.body_types);
+            break;
+        }
+        case FILE_FORMAT::GADGET:
         {
-            ASSERT(false && "Unsupported extension");
+            const MAPPED_FILE file(file_path);
+            n_body = read_gadget_layout(file.data(), file.size())->num_selected_particles(ingestion.body_types);
+            break;
         }
+        default:
+            return std::nullopt;
+        }
+        return std::min((n_body + ingestion.stride - 1) / ingestion.stride, ingestion.max_n_body);
     }
-}
\ No newline at end of file
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_file(const std::string &file_path, const INGESTION &ingestion)
+    {
+        SYSTEM_STATE_BASE<T> system_state;
+        if (const std::optional<size_t> n_body = num_bodies_to_ingest(file_path, ingestion))
+        {
+            system_state.reserve(*n_body);
+        }
+        ingest_system_state_from_file<T>(file_path, ingestion,
+                                         [&system_state](const SYSTEM_STATE_BASE<T> &chunk, size_t)
+                                         { system_state.insert(system_state.end(), chunk.begin(), chunk.end()); });
+        return system_state;
+    }
+
+    template <typename T>
+    SOA_SYSTEM_STATE_BASE<T> deserialize_soa_system_state_from_file(const std::string &file_path, const INGESTION &ingestion)
+    {
+        SOA_SYSTEM_STATE_BASE<T> system_state;
+        if (detect_file_format(file_path) == FILE_FORMAT::BIN && ingestion.stride == 1)
+        {
+            const MAPPED_BIN mapped_bin(file_path);
+            if (mapped_bin.version() == 2)
+            {
+                // Column by column, straight from the mapped pages
+                system_state.resize(std::min(mapped_bin.n_body(), ingestion.max_n_body));
+                auto copy_columns = [&system_state](const auto &columns)
+                {
+                    for (size_t i_column = 0; i_column < BIN::n_column; i_column++)
+                    {
+                        std::copy_n(columns.column(i_column), system_state.size(), system_state.column(i_column).data());
+                    }
+                };
+                if (mapped_bin.floating_value_size() == sizeof(float))
+                {
+                    copy_columns(mapped_bin.columns<float>());
+                }
+                else
+                {
+                    copy_columns(mapped_bin.columns<double>());
+                }
+                return system_state;
+            }
+        }
+
+        if (const std::optional<size_t> n_body = num_bodies_to_ingest(file_path, ingestion))
+        {
+            system_state.reserve(*n_body);
+        }
+        ingest_system_state_from_file<T>(file_path, ingestion,
+                                         [&system_state](const SYSTEM_STATE_BASE<T> &chunk, size_t i_first_body)
+                                         {
+                                             system_state.resize(i_first_body + chunk.size());
+                                             for (size_t i_body = 0; i_body < chunk.size(); i_body++)
+                                             {
+                                                 system_state.set_body(i_first_body + i_body, chunk[i_body]);
+                                             }
+                                         });
+        return system_state;
+    }
+
+    /// Instantiations
+
+#define INSTANTIATE_SERDE(T)                                                                                  \
+    template void serialize_system_state_to_csv<T>(std::ostream &, const SYSTEM_STATE_BASE<T> &);            \
+    template void serialize_system_state_to_csv<T>(const std::string &, const SYSTEM_STATE_BASE<T> &);       \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv<T>(std::istream &);                      \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv<T>(const std::string &);                 \
+    template void serialize_system_state_to_bin<T>(std::ostream &, const SYSTEM_STATE_BASE<T> &,             \
+                                                   const std::optional<BIN::METADATA> &, uint32_t);          \
+    template void serialize_system_state_to_bin<T>(const std::string &, const SYSTEM_STATE_BASE<T> &, bool,  \
+                                                   const std::optional<BIN::METADATA> &, uint32_t);          \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin<T>(std::istream &);                      \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin<T>(const std::string &);                 \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_trajectory<T>(const std::string &, long);    \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_file<T>(const std::string &);                \
+    template size_t ingest_system_state_from_file<T>(const std::string &, const INGESTION &,                 \
+        const std::function<void(const SYSTEM_STATE_BASE<T> &, size_t)> &);                                  \
+    template SYSTEM_STATE_BASE<T> deserialize_system_state_from_file<T>(const std::string &, const INGESTION &); \
+    template void serialize_system_state_to_bin<T>(std::ostream &, const SOA_SYSTEM_STATE_BASE<T> &,         \
+                                                   const std::optional<BIN::METADATA> &, uint32_t);          \
+    template void serialize_system_state_to_bin<T>(const std::string &, const SOA_SYSTEM_STATE_BASE<T> &,    \
+                                                   bool, const std::optional<BIN::METADATA> &, uint32_t);    \
+    template SOA_SYSTEM_STATE_BASE<T> deserialize_soa_system_state_from_file<T>(const std::string &, const INGESTION &);
+
+    INSTANTIATE_SERDE(float)
+    INSTANTIATE_SERDE(double)
+
+#undef INSTANTIATE_SERDE
+}
@@ -1,32 +1,193 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <optional>
 
 #include "physics.hpp"
 
 namespace CORE
 {
+    /// All the functions are templated on the floating type T of SYSTEM_STATE_BASE,
+    /// and instantiated for float and double.
+
     /// CSV
     /// (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each row
 
-    void serialize_system_state_to_csv(std::ostream &, const SYSTEM_STATE &);
-    void serialize_system_state_to_csv(const std::string &, const SYSTEM_STATE &);
+    template <typename T>
+    void serialize_system_state_to_csv(std::ostream &, const SYSTEM_STATE_BASE<T> &);
+    template <typename T>
+    void serialize_system_state_to_csv(const std::string &, const SYSTEM_STATE_BASE<T> &);
 
-    SYSTEM_STATE deserialize_system_state_from_csv(std::istream &);
-    SYSTEM_STATE deserialize_system_state_from_csv(const std::string &);
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv(std::istream &);
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_csv(const std::string &);
 
-    /// BINARY
+    /// BINARY, version 1
     /// - first 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
     /// - second 4 bytes: number of bodies
     /// - rest: (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE
     /// Everything in binary
+    ///
+    /// BINARY, version 2, little-endian
+    /// - header, 64 bytes:
+    ///   - 8 bytes: magic "TUSSBIN\0", which a version 1 file never starts with
+    ///   - 4 bytes: version (2)
+    ///   - 4 bytes: size of floating type
+    ///   - 8 bytes: number of bodies
+    ///   - 4 bytes: flags, bit 0 set if the metadata below is valid
+    ///   - 4 bytes: reserved (0)
+    ///   - 8 bytes: dt (double), 8 bytes: iteration, 8 bytes: time (double), see BIN::METADATA
+    ///   - 8 bytes: reserved (0)
+    /// - columns POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS: the value of every body,
+    ///   zero-padded to a multiple of 64 bytes, so that every column of a mapped file is 64-byte aligned (see MAPPED_BIN)
+    ///
+    /// Written with sizeof(T), as version 2 unless asked otherwise.
+    /// Either version is read into T from either size, which only loses precision from double into float.
+    namespace BIN
+    {
+        constexpr char magic[8] = {'T', 'U', 'S', 'S', 'B', 'I', 'N', '\0'};
+        constexpr uint32_t latest_version = 2;
+        constexpr size_t header_size_v2 = 64;
+        constexpr size_t column_alignment = 64;
+        /// POS.x, POS.y, POS.z, VEL.x, VEL.y, VEL.z, MASS
+        constexpr size_t n_column = 7;
+        constexpr uint32_t has_metadata_flag = 1;
+
+        /// Where the SYSTEM_STATE stands in its run
+        struct METADATA
+        {
+            double dt = 0;
+            uint64_t iteration = 0;
+            double time = 0;
+        };
+
+        /// Bytes from a version 2 column to the next
+        inline size_t column_stride(int floating_value_size, uint64_t n_body)
+        {
+            return (n_body * floating_value_size + column_alignment - 1) / column_alignment * column_alignment;
+        }
+    }
+
+    /// metadata is only written in version 2
+    template <typename T>
+    void serialize_system_state_to_bin(std::ostream &, const SYSTEM_STATE_BASE<T> &,
+                                       const std::optional<BIN::METADATA> &metadata = {}, uint32_t version = BIN::latest_version);
+    template <typename T>
+    void serialize_system_state_to_bin(const std::string &, const SYSTEM_STATE_BASE<T> &, bool print_file_name = false,
+                                       const std::optional<BIN::METADATA> &metadata = {}, uint32_t version = BIN::latest_version);
+
+    /// The SoA SYSTEM_STATE of the ENGINEs, whose columns version 2 writes as they are
+    template <typename T>
+    void serialize_system_state_to_bin(std::ostream &, const SOA_SYSTEM_STATE_BASE<T> &,
+                                       const std::optional<BIN::METADATA> &metadata = {}, uint32_t version = BIN::latest_version);
+    template <typename T>
+    void serialize_system_state_to_bin(const std::string &, const SOA_SYSTEM_STATE_BASE<T> &, bool print_file_name = false,
+                                       const std::optional<BIN::METADATA> &metadata = {}, uint32_t version = BIN::latest_version);
+
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin(std::istream &);
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_bin(const std::string &);
+
+    /// Metadata of a version 2 BIN file, if it has some
+    std::optional<BIN::METADATA> deserialize_metadata_from_bin(const std::string &);
+
+    /// TRAJECTORY
+    /// Every frame of a run in one file, see trajectory.h
 
-    void serialize_system_state_to_bin(std::ostream &, const SYSTEM_STATE &);
-    void serialize_system_state_to_bin(const std::string &, const SYSTEM_STATE &, bool print_file_name = false);
+    /// Frame i_frame, or the last one if negative
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_trajectory(const std::string &, long i_frame = -1);
 
-    SYSTEM_STATE deserialize_system_state_from_bin(std::istream &);
-    SYSTEM_STATE deserialize_system_state_from_bin(const std::string &);
+    /// Snapshots of other codes, converted into the units of TUSS: G = 1 with pc, km/s and Msun * G (see README).
+    /// Their particles come in types, in file order, which INGESTION::body_types selects from.
+    constexpr double G_solar_mass_parsec_kmps = 4.3009e-3;
+
+    /// What one code unit of a snapshot is worth
+    struct SNAPSHOT_UNITS
+    {
+        double length_in_pc = 1;
+        double velocity_in_kms = 1;
+        double mass_in_msun = 1;
+    };
+
+    /// TIPSY (standard), big-endian as written through XDR, or native-endian
+    /// - header, 28 bytes, padded to 32 in the standard format:
+    ///   - 8 bytes: time (double)
+    ///   - 4 bytes each: number of particles, number of dimensions (3), number of gas, dark and star particles
+    /// - gas particles: mass, pos[3], vel[3], rho, temp, hsmooth, metals, phi (float)
+    /// - dark particles: mass, pos[3], vel[3], eps, phi (float)
+    /// - star particles: mass, pos[3], vel[3], metals, tform, eps, phi (float)
+    /// Code units have G = 1. dKpcUnit and dMsolUnit of the .param file next to the snapshot (<name>.param for <name>.<anything>,
+    /// or the only .param of the directory) turn them into physical units, either one being 1 without it, as yt has them.
+    namespace TIPSY
+    {
+        enum BODY_TYPE
+        {
+            GAS = 0,
+            DARK,
+            STAR,
+            N_BODY_TYPE
+        };
+    }
+
+    /// GADGET-2 snapshot, single file, SnapFormat 1 or 2 (blocks labelled with 4 characters), either endianness
+    /// - blocks, each within 4-byte size markers: HEAD (256 bytes), POS, VEL, ID, then MASS if some type has no fixed mass
+    /// - POS and VEL in float, or double as written with OUTPUT_IN_DOUBLEPRECISION
+    /// Types 0 to 5 are gas, halo, disk, bulge, stars and boundary.
+    /// Code units are the GADGET-2 defaults: 1 kpc/h, 1e10 Msun/h and 1 km/s.
+    /// Cosmological snapshots (Omega0 > 0) are taken at their scale factor a = time:
+    /// comoving positions are multiplied by a, and the stored velocities by sqrt(a).
+    namespace GADGET
+    {
+        constexpr int n_body_type = 6;
+        constexpr size_t header_size = 256;
+    }
 
     /// Useful
-    SYSTEM_STATE deserialize_system_state_from_file(const std::string &);
-}
\ No newline at end of file
+    /// .bin files of either version are read through MAPPED_BIN (see mapped_bin.h)
+    /// .traj files give their last frame
+    /// TIPSY and GADGET files are told apart by their content, whatever their extension, e.g., .bin
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_file(const std::string &);
+
+    /// Streaming
+    /// Reads a .bin, .csv, .traj, TIPSY or GADGET file chunk by chunk, and keeps a subsample of its bodies on the way,
+    /// so that the bodies left out are never materialized, and the memory besides the bodies kept is one chunk.
+    struct INGESTION
+    {
+        /// Bodies of the file read at once, about as many for CSV
+        size_t chunk_size = size_t{1} << 16;
+        /// Keeps the first body of every stride bodies
+        size_t stride = 1;
+        /// Stops once that many bodies are kept
+        size_t max_n_body = std::numeric_limits<size_t>::max();
+        /// TIPSY and GADGET only, bit i keeps the particles of type i (see TIPSY::BODY_TYPE), before stride
+        uint32_t body_types = ~uint32_t{0};
+        /// TIPSY and GADGET only, instead of the units of the file
+        std::optional<SNAPSHOT_UNITS> units;
+    };
+
+    /// Hands the bodies kept from each chunk to consumer(chunk, i_first_body), i_first_body being the index of chunk[0]
+    /// among all the bodies kept, so that the consumer can fill its own buffers. Returns the number of bodies kept.
+    /// COMPRESSED .traj frames are decoded whole before being handed out in chunks.
+    /// TIPSY and GADGET files are mapped, and every chunk is decoded on all threads.
+    template <typename T>
+    size_t ingest_system_state_from_file(const std::string &, const INGESTION &,
+                                         const std::function<void(const SYSTEM_STATE_BASE<T> &, size_t)> &consumer);
+
+    /// Number of bodies ingest_system_state_from_file() keeps, if the file tells its number of bodies upfront (not CSV)
+    std::optional<size_t> num_bodies_to_ingest(const std::string &, const INGESTION &);
+
+    /// The bodies kept by ingest_system_state_from_file(), in a SYSTEM_STATE reserved upfront when possible
+    template <typename T = UNIVERSE::floating_value_type>
+    SYSTEM_STATE_BASE<T> deserialize_system_state_from_file(const std::string &, const INGESTION &);
+
+    /// Same bodies into the SoA SYSTEM_STATE of the ENGINEs; the columns of a version 2 .bin are copied whole
+    template <typename T = UNIVERSE::floating_value_type>
+    SOA_SYSTEM_STATE_BASE<T> deserialize_soa_system_state_from_file(const std::string &, const INGESTION & = {});
+}
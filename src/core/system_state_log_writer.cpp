@@ -0,0 +1,173 @@
+#include "system_state_log_writer.h"
+
+#include <memory>
+#include <utility>
+
+namespace CORE
+{
+    template <typename T>
+    SYSTEM_STATE_LOG_WRITER<T>::SYSTEM_STATE_LOG_WRITER(std::string log_dir, size_t memory_budget)
+        : log_dir_(std::move(log_dir)),
+          memory_budget_(memory_budget),
+          writer_thread_([this]()
+                         { writer_loop(); })
+    {
+    }
+
+    template <typename T>
+    SYSTEM_STATE_LOG_WRITER<T>::~SYSTEM_STATE_LOG_WRITER()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_stopping_ = true;
+        }
+        frame_pushed_cv_.notify_one();
+        writer_thread_.join();
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::set_memory_budget(size_t memory_budget)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memory_budget_ = memory_budget;
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::set_compression(TRAJECTORY::COMPRESSION compression)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        compression_ = compression;
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::keep_frames(int n_frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ASSERT(num_pushed_frames_ == n_kept_frames_);
+        n_kept_frames_ = n_frame;
+        num_pushed_frames_ = n_frame;
+        num_written_frames_ = n_frame;
+    }
+
+    template <typename T>
+    typename SYSTEM_STATE_LOG_WRITER<T>::system_state_type SYSTEM_STATE_LOG_WRITER<T>::acquire_frame(size_t n_body)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            if (!free_frames_.empty())
+            {
+                system_state_type frame = std::move(free_frames_.back());
+                free_frames_.pop_back();
+                lock.unlock();
+                frame.reserve(n_body);
+                return frame;
+            }
+            // Always allow one frame, or nothing could ever be logged
+            if (owned_size_ == 0 || owned_size_ + frame_size(n_body) <= memory_budget_)
+            {
+                owned_size_ += frame_size(n_body);
+                lock.unlock();
+                system_state_type frame;
+                frame.reserve(n_body);
+                return frame;
+            }
+            // Backpressure
+            frame_written_cv_.wait(lock);
+        }
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::push(system_state_type frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rethrow_write_failure();
+            queue_.push_back(std::move(frame));
+            num_pushed_frames_++;
+        }
+        frame_pushed_cv_.notify_one();
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frame_written_cv_.wait(lock, [this]()
+                               { return num_written_frames_ == num_pushed_frames_; });
+        rethrow_write_failure();
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::check_write_failure()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rethrow_write_failure();
+    }
+
+    template <typename T>
+    int SYSTEM_STATE_LOG_WRITER<T>::num_pushed_frames() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_pushed_frames_;
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::rethrow_write_failure()
+    {
+        if (write_failure_)
+        {
+            std::rethrow_exception(std::exchange(write_failure_, nullptr));
+        }
+    }
+
+    template <typename T>
+    void SYSTEM_STATE_LOG_WRITER<T>::writer_loop()
+    {
+        // Opened with the first frame, which gives the number of bodies, and closed with its index when stopping
+        std::unique_ptr<TRAJECTORY_WRITER<T>> trajectory_writer;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            frame_pushed_cv_.wait(lock, [this]()
+                                  { return !queue_.empty() || is_stopping_; });
+            if (queue_.empty())
+            {
+                return;
+            }
+            system_state_type frame = std::move(queue_.front());
+            queue_.pop_front();
+            const TRAJECTORY::COMPRESSION compression = compression_;
+            const int n_kept_frame = n_kept_frames_;
+            lock.unlock();
+
+            std::exception_ptr write_failure;
+            try
+            {
+                if (!trajectory_writer)
+                {
+                    trajectory_writer = std::make_unique<TRAJECTORY_WRITER<T>>(trajectory_file_path(log_dir_), frame.size(), compression, n_kept_frame);
+                }
+                trajectory_writer->write_frame(frame);
+            }
+            catch (...)
+            {
+                write_failure = std::current_exception();
+            }
+            frame.clear();
+
+            lock.lock();
+            if (write_failure && !write_failure_)
+            {
+                write_failure_ = write_failure;
+            }
+            free_frames_.push_back(std::move(frame));
+            num_written_frames_++;
+            frame_written_cv_.notify_all();
+        }
+    }
+
+    template class SYSTEM_STATE_LOG_WRITER<float>;
+    template class SYSTEM_STATE_LOG_WRITER<double>;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "physics.hpp"
+#include "trajectory.h"
+
+namespace CORE
+{
+    /// Writes the SYSTEM_STATE log of an ENGINE from a background thread,
+    /// into the TRAJECTORY file trajectory_file_path(log_dir), in the order the frames are pushed.
+    /// Frames are taken with acquire_frame() and handed back with push(),
+    /// then recycled once written, so a steady run allocates no SYSTEM_STATE per frame.
+    /// The frames owned by the writer stay within memory_budget bytes (at least one frame),
+    /// beyond which acquire_frame() waits for the writer to catch up.
+    template <typename T>
+    class SYSTEM_STATE_LOG_WRITER
+    {
+    public:
+        using system_state_type = SOA_SYSTEM_STATE_BASE<T>;
+
+        static constexpr size_t default_memory_budget = size_t{256} << 20;
+
+        static std::string trajectory_file_path(const std::string &log_dir) { return log_dir + "/trajectory.traj"; }
+
+        explicit SYSTEM_STATE_LOG_WRITER(std::string log_dir, size_t memory_budget = default_memory_budget);
+        /// Writes whatever is still queued, then the index of the TRAJECTORY file
+        ~SYSTEM_STATE_LOG_WRITER();
+
+        SYSTEM_STATE_LOG_WRITER(const SYSTEM_STATE_LOG_WRITER &) = delete;
+        SYSTEM_STATE_LOG_WRITER &operator=(const SYSTEM_STATE_LOG_WRITER &) = delete;
+
+        void set_memory_budget(size_t memory_budget);
+        /// Takes effect if set before the first frame is pushed
+        void set_compression(TRAJECTORY::COMPRESSION compression);
+        /// Takes effect if set before the first frame is pushed: continues the existing TRAJECTORY file after its first
+        /// n_frame frames (see TRAJECTORY_WRITER), which count as pushed
+        void keep_frames(int n_frame);
+
+        /// An empty frame with room for n_body bodies, recycled when possible.
+        /// Blocks while the budget is used up.
+        system_state_type acquire_frame(size_t n_body);
+        /// Queues frame, taken from acquire_frame(), to be written. Rethrows the failure of a previous write, if any.
+        void push(system_state_type frame);
+        /// Blocks until every pushed frame is written. Rethrows the failure of a write, if any.
+        void flush();
+        /// Rethrows the failure of a write, if any, without waiting
+        void check_write_failure();
+
+        int num_pushed_frames() const;
+
+    private:
+        static size_t frame_size(size_t n_body) { return n_body * system_state_type::n_column * sizeof(T); }
+        void rethrow_write_failure();
+        void writer_loop();
+
+    private:
+        std::string log_dir_;
+        size_t memory_budget_;
+        TRAJECTORY::COMPRESSION compression_;
+        int n_kept_frames_ = 0;
+
+        mutable std::mutex mutex_;
+        std::condition_variable frame_pushed_cv_;
+        std::condition_variable frame_written_cv_;
+        /// To be written
+        std::deque<system_state_type> queue_;
+        /// Written frames, ready to be acquired again
+        std::vector<system_state_type> free_frames_;
+        /// Of the frames acquired and not yet freed, free_frames_ included
+        size_t owned_size_ = 0;
+        int num_pushed_frames_ = 0;
+        int num_written_frames_ = 0;
+        std::exception_ptr write_failure_;
+        bool is_stopping_ = false;
+
+        /// Last, to start once everything else is initialized
+        std::thread writer_thread_;
+    };
+
+    extern template class SYSTEM_STATE_LOG_WRITER<float>;
+    extern template class SYSTEM_STATE_LOG_WRITER<double>;
+}
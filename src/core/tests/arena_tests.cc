@@ -0,0 +1,66 @@
+#include "utst.hpp"
+#include "arena.hpp"
+
+#include <cstdint>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+UTST_TEST(arena_allocate)
+{
+    ARENA arena(ARENA::footprint<float>(3) + ARENA::footprint<ACC>(5));
+    UTST_ASSERT_EQUAL(0, arena.size());
+    UTST_ASSERT_EQUAL(2 * ARENA::alignment, arena.capacity());
+
+    const SPAN<float> floats = arena.allocate<float>(3);
+    const SPAN<ACC> accs = arena.allocate<ACC>(5);
+    UTST_ASSERT_EQUAL(3, floats.size());
+    UTST_ASSERT_EQUAL(5, accs.size());
+    UTST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(floats.data()) % ARENA::alignment);
+    UTST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(accs.data()) % ARENA::alignment);
+    UTST_ASSERT_EQUAL(arena.capacity(), arena.size());
+
+    // Full
+    bool has_thrown = false;
+    try
+    {
+        arena.allocate<float>(1);
+    }
+    catch (const std::runtime_error &)
+    {
+        has_thrown = true;
+    }
+    UTST_ASSERT(has_thrown);
+
+    // The same memory again
+    arena.reset();
+    UTST_ASSERT_EQUAL(0, arena.size());
+    UTST_ASSERT(arena.allocate<float>(3).data() == floats.data());
+}
+
+UTST_TEST(per_thread_scratch)
+{
+    constexpr size_t n_thread = 3;
+    constexpr size_t n_body = 5;
+    ARENA arena(PER_THREAD_SCRATCH<ACC>::footprint(n_thread, n_body));
+    const PER_THREAD_SCRATCH<ACC> scratch(arena, n_thread, n_body);
+    UTST_ASSERT_EQUAL(n_thread, scratch.n_thread());
+    UTST_ASSERT_EQUAL(arena.capacity(), arena.size());
+
+    for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+    {
+        UTST_ASSERT_EQUAL(n_body, scratch[thread_id].size());
+        // Never on the cache line of another thread
+        UTST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(scratch[thread_id].data()) % ARENA::alignment);
+        for (const ACC &acc : scratch[thread_id])
+        {
+            UTST_ASSERT(acc == (ACC{0, 0, 0}));
+        }
+    }
+
+    scratch[1][2] = {1, 2, 3};
+    UTST_ASSERT(scratch[0][2] == (ACC{0, 0, 0}));
+    UTST_ASSERT(scratch[2][2] == (ACC{0, 0, 0}));
+    UTST_ASSERT(scratch[1][2] == (ACC{1, 2, 3}));
+}
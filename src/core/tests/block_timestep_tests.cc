@@ -0,0 +1,75 @@
+#include "utst.hpp"
+#include "block_timestep.h"
+
+#include <cmath>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+UTST_TEST(block_timestep_bins)
+{
+    const BLOCK_TIMESTEP_BASE<double> block_timestep(1, 3);
+    UTST_ASSERT_EQUAL(8, block_timestep.n_tick());
+    UTST_ASSERT_EQUAL(8, block_timestep.n_tick(0));
+    UTST_ASSERT_EQUAL(1, block_timestep.n_tick(3));
+    UTST_ASSERT_EQUAL(1.0, block_timestep.dt(0));
+    UTST_ASSERT_EQUAL(0.125, block_timestep.dt(3));
+
+    UTST_ASSERT(block_timestep.is_active(0, 0));
+    UTST_ASSERT(block_timestep.is_active(0, 8));
+    UTST_ASSERT(!block_timestep.is_active(0, 4));
+    UTST_ASSERT(block_timestep.is_active(1, 4));
+    UTST_ASSERT(block_timestep.is_active(3, 5));
+
+    UTST_ASSERT_EQUAL(8, block_timestep.next_tick(0, 0));
+    UTST_ASSERT_EQUAL(4, block_timestep.next_tick(1, 0));
+    UTST_ASSERT_EQUAL(6, block_timestep.next_tick(2, 4));
+    UTST_ASSERT_EQUAL(6, block_timestep.next_tick(2, 5));
+}
+
+UTST_TEST(block_timestep_bin_of)
+{
+    const BLOCK_TIMESTEP_BASE<float> block_timestep(1, 3);
+    UTST_ASSERT_EQUAL(0, block_timestep.bin_of(INFINITY));
+    UTST_ASSERT_EQUAL(0, block_timestep.bin_of(1));
+    UTST_ASSERT_EQUAL(1, block_timestep.bin_of(0.99f));
+    UTST_ASSERT_EQUAL(1, block_timestep.bin_of(0.5f));
+    UTST_ASSERT_EQUAL(2, block_timestep.bin_of(0.3f));
+    // The finest bin at the finest
+    UTST_ASSERT_EQUAL(3, block_timestep.bin_of(0.01f));
+    UTST_ASSERT_EQUAL(3, block_timestep.bin_of(0));
+    UTST_ASSERT_EQUAL(3, block_timestep.bin_of(NAN));
+}
+
+UTST_TEST(block_timestep_next_bin)
+{
+    const BLOCK_TIMESTEP_BASE<float> block_timestep(1, 3);
+    // Finer whenever asked
+    UTST_ASSERT_EQUAL(3, block_timestep.next_bin(1, 4, 0.1f));
+    UTST_ASSERT_EQUAL(2, block_timestep.next_bin(2, 6, 0.25f));
+    // Coarser by one bin, once synchronized with it
+    UTST_ASSERT_EQUAL(2, block_timestep.next_bin(3, 4, 1));
+    UTST_ASSERT_EQUAL(3, block_timestep.next_bin(3, 5, 1));
+    UTST_ASSERT_EQUAL(2, block_timestep.next_bin(2, 6, 1));
+    UTST_ASSERT_EQUAL(0, block_timestep.next_bin(1, 8, 1));
+}
+
+UTST_TEST(aarseth_timestep)
+{
+    const XYZ_BASE<double> acc{3, 0, 4};
+    UTST_ASSERT_EQUAL(0.5, aarseth_timestep(0.1, acc, XYZ_BASE<double>{0, 1, 0}));
+    UTST_ASSERT(std::isinf(aarseth_timestep(0.1, acc, XYZ_BASE<double>{0, 0, 0})));
+}
+
+UTST_TEST(aarseth_timestep_fourth_order)
+{
+    const XYZ_BASE<double> acc{3, 0, 4};
+    const XYZ_BASE<double> jerk{0, 2, 0};
+    const XYZ_BASE<double> snap{0, 0, 2};
+    const XYZ_BASE<double> crackle{1, 0, 0};
+    // sqrt(eta (5 * 2 + 4) / (2 * 1 + 4))
+    UTST_ASSERT(std::abs(std::sqrt(0.03 * 14 / 6) - aarseth_timestep(0.03, acc, jerk, snap, crackle)) < 1e-15);
+    const XYZ_BASE<double> zero{0, 0, 0};
+    UTST_ASSERT(std::isinf(aarseth_timestep(0.03, acc, jerk, zero, zero)));
+}
@@ -0,0 +1,155 @@
+#include "utst.hpp"
+#include "checkpoint.h"
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    std::string temp_checkpoint_file(const std::string &name)
+    {
+        return (std::filesystem::temp_directory_path() / ("checkpoint_tests_" + name + ".ckpt")).string();
+    }
+
+    template <typename T>
+    CHECKPOINT_BASE<T> make_checkpoint(size_t n_body)
+    {
+        CHECKPOINT_BASE<T> checkpoint;
+        checkpoint.engine_name = "TEST_ENGINE";
+        checkpoint.engine_config = "n_thread=2";
+        checkpoint.dt = static_cast<T>(0.1);
+        checkpoint.num_iterations = 42;
+        checkpoint.num_log_frames = 43;
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const T x = static_cast<T>(i_body) + static_cast<T>(0.1);
+            checkpoint.system_state.emplace_back(POS_BASE<T>{x, 1, 2}, VEL_BASE<T>{3, x, 4}, 5);
+            checkpoint.acc.push_back({6, 7, -x});
+        }
+        return checkpoint;
+    }
+
+    template <typename T>
+    bool operator==(const CHECKPOINT_BASE<T> &lhs, const CHECKPOINT_BASE<T> &rhs)
+    {
+        return lhs.engine_name == rhs.engine_name && lhs.engine_config == rhs.engine_config && lhs.dt == rhs.dt &&
+               lhs.num_iterations == rhs.num_iterations && lhs.num_log_frames == rhs.num_log_frames &&
+               lhs.system_state == rhs.system_state && lhs.acc == rhs.acc &&
+               lhs.n_engine_value == rhs.n_engine_value && lhs.engine_values == rhs.engine_values;
+    }
+}
+
+UTST_TEST(checkpoint_serde)
+{
+    const std::string checkpoint_file = temp_checkpoint_file("serde");
+    // More bodies than staged at once
+    const CHECKPOINT_BASE<float> checkpoint = make_checkpoint<float>(100000);
+    serialize_checkpoint(checkpoint_file, checkpoint);
+    UTST_ASSERT(!std::filesystem::exists(checkpoint_file + ".tmp"));
+    UTST_ASSERT(checkpoint == deserialize_checkpoint<float>(checkpoint_file));
+
+    // Replaced as a whole
+    const CHECKPOINT_BASE<float> next_checkpoint = make_checkpoint<float>(3);
+    serialize_checkpoint(checkpoint_file, next_checkpoint);
+    UTST_ASSERT(next_checkpoint == deserialize_checkpoint<float>(checkpoint_file));
+    std::filesystem::remove(checkpoint_file);
+}
+
+UTST_TEST(checkpoint_serde_double)
+{
+    const std::string checkpoint_file = temp_checkpoint_file("serde_double");
+    const CHECKPOINT_BASE<double> checkpoint = make_checkpoint<double>(10);
+    serialize_checkpoint(checkpoint_file, checkpoint);
+    UTST_ASSERT(checkpoint == deserialize_checkpoint<double>(checkpoint_file));
+
+    // Never cast
+    bool has_thrown = false;
+    try
+    {
+        deserialize_checkpoint<float>(checkpoint_file);
+    }
+    catch (const std::runtime_error &)
+    {
+        has_thrown = true;
+    }
+    UTST_ASSERT(has_thrown);
+    std::filesystem::remove(checkpoint_file);
+}
+
+UTST_TEST(checkpoint_serde_engine_values)
+{
+    const std::string checkpoint_file = temp_checkpoint_file("serde_engine_values");
+    CHECKPOINT_BASE<float> checkpoint = make_checkpoint<float>(70000);
+    checkpoint.n_engine_value = 2;
+    for (size_t i_body = 0; i_body < checkpoint.system_state.size(); i_body++)
+    {
+        checkpoint.engine_values.insert(checkpoint.engine_values.end(), {static_cast<float>(i_body), -1});
+    }
+    serialize_checkpoint(checkpoint_file, checkpoint);
+    UTST_ASSERT(checkpoint == deserialize_checkpoint<float>(checkpoint_file));
+    std::filesystem::remove(checkpoint_file);
+}
+
+UTST_TEST(checkpoint_version_1)
+{
+    // Written before engine values, i.e., without their number in the header
+    const std::string checkpoint_file = temp_checkpoint_file("version_1");
+    const CHECKPOINT_BASE<double> checkpoint = make_checkpoint<double>(3);
+    {
+        std::ofstream ofstream(checkpoint_file, std::ios::binary);
+        auto write = [&ofstream](auto value)
+        {
+            ofstream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        auto write_string = [&ofstream, &write](const std::string &str)
+        {
+            write(static_cast<uint32_t>(str.size()));
+            ofstream.write(str.data(), str.size());
+        };
+        ofstream.write(CHECKPOINT::magic, sizeof(CHECKPOINT::magic));
+        write(uint32_t{1});
+        write(static_cast<uint32_t>(sizeof(double)));
+        write(uint64_t{3});
+        write(checkpoint.num_iterations);
+        write(checkpoint.num_log_frames);
+        write(static_cast<double>(checkpoint.dt));
+        write_string(checkpoint.engine_name);
+        write_string(checkpoint.engine_config);
+        for (size_t i_body = 0; i_body < 3; i_body++)
+        {
+            const auto [p, v, m] = checkpoint.system_state.body(i_body);
+            const ACC_BASE<double> &a = checkpoint.acc[i_body];
+            for (const double value : {p.x, p.y, p.z, v.x, v.y, v.z, m, a.x, a.y, a.z})
+            {
+                write(value);
+            }
+        }
+    }
+    UTST_ASSERT(checkpoint == deserialize_checkpoint<double>(checkpoint_file));
+    std::filesystem::remove(checkpoint_file);
+}
+
+UTST_TEST(checkpoint_request)
+{
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::NONE);
+    CHECKPOINT::request(CHECKPOINT::REQUEST::CHECKPOINT);
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::CHECKPOINT);
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::NONE);
+
+    // The strongest is kept
+    CHECKPOINT::request(CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP);
+    CHECKPOINT::request(CHECKPOINT::REQUEST::CHECKPOINT);
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP);
+
+    CHECKPOINT::install_signal_handlers();
+    std::raise(SIGUSR1);
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::CHECKPOINT);
+    std::raise(SIGTERM);
+    UTST_ASSERT(CHECKPOINT::take_request() == CHECKPOINT::REQUEST::CHECKPOINT_AND_STOP);
+}
@@ -0,0 +1,139 @@
+#include "utst.hpp"
+#include "engine.h"
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    /// Drifts every body by its velocity, in its own buffer, and counts what the warm start spares
+    class DRIFT_ENGINE final : public ENGINE_BASE<float>
+    {
+    public:
+        DRIFT_ENGINE(SOA_SYSTEM_STATE system_state_ic, bool is_warm_started)
+            : ENGINE_BASE<float>(std::move(system_state_ic), 1), is_warm_started_(is_warm_started) {}
+
+        virtual std::string name() override { return "DRIFT_ENGINE"; }
+
+        int n_ic_read = 0;
+        int n_materialized = 0;
+        /// Counted per iteration if set, as with block time steps
+        std::optional<uint64_t> n_force_evaluation_per_iteration;
+
+    protected:
+        virtual std::optional<system_state_type> execute(int n_iter, TIMER &) override
+        {
+            if (!pos_x_opt_)
+            {
+                n_ic_read++;
+                pos_x_opt_.emplace(system_state_snapshot().pos_x().begin(), system_state_snapshot().pos_x().end());
+            }
+            for (int i_iter = 0; i_iter < n_iter; i_iter++)
+            {
+                for (size_t i_body = 0; i_body < pos_x_opt_->size(); i_body++)
+                {
+                    (*pos_x_opt_)[i_body] += system_state_snapshot().vel_x()[i_body] * dt();
+                }
+                if (n_force_evaluation_per_iteration)
+                {
+                    count_force_evaluations(*n_force_evaluation_per_iteration);
+                }
+            }
+            if (is_warm_started_)
+            {
+                return std::nullopt;
+            }
+            system_state_type system_state = system_state_snapshot();
+            materialize_system_state(system_state);
+            pos_x_opt_.reset();
+            return system_state;
+        }
+
+        virtual void materialize_system_state(system_state_type &system_state) override
+        {
+            n_materialized++;
+            std::copy(pos_x_opt_->begin(), pos_x_opt_->end(), system_state.pos_x().begin());
+        }
+
+    private:
+        bool is_warm_started_;
+        std::optional<std::vector<float>> pos_x_opt_;
+    };
+
+    SOA_SYSTEM_STATE make_system_state()
+    {
+        SOA_SYSTEM_STATE system_state;
+        system_state.emplace_back(POS{0, 0, 0}, VEL{1, 0, 0}, 1);
+        system_state.emplace_back(POS{1, 0, 0}, VEL{-2, 0, 0}, 1);
+        return system_state;
+    }
+}
+
+UTST_TEST(engine_warm_start)
+{
+    DRIFT_ENGINE engine(make_system_state(), true);
+    // The ic before any run()
+    UTST_ASSERT(make_system_state() == engine.system_state());
+
+    engine.run(2);
+    engine.run(3);
+    UTST_ASSERT_EQUAL(1, engine.n_ic_read);
+    UTST_ASSERT_EQUAL(0, engine.n_materialized);
+    UTST_ASSERT_EQUAL(uint64_t{5}, engine.num_iterations());
+
+    // Materialized once, on the first read
+    UTST_ASSERT_EQUAL(5.0f, engine.system_state().pos_x()[0]);
+    UTST_ASSERT_EQUAL(-9.0f, engine.system_state().pos_x()[1]);
+    UTST_ASSERT_EQUAL(1, engine.n_materialized);
+
+    engine.run(1);
+    UTST_ASSERT_EQUAL(6.0f, engine.system_state().pos_x()[0]);
+    UTST_ASSERT_EQUAL(1, engine.n_ic_read);
+    UTST_ASSERT_EQUAL(2, engine.n_materialized);
+}
+
+UTST_TEST(engine_cold_start)
+{
+    // Engines returning their SYSTEM_STATE restart from it on every run()
+    DRIFT_ENGINE engine(make_system_state(), false);
+    engine.run(2);
+    engine.run(3);
+    UTST_ASSERT_EQUAL(2, engine.n_ic_read);
+    UTST_ASSERT_EQUAL(5.0f, engine.system_state().pos_x()[0]);
+    UTST_ASSERT_EQUAL(2, engine.n_materialized);
+}
+
+UTST_TEST(engine_force_evaluations)
+{
+    // Every body on every iteration by default
+    DRIFT_ENGINE engine(make_system_state(), true);
+    engine.run(2);
+    engine.run(3);
+    UTST_ASSERT_EQUAL(uint64_t{10}, engine.num_force_evaluations());
+
+    // Or as counted by execute()
+    DRIFT_ENGINE counting_engine(make_system_state(), true);
+    counting_engine.n_force_evaluation_per_iteration = 1;
+    counting_engine.run(2);
+    counting_engine.run(3);
+    UTST_ASSERT_EQUAL(uint64_t{5}, counting_engine.num_force_evaluations());
+}
+
+UTST_TEST(engine_integrator)
+{
+    // Engines stepping on their own take the default kick-drift-kick leapfrog only
+    DRIFT_ENGINE engine(make_system_state(), true);
+    engine.set_integrator(INTEGRATOR(INTEGRATOR::SCHEME::LEAPFROG_KDK));
+    bool has_thrown = false;
+    try
+    {
+        engine.set_integrator(INTEGRATOR(INTEGRATOR::SCHEME::PEFRL));
+    }
+    catch (const std::runtime_error &)
+    {
+        has_thrown = true;
+    }
+    UTST_ASSERT(has_thrown);
+    UTST_ASSERT(INTEGRATOR::SCHEME::LEAPFROG_KDK == engine.integrator().scheme());
+}
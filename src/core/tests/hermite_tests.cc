@@ -0,0 +1,87 @@
+#include "utst.hpp"
+#include "hermite.hpp"
+
+#include <cmath>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    /// A body whose acceleration is a cubic in time
+    struct CUBIC_MOTION
+    {
+        XYZ_BASE<double> p{1, -2, 0.5};
+        XYZ_BASE<double> v{0.25, 1, -1};
+        XYZ_BASE<double> a{-1, 0.5, 2};
+        XYZ_BASE<double> j{0.5, 0.25, -0.5};
+        XYZ_BASE<double> s{1, -1, 0.25};
+        XYZ_BASE<double> c{-0.5, 2, 1};
+
+        POS_BASE<double> pos(double t) const { return {p + t * v + t * t / 2 * a + t * t * t / 6 * j + std::pow(t, 4) / 24 * s + std::pow(t, 5) / 120 * c}; }
+        VEL_BASE<double> vel(double t) const { return {v + t * a + t * t / 2 * j + t * t * t / 6 * s + std::pow(t, 4) / 24 * c}; }
+        ACC_BASE<double> acc(double t) const { return {a + t * j + t * t / 2 * s + t * t * t / 6 * c}; }
+        XYZ_BASE<double> jerk(double t) const { return j + t * s + t * t / 2 * c; }
+        XYZ_BASE<double> snap(double t) const { return s + t * c; }
+    };
+
+    bool is_close(const XYZ_BASE<double> &expected, const XYZ_BASE<double> &actual)
+    {
+        return (expected - actual).norm_square() < 1e-24;
+    }
+}
+
+UTST_TEST(hermite_predict)
+{
+    // Exact without snap
+    CUBIC_MOTION motion;
+    motion.s = {0, 0, 0};
+    motion.c = {0, 0, 0};
+    POS_BASE<double> pos_predicted{0, 0, 0};
+    VEL_BASE<double> vel_predicted{0, 0, 0};
+    hermite_predict(motion.pos(0), motion.vel(0), motion.acc(0), motion.jerk(0), 0.5, pos_predicted, vel_predicted);
+    UTST_ASSERT(is_close(motion.pos(0.5), pos_predicted));
+    UTST_ASSERT(is_close(motion.vel(0.5), vel_predicted));
+
+    // As is by 0
+    hermite_predict(motion.pos(0), motion.vel(0), motion.acc(0), motion.jerk(0), 0.0, pos_predicted, vel_predicted);
+    UTST_ASSERT_EQUAL(motion.pos(0), pos_predicted);
+    UTST_ASSERT_EQUAL(motion.vel(0), vel_predicted);
+}
+
+UTST_TEST(hermite_correct)
+{
+    const CUBIC_MOTION motion;
+    const double dt = 0.5;
+    const HERMITE_CORRECTED_BASE<double> corrected =
+        hermite_correct(motion.pos(0), motion.vel(0), motion.acc(0), motion.jerk(0), motion.acc(dt), motion.jerk(dt), dt);
+    UTST_ASSERT(is_close(motion.vel(dt), corrected.vel));
+    UTST_ASSERT(is_close(motion.snap(dt), corrected.snap));
+    UTST_ASSERT(is_close(motion.c, corrected.crackle));
+
+    // The position, without crackle
+    CUBIC_MOTION quadratic_motion;
+    quadratic_motion.c = {0, 0, 0};
+    const HERMITE_CORRECTED_BASE<double> quadratic_corrected =
+        hermite_correct(quadratic_motion.pos(0), quadratic_motion.vel(0), quadratic_motion.acc(0), quadratic_motion.jerk(0),
+                        quadratic_motion.acc(dt), quadratic_motion.jerk(dt), dt);
+    UTST_ASSERT(is_close(quadratic_motion.pos(dt), quadratic_corrected.pos));
+}
+
+UTST_TEST(hermite_correct_fourth_order)
+{
+    // Beyond a cubic acceleration, the error of a step shrinks as dt^5, i.e., 32 times over half the step
+    auto error = [](double dt)
+    {
+        const double omega = 1.0;
+        auto pos = [omega](double t) { return POS_BASE<double>{std::cos(omega * t), std::sin(omega * t), 0}; };
+        auto vel = [omega](double t) { return VEL_BASE<double>{-omega * std::sin(omega * t), omega * std::cos(omega * t), 0}; };
+        auto acc = [omega, &pos](double t) { return ACC_BASE<double>{-omega * omega * pos(t)}; };
+        auto jerk = [omega, &vel](double t) { return -omega * omega * vel(t); };
+        const HERMITE_CORRECTED_BASE<double> corrected = hermite_correct(pos(0), vel(0), acc(0), jerk(0), acc(dt), jerk(dt), dt);
+        return std::sqrt((corrected.pos - pos(dt)).norm_square());
+    };
+    const double ratio = error(0.1) / error(0.05);
+    UTST_ASSERT(ratio > 28 && ratio < 36);
+}
@@ -0,0 +1,103 @@
+#include "utst.hpp"
+#include "integrator.h"
+
+#include <cmath>
+#include <numeric>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    const INTEGRATOR::SCHEME schemes[] = {INTEGRATOR::SCHEME::LEAPFROG_KDK, INTEGRATOR::SCHEME::LEAPFROG_DKD, INTEGRATOR::SCHEME::FOREST_RUTH,
+                                          INTEGRATOR::SCHEME::YOSHIDA4, INTEGRATOR::SCHEME::YOSHIDA6, INTEGRATOR::SCHEME::PEFRL};
+
+    /// Error of a harmonic oscillator, x'' = -x, after one period in n_step steps
+    double oscillator_error(const INTEGRATOR &integrator, int n_step)
+    {
+        const double dt = 2 * M_PI / n_step;
+        double x = 1;
+        double v = 0;
+        double a = -x;
+        for (int i_step = 0; i_step < n_step; i_step++)
+        {
+            integrator.step(
+                dt,
+                [&x, &v](double c_dt)
+                { x += c_dt * v; },
+                [&v, &a](double d_dt)
+                { v += d_dt * a; },
+                [&x, &a]()
+                { a = -x; });
+        }
+        return std::sqrt((x - 1) * (x - 1) + v * v);
+    }
+}
+
+UTST_TEST(integrator_coefficients)
+{
+    for (const INTEGRATOR::SCHEME scheme : schemes)
+    {
+        const INTEGRATOR integrator(scheme);
+        const std::vector<double> &c = integrator.drift_coefficients();
+        const std::vector<double> &d = integrator.kick_coefficients();
+        UTST_ASSERT_EQUAL(d.size() + 1, c.size());
+        // A whole dt of drifts and of kicks, symmetric
+        UTST_ASSERT(std::abs(std::accumulate(c.begin(), c.end(), 0.0) - 1) < 1e-14);
+        UTST_ASSERT(std::abs(std::accumulate(d.begin(), d.end(), 0.0) - 1) < 1e-14);
+        for (size_t i = 0; i < c.size(); i++)
+        {
+            UTST_ASSERT(std::abs(c[i] - c[c.size() - 1 - i]) < 1e-14);
+        }
+        for (size_t i = 0; i < d.size(); i++)
+        {
+            UTST_ASSERT(std::abs(d[i] - d[d.size() - 1 - i]) < 1e-14);
+        }
+        UTST_ASSERT(INTEGRATOR::from_name(integrator.name())->scheme() == scheme);
+    }
+    UTST_ASSERT(!INTEGRATOR::from_name("rk4").has_value());
+}
+
+UTST_TEST(integrator_force_evaluations)
+{
+    for (const INTEGRATOR::SCHEME scheme : schemes)
+    {
+        const INTEGRATOR integrator(scheme);
+        int n_force_evaluation = 0;
+        int n_kick = 0;
+        integrator.step(
+            1.0, [](double) {}, [&n_kick](double)
+            { n_kick++; },
+            [&n_force_evaluation]()
+            { n_force_evaluation++; });
+        UTST_ASSERT_EQUAL(integrator.n_force_evaluation(), n_force_evaluation);
+        UTST_ASSERT_EQUAL(static_cast<int>(integrator.kick_coefficients().size()), n_kick);
+    }
+    UTST_ASSERT_EQUAL(1, INTEGRATOR(INTEGRATOR::SCHEME::LEAPFROG_KDK).n_force_evaluation());
+    UTST_ASSERT_EQUAL(1, INTEGRATOR(INTEGRATOR::SCHEME::LEAPFROG_DKD).n_force_evaluation());
+    UTST_ASSERT_EQUAL(3, INTEGRATOR(INTEGRATOR::SCHEME::FOREST_RUTH).n_force_evaluation());
+    UTST_ASSERT_EQUAL(3, INTEGRATOR(INTEGRATOR::SCHEME::YOSHIDA4).n_force_evaluation());
+    UTST_ASSERT_EQUAL(7, INTEGRATOR(INTEGRATOR::SCHEME::YOSHIDA6).n_force_evaluation());
+    UTST_ASSERT_EQUAL(4, INTEGRATOR(INTEGRATOR::SCHEME::PEFRL).n_force_evaluation());
+}
+
+UTST_TEST(integrator_order)
+{
+    // Twice the steps divide the error by 2^order
+    for (const INTEGRATOR::SCHEME scheme : schemes)
+    {
+        const INTEGRATOR integrator(scheme);
+        const double ratio = oscillator_error(integrator, 32) / oscillator_error(integrator, 64);
+        const double expected_ratio = std::pow(2.0, integrator.order());
+        UTST_ASSERT(ratio > 0.8 * expected_ratio && ratio < 1.25 * expected_ratio);
+    }
+}
+
+UTST_TEST(integrator_pefrl_accuracy)
+{
+    // Same order as Forest-Ruth, for far less error per force evaluation
+    const double pefrl_error = oscillator_error(INTEGRATOR(INTEGRATOR::SCHEME::PEFRL), 48);
+    const double forest_ruth_error = oscillator_error(INTEGRATOR(INTEGRATOR::SCHEME::FOREST_RUTH), 64);
+    UTST_ASSERT(pefrl_error * 10 < forest_ruth_error);
+}
@@ -0,0 +1,141 @@
+#include "utst.hpp"
+#include "mapped_bin.h"
+#include "serde.h"
+#include "timer.h"
+
+#include <filesystem>
+#include <random>
+#include <iostream>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    std::string temp_bin_file(const std::string &name)
+    {
+        return (std::filesystem::temp_directory_path() / ("mapped_bin_tests_" + name + ".bin")).string();
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> random_system_state(size_t n_body)
+    {
+        std::mt19937 generator(1782);
+        std::uniform_real_distribution<T> distribution(-1, 1);
+        SYSTEM_STATE_BASE<T> system_state(n_body);
+        for (auto &[pos, vel, mass] : system_state)
+        {
+            pos = {distribution(generator), distribution(generator), distribution(generator)};
+            vel = {distribution(generator), distribution(generator), distribution(generator)};
+            mass = distribution(generator) + 1;
+        }
+        return system_state;
+    }
+}
+
+UTST_TEST(mapped_bin_view)
+{
+    SYSTEM_STATE expected_data{
+        {{1.0, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0},
+        {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, 17},
+    };
+    const std::string bin_file = temp_bin_file("view");
+    serialize_system_state_to_bin(bin_file, expected_data, false, {}, 1);
+
+    MAPPED_BIN mapped_bin(bin_file);
+    UTST_ASSERT_EQUAL(static_cast<uint32_t>(1), mapped_bin.version());
+    UTST_ASSERT_EQUAL(static_cast<int>(sizeof(float)), mapped_bin.floating_value_size());
+    UTST_ASSERT_EQUAL(expected_data.size(), mapped_bin.n_body());
+
+    const BIN_PAYLOAD_VIEW<float> payload = mapped_bin.view<float>();
+    UTST_ASSERT_EQUAL(expected_data.size(), payload.size());
+    for (size_t i_body = 0; i_body < payload.size(); i_body++)
+    {
+        UTST_ASSERT(std::get<POS>(expected_data[i_body]) == payload.pos(i_body));
+        UTST_ASSERT(std::get<VEL>(expected_data[i_body]) == payload.vel(i_body));
+        UTST_ASSERT_EQUAL(std::get<MASS>(expected_data[i_body]), payload.mass(i_body));
+    }
+    std::filesystem::remove(bin_file);
+}
+
+UTST_TEST(mapped_bin_columns)
+{
+    const std::string bin_file = temp_bin_file("columns");
+    // Not a multiple of the column alignment
+    const SYSTEM_STATE_BASE<double> expected_data = random_system_state<double>(1001);
+    const BIN::METADATA expected_metadata{0.01, 300, 3.0};
+    serialize_system_state_to_bin(bin_file, expected_data, false, expected_metadata);
+
+    MAPPED_BIN mapped_bin(bin_file);
+    UTST_ASSERT_EQUAL(static_cast<uint32_t>(2), mapped_bin.version());
+    UTST_ASSERT_EQUAL(static_cast<int>(sizeof(double)), mapped_bin.floating_value_size());
+    UTST_ASSERT(mapped_bin.metadata().has_value());
+    UTST_ASSERT_EQUAL(expected_metadata.dt, mapped_bin.metadata()->dt);
+    UTST_ASSERT_EQUAL(expected_metadata.iteration, mapped_bin.metadata()->iteration);
+    UTST_ASSERT_EQUAL(expected_metadata.time, mapped_bin.metadata()->time);
+
+    const BIN_COLUMNS_VIEW<double> columns = mapped_bin.columns<double>();
+    UTST_ASSERT_EQUAL(expected_data.size(), columns.size());
+    for (size_t i_column = 0; i_column < BIN::n_column; i_column++)
+    {
+        UTST_ASSERT_EQUAL(static_cast<uintptr_t>(0), reinterpret_cast<uintptr_t>(columns.column(i_column)) % BIN::column_alignment);
+    }
+    for (size_t i_body = 0; i_body < columns.size(); i_body++)
+    {
+        UTST_ASSERT(std::get<POS_BASE<double>>(expected_data[i_body]) == columns.pos(i_body));
+        UTST_ASSERT(std::get<VEL_BASE<double>>(expected_data[i_body]) == columns.vel(i_body));
+        UTST_ASSERT_EQUAL(std::get<double>(expected_data[i_body]), columns.mass(i_body));
+    }
+
+    serialize_system_state_to_bin(bin_file, expected_data);
+    UTST_ASSERT(!MAPPED_BIN(bin_file).metadata().has_value());
+    std::filesystem::remove(bin_file);
+}
+
+UTST_TEST(mapped_bin_matches_stream)
+{
+    const std::string bin_file = temp_bin_file("matches_stream");
+
+    // Enough bodies to be split over several threads
+    const SYSTEM_STATE expected_data = random_system_state<float>(300000);
+    serialize_system_state_to_bin(bin_file, expected_data);
+    UTST_ASSERT(deserialize_system_state_from_bin(bin_file) == deserialize_system_state_from_mapped_bin(bin_file, 4));
+    UTST_ASSERT(expected_data == deserialize_system_state_from_mapped_bin(bin_file, 4));
+    // Widening is exact
+    UTST_ASSERT(deserialize_system_state_from_bin<double>(bin_file) == deserialize_system_state_from_mapped_bin<double>(bin_file, 4));
+
+    const SYSTEM_STATE_BASE<double> expected_data_double = random_system_state<double>(1000);
+    serialize_system_state_to_bin(bin_file, expected_data_double);
+    UTST_ASSERT(expected_data_double == deserialize_system_state_from_mapped_bin<double>(bin_file));
+    UTST_ASSERT(deserialize_system_state_from_bin<float>(bin_file) == deserialize_system_state_from_mapped_bin<float>(bin_file, 3));
+
+    // Version 1
+    serialize_system_state_to_bin(bin_file, expected_data, false, {}, 1);
+    UTST_ASSERT(expected_data == deserialize_system_state_from_mapped_bin(bin_file, 4));
+    UTST_ASSERT(deserialize_system_state_from_bin<double>(bin_file) == deserialize_system_state_from_mapped_bin<double>(bin_file, 4));
+
+    std::filesystem::remove(bin_file);
+}
+
+UTST_TEST(mapped_bin_startup_benchmark)
+{
+    const std::string bin_file = temp_bin_file("startup_benchmark");
+    serialize_system_state_to_bin(bin_file, random_system_state<float>(1000000));
+
+    TIMER timer("mapped_bin_startup_benchmark");
+    // Both paths see a warm page cache
+    SYSTEM_STATE stream_data = deserialize_system_state_from_bin(bin_file);
+    timer.elapsed_previous("warm_up");
+
+    stream_data = deserialize_system_state_from_bin(bin_file);
+    timer.elapsed_previous("deserialize_system_state_from_bin");
+    SYSTEM_STATE mapped_data = deserialize_system_state_from_mapped_bin(bin_file);
+    timer.elapsed_previous("deserialize_system_state_from_mapped_bin");
+    SYSTEM_STATE_BASE<double> mapped_data_double = deserialize_system_state_from_mapped_bin<double>(bin_file);
+    timer.elapsed_previous("deserialize_system_state_from_mapped_bin<double>");
+
+    UTST_ASSERT(stream_data == mapped_data);
+    UTST_ASSERT_EQUAL(stream_data.size(), mapped_data_double.size());
+    std::filesystem::remove(bin_file);
+}
@@ -24,4 +24,87 @@ UTST_TEST(pos_updated)
 
     POS p_new_expected{16.0, 23.0, 30.0};
     UTST_ASSERT_EQUAL(p_new_expected, p_new);
-}
\ No newline at end of file
+}
+UTST_TEST(pos_vel_updated_double)
+{
+    POS_BASE<double> p{10.0, 11.0, 12.0};
+    VEL_BASE<double> v{1.0, 2.0, 3.0};
+    ACC_BASE<double> a{2.0, 4.0, 6.0};
+
+    VEL_BASE<double> v_new_expected{3.0, 6.0, 9.0};
+    UTST_ASSERT_EQUAL(v_new_expected, VEL_BASE<double>::updated(v, a, 2.0));
+
+    POS_BASE<double> p_new_expected{16.0, 23.0, 30.0};
+    UTST_ASSERT_EQUAL(p_new_expected, POS_BASE<double>::updated(p, v, a, 2.0));
+}
+
+UTST_TEST(universal_field_double)
+{
+    // Beyond float precision: the field of a source 1e-9 further away must differ
+    POS_BASE<double> p_target{0.0, 0.0, 0.0};
+    POS_BASE<double> p_src{1.0, 0.0, 0.0};
+    POS_BASE<double> p_src_further{1.0 + 1e-9, 0.0, 0.0};
+    UTST_ASSERT(universal_field(p_src, p_target).x > universal_field(p_src_further, p_target).x);
+}
+
+UTST_TEST(gravity_and_jerk)
+{
+    const POS_BASE<double> p_src{1.0, 2.0, -1.0};
+    const VEL_BASE<double> v_src{0.5, -0.25, 1.0};
+    const POS_BASE<double> p_target{-0.5, 0.0, 0.5};
+    const VEL_BASE<double> v_target{0.0, 1.0, 0.0};
+    const auto [acc, jerk] = gravity_and_jerk(p_src, v_src, 3.0, p_target, v_target);
+    UTST_ASSERT_EQUAL(ACC_BASE<double>::from_gravity(p_src, 3.0, p_target).x, acc.x);
+
+    // The jerk is the time derivative of the acceleration, as both bodies move
+    const double h = 1e-6;
+    const POS_BASE<double> p_src_later{p_src + h * v_src};
+    const POS_BASE<double> p_target_later{p_target + h * v_target};
+    const POS_BASE<double> p_src_earlier{p_src - h * v_src};
+    const POS_BASE<double> p_target_earlier{p_target - h * v_target};
+    const XYZ_BASE<double> jerk_expected = (ACC_BASE<double>::from_gravity(p_src_later, 3.0, p_target_later) -
+                                            ACC_BASE<double>::from_gravity(p_src_earlier, 3.0, p_target_earlier)) /
+                                           (2 * h);
+    UTST_ASSERT((jerk - jerk_expected).norm_square() < 1e-16);
+}
+
+UTST_TEST(soa_system_state_adapters)
+{
+    const SYSTEM_STATE system_state{
+        {{1.0, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0},
+        {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, 17},
+    };
+    SOA_SYSTEM_STATE soa_system_state(system_state);
+    UTST_ASSERT_EQUAL(system_state.size(), soa_system_state.size());
+    UTST_ASSERT(system_state == soa_system_state.to_aos());
+
+    // Columns in the serialization order, 64-byte aligned
+    UTST_ASSERT_EQUAL(-2.0f, soa_system_state.pos_y()[0]);
+    UTST_ASSERT_EQUAL(16.0f, soa_system_state.column(5)[1]);
+    UTST_ASSERT_EQUAL(17.0f, soa_system_state.mass()[1]);
+    for (size_t i_column = 0; i_column < SOA_SYSTEM_STATE::n_column; i_column++)
+    {
+        UTST_ASSERT_EQUAL(size_t{0}, reinterpret_cast<uintptr_t>(soa_system_state.column(i_column).data()) % 64);
+    }
+
+    soa_system_state.set_pos(0, POS{0.5, 0.5, 0.5});
+    soa_system_state.vel_x()[1] = -1;
+    UTST_ASSERT_EQUAL((POS{0.5, 0.5, 0.5}), soa_system_state.pos(0));
+    UTST_ASSERT_EQUAL((VEL{-1.0, 15.0, 16.0}), soa_system_state.vel(1));
+
+    // Grown bodies are at rest at the origin, without mass
+    soa_system_state.resize(3);
+    UTST_ASSERT(std::make_tuple(POS{0, 0, 0}, VEL{0, 0, 0}, MASS{0}) == soa_system_state.body(2));
+}
+
+UTST_TEST(verify_soa_system_state)
+{
+    SOA_SYSTEM_STATE expected;
+    expected.emplace_back(POS{1.0, 2.0, 3.0}, VEL{4.0, 5.0, 6.0}, 7.0);
+    expected.emplace_back(POS{-1.0, -2.0, -3.0}, VEL{0.0, 0.0, 0.0}, 1.0);
+    SOA_SYSTEM_STATE actual = expected;
+    UTST_ASSERT(verify(expected, actual));
+
+    actual.set_pos(1, POS{-1.0, -2.0, 3.0});
+    UTST_ASSERT(!verify(expected, actual));
+}
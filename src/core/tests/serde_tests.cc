@@ -1,9 +1,16 @@
 #include "utst.hpp"
 #include "serde.h"
+#include "trajectory.h"
 #include "timer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
 #include <sstream>
 #include <iostream>
+#include <filesystem>
 
 using namespace CORE;
 
@@ -24,6 +31,65 @@ UTST_TEST(serialize_deserialize_system_state_to_csv_stream)
     UTST_ASSERT(expected_data == data);
 }
 
+UTST_TEST(serialize_system_state_to_csv_stream_fixed)
+{
+    SYSTEM_STATE data{
+        {{0.1f, -2.5e-7f, 3e20f}, {-0.0f, 5.0f, -6.123456789f}, 7.0f},
+    };
+
+    std::stringstream expected_ss;
+    expected_ss << std::fixed;
+    for (const auto &[p, v, m] : data)
+    {
+        expected_ss << p.x << "," << p.y << "," << p.z << "," << v.x << "," << v.y << "," << v.z << "," << m << "\n";
+    }
+
+    std::stringstream ss;
+    serialize_system_state_to_csv(ss, data);
+    UTST_ASSERT_EQUAL(expected_ss.str(), ss.str());
+}
+
+UTST_TEST(deserialize_system_state_from_csv_stream_tolerance)
+{
+    SYSTEM_STATE expected_data{
+        {{1.0, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0},
+        {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, 17},
+        {{0.5, 1e-3, 2.0}, {3.0, 4.0, 5.0}, 6},
+    };
+
+    std::stringstream ss;
+    ss << "x,y,z,vx,vy,vz,m\n"                // Invalid: header
+       << "1,-2,3,4,5,-6,7\n"
+       << "\n"                                 // Invalid: empty
+       << "1,2,3\n"                            // Invalid: too few values
+       << "11, 12 ,+13,14,15,16,17,\r\n"        // Spaces, '+', trailing comma and CRLF
+       << "1,2,3,4,5,6,7,8\n"                  // Invalid: too many values
+       << "0.5,1e-3,2.0,3.0,4.0,5.0,6.000000"; // No trailing '\n'
+    SYSTEM_STATE data = deserialize_system_state_from_csv(ss);
+
+    UTST_ASSERT_EQUAL(expected_data.size(), data.size());
+    UTST_ASSERT(expected_data == data);
+}
+
+UTST_TEST(serialize_deserialize_system_state_to_csv_file_parallel)
+{
+    // Enough rows to be split over several threads
+    SYSTEM_STATE expected_data;
+    for (int i_body = 0; i_body < 200000; i_body++)
+    {
+        const float x = static_cast<float>(i_body % 1000) / 8;
+        expected_data.emplace_back(POS{x, -x, 1}, VEL{2, x, -3}, x + 1);
+    }
+
+    std::string csv_file = std::filesystem::temp_directory_path() / "serde_tests_parallel.csv";
+    serialize_system_state_to_csv(csv_file, expected_data);
+    SYSTEM_STATE data = deserialize_system_state_from_csv(csv_file);
+    std::filesystem::remove(csv_file);
+
+    UTST_ASSERT_EQUAL(expected_data.size(), data.size());
+    UTST_ASSERT(expected_data == data);
+}
+
 UTST_IGNORED_TEST(bin_to_csv_converter)
 {
     TIMER timer("bin_to_csv_converter");
@@ -75,4 +141,426 @@ UTST_TEST(serialize_deserialize_system_state_to_bin_stream)
 
     UTST_ASSERT_EQUAL(expected_data.size(), data.size());
     UTST_ASSERT(expected_data == data);
-}
\ No newline at end of file
+}
+UTST_TEST(serialize_deserialize_system_state_to_bin_stream_v1)
+{
+    SYSTEM_STATE expected_data{
+        {{1.0, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0},
+        {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0}, 17},
+    };
+
+    std::stringstream ss;
+    serialize_system_state_to_bin(ss, expected_data, {}, 1);
+    // The original layout: 4-byte floating value size, 4-byte number of bodies, then 7 values per body
+    UTST_ASSERT_EQUAL(8 + expected_data.size() * 7 * sizeof(float), ss.str().size());
+    SYSTEM_STATE data = deserialize_system_state_from_bin(ss);
+
+    UTST_ASSERT(expected_data == data);
+}
+
+UTST_TEST(serialize_system_state_to_bin_stream_v2_layout)
+{
+    // Not a multiple of the column alignment
+    SYSTEM_STATE expected_data(5, {{1.0, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0});
+
+    std::stringstream ss;
+    serialize_system_state_to_bin(ss, expected_data, BIN::METADATA{0.5, 10, 5.0});
+    const std::string bytes = ss.str();
+    UTST_ASSERT_EQUAL(BIN::header_size_v2 + BIN::n_column * 64, bytes.size());
+    UTST_ASSERT(bytes.compare(0, sizeof(BIN::magic), BIN::magic, sizeof(BIN::magic)) == 0);
+    // Column VEL.x
+    float vel_x = 0;
+    std::memcpy(&vel_x, bytes.data() + BIN::header_size_v2 + 3 * 64 + 4 * sizeof(float), sizeof(float));
+    UTST_ASSERT_EQUAL(4.0f, vel_x);
+
+    SYSTEM_STATE data = deserialize_system_state_from_bin(ss);
+    UTST_ASSERT(expected_data == data);
+}
+
+UTST_TEST(serialize_deserialize_system_state_to_bin_stream_double)
+{
+    // Not representable in float
+    SYSTEM_STATE_BASE<double> expected_data{
+        {{1.0 + 1e-12, -2.0, 3.0}, {4.0, 5.0, -6.0}, 7.0},
+        {{11.0, 12.0, 13.0}, {14.0, 15.0, 16.0 + 1e-12}, 17},
+    };
+
+    std::stringstream ss;
+    serialize_system_state_to_bin(ss, expected_data);
+    SYSTEM_STATE_BASE<double> data = deserialize_system_state_from_bin<double>(ss);
+
+    UTST_ASSERT_EQUAL(expected_data.size(), data.size());
+    UTST_ASSERT(expected_data == data);
+}
+
+UTST_TEST(deserialize_system_state_from_bin_stream_float_as_double)
+{
+    SYSTEM_STATE expected_data{
+        {{0.1f, -2.0f, 3.0f}, {4.0f, 5.0f, -6.0f}, 7.0f},
+    };
+
+    std::stringstream ss;
+    serialize_system_state_to_bin(ss, expected_data);
+    SYSTEM_STATE_BASE<double> data = deserialize_system_state_from_bin<double>(ss);
+
+    // Widening is exact
+    UTST_ASSERT_EQUAL(expected_data.size(), data.size());
+    UTST_ASSERT_EQUAL(static_cast<double>(std::get<POS>(expected_data[0]).x), std::get<POS_BASE<double>>(data[0]).x);
+    UTST_ASSERT_EQUAL(static_cast<double>(std::get<MASS>(expected_data[0])), std::get<double>(data[0]));
+}
+
+UTST_TEST(serialize_soa_system_state_to_bin_stream)
+{
+    // Not a multiple of the column alignment
+    SYSTEM_STATE expected_data;
+    for (int i_body = 0; i_body < 37; i_body++)
+    {
+        const float x = static_cast<float>(i_body) / 4;
+        expected_data.emplace_back(POS{x, -x, 1}, VEL{2, x, -3}, x + 1);
+    }
+    const SOA_SYSTEM_STATE soa_data(expected_data);
+
+    // Byte for byte what the AoS SYSTEM_STATE gives, in either version
+    for (const uint32_t version : {1u, 2u})
+    {
+        std::stringstream expected_ss;
+        std::stringstream ss;
+        serialize_system_state_to_bin(expected_ss, expected_data, {}, version);
+        serialize_system_state_to_bin(ss, soa_data, {}, version);
+        UTST_ASSERT(expected_ss.str() == ss.str());
+        UTST_ASSERT(expected_data == deserialize_system_state_from_bin(ss));
+    }
+}
+
+namespace
+{
+    /// Every stride-th body of system_state, up to max_n_body
+    SYSTEM_STATE subsample(const SYSTEM_STATE &system_state, size_t stride, size_t max_n_body)
+    {
+        SYSTEM_STATE subsampled;
+        for (size_t i_body = 0; i_body < system_state.size() && subsampled.size() < max_n_body; i_body += stride)
+        {
+            subsampled.push_back(system_state[i_body]);
+        }
+        return subsampled;
+    }
+}
+
+UTST_TEST(ingest_system_state_from_file)
+{
+    SYSTEM_STATE expected_data;
+    for (int i_body = 0; i_body < 1000; i_body++)
+    {
+        const float x = static_cast<float>(i_body) / 8;
+        expected_data.emplace_back(POS{x, -x, 1}, VEL{2, x, -3}, x + 1);
+    }
+
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+    const std::string bin_v1_file = temp_dir / "serde_tests_ingest_v1.bin";
+    const std::string bin_v2_file = temp_dir / "serde_tests_ingest_v2.bin";
+    const std::string csv_file = temp_dir / "serde_tests_ingest.csv";
+    const std::string trajectory_file = temp_dir / "serde_tests_ingest.traj";
+    serialize_system_state_to_bin(bin_v1_file, expected_data, false, {}, 1);
+    serialize_system_state_to_bin(bin_v2_file, expected_data);
+    serialize_system_state_to_csv(csv_file, expected_data);
+    {
+        // The last frame is ingested
+        TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, expected_data.size());
+        trajectory_writer.write_frame(SYSTEM_STATE(expected_data.size()));
+        trajectory_writer.write_frame(expected_data);
+    }
+
+    for (const std::string &file : {bin_v1_file, bin_v2_file, csv_file, trajectory_file})
+    {
+        INGESTION ingestion;
+        UTST_ASSERT(expected_data == deserialize_system_state_from_file(file, ingestion));
+        UTST_ASSERT(SOA_SYSTEM_STATE(expected_data) == deserialize_soa_system_state_from_file(file, ingestion));
+
+        // Chunks not a multiple of the stride, cut by max_n_body
+        ingestion.chunk_size = 64;
+        ingestion.stride = 3;
+        ingestion.max_n_body = 200;
+        const SYSTEM_STATE expected_subsample = subsample(expected_data, ingestion.stride, ingestion.max_n_body);
+        SYSTEM_STATE data(expected_subsample.size());
+        size_t n_chunk = 0;
+        const size_t n_body = ingest_system_state_from_file<float>(
+            file, ingestion,
+            [&data, &n_chunk](const SYSTEM_STATE &chunk, size_t i_first_body)
+            {
+                UTST_ASSERT(i_first_body + chunk.size() <= data.size());
+                std::copy(chunk.begin(), chunk.end(), data.begin() + i_first_body);
+                n_chunk++;
+            });
+        UTST_ASSERT_EQUAL(expected_subsample.size(), n_body);
+        UTST_ASSERT(expected_subsample == data);
+        UTST_ASSERT(n_chunk > 1);
+        if (file != csv_file)
+        {
+            UTST_ASSERT_EQUAL(expected_subsample.size(), *num_bodies_to_ingest(file, ingestion));
+        }
+
+        ingestion.max_n_body = std::numeric_limits<size_t>::max();
+        ingestion.stride = 7;
+        UTST_ASSERT(subsample(expected_data, 7, expected_data.size()) == deserialize_system_state_from_file(file, ingestion));
+        UTST_ASSERT(SOA_SYSTEM_STATE(subsample(expected_data, 7, expected_data.size())) == deserialize_soa_system_state_from_file(file, ingestion));
+        ingestion.stride = 1;
+        ingestion.max_n_body = 100;
+        UTST_ASSERT(SOA_SYSTEM_STATE(subsample(expected_data, 1, 100)) == deserialize_soa_system_state_from_file(file, ingestion));
+    }
+    UTST_ASSERT(!num_bodies_to_ingest(csv_file, INGESTION{}));
+
+    std::filesystem::remove(bin_v1_file);
+    std::filesystem::remove(bin_v2_file);
+    std::filesystem::remove(csv_file);
+    std::filesystem::remove(trajectory_file);
+}
+
+namespace
+{
+    /// Appends the bytes of value, big-endian or little-endian
+    template <typename V>
+    void append_value(std::string &bytes, V value, bool is_big_endian)
+    {
+        char value_bytes[sizeof(V)];
+        std::memcpy(value_bytes, &value, sizeof(V));
+        if (is_big_endian)
+        {
+            std::reverse(std::begin(value_bytes), std::end(value_bytes));
+        }
+        bytes.append(value_bytes, sizeof(V));
+    }
+
+    /// Particle i_particle of a snapshot, in its code units
+    BODY_STATE_BASE<double> snapshot_particle(size_t i_particle)
+    {
+        const double x = static_cast<double>(i_particle) + 0.25;
+        return {POS_BASE<double>{x, -x, 2 * x}, VEL_BASE<double>{1, -x, 0.5}, x / 16};
+    }
+
+    /// The particles of n_particles[i_type] for each selected type, in TUSS units
+    SYSTEM_STATE snapshot_system_state(const std::vector<size_t> &n_particles, uint32_t body_types, const SNAPSHOT_UNITS &units)
+    {
+        SYSTEM_STATE system_state;
+        size_t i_particle = 0;
+        for (size_t i_type = 0; i_type < n_particles.size(); i_type++)
+        {
+            for (size_t i_type_particle = 0; i_type_particle < n_particles[i_type]; i_type_particle++, i_particle++)
+            {
+                if (body_types >> i_type & 1)
+                {
+                    const auto [pos, vel, mass] = snapshot_particle(i_particle);
+                    system_state.emplace_back(POS{static_cast<float>(pos.x * units.length_in_pc), static_cast<float>(pos.y * units.length_in_pc), static_cast<float>(pos.z * units.length_in_pc)},
+                                              VEL{static_cast<float>(vel.x * units.velocity_in_kms), static_cast<float>(vel.y * units.velocity_in_kms), static_cast<float>(vel.z * units.velocity_in_kms)},
+                                              static_cast<float>(mass * units.mass_in_msun * G_solar_mass_parsec_kmps));
+                }
+            }
+        }
+        return system_state;
+    }
+
+    /// Equal up to the float rounding of the files and of the unit conversion
+    bool is_near(const SYSTEM_STATE &lhs, const SYSTEM_STATE &rhs)
+    {
+        auto is_near_value = [](float lhs, float rhs)
+        { return std::abs(lhs - rhs) <= 1e-5f * std::max(std::abs(lhs), std::abs(rhs)); };
+        if (lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for (size_t i_body = 0; i_body < lhs.size(); i_body++)
+        {
+            const auto &[lhs_pos, lhs_vel, lhs_mass] = lhs[i_body];
+            const auto &[rhs_pos, rhs_vel, rhs_mass] = rhs[i_body];
+            if (!is_near_value(lhs_pos.x, rhs_pos.x) || !is_near_value(lhs_pos.y, rhs_pos.y) || !is_near_value(lhs_pos.z, rhs_pos.z) ||
+                !is_near_value(lhs_vel.x, rhs_vel.x) || !is_near_value(lhs_vel.y, rhs_vel.y) || !is_near_value(lhs_vel.z, rhs_vel.z) ||
+                !is_near_value(lhs_mass, rhs_mass))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Standard TIPSY of n_particles gas, dark and star particles, see TIPSY
+    void write_tipsy(const std::string &tipsy_file_path, const std::vector<size_t> &n_particles, bool is_big_endian)
+    {
+        // Values per record beyond mass, pos and vel
+        constexpr size_t n_extra_values[TIPSY::N_BODY_TYPE] = {5, 2, 4};
+        std::string bytes;
+        append_value(bytes, 0.5, is_big_endian);
+        append_value(bytes, static_cast<int32_t>(n_particles[0] + n_particles[1] + n_particles[2]), is_big_endian);
+        append_value(bytes, int32_t{3}, is_big_endian);
+        for (const size_t n_particle : n_particles)
+        {
+            append_value(bytes, static_cast<int32_t>(n_particle), is_big_endian);
+        }
+        append_value(bytes, int32_t{0}, is_big_endian);
+        size_t i_particle = 0;
+        for (size_t i_type = 0; i_type < TIPSY::N_BODY_TYPE; i_type++)
+        {
+            for (size_t i_type_particle = 0; i_type_particle < n_particles[i_type]; i_type_particle++, i_particle++)
+            {
+                const auto [pos, vel, mass] = snapshot_particle(i_particle);
+                for (const double value : {mass, pos.x, pos.y, pos.z, vel.x, vel.y, vel.z})
+                {
+                    append_value(bytes, static_cast<float>(value), is_big_endian);
+                }
+                for (size_t i_value = 0; i_value < n_extra_values[i_type]; i_value++)
+                {
+                    append_value(bytes, 1.f, is_big_endian);
+                }
+            }
+        }
+        std::ofstream(tipsy_file_path, std::ios::binary).write(bytes.data(), bytes.size());
+    }
+
+    /// GADGET-2 of n_particles[i_type] particles for each type, the mass of the types in fixed_masses being fixed
+    template <typename F>
+    void write_gadget(const std::string &gadget_file_path, const std::vector<size_t> &n_particles, const std::vector<double> &fixed_masses,
+                      bool has_labels, bool is_big_endian, double omega_0 = 0, double hubble_param = 0, double time = 0)
+    {
+        std::string bytes;
+        auto append_block = [&](const char *label, const std::string &payload)
+        {
+            if (has_labels)
+            {
+                append_value(bytes, uint32_t{8}, is_big_endian);
+                bytes.append(label, 4);
+                append_value(bytes, static_cast<uint32_t>(payload.size() + 8), is_big_endian);
+                append_value(bytes, uint32_t{8}, is_big_endian);
+            }
+            append_value(bytes, static_cast<uint32_t>(payload.size()), is_big_endian);
+            bytes += payload;
+            append_value(bytes, static_cast<uint32_t>(payload.size()), is_big_endian);
+        };
+
+        std::string header;
+        for (const size_t n_particle : n_particles)
+        {
+            append_value(header, static_cast<int32_t>(n_particle), is_big_endian);
+        }
+        for (const double fixed_mass : fixed_masses)
+        {
+            append_value(header, fixed_mass, is_big_endian);
+        }
+        append_value(header, time, is_big_endian);
+        header.resize(124, '\0');
+        append_value(header, int32_t{1}, is_big_endian);
+        append_value(header, 0., is_big_endian);
+        append_value(header, omega_0, is_big_endian);
+        append_value(header, 0., is_big_endian);
+        append_value(header, hubble_param, is_big_endian);
+        header.resize(GADGET::header_size, '\0');
+        append_block("HEAD", header);
+
+        std::string pos_payload, vel_payload, id_payload, mass_payload;
+        size_t i_particle = 0;
+        for (size_t i_type = 0; i_type < n_particles.size(); i_type++)
+        {
+            for (size_t i_type_particle = 0; i_type_particle < n_particles[i_type]; i_type_particle++, i_particle++)
+            {
+                const auto [pos, vel, mass] = snapshot_particle(i_particle);
+                for (const double value : {pos.x, pos.y, pos.z})
+                {
+                    append_value(pos_payload, static_cast<F>(value), is_big_endian);
+                }
+                for (const double value : {vel.x, vel.y, vel.z})
+                {
+                    append_value(vel_payload, static_cast<F>(value), is_big_endian);
+                }
+                append_value(id_payload, static_cast<uint32_t>(i_particle), is_big_endian);
+                if (fixed_masses[i_type] == 0)
+                {
+                    append_value(mass_payload, static_cast<F>(mass), is_big_endian);
+                }
+            }
+        }
+        append_block("POS ", pos_payload);
+        append_block("VEL ", vel_payload);
+        append_block("ID  ", id_payload);
+        if (!mass_payload.empty())
+        {
+            append_block("MASS", mass_payload);
+        }
+        std::ofstream(gadget_file_path, std::ios::binary).write(bytes.data(), bytes.size());
+    }
+}
+
+UTST_TEST(ingest_system_state_from_tipsy)
+{
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "serde_tests_tipsy";
+    std::filesystem::create_directories(temp_dir);
+    // Told from BIN by its content
+    const std::string tipsy_file = temp_dir / "galaxy.bin";
+    const std::vector<size_t> n_particles = {3, 50, 20};
+    const uint32_t all_types = ~uint32_t{0};
+    // Without a .param file, 1 kpc and 1 Msun as yt has them, G being 1 in TIPSY units
+    const SNAPSHOT_UNITS tipsy_units{1000, std::sqrt(G_solar_mass_parsec_kmps / 1000), 1};
+
+    for (const bool is_big_endian : {true, false})
+    {
+        write_tipsy(tipsy_file, n_particles, is_big_endian);
+        UTST_ASSERT(is_near(snapshot_system_state(n_particles, all_types, tipsy_units), deserialize_system_state_from_file(tipsy_file)));
+    }
+
+    INGESTION ingestion;
+    ingestion.body_types = 1 << TIPSY::DARK | 1 << TIPSY::STAR;
+    ingestion.chunk_size = 16;
+    ingestion.stride = 3;
+    const SYSTEM_STATE expected_subsample = subsample(snapshot_system_state(n_particles, ingestion.body_types, tipsy_units), 3, 1000);
+    UTST_ASSERT_EQUAL(expected_subsample.size(), *num_bodies_to_ingest(tipsy_file, ingestion));
+    UTST_ASSERT(is_near(expected_subsample, deserialize_system_state_from_file(tipsy_file, ingestion)));
+
+    // Physical units of the .param file, G = 1 in TIPSY units
+    std::ofstream(temp_dir / "galaxy.param") << "dKpcUnit = 2 # kpc\n"
+                                             << "dMsolUnit        = 1e9\n";
+    const SNAPSHOT_UNITS param_units{2000, std::sqrt(G_solar_mass_parsec_kmps * 1e9 / 2000), 1e9};
+    UTST_ASSERT(is_near(snapshot_system_state(n_particles, all_types, param_units), deserialize_system_state_from_file(tipsy_file)));
+
+    // An invalid line is skipped, its unit taking the default
+    std::ofstream(temp_dir / "galaxy.param") << "dKpcUnit = 2kpc\n"
+                                             << "dMsolUnit = 1e9\n";
+    const SNAPSHOT_UNITS msol_param_units{1000, std::sqrt(G_solar_mass_parsec_kmps * 1e9 / 1000), 1e9};
+    UTST_ASSERT(is_near(snapshot_system_state(n_particles, all_types, msol_param_units), deserialize_system_state_from_file(tipsy_file)));
+
+    // Overridden
+    ingestion = INGESTION{};
+    ingestion.units = SNAPSHOT_UNITS{3, 4, 5};
+    UTST_ASSERT(is_near(snapshot_system_state(n_particles, all_types, *ingestion.units), deserialize_system_state_from_file(tipsy_file, ingestion)));
+
+    std::filesystem::remove_all(temp_dir);
+}
+
+UTST_TEST(ingest_system_state_from_gadget)
+{
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+    const std::string gadget_file = temp_dir / "serde_tests_gadget_000";
+    const std::vector<size_t> n_particles = {40, 30, 0, 0, 10, 0};
+    // Halo particles of fixed mass, the others in the MASS block
+    const std::vector<double> fixed_masses = {0, 0.5, 0, 0, 0, 0};
+    const SNAPSHOT_UNITS gadget_units{1000, 1, 1e10};
+
+    // SnapFormat 1, little-endian, float
+    write_gadget<float>(gadget_file, n_particles, fixed_masses, false, false);
+    SYSTEM_STATE expected_data = snapshot_system_state(n_particles, ~uint32_t{0}, gadget_units);
+    for (size_t i_body = n_particles[0]; i_body < n_particles[0] + n_particles[1]; i_body++)
+    {
+        std::get<MASS>(expected_data[i_body]) = static_cast<MASS>(0.5 * gadget_units.mass_in_msun * G_solar_mass_parsec_kmps);
+    }
+    UTST_ASSERT(is_near(expected_data, deserialize_system_state_from_file(gadget_file)));
+
+    // SnapFormat 2, big-endian, double, without the fixed masses
+    write_gadget<double>(gadget_file, n_particles, {0, 0, 0, 0, 0, 0}, true, true);
+    INGESTION ingestion;
+    ingestion.body_types = 1 << 0 | 1 << 4;
+    ingestion.chunk_size = 7;
+    UTST_ASSERT_EQUAL(size_t{50}, *num_bodies_to_ingest(gadget_file, ingestion));
+    UTST_ASSERT(is_near(snapshot_system_state(n_particles, ingestion.body_types, gadget_units), deserialize_system_state_from_file(gadget_file, ingestion)));
+
+    // Cosmological, in physical units at a = 0.5, h = 0.7
+    write_gadget<float>(gadget_file, n_particles, {0, 0, 0, 0, 0, 0}, false, false, 0.3, 0.7, 0.5);
+    const SNAPSHOT_UNITS cosmological_units{1000 / 0.7 * 0.5, std::sqrt(0.5), 1e10 / 0.7};
+    UTST_ASSERT(is_near(snapshot_system_state(n_particles, ~uint32_t{0}, cosmological_units), deserialize_system_state_from_file(gadget_file)));
+
+    std::filesystem::remove(gadget_file);
+}
@@ -0,0 +1,104 @@
+#include "utst.hpp"
+#include "system_state_log_writer.h"
+#include "trajectory.h"
+
+#include <filesystem>
+#include <iostream>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    std::string make_temp_log_dir(const std::string &name)
+    {
+        const auto log_dir = std::filesystem::temp_directory_path() / ("system_state_log_writer_tests_" + name);
+        std::filesystem::remove_all(log_dir);
+        std::filesystem::create_directories(log_dir);
+        return log_dir.string();
+    }
+
+    SOA_SYSTEM_STATE make_frame(int i_frame, size_t n_body)
+    {
+        SOA_SYSTEM_STATE frame;
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const float x = static_cast<float>(i_frame * 100 + i_body);
+            frame.emplace_back(POS{x, 1, 2}, VEL{3, x, 4}, 5);
+        }
+        return frame;
+    }
+}
+
+UTST_TEST(system_state_log_writer_in_order)
+{
+    const std::string log_dir = make_temp_log_dir("in_order");
+    constexpr int n_frame = 20;
+    constexpr size_t n_body = 10;
+    {
+        // Room for 2 frames, so that acquire_frame() has to wait for the writer
+        SYSTEM_STATE_LOG_WRITER<float> writer(log_dir, 2 * n_body * sizeof(BODY_STATE));
+        for (int i_frame = 0; i_frame < n_frame; i_frame++)
+        {
+            SOA_SYSTEM_STATE frame = writer.acquire_frame(n_body);
+            UTST_ASSERT(frame.empty());
+            frame = make_frame(i_frame, n_body);
+            writer.push(std::move(frame));
+        }
+        writer.flush();
+        UTST_ASSERT_EQUAL(n_frame, writer.num_pushed_frames());
+
+        // Written frames are recycled
+        SOA_SYSTEM_STATE frame = writer.acquire_frame(n_body);
+        UTST_ASSERT(frame.empty());
+        UTST_ASSERT(frame.capacity() >= n_body);
+    }
+
+    const TRAJECTORY_READER trajectory_reader(SYSTEM_STATE_LOG_WRITER<float>::trajectory_file_path(log_dir));
+    UTST_ASSERT(trajectory_reader.has_index());
+    UTST_ASSERT_EQUAL(static_cast<size_t>(n_frame), trajectory_reader.num_frames());
+    for (int i_frame = 0; i_frame < n_frame; i_frame++)
+    {
+        UTST_ASSERT(make_frame(i_frame, n_body).to_aos() == trajectory_reader.read_frame(i_frame));
+    }
+    std::filesystem::remove_all(log_dir);
+}
+
+UTST_TEST(system_state_log_writer_written_on_destruction)
+{
+    const std::string log_dir = make_temp_log_dir("destruction");
+    {
+        SYSTEM_STATE_LOG_WRITER<double> writer(log_dir);
+        SOA_SYSTEM_STATE_BASE<double> frame = writer.acquire_frame(1);
+        frame.emplace_back(POS_BASE<double>{1, 2, 3}, VEL_BASE<double>{4, 5, 6}, 7);
+        writer.push(std::move(frame));
+    }
+
+    const SYSTEM_STATE_BASE<double> expected_frame{{{1, 2, 3}, {4, 5, 6}, 7}};
+    const TRAJECTORY_READER trajectory_reader(SYSTEM_STATE_LOG_WRITER<double>::trajectory_file_path(log_dir));
+    UTST_ASSERT_EQUAL(static_cast<size_t>(1), trajectory_reader.num_frames());
+    UTST_ASSERT(expected_frame == trajectory_reader.read_frame<double>(0));
+    std::filesystem::remove_all(log_dir);
+}
+
+UTST_TEST(system_state_log_writer_failure)
+{
+    const std::string log_dir = make_temp_log_dir("failure") + "/missing";
+    SYSTEM_STATE_LOG_WRITER<float> writer(log_dir);
+    writer.push(make_frame(0, 1));
+
+    bool has_thrown = false;
+    try
+    {
+        writer.flush();
+    }
+    catch (const std::runtime_error &)
+    {
+        has_thrown = true;
+    }
+    UTST_ASSERT(has_thrown);
+    // Reported once
+    writer.flush();
+    std::filesystem::remove_all(std::filesystem::path(log_dir).parent_path());
+}
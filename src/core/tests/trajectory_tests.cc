@@ -0,0 +1,234 @@
+#include "utst.hpp"
+#include "trajectory.h"
+#include "serde.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+using namespace CORE;
+
+UTST_MAIN();
+
+namespace
+{
+    std::string temp_trajectory_file(const std::string &name)
+    {
+        return (std::filesystem::temp_directory_path() / ("trajectory_tests_" + name + ".traj")).string();
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> make_frame(int i_frame, size_t n_body)
+    {
+        SYSTEM_STATE_BASE<T> frame;
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const T x = static_cast<T>(i_frame * 100 + i_body) + static_cast<T>(0.25);
+            frame.emplace_back(POS_BASE<T>{x, 1, 2}, VEL_BASE<T>{3, x, 4}, 5);
+        }
+        return frame;
+    }
+}
+
+UTST_TEST(trajectory_write_read)
+{
+    const std::string trajectory_file = temp_trajectory_file("write_read");
+    constexpr int n_frame = 5;
+    constexpr size_t n_body = 3;
+    {
+        TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body);
+        for (int i_frame = 0; i_frame < n_frame; i_frame++)
+        {
+            trajectory_writer.write_frame(make_frame<float>(i_frame, n_body));
+        }
+    }
+
+    const TRAJECTORY_READER trajectory_reader(trajectory_file);
+    UTST_ASSERT(trajectory_reader.has_index());
+    UTST_ASSERT_EQUAL(static_cast<int>(sizeof(float)), trajectory_reader.floating_value_size());
+    UTST_ASSERT_EQUAL(n_body, trajectory_reader.n_body());
+    UTST_ASSERT_EQUAL(static_cast<size_t>(n_frame), trajectory_reader.num_frames());
+    // Any order
+    for (int i_frame = n_frame - 1; i_frame >= 0; i_frame--)
+    {
+        UTST_ASSERT(make_frame<float>(i_frame, n_body) == trajectory_reader.read_frame(i_frame));
+    }
+    UTST_ASSERT(make_frame<float>(3, n_body)[1] == std::make_tuple(trajectory_reader.frame_view<float>(3).pos(1),
+                                                                   trajectory_reader.frame_view<float>(3).vel(1),
+                                                                   trajectory_reader.frame_view<float>(3).mass(1)));
+    // Last frame
+    UTST_ASSERT(make_frame<float>(n_frame - 1, n_body) == deserialize_system_state_from_file(trajectory_file));
+    std::filesystem::remove(trajectory_file);
+}
+
+UTST_TEST(trajectory_write_read_double)
+{
+    const std::string trajectory_file = temp_trajectory_file("write_read_double");
+    {
+        TRAJECTORY_WRITER<double> trajectory_writer(trajectory_file, 2);
+        trajectory_writer.write_frame(make_frame<double>(0, 2));
+        trajectory_writer.write_frame(make_frame<double>(1, 2));
+    }
+
+    UTST_ASSERT(make_frame<double>(0, 2) == deserialize_system_state_from_trajectory<double>(trajectory_file, 0));
+    UTST_ASSERT(make_frame<double>(1, 2) == deserialize_system_state_from_trajectory<double>(trajectory_file, 1));
+    std::filesystem::remove(trajectory_file);
+}
+
+UTST_TEST(trajectory_partial_file)
+{
+    const std::string trajectory_file = temp_trajectory_file("partial_file");
+    constexpr size_t n_body = 4;
+    {
+        TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body);
+        for (int i_frame = 0; i_frame < 3; i_frame++)
+        {
+            trajectory_writer.write_frame(make_frame<float>(i_frame, n_body));
+        }
+    }
+    // As if the run crashed in the middle of the last frame, before the index
+    const size_t record_size = TRAJECTORY::frame_record_size(sizeof(float), n_body);
+    std::filesystem::resize_file(trajectory_file, TRAJECTORY::header_size + 2 * record_size + record_size / 2);
+
+    const TRAJECTORY_READER trajectory_reader(trajectory_file);
+    UTST_ASSERT(!trajectory_reader.has_index());
+    UTST_ASSERT_EQUAL(static_cast<size_t>(2), trajectory_reader.num_frames());
+    UTST_ASSERT(make_frame<float>(0, n_body) == trajectory_reader.read_frame(0));
+    UTST_ASSERT(make_frame<float>(1, n_body) == trajectory_reader.read_frame(1));
+    std::filesystem::remove(trajectory_file);
+}
+
+namespace
+{
+    /// Bodies drifting and accelerating smoothly, with a few outliers
+    SYSTEM_STATE make_moving_frame(int i_frame, size_t n_body)
+    {
+        SYSTEM_STATE frame;
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const float t = 0.01f * i_frame;
+            const float x0 = static_cast<float>(i_body % 97) - 48;
+            const float vx = (i_body % 13 == 0) ? 50.0f : 0.5f;
+            frame.emplace_back(POS{x0 + vx * t + 0.5f * t * t, -x0, 0.25f * t}, VEL{vx + t, 0, 0.25f}, 1.0f + i_body % 5);
+        }
+        return frame;
+    }
+}
+
+UTST_TEST(trajectory_compressed)
+{
+    const std::string trajectory_file = temp_trajectory_file("compressed");
+    // Several chunks, the last one partial, and several keyframes
+    constexpr size_t n_body = TRAJECTORY::compressed_chunk_size + 100;
+    constexpr int n_frame = 20;
+    TRAJECTORY::COMPRESSION compression;
+    compression.pos_error_bound = 1e-3;
+    compression.vel_error_bound = 1e-2;
+    compression.keyframe_interval = 8;
+    {
+        TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body, compression);
+        for (int i_frame = 0; i_frame < n_frame; i_frame++)
+        {
+            trajectory_writer.write_frame(make_moving_frame(i_frame, n_body));
+        }
+        // Far less than RAW
+        UTST_ASSERT(trajectory_writer.size() * 5 < TRAJECTORY::header_size + n_frame * TRAJECTORY::frame_record_size(sizeof(float), n_body));
+    }
+
+    const TRAJECTORY_READER trajectory_reader(trajectory_file);
+    UTST_ASSERT(trajectory_reader.has_index());
+    UTST_ASSERT(trajectory_reader.encoding() == TRAJECTORY::ENCODING::COMPRESSED);
+    UTST_ASSERT_EQUAL(static_cast<size_t>(n_frame), trajectory_reader.num_frames());
+    // Out of order, across keyframes
+    for (int i_frame : {5, 19, 0, 9, 8, 10, 11, 3})
+    {
+        const SYSTEM_STATE expected_frame = make_moving_frame(i_frame, n_body);
+        const SYSTEM_STATE frame = trajectory_reader.read_frame(i_frame);
+        UTST_ASSERT_EQUAL(expected_frame.size(), frame.size());
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const auto &[expected_p, expected_v, expected_m] = expected_frame[i_body];
+            const auto &[p, v, m] = frame[i_body];
+            UTST_ASSERT(std::abs(p.x - expected_p.x) <= 1.001e-3 && std::abs(p.y - expected_p.y) <= 1.001e-3 && std::abs(p.z - expected_p.z) <= 1.001e-3);
+            UTST_ASSERT(std::abs(v.x - expected_v.x) <= 1.001e-2 && std::abs(v.y - expected_v.y) <= 1.001e-2 && std::abs(v.z - expected_v.z) <= 1.001e-2);
+            UTST_ASSERT_EQUAL(expected_m, m);
+        }
+    }
+    std::filesystem::remove(trajectory_file);
+}
+
+UTST_TEST(trajectory_compressed_partial_file)
+{
+    const std::string trajectory_file = temp_trajectory_file("compressed_partial_file");
+    constexpr size_t n_body = 300;
+    TRAJECTORY::COMPRESSION compression;
+    compression.pos_error_bound = compression.vel_error_bound = 1e-4;
+    uint64_t size_after_2_frames = 0;
+    {
+        TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body, compression);
+        for (int i_frame = 0; i_frame < 3; i_frame++)
+        {
+            trajectory_writer.write_frame(make_moving_frame(i_frame, n_body));
+            if (i_frame == 1)
+            {
+                size_after_2_frames = trajectory_writer.size();
+            }
+        }
+    }
+    // As if the run crashed in the middle of the last frame, before the index
+    std::filesystem::resize_file(trajectory_file, size_after_2_frames + 10);
+
+    const TRAJECTORY_READER trajectory_reader(trajectory_file);
+    UTST_ASSERT(!trajectory_reader.has_index());
+    UTST_ASSERT_EQUAL(static_cast<size_t>(2), trajectory_reader.num_frames());
+    const SYSTEM_STATE frame = trajectory_reader.read_frame(1);
+    UTST_ASSERT(std::abs(std::get<POS>(frame[13]).x - std::get<POS>(make_moving_frame(1, n_body)[13]).x) <= 1.001e-4);
+    std::filesystem::remove(trajectory_file);
+}
+
+UTST_TEST(trajectory_reopen)
+{
+    const std::string expected_trajectory_file = temp_trajectory_file("reopen_expected");
+    const std::string trajectory_file = temp_trajectory_file("reopen");
+    constexpr size_t n_body = 300;
+    constexpr int n_frame = 10;
+    TRAJECTORY::COMPRESSION compression;
+    compression.pos_error_bound = compression.vel_error_bound = 1e-4;
+    compression.keyframe_interval = 4;
+
+    for (const TRAJECTORY::COMPRESSION &file_compression : {TRAJECTORY::COMPRESSION{}, compression})
+    {
+        {
+            TRAJECTORY_WRITER<float> trajectory_writer(expected_trajectory_file, n_body, file_compression);
+            for (int i_frame = 0; i_frame < n_frame; i_frame++)
+            {
+                trajectory_writer.write_frame(make_moving_frame(i_frame, n_body));
+            }
+        }
+        // A run which went further than the frames kept, then resumed
+        {
+            TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body, file_compression);
+            for (int i_frame = 0; i_frame < 7; i_frame++)
+            {
+                trajectory_writer.write_frame(make_moving_frame(i_frame, n_body));
+            }
+        }
+        {
+            // The encoding of the file wins
+            TRAJECTORY_WRITER<float> trajectory_writer(trajectory_file, n_body, {}, 5);
+            UTST_ASSERT_EQUAL(static_cast<size_t>(5), trajectory_writer.num_frames());
+            for (int i_frame = 5; i_frame < n_frame; i_frame++)
+            {
+                trajectory_writer.write_frame(make_moving_frame(i_frame, n_body));
+            }
+        }
+
+        const MAPPED_FILE expected_file(expected_trajectory_file);
+        const MAPPED_FILE file(trajectory_file);
+        UTST_ASSERT_EQUAL(expected_file.size(), file.size());
+        UTST_ASSERT(std::equal(expected_file.data(), expected_file.data() + expected_file.size(), file.data()));
+    }
+    std::filesystem::remove(expected_trajectory_file);
+    std::filesystem::remove(trajectory_file);
+}
@@ -0,0 +1,662 @@
+#include "trajectory.h"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    template <typename T>
+    unsigned char *write_as_bytes(unsigned char *bytes, T value)
+    {
+        std::memcpy(bytes, &value, sizeof(T));
+        return bytes + sizeof(T);
+    }
+
+    template <typename T>
+    T read_as_bytes(const unsigned char *bytes)
+    {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void write_as_binary(std::ostream &os, T value)
+    {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    /// Small magnitudes of either sign to small unsigned values
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    int64_t quantize(double value, double quantum)
+    {
+        const double quantized = std::round(value / quantum);
+        // Leaves room for the prediction and the delta in int64_t, also rejects NaN
+        ASSERT(std::abs(quantized) < 0x1p60);
+        return static_cast<int64_t>(quantized);
+    }
+
+    /// Appends the bit width w of values[0, n), then every value as w bits, little-endian
+    void pack_block(const uint64_t *values, size_t n, std::vector<unsigned char> &bytes)
+    {
+        uint64_t max_value = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            max_value |= values[i];
+        }
+        const int w = max_value == 0 ? 0 : 64 - __builtin_clzll(max_value);
+        bytes.push_back(static_cast<unsigned char>(w));
+
+        auto append = [&bytes](uint64_t word, int n_byte)
+        {
+            for (int i_byte = 0; i_byte < n_byte; i_byte++)
+            {
+                bytes.push_back(static_cast<unsigned char>(word >> (8 * i_byte)));
+            }
+        };
+        uint64_t word = 0;
+        int n_bit = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            word |= values[i] << n_bit;
+            if (n_bit + w >= 64)
+            {
+                append(word, 8);
+                word = n_bit == 0 ? 0 : values[i] >> (64 - n_bit);
+                n_bit = n_bit + w - 64;
+            }
+            else
+            {
+                n_bit += w;
+            }
+        }
+        append(word, (n_bit + 7) / 8);
+    }
+
+    /// Reverse of pack_block(), returns the end of the block
+    const unsigned char *unpack_block(const unsigned char *first, const unsigned char *last, uint64_t *values, size_t n)
+    {
+        ASSERT(first < last);
+        const int w = *first++;
+        ASSERT(w <= 64);
+        const size_t n_byte = (n * w + 7) / 8;
+        ASSERT(static_cast<size_t>(last - first) >= n_byte);
+
+        const uint64_t mask = w == 64 ? ~uint64_t{0} : (uint64_t{1} << w) - 1;
+        for (size_t i = 0; i < n; i++)
+        {
+            const size_t i_bit = i * w;
+            const size_t i_byte = i_bit / 8;
+            const int shift = i_bit % 8;
+            uint64_t word = 0;
+            std::memcpy(&word, first + i_byte, std::min<size_t>(8, n_byte - i_byte));
+            word >>= shift;
+            if (shift + w > 64)
+            {
+                word |= static_cast<uint64_t>(first[i_byte + 8]) << (64 - shift);
+            }
+            values[i] = word & mask;
+        }
+        return first + n_byte;
+    }
+
+    /// Predicts a quantized value from the previous two, q1 being the last one (see TRAJECTORY)
+    int64_t predict(int prediction_order, int64_t q1, int64_t q2)
+    {
+        return prediction_order == 0 ? 0 : prediction_order == 1 ? q1
+                                                                 : 2 * q1 - q2;
+    }
+
+    /// Number of previous frames the prediction of frame i_frame uses
+    int prediction_order(size_t i_frame, size_t keyframe_interval)
+    {
+        return static_cast<int>(std::min<size_t>(i_frame % keyframe_interval, 2));
+    }
+
+    /// (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) of body i_body
+    template <typename T>
+    void body_state_values(const CORE::SYSTEM_STATE_BASE<T> &system_state, size_t i_body, T *values)
+    {
+        const auto &[p, v, m] = system_state[i_body];
+        values[0] = p.x;
+        values[1] = p.y;
+        values[2] = p.z;
+        values[3] = v.x;
+        values[4] = v.y;
+        values[5] = v.z;
+        values[6] = m;
+    }
+
+    template <typename T>
+    void body_state_values(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, size_t i_body, T *values)
+    {
+        for (size_t i_column = 0; i_column < CORE::SOA_SYSTEM_STATE_BASE<T>::n_column; i_column++)
+        {
+            values[i_column] = system_state.column(i_column)[i_body];
+        }
+    }
+}
+
+namespace CORE
+{
+    template <typename T>
+    TRAJECTORY_WRITER<T>::TRAJECTORY_WRITER(const std::string &trajectory_file_path, size_t n_body, TRAJECTORY::COMPRESSION compression, size_t n_kept_frame)
+        : n_body_(n_body),
+          compression_(compression),
+          next_frame_offset_(TRAJECTORY::header_size)
+    {
+        if (n_kept_frame > 0)
+        {
+            reopen(trajectory_file_path, n_kept_frame);
+        }
+        else
+        {
+            create(trajectory_file_path);
+        }
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::create(const std::string &trajectory_file_path)
+    {
+        ofstream_.open(trajectory_file_path, std::ios::binary);
+        if (!ofstream_.is_open())
+        {
+            std::cout << "Cannot open " << trajectory_file_path << std::endl;
+            ASSERT(false);
+        }
+        allocate_buffers();
+
+        const TRAJECTORY::ENCODING encoding = compression_.is_enabled() ? TRAJECTORY::ENCODING::COMPRESSED : TRAJECTORY::ENCODING::RAW;
+        ofstream_.write(TRAJECTORY::magic, sizeof(TRAJECTORY::magic));
+        write_as_binary(ofstream_, TRAJECTORY::version);
+        write_as_binary(ofstream_, static_cast<uint32_t>(sizeof(T)));
+        write_as_binary(ofstream_, static_cast<uint64_t>(n_body_));
+        write_as_binary(ofstream_, static_cast<uint32_t>(encoding));
+        write_as_binary(ofstream_, uint32_t{0});
+        ofstream_.flush();
+        ASSERT(ofstream_.good());
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::reopen(const std::string &trajectory_file_path, size_t n_kept_frame)
+    {
+        {
+            const TRAJECTORY_READER reader(trajectory_file_path);
+            ASSERT(reader.floating_value_size() == sizeof(T));
+            ASSERT(reader.n_body() == n_body_);
+            if (reader.num_frames() < n_kept_frame)
+            {
+                std::cout << trajectory_file_path << " has " << reader.num_frames() << " frames, "
+                          << n_kept_frame << " expected" << std::endl;
+                ASSERT(false);
+            }
+            compression_ = {};
+            if (reader.encoding() == TRAJECTORY::ENCODING::COMPRESSED)
+            {
+                ASSERT(reader.chunk_size() == TRAJECTORY::compressed_chunk_size);
+                compression_ = reader.compression();
+            }
+            allocate_buffers();
+            if (compression_.is_enabled())
+            {
+                // The prediction of the next frame goes on from the last kept ones
+                reader.read_quantized(n_kept_frame - 1, previous_quantized_);
+            }
+            for (size_t i_frame = 0; i_frame < n_kept_frame; i_frame++)
+            {
+                frame_offsets_.push_back(reader.frame_offset(i_frame));
+            }
+            next_frame_offset_ = reader.frame_end_offset(n_kept_frame - 1);
+        }
+        // Drops the frames after the kept ones, and the index
+        std::filesystem::resize_file(trajectory_file_path, next_frame_offset_);
+        ofstream_.open(trajectory_file_path, std::ios::binary | std::ios::app);
+        if (!ofstream_.is_open())
+        {
+            std::cout << "Cannot open " << trajectory_file_path << std::endl;
+            ASSERT(false);
+        }
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::allocate_buffers()
+    {
+        if (compression_.is_enabled())
+        {
+            ASSERT(compression_.keyframe_interval > 0);
+            previous_quantized_[0].resize(TRAJECTORY::n_compressed_component * n_body_);
+            previous_quantized_[1].resize(TRAJECTORY::n_compressed_component * n_body_);
+            chunk_buffers_.resize((n_body_ + TRAJECTORY::compressed_chunk_size - 1) / TRAJECTORY::compressed_chunk_size);
+        }
+        else
+        {
+            record_buffer_.resize(TRAJECTORY::frame_record_size(sizeof(T), n_body_));
+        }
+    }
+
+    template <typename T>
+    TRAJECTORY_WRITER<T>::~TRAJECTORY_WRITER()
+    {
+        close();
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::write_frame(const SYSTEM_STATE_BASE<T> &system_state)
+    {
+        write_any_frame(system_state);
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::write_frame(const SOA_SYSTEM_STATE_BASE<T> &system_state)
+    {
+        write_any_frame(system_state);
+    }
+
+    template <typename T>
+    template <typename S>
+    void TRAJECTORY_WRITER<T>::write_any_frame(const S &system_state)
+    {
+        ASSERT(ofstream_.is_open());
+        ASSERT(system_state.size() == n_body_);
+
+        if (compression_.is_enabled())
+        {
+            write_compressed_frame(system_state);
+        }
+        else
+        {
+            write_raw_frame(system_state);
+        }
+        // Readable even if the run crashes right after
+        ofstream_.flush();
+        ASSERT(ofstream_.good());
+    }
+
+    template <typename T>
+    template <typename S>
+    void TRAJECTORY_WRITER<T>::write_raw_frame(const S &system_state)
+    {
+        unsigned char *bytes = write_as_bytes(record_buffer_.data(), static_cast<uint64_t>(frame_offsets_.size()));
+        for (size_t i_body = 0; i_body < n_body_; i_body++)
+        {
+            T values[SOA_SYSTEM_STATE_BASE<T>::n_column];
+            body_state_values(system_state, i_body, values);
+            for (T value : values)
+            {
+                bytes = write_as_bytes(bytes, value);
+            }
+        }
+        ofstream_.write(reinterpret_cast<const char *>(record_buffer_.data()), record_buffer_.size());
+
+        frame_offsets_.push_back(next_frame_offset_);
+        next_frame_offset_ += record_buffer_.size();
+    }
+
+    template <typename T>
+    template <typename S>
+    void TRAJECTORY_WRITER<T>::write_compressed_frame(const S &system_state)
+    {
+        const uint64_t frame_id = frame_offsets_.size();
+        if (frame_id == 0)
+        {
+            // Quantum of twice the error bound, as rounding is off by half a quantum at most
+            write_as_binary(ofstream_, 2 * compression_.pos_error_bound);
+            write_as_binary(ofstream_, 2 * compression_.vel_error_bound);
+            write_as_binary(ofstream_, compression_.keyframe_interval);
+            write_as_binary(ofstream_, static_cast<uint32_t>(TRAJECTORY::compressed_chunk_size));
+            for (size_t i_body = 0; i_body < n_body_; i_body++)
+            {
+                T values[SOA_SYSTEM_STATE_BASE<T>::n_column];
+                body_state_values(system_state, i_body, values);
+                write_as_binary(ofstream_, values[6]);
+            }
+            next_frame_offset_ += 2 * sizeof(double) + 2 * sizeof(uint32_t) + n_body_ * sizeof(T);
+        }
+
+        const int order = prediction_order(frame_id, compression_.keyframe_interval);
+        const size_t n_chunk = chunk_buffers_.size();
+        parallel_chunks(n_chunk, default_n_thread(n_chunk, 1),
+                        [&](size_t, size_t begin, size_t end)
+                        {
+                            for (size_t i_chunk = begin; i_chunk < end; i_chunk++)
+                            {
+                                encode_chunk(system_state, i_chunk, order);
+                            }
+                        });
+
+        uint64_t record_size = sizeof(uint32_t) * (1 + n_chunk);
+        for (const auto &chunk_buffer : chunk_buffers_)
+        {
+            record_size += chunk_buffer.size();
+        }
+        write_as_binary(ofstream_, frame_id);
+        write_as_binary(ofstream_, record_size);
+        write_as_binary(ofstream_, static_cast<uint32_t>(n_chunk));
+        for (const auto &chunk_buffer : chunk_buffers_)
+        {
+            write_as_binary(ofstream_, static_cast<uint32_t>(chunk_buffer.size()));
+        }
+        for (const auto &chunk_buffer : chunk_buffers_)
+        {
+            ofstream_.write(reinterpret_cast<const char *>(chunk_buffer.data()), chunk_buffer.size());
+        }
+
+        frame_offsets_.push_back(next_frame_offset_);
+        next_frame_offset_ += 2 * sizeof(uint64_t) + record_size;
+    }
+
+    template <typename T>
+    template <typename S>
+    void TRAJECTORY_WRITER<T>::encode_chunk(const S &system_state, size_t i_chunk, int prediction_order)
+    {
+        constexpr size_t n_component = TRAJECTORY::n_compressed_component;
+        constexpr size_t block_size = TRAJECTORY::compressed_block_size;
+        const size_t chunk_begin = i_chunk * TRAJECTORY::compressed_chunk_size;
+        const size_t chunk_end = std::min(chunk_begin + TRAJECTORY::compressed_chunk_size, n_body_);
+        std::vector<unsigned char> &bytes = chunk_buffers_[i_chunk];
+        bytes.clear();
+
+        uint64_t deltas[n_component][block_size];
+        for (size_t block_begin = chunk_begin; block_begin < chunk_end; block_begin += block_size)
+        {
+            const size_t n = std::min(block_size, chunk_end - block_begin);
+            for (size_t i = 0; i < n; i++)
+            {
+                const size_t i_body = block_begin + i;
+                T values[SOA_SYSTEM_STATE_BASE<T>::n_column];
+                body_state_values(system_state, i_body, values);
+                for (size_t i_component = 0; i_component < n_component; i_component++)
+                {
+                    const double quantum = 2 * (i_component < 3 ? compression_.pos_error_bound : compression_.vel_error_bound);
+                    const int64_t quantized = quantize(values[i_component], quantum);
+                    int64_t &q1 = previous_quantized_[0][i_component * n_body_ + i_body];
+                    int64_t &q2 = previous_quantized_[1][i_component * n_body_ + i_body];
+                    deltas[i_component][i] = zigzag(quantized - predict(prediction_order, q1, q2));
+                    q2 = q1;
+                    q1 = quantized;
+                }
+            }
+            for (size_t i_component = 0; i_component < n_component; i_component++)
+            {
+                pack_block(deltas[i_component], n, bytes);
+            }
+        }
+    }
+
+    template <typename T>
+    void TRAJECTORY_WRITER<T>::close()
+    {
+        if (!ofstream_.is_open())
+        {
+            return;
+        }
+        for (uint64_t frame_offset : frame_offsets_)
+        {
+            write_as_binary(ofstream_, frame_offset);
+        }
+        write_as_binary(ofstream_, static_cast<uint64_t>(frame_offsets_.size()));
+        write_as_binary(ofstream_, next_frame_offset_);
+        ofstream_.write(TRAJECTORY::index_magic, sizeof(TRAJECTORY::index_magic));
+        ofstream_.close();
+    }
+
+    TRAJECTORY_READER::TRAJECTORY_READER(const std::string &trajectory_file_path) : file_(trajectory_file_path)
+    {
+        const unsigned char *data = file_.data();
+        const size_t size = file_.size();
+        ASSERT(size >= TRAJECTORY::header_size);
+        ASSERT(std::memcmp(data, TRAJECTORY::magic, sizeof(TRAJECTORY::magic)) == 0);
+        ASSERT(read_as_bytes<uint32_t>(data + 8) == TRAJECTORY::version);
+        floating_value_size_ = static_cast<int>(read_as_bytes<uint32_t>(data + 12));
+        ASSERT(floating_value_size_ == sizeof(float) || floating_value_size_ == sizeof(double));
+        n_body_ = static_cast<size_t>(read_as_bytes<uint64_t>(data + 16));
+        encoding_ = static_cast<TRAJECTORY::ENCODING>(read_as_bytes<uint32_t>(data + 24));
+        ASSERT(encoding_ == TRAJECTORY::ENCODING::RAW || encoding_ == TRAJECTORY::ENCODING::COMPRESSED);
+        const size_t record_size = TRAJECTORY::frame_record_size(floating_value_size_, n_body_);
+
+        // Complete file: the footer points at an index right after the last frame record
+        if (size >= TRAJECTORY::header_size + TRAJECTORY::footer_size &&
+            std::memcmp(data + size - sizeof(TRAJECTORY::index_magic), TRAJECTORY::index_magic, sizeof(TRAJECTORY::index_magic)) == 0)
+        {
+            const unsigned char *footer = data + size - TRAJECTORY::footer_size;
+            const uint64_t n_frame = read_as_bytes<uint64_t>(footer);
+            const uint64_t index_offset = read_as_bytes<uint64_t>(footer + 8);
+            const bool is_record_size_valid = encoding_ == TRAJECTORY::ENCODING::COMPRESSED ||
+                                              index_offset == TRAJECTORY::header_size + n_frame * record_size;
+            if (is_record_size_valid && index_offset <= size &&
+                index_offset + n_frame * sizeof(uint64_t) + TRAJECTORY::footer_size == size)
+            {
+                frame_offsets_.resize(n_frame);
+                std::memcpy(frame_offsets_.data(), data + index_offset, n_frame * sizeof(uint64_t));
+                has_index_ = true;
+            }
+        }
+
+        if (encoding_ == TRAJECTORY::ENCODING::COMPRESSED)
+        {
+            read_compression(trajectory_file_path);
+        }
+        else if (!has_index_)
+        {
+            // Partial file: every complete frame record is kept
+            const size_t n_frame = (size - TRAJECTORY::header_size) / record_size;
+            for (size_t i_frame = 0; i_frame < n_frame; i_frame++)
+            {
+                frame_offsets_.push_back(TRAJECTORY::header_size + i_frame * record_size);
+            }
+        }
+
+        if (!has_index_)
+        {
+            std::cout << "Warning: " << trajectory_file_path << " has no index, recovered "
+                      << frame_offsets_.size() << " frames" << std::endl;
+        }
+    }
+
+    void TRAJECTORY_READER::read_compression(const std::string &trajectory_file_path)
+    {
+        const unsigned char *data = file_.data();
+        const size_t size = file_.size();
+        const size_t first_record_offset = TRAJECTORY::header_size + 2 * sizeof(double) + 2 * sizeof(uint32_t) + n_body_ * floating_value_size_;
+        if (size < first_record_offset)
+        {
+            // Not even one frame
+            ASSERT(!has_index_ || frame_offsets_.empty());
+            frame_offsets_.clear();
+            return;
+        }
+
+        const unsigned char *compression = data + TRAJECTORY::header_size;
+        quanta_[0] = read_as_bytes<double>(compression);
+        quanta_[1] = read_as_bytes<double>(compression + 8);
+        keyframe_interval_ = read_as_bytes<uint32_t>(compression + 16);
+        chunk_size_ = read_as_bytes<uint32_t>(compression + 20);
+        ASSERT(quanta_[0] > 0 && quanta_[1] > 0 && keyframe_interval_ > 0);
+        ASSERT(chunk_size_ > 0 && chunk_size_ % TRAJECTORY::compressed_block_size == 0);
+        const unsigned char *mass_bytes = compression + 24;
+        masses_.resize(n_body_);
+        for (size_t i_body = 0; i_body < n_body_; i_body++)
+        {
+            masses_[i_body] = floating_value_size_ == sizeof(double)
+                                  ? read_as_bytes<double>(mass_bytes + i_body * sizeof(double))
+                                  : read_as_bytes<float>(mass_bytes + i_body * sizeof(float));
+        }
+        decoded_quantized_[0].resize(TRAJECTORY::n_compressed_component * n_body_);
+        decoded_quantized_[1].resize(TRAJECTORY::n_compressed_component * n_body_);
+
+        if (!has_index_)
+        {
+            // Partial file: walk the frame records, up to the last complete one
+            size_t offset = first_record_offset;
+            while (offset + 2 * sizeof(uint64_t) <= size)
+            {
+                const uint64_t frame_id = read_as_bytes<uint64_t>(data + offset);
+                const uint64_t record_size = read_as_bytes<uint64_t>(data + offset + sizeof(uint64_t));
+                if (frame_id != frame_offsets_.size() || record_size > size - offset - 2 * sizeof(uint64_t))
+                {
+                    break;
+                }
+                frame_offsets_.push_back(offset);
+                offset += 2 * sizeof(uint64_t) + record_size;
+            }
+        }
+    }
+
+    const unsigned char *TRAJECTORY_READER::frame_record(size_t i_frame) const
+    {
+        ASSERT(i_frame < frame_offsets_.size());
+        const unsigned char *record = file_.data() + frame_offsets_[i_frame];
+        ASSERT(read_as_bytes<uint64_t>(record) == i_frame);
+        return record;
+    }
+
+    void TRAJECTORY_READER::decode_frame(size_t i_frame) const
+    {
+        constexpr size_t n_component = TRAJECTORY::n_compressed_component;
+        constexpr size_t block_size = TRAJECTORY::compressed_block_size;
+
+        const size_t keyframe = i_frame - i_frame % keyframe_interval_;
+        size_t next_frame = keyframe;
+        if (decoded_frame_ >= static_cast<long>(keyframe) && decoded_frame_ <= static_cast<long>(i_frame))
+        {
+            next_frame = decoded_frame_ + 1;
+        }
+
+        for (; next_frame <= i_frame; next_frame++)
+        {
+            const unsigned char *record = frame_record(next_frame);
+            const uint64_t record_size = read_as_bytes<uint64_t>(record + sizeof(uint64_t));
+            const unsigned char *payload = record + 2 * sizeof(uint64_t);
+            const unsigned char *payload_last = payload + record_size;
+            const size_t n_chunk = read_as_bytes<uint32_t>(payload);
+            ASSERT(n_chunk == (n_body_ + chunk_size_ - 1) / chunk_size_);
+
+            std::vector<const unsigned char *> chunk_firsts(n_chunk + 1);
+            chunk_firsts[0] = payload + sizeof(uint32_t) * (1 + n_chunk);
+            for (size_t i_chunk = 0; i_chunk < n_chunk; i_chunk++)
+            {
+                chunk_firsts[i_chunk + 1] = chunk_firsts[i_chunk] + read_as_bytes<uint32_t>(payload + sizeof(uint32_t) * (1 + i_chunk));
+            }
+            ASSERT(chunk_firsts[n_chunk] <= payload_last);
+
+            const int order = prediction_order(next_frame, keyframe_interval_);
+            parallel_chunks(n_chunk, default_n_thread(n_chunk, 1),
+                            [&](size_t, size_t begin, size_t end)
+                            {
+                                uint64_t deltas[block_size];
+                                for (size_t i_chunk = begin; i_chunk < end; i_chunk++)
+                                {
+                                    const unsigned char *bytes = chunk_firsts[i_chunk];
+                                    const size_t chunk_begin = i_chunk * chunk_size_;
+                                    const size_t chunk_end = std::min(chunk_begin + chunk_size_, n_body_);
+                                    for (size_t block_begin = chunk_begin; block_begin < chunk_end; block_begin += block_size)
+                                    {
+                                        const size_t n = std::min(block_size, chunk_end - block_begin);
+                                        for (size_t i_component = 0; i_component < n_component; i_component++)
+                                        {
+                                            bytes = unpack_block(bytes, chunk_firsts[i_chunk + 1], deltas, n);
+                                            int64_t *q1 = decoded_quantized_[0].data() + i_component * n_body_ + block_begin;
+                                            int64_t *q2 = decoded_quantized_[1].data() + i_component * n_body_ + block_begin;
+                                            for (size_t i = 0; i < n; i++)
+                                            {
+                                                const int64_t quantized = predict(order, q1[i], q2[i]) + unzigzag(deltas[i]);
+                                                q2[i] = q1[i];
+                                                q1[i] = quantized;
+                                            }
+                                        }
+                                    }
+                                }
+                            });
+            decoded_frame_ = next_frame;
+        }
+    }
+
+    uint64_t TRAJECTORY_READER::frame_end_offset(size_t i_frame) const
+    {
+        if (encoding_ == TRAJECTORY::ENCODING::COMPRESSED)
+        {
+            const unsigned char *record = frame_record(i_frame);
+            return frame_offsets_[i_frame] + 2 * sizeof(uint64_t) + read_as_bytes<uint64_t>(record + sizeof(uint64_t));
+        }
+        ASSERT(i_frame < frame_offsets_.size());
+        return frame_offsets_[i_frame] + TRAJECTORY::frame_record_size(floating_value_size_, n_body_);
+    }
+
+    TRAJECTORY::COMPRESSION TRAJECTORY_READER::compression() const
+    {
+        ASSERT(encoding_ == TRAJECTORY::ENCODING::COMPRESSED);
+        // Quantum of twice the error bound, see TRAJECTORY_WRITER
+        return {quanta_[0] / 2, quanta_[1] / 2, keyframe_interval_};
+    }
+
+    void TRAJECTORY_READER::read_quantized(size_t i_frame, std::vector<int64_t> (&quantized)[2]) const
+    {
+        ASSERT(encoding_ == TRAJECTORY::ENCODING::COMPRESSED);
+        decode_frame(i_frame);
+        quantized[0] = decoded_quantized_[0];
+        quantized[1] = decoded_quantized_[1];
+    }
+
+    template <typename T>
+    SYSTEM_STATE_BASE<T> TRAJECTORY_READER::read_frame(size_t i_frame) const
+    {
+        SYSTEM_STATE_BASE<T> system_state;
+        system_state.reserve(n_body_);
+
+        if (encoding_ == TRAJECTORY::ENCODING::COMPRESSED)
+        {
+            decode_frame(i_frame);
+            auto value = [this](size_t i_component, size_t i_body)
+            {
+                return static_cast<T>(decoded_quantized_[0][i_component * n_body_ + i_body] * quanta_[i_component / 3]);
+            };
+            for (size_t i_body = 0; i_body < n_body_; i_body++)
+            {
+                system_state.emplace_back(POS_BASE<T>{value(0, i_body), value(1, i_body), value(2, i_body)},
+                                          VEL_BASE<T>{value(3, i_body), value(4, i_body), value(5, i_body)},
+                                          static_cast<T>(masses_[i_body]));
+            }
+            return system_state;
+        }
+
+        auto read = [this, i_frame, &system_state](auto file_floating_value)
+        {
+            using F = decltype(file_floating_value);
+            const BIN_PAYLOAD_VIEW<F> payload = frame_view<F>(i_frame);
+            for (size_t i_body = 0; i_body < payload.size(); i_body++)
+            {
+                const F *record = payload.record(i_body);
+                system_state.emplace_back(POS_BASE<T>{static_cast<T>(record[0]), static_cast<T>(record[1]), static_cast<T>(record[2])},
+                                          VEL_BASE<T>{static_cast<T>(record[3]), static_cast<T>(record[4]), static_cast<T>(record[5])},
+                                          static_cast<T>(record[6]));
+            }
+        };
+        if (floating_value_size_ == sizeof(double))
+        {
+            read(double{});
+        }
+        else
+        {
+            read(float{});
+        }
+        return system_state;
+    }
+
+    template class TRAJECTORY_WRITER<float>;
+    template class TRAJECTORY_WRITER<double>;
+    template SYSTEM_STATE_BASE<float> TRAJECTORY_READER::read_frame<float>(size_t) const;
+    template SYSTEM_STATE_BASE<double> TRAJECTORY_READER::read_frame<double>(size_t) const;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "physics.hpp"
+#include "mapped_bin.h"
+
+namespace CORE
+{
+    /// TRAJECTORY (.traj), all the SYSTEM_STATEs of a run in one append-only file, little-endian
+    /// - header, 32 bytes:
+    ///   - 8 bytes: magic "TUSSTRAJ"
+    ///   - 4 bytes: version (1)
+    ///   - 4 bytes: size of floating type (ie., 4 for floating, 8 for double)
+    ///   - 8 bytes: number of bodies
+    ///   - 4 bytes: encoding (0 for RAW, 1 for COMPRESSED)
+    ///   - 4 bytes: reserved (0)
+    /// - RAW frame records, all of the same size:
+    ///   - 8 bytes: frame id, from 0
+    ///   - (POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z, MASS) for each BODY_STATE, as in BIN
+    /// - trailing index, written on close:
+    ///   - 8 bytes: offset of each frame record
+    ///   - 8 bytes: number of frames
+    ///   - 8 bytes: offset of the index
+    ///   - 8 bytes: magic "TRAJINDX"
+    /// A file without a valid index, e.g., from a crashed run, is read up to its last complete frame record.
+    ///
+    /// COMPRESSED (see TRAJECTORY::COMPRESSION) replaces the frame records with:
+    /// - written with the first frame, right after the header:
+    ///   - 8 bytes: position quantum, 8 bytes: velocity quantum (double)
+    ///   - 4 bytes: keyframe interval, 4 bytes: bodies per chunk
+    ///   - MASS of each body, stored once
+    /// - frame records:
+    ///   - 8 bytes: frame id, 8 bytes: size of the rest of the record
+    ///   - 4 bytes: number of chunks, 4 bytes: size of each chunk, then the chunks
+    ///   - chunk: for each block of compressed_block_size bodies, for each of POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z:
+    ///     1 byte bit width w, then the w-bit zigzag deltas of the quantized values q = round(value / quantum),
+    ///     bit-packed little-endian. The deltas are against a prediction from the previous frames since the keyframe:
+    ///     0 on keyframes, q[k - 1] right after them, then 2 q[k - 1] - q[k - 2] (smooth motion leaves tiny deltas).
+    namespace TRAJECTORY
+    {
+        constexpr char magic[8] = {'T', 'U', 'S', 'S', 'T', 'R', 'A', 'J'};
+        constexpr char index_magic[8] = {'T', 'R', 'A', 'J', 'I', 'N', 'D', 'X'};
+        constexpr uint32_t version = 1;
+        constexpr size_t header_size = 32;
+        constexpr size_t footer_size = 24;
+
+        enum class ENCODING : uint32_t
+        {
+            RAW = 0,
+            COMPRESSED
+        };
+
+        /// Lossy compression of the positions and velocities, with an absolute error bound for each
+        /// (besides the rounding of the decoded values to the floating type)
+        struct COMPRESSION
+        {
+            double pos_error_bound = 0;
+            double vel_error_bound = 0;
+            /// Frames encoded without delta, where decoding can start from
+            uint32_t keyframe_interval = 64;
+
+            /// Off unless both bounds are set
+            bool is_enabled() const { return pos_error_bound > 0 && vel_error_bound > 0; }
+        };
+
+        /// Bodies per chunk, the unit of multithreading
+        constexpr size_t compressed_chunk_size = 4096;
+        /// Bodies sharing a bit width, small enough to limit the cost of a single large delta
+        constexpr size_t compressed_block_size = 32;
+        /// POS.x,POS.y,POS.z,VEL.x,VEL.y,VEL.z
+        constexpr size_t n_compressed_component = 6;
+
+        inline size_t frame_record_size(int floating_value_size, uint64_t n_body)
+        {
+            return sizeof(uint64_t) + n_body * BIN_PAYLOAD_VIEW<float>::n_value_per_body * floating_value_size;
+        }
+    }
+
+    /// Appends frames to a TRAJECTORY file. Every frame is handed to the OS once written,
+    /// so that a crashed run leaves all of them readable.
+    /// With compression, the masses are taken from the first frame.
+    /// With n_kept_frame > 0, the existing file at trajectory_file_path is continued instead, e.g., on resume:
+    /// its first n_kept_frame frames are kept, anything after them is cut,
+    /// and the next frames go on with the encoding of the file, whatever compression is given.
+    template <typename T>
+    class TRAJECTORY_WRITER
+    {
+    public:
+        TRAJECTORY_WRITER(const std::string &trajectory_file_path, size_t n_body, TRAJECTORY::COMPRESSION compression = {}, size_t n_kept_frame = 0);
+        /// close()
+        ~TRAJECTORY_WRITER();
+
+        TRAJECTORY_WRITER(const TRAJECTORY_WRITER &) = delete;
+        TRAJECTORY_WRITER &operator=(const TRAJECTORY_WRITER &) = delete;
+
+        /// system_state must have n_body bodies
+        void write_frame(const SYSTEM_STATE_BASE<T> &system_state);
+        void write_frame(const SOA_SYSTEM_STATE_BASE<T> &system_state);
+        /// Writes the index, no more frames afterwards
+        void close();
+
+        size_t num_frames() const { return frame_offsets_.size(); }
+        /// Bytes written so far
+        uint64_t size() const { return next_frame_offset_; }
+
+    private:
+        void create(const std::string &trajectory_file_path);
+        void reopen(const std::string &trajectory_file_path, size_t n_kept_frame);
+        void allocate_buffers();
+        /// S: SYSTEM_STATE_BASE<T> or SOA_SYSTEM_STATE_BASE<T>
+        template <typename S>
+        void write_any_frame(const S &system_state);
+        template <typename S>
+        void write_raw_frame(const S &system_state);
+        template <typename S>
+        void write_compressed_frame(const S &system_state);
+        template <typename S>
+        void encode_chunk(const S &system_state, size_t i_chunk, int prediction_order);
+
+    private:
+        std::ofstream ofstream_;
+        size_t n_body_;
+        TRAJECTORY::COMPRESSION compression_;
+        std::vector<uint64_t> frame_offsets_;
+        uint64_t next_frame_offset_;
+        /// One RAW frame record, reused
+        std::vector<unsigned char> record_buffer_;
+        /// Quantized values of the last two frames, n_body per component
+        std::vector<int64_t> previous_quantized_[2];
+        /// Encoded chunks of a COMPRESSED frame, reused
+        std::vector<std::vector<unsigned char>> chunk_buffers_;
+    };
+
+    /// Maps a TRAJECTORY file, and seeks to any of its frames in O(1).
+    /// COMPRESSED frames are decoded from the previous keyframe, or from the frame read last if closer.
+    /// Not thread-safe.
+    class TRAJECTORY_READER
+    {
+    public:
+        explicit TRAJECTORY_READER(const std::string &trajectory_file_path);
+
+        /// 4 for float, 8 for double
+        int floating_value_size() const { return floating_value_size_; }
+        size_t n_body() const { return n_body_; }
+        size_t num_frames() const { return frame_offsets_.size(); }
+        /// False for a partial file, read without its index
+        bool has_index() const { return has_index_; }
+        TRAJECTORY::ENCODING encoding() const { return encoding_; }
+
+        /// Payload of frame i_frame, straight on the mapped pages. RAW only, F must match floating_value_size().
+        template <typename F>
+        BIN_PAYLOAD_VIEW<F> frame_view(size_t i_frame) const;
+
+        template <typename T = UNIVERSE::floating_value_type>
+        SYSTEM_STATE_BASE<T> read_frame(size_t i_frame) const;
+
+        /// Offset of the record of frame i_frame
+        uint64_t frame_offset(size_t i_frame) const { return frame_offsets_.at(i_frame); }
+        /// Offset of the first byte after frame i_frame
+        uint64_t frame_end_offset(size_t i_frame) const;
+        /// COMPRESSED only, as the file was written with
+        TRAJECTORY::COMPRESSION compression() const;
+        /// COMPRESSED only, bodies per chunk
+        uint32_t chunk_size() const { return chunk_size_; }
+        /// COMPRESSED only, the quantized values of frame i_frame in quantized[0] and of the one before in quantized[1],
+        /// n_body per component, which the next frame is predicted from
+        void read_quantized(size_t i_frame, std::vector<int64_t> (&quantized)[2]) const;
+
+    private:
+        const unsigned char *frame_record(size_t i_frame) const;
+        void read_compression(const std::string &trajectory_file_path);
+        /// Brings decoded_quantized_[0] to frame i_frame
+        void decode_frame(size_t i_frame) const;
+
+    private:
+        MAPPED_FILE file_;
+        int floating_value_size_;
+        size_t n_body_;
+        TRAJECTORY::ENCODING encoding_;
+        bool has_index_ = false;
+        std::vector<uint64_t> frame_offsets_;
+
+        /// COMPRESSED only
+        double quanta_[2] = {0, 0};
+        uint32_t keyframe_interval_ = 0;
+        uint32_t chunk_size_ = 0;
+        std::vector<double> masses_;
+        /// Of the last two frames decoded
+        mutable std::vector<int64_t> decoded_quantized_[2];
+        mutable long decoded_frame_ = -1;
+    };
+
+    extern template class TRAJECTORY_WRITER<float>;
+    extern template class TRAJECTORY_WRITER<double>;
+
+    /// Implementation
+
+    template <typename F>
+    BIN_PAYLOAD_VIEW<F> TRAJECTORY_READER::frame_view(size_t i_frame) const
+    {
+        ASSERT(encoding_ == TRAJECTORY::ENCODING::RAW);
+        ASSERT(sizeof(F) == static_cast<size_t>(floating_value_size_));
+        // Records start at 8-byte boundaries for double, and 4-byte boundaries for float
+        return {reinterpret_cast<const F *>(frame_record(i_frame) + sizeof(uint64_t)), n_body_};
+    }
+}
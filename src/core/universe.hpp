@@ -5,6 +5,12 @@ namespace CORE::UNIVERSE
     // Universe types, defs, and constants
     using floating_value_type = float;
 
-    constexpr floating_value_type epislon = 0.001f;
+    /// Per-precision constants, for code templated on the floating type
+    template <typename T>
+    constexpr T epislon_v = static_cast<T>(0.001);
+    template <typename T>
+    constexpr T epislon_square_v = epislon_v<T> * epislon_v<T>;
+
+    constexpr floating_value_type epislon = epislon_v<floating_value_type>;
     constexpr floating_value_type epislon_square = epislon * epislon;
 }
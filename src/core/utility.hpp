@@ -2,6 +2,9 @@
 
 #include <utility>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 namespace CORE
 {
@@ -43,4 +46,42 @@ namespace CORE
         typename T::size_type const p(filename.find_last_of('.'));
         return p > 0 && p != T::npos ? filename.substr(0, p) : filename;
     }
-}
\ No newline at end of file
+
+    /// Number of threads for count independent items,
+    /// such that every thread gets at least min_count_per_thread of them
+    inline size_t default_n_thread(size_t count, size_t min_count_per_thread)
+    {
+        const size_t n_hardware_thread = std::max(std::thread::hardware_concurrency(), 1u);
+        return std::clamp<size_t>(count / min_count_per_thread, 1, n_hardware_thread);
+    }
+
+    /// Splits [0, count) into n_chunk contiguous chunks, and runs f(i_chunk, begin, end) for each of them,
+    /// one std::thread per chunk but the first, which runs on the calling thread
+    template <typename Function>
+    void parallel_chunks(size_t count, size_t n_chunk, Function &&f)
+    {
+        if (n_chunk <= 1)
+        {
+            f(size_t{0}, size_t{0}, count);
+            return;
+        }
+        const size_t count_per_chunk = (count + n_chunk - 1) / n_chunk;
+        auto chunk_range = [count, count_per_chunk](size_t i_chunk)
+        {
+            const size_t begin = std::min(i_chunk * count_per_chunk, count);
+            return std::pair<size_t, size_t>(begin, std::min(begin + count_per_chunk, count));
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(n_chunk - 1);
+        for (size_t i_chunk = 1; i_chunk < n_chunk; i_chunk++)
+        {
+            threads.emplace_back([&f, i_chunk, range = chunk_range(i_chunk)]()
+                                 { f(i_chunk, range.first, range.second); });
+        }
+        f(size_t{0}, chunk_range(0).first, chunk_range(0).second);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#include "barnes_hut_engine.h"
+#include "core/timer.h"
+
+#include <iostream>
+
+namespace CPUSIM
+{
+    template <typename T>
+    BARNES_HUT_ENGINE_BASE<T>::BARNES_HUT_ENGINE_BASE(system_state_type system_state_ic,
+                                                      T dt,
+                                                      size_t n_thread,
+                                                      bool use_thread_pool,
+                                                      T theta,
+                                                      size_t leaf_capacity,
+                                                      std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt)),
+          theta_(theta),
+          octree_(leaf_capacity)
+    {
+        std::cout << "Using theta " << theta_ << " with leaf capacity " << leaf_capacity << std::endl;
+    }
+
+    template <typename T>
+    CORE::ACC_BASE<T> BARNES_HUT_ENGINE_BASE<T>::walk(const CORE::POS_BASE<T> &p_target,
+                                                      const std::vector<CORE::POS_BASE<T>> &pos,
+                                                      const std::vector<T> &mass) const
+    {
+        const auto &nodes = octree_.nodes();
+        const auto &body_indices = octree_.body_indices();
+        const auto theta_square = theta_ * theta_;
+
+        CORE::ACC_BASE<T> acc{0, 0, 0};
+        // Depth-first, at most 7 pending siblings per level
+        int32_t stack[8 * OCTREE_BASE<T>::max_depth + 1];
+        int stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0)
+        {
+            const OCTREE_NODE_BASE<T> &node = nodes[stack[--stack_size]];
+            if (node.mass == 0)
+            {
+                continue;
+            }
+
+            const CORE::XYZ_BASE<T> r = p_target - node.com;
+            const auto r_square = r.norm_square();
+            const auto width = 2 * node.half_width;
+            if (width * width < theta_square * r_square && !node.contains(p_target))
+            {
+                // Monopole + quadrupole:
+                // a = -M r / |r|^3 + Q r / |r|^5 - 5/2 (r Q r) r / |r|^7
+                const auto denom_base = r_square + CORE::UNIVERSE::epislon_square_v<T>;
+                const auto inv_r = 1 / std::sqrt(denom_base);
+                const auto inv_r2 = inv_r * inv_r;
+                const auto inv_r3 = inv_r2 * inv_r;
+                const auto inv_r5 = inv_r3 * inv_r2;
+                const CORE::XYZ_BASE<T> q_r = node.quadrupole.multiply(r);
+                const auto r_q_r = q_r.x * r.x + q_r.y * r.y + q_r.z * r.z;
+                acc += (-node.mass * inv_r3 - static_cast<T>(2.5) * r_q_r * inv_r5 * inv_r2) * r + inv_r5 * q_r;
+            }
+            else if (node.is_leaf())
+            {
+                for (uint32_t k = node.body_begin; k < node.body_end; k++)
+                {
+                    const uint32_t j_source_body = body_indices[k];
+                    acc += CORE::ACC_BASE<T>::from_gravity(pos[j_source_body], mass[j_source_body], p_target);
+                }
+            }
+            else
+            {
+                for (int32_t child_id = node.first_child; child_id < node.first_child + node.n_child; child_id++)
+                {
+                    stack[stack_size++] = child_id;
+                }
+            }
+        }
+        return acc;
+    }
+
+    template <typename T>
+    void BARNES_HUT_ENGINE_BASE<T>::compute_tree_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                                              const std::vector<CORE::POS_BASE<T>> &pos,
+                                                              const std::vector<T> &mass)
+    {
+        octree_.build(pos, mass);
+
+        // Walk in tree order, so that neighbouring targets share most of their walks in cache
+        const auto &body_indices = octree_.body_indices();
+        parallel_for_helper(0, body_indices.size(),
+                            [&acc, &pos, &mass, &body_indices, this](size_t k)
+                            {
+                                const uint32_t i_target_body = body_indices[k];
+                                acc[i_target_body] = walk(pos[i_target_body], pos, mass);
+                            });
+    }
+
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> BARNES_HUT_ENGINE_BASE<T>::compute_acceleration(const system_state_type &system_state)
+    {
+        const size_t n_body = system_state.size();
+        std::vector<CORE::POS_BASE<T>> pos(n_body);
+        std::vector<T> mass(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            pos[i_body] = system_state.pos(i_body);
+            mass[i_body] = system_state.mass()[i_body];
+        }
+        std::vector<CORE::ACC_BASE<T>> acc(n_body);
+        compute_tree_acceleration(acc, pos, mass);
+        return acc;
+    }
+
+    template <typename T>
+    std::optional<typename BARNES_HUT_ENGINE_BASE<T>::system_state_type> BARNES_HUT_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        return execute_integrator(n_iter, timer,
+                                  [this](std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+                                  { compute_tree_acceleration(acc, pos, mass); });
+    }
+
+    template class BARNES_HUT_ENGINE_BASE<float>;
+    template class BARNES_HUT_ENGINE_BASE<double>;
+}
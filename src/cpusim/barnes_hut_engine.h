@@ -0,0 +1,58 @@
+#pragma once
+
+#include "basic_engine.h"
+#include "octree.h"
+#include "reference.h"
+
+namespace CPUSIM
+{
+    /// O(N log N) Barnes-Hut tree code.
+    /// An octree is rebuilt every step, with monopole and quadrupole moments on every node.
+    /// A node of width w at distance d is accepted as a whole when w < theta * d,
+    /// so theta = 0 degenerates to direct summation.
+    /// The tree walks (one per target body) run in parallel.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class BARNES_HUT_ENGINE_BASE final : public BASIC_ENGINE_BASE<T>, public APPROXIMATE_FORCE_ENGINE_BASE<T>
+    {
+    public:
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~BARNES_HUT_ENGINE_BASE() = default;
+
+        BARNES_HUT_ENGINE_BASE(system_state_type system_state_ic,
+                               T dt,
+                               size_t n_thread,
+                               bool use_thread_pool,
+                               T theta,
+                               size_t leaf_capacity = 8,
+                               std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("BARNES_HUT_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+
+        virtual std::vector<CORE::ACC_BASE<T>> compute_acceleration(const system_state_type &system_state) override;
+
+    private:
+        void compute_tree_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                       const std::vector<CORE::POS_BASE<T>> &pos,
+                                       const std::vector<T> &mass);
+
+        CORE::ACC_BASE<T> walk(const CORE::POS_BASE<T> &p_target,
+                               const std::vector<CORE::POS_BASE<T>> &pos,
+                               const std::vector<T> &mass) const;
+
+        using BASIC_ENGINE_BASE<T>::execute_integrator;
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        T theta_;
+        OCTREE_BASE<T> octree_;
+    };
+
+    /// Use this type
+    using BARNES_HUT_ENGINE = BARNES_HUT_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class BARNES_HUT_ENGINE_BASE<float>;
+    extern template class BARNES_HUT_ENGINE_BASE<double>;
+}
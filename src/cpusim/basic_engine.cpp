@@ -7,109 +7,47 @@
 
 namespace CPUSIM
 {
-    BASIC_ENGINE::BASIC_ENGINE(CORE::SYSTEM_STATE system_state_ic,
-                               CORE::DT dt,
-                               size_t n_thread,
-                               bool use_thread_pool,
-                               std::optional<std::string> system_state_log_dir_opt)
-        : ENGINE(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
+    template <typename T>
+    BASIC_ENGINE_BASE<T>::BASIC_ENGINE_BASE(system_state_type system_state_ic,
+                                            T dt,
+                                            size_t n_thread,
+                                            bool use_thread_pool,
+                                            std::optional<std::string> system_state_log_dir_opt)
+        : CORE::ENGINE_BASE<T>(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
           n_thread_(n_thread),
           thread_pool_opt_(use_thread_pool ? std::make_optional<THREAD_POOL>(n_thread_) : std::nullopt)
     {
         std::cout << "Using " << n_thread << " threads " << (use_thread_pool ? "WITH" : "without") << " threadpool" << std::endl;
     }
 
-    CORE::SYSTEM_STATE BASIC_ENGINE::execute(int n_iter, CORE::TIMER &timer)
+    template <typename T>
+    void BASIC_ENGINE_BASE<T>::materialize_system_state(system_state_type &system_state)
     {
-        const size_t n_body = system_state_snapshot().size();
-
-        std::vector<CORE::MASS> mass(n_body, 0);
-        BUFFER buf_in(n_body);
-        // Step 1: Prepare ic
-        for (size_t i_body = 0; i_body < n_body; i_body++)
-        {
-            const auto &[body_pos, body_vel, body_mass] = system_state_snapshot()[i_body];
-            buf_in.pos[i_body] = body_pos;
-            buf_in.vel[i_body] = body_vel;
-            mass[i_body] = body_mass;
-        }
-        timer.elapsed_previous("step1");
-
-        // Step 2: Prepare acceleration for ic
-        parallel_for_helper(0, n_body,
-                            [n_body, &buf_in, &mass](size_t i_target_body)
-                            {
-                                buf_in.acc[i_target_body].reset();
-                                for (size_t j_source_body = 0; j_source_body < n_body; j_source_body++)
-                                {
-                                    if (i_target_body != j_source_body)
-                                    {
-                                        buf_in.acc[i_target_body] += CORE::ACC::from_gravity(buf_in.pos[j_source_body], mass[j_source_body], buf_in.pos[i_target_body]);
-                                    }
-                                }
-                            });
-        timer.elapsed_previous("step2");
+        generate_system_state(integrator_buffers_opt_->bodies, integrator_buffers_opt_->mass, system_state);
+    }
 
-        BUFFER buf_out(n_body);
-        std::vector<CORE::VEL> vel_tmp(n_body);
-        // Core iteration loop
-        for (int i_iter = 0; i_iter < n_iter; i_iter++)
+    template <typename T>
+    std::optional<typename BASIC_ENGINE_BASE<T>::system_state_type> BASIC_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        const size_t n_body = system_state_snapshot().size();
+        auto compute_acceleration = [n_body, this](std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
         {
-            if (false)
-            {
-                debug_workspace(buf_in, mass);
-            }
-
             parallel_for_helper(0, n_body,
-                                [&buf_out, &buf_in, &vel_tmp, this](size_t i_target_body)
+                                [n_body, &acc, &pos, &mass](size_t i_target_body)
                                 {
-                                    // Step 3: Compute temp velocity
-                                    vel_tmp[i_target_body] =
-                                        CORE::VEL::updated(buf_in.vel[i_target_body], buf_in.acc[i_target_body], dt());
-
-                                    // Step 4: Update position
-                                    buf_out.pos[i_target_body] =
-                                        CORE::POS::updated(buf_in.pos[i_target_body], buf_in.vel[i_target_body], buf_in.acc[i_target_body], dt());
-                                });
-
-            parallel_for_helper(0, n_body,
-                                [n_body, &buf_out, &vel_tmp, &mass, this](size_t i_target_body)
-                                {
-                                    buf_out.acc[i_target_body].reset();
-                                    // Step 5: Compute acceleration
+                                    acc[i_target_body].reset();
                                     for (size_t j_source_body = 0; j_source_body < n_body; j_source_body++)
                                     {
                                         if (i_target_body != j_source_body)
                                         {
-                                            buf_out.acc[i_target_body] += CORE::ACC::from_gravity(buf_out.pos[j_source_body], mass[j_source_body], buf_out.pos[i_target_body]);
+                                            acc[i_target_body] += CORE::ACC_BASE<T>::from_gravity(pos[j_source_body], mass[j_source_body], pos[i_target_body]);
                                         }
                                     }
-
-                                    // Step 6: Update velocity
-                                    buf_out.vel[i_target_body] = CORE::VEL::updated(vel_tmp[i_target_body], buf_out.acc[i_target_body], dt());
                                 });
-
-            // Write SYSTEM_STATE to log
-            if (i_iter == 0)
-            {
-                push_system_state_to_log([&]()
-                                         { return generate_system_state(buf_in, mass); });
-            }
-            push_system_state_to_log([&]()
-                                     { return generate_system_state(buf_out, mass); });
-            if (i_iter % 10 == 0)
-            {
-                serialize_system_state_log();
-            }
-
-            // Prepare for next iteration
-            std::swap(buf_in, buf_out);
-
-            timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
-        }
-
-        timer.elapsed_previous("all_iters");
-
-        return generate_system_state(buf_in, mass);
+        };
+        return execute_integrator(n_iter, timer, compute_acceleration);
     }
-}
\ No newline at end of file
+
+    template class BASIC_ENGINE_BASE<float>;
+    template class BASIC_ENGINE_BASE<double>;
+}
@@ -3,41 +3,107 @@
 #include "core/engine.h"
 #include <optional>
 #include "threading.h"
+#include "buffer.h"
 
 namespace CPUSIM
 {
-    class BASIC_ENGINE : public CORE::ENGINE
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class BASIC_ENGINE_BASE : public CORE::ENGINE_BASE<T>
     {
     public:
-        virtual ~BASIC_ENGINE() = default;
+        using system_state_type = typename CORE::ENGINE_BASE<T>::system_state_type;
 
-        BASIC_ENGINE(CORE::SYSTEM_STATE system_state_ic,
-                     CORE::DT dt,
-                     size_t n_thread,
-                     bool use_thread_pool,
-                     std::optional<std::string> system_state_log_dir_opt = {});
+        virtual ~BASIC_ENGINE_BASE() = default;
 
-        virtual std::string name() override { return "BASIC_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        BASIC_ENGINE_BASE(system_state_type system_state_ic,
+                          T dt,
+                          size_t n_thread,
+                          bool use_thread_pool,
+                          std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("BASIC_ENGINE") + precision_suffix(); }
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
 
     protected:
+        /// The bodies of the iteration loop, moved in place and kept from one execute() to the next (warm start)
+        struct INTEGRATOR_BUFFERS
+        {
+            /// The bodies reached and their acceleration
+            BUFFER_BASE<T> bodies;
+            std::vector<T> mass;
+
+            explicit INTEGRATOR_BUFFERS(size_t n_body) : bodies(n_body), mass(n_body, 0) {}
+        };
+
+        /// Step 1 and step 2 on the first execute(): bodies and mass from system_state_snapshot(),
+        /// with the acceleration of the checkpoint resumed from, or else of compute_acceleration if integrator().is_kick_first().
+        /// Later execute()s take the buffers over as the previous one left them.
+        /// is_ic_logged tells whether the log has the bodies already, i.e., unless the buffers hold a fresh ic.
+        /// AccelerationFunction signature: see execute_integrator()
+        template <typename AccelerationFunction>
+        INTEGRATOR_BUFFERS &warm_start(CORE::TIMER &timer, AccelerationFunction &&compute_acceleration, bool &is_ic_logged);
+        virtual void materialize_system_state(system_state_type &system_state) override;
+        /// Any CORE::INTEGRATOR, see execute_integrator()
+        virtual bool supports_integrator(const CORE::INTEGRATOR &) const override { return true; }
+
         /// Function signature: void(size_t i)
         ///                     void(size_t i, size_t thread_id)
+        /// grain_size: see parallel_for(), 0 for default
+        template <typename Function>
+        void parallel_for_helper(size_t begin, size_t end, Function &&f, size_t grain_size = 0);
+
+        /// Runs f once on each of the n_thread() threads, all of them at the same time,
+        /// so that f may synchronize them, e.g., with a SENSE_REVERSING_BARRIER.
+        /// Function signature: void(size_t thread_id)
         template <typename Function>
-        void parallel_for_helper(size_t begin, size_t end, Function &&f);
+        void parallel_region_helper(Function &&f);
+
+        /// The iteration loop of BASIC_ENGINE, stepping with integrator(), any CORE::INTEGRATOR,
+        /// with the force evaluations delegated to compute_acceleration.
+        /// AccelerationFunction signature: void(std::vector<CORE::ACC_BASE<T>> &acc,
+        ///                                      const std::vector<CORE::POS_BASE<T>> &pos,
+        ///                                      const std::vector<T> &mass)
+        ///     Overwrites every acc[i] with the acceleration of body i caused by all the bodies.
+        /// The bodies are moved in place in the INTEGRATOR_BUFFERS, whose acceleration is only current
+        /// at the end of an iteration if integrator().is_kick_first(), as the checkpoints have it.
+        /// Continues from the INTEGRATOR_BUFFERS of the previous execute(), and keeps them for the next one.
+        template <typename AccelerationFunction>
+        std::optional<system_state_type> execute_integrator(int n_iter, CORE::TIMER &timer, AccelerationFunction &&compute_acceleration);
 
         size_t n_thread() const { return n_thread_; }
         std::optional<THREAD_POOL> &thread_pool_opt() { return thread_pool_opt_; }
 
+        /// "" for float, "_DOUBLE" for double, to tell the precision apart in name()
+        static std::string precision_suffix() { return std::is_same_v<T, float> ? "" : "_DOUBLE"; }
+
+        using CORE::ENGINE_BASE<T>::system_state_snapshot;
+        using CORE::ENGINE_BASE<T>::dt;
+        using CORE::ENGINE_BASE<T>::is_system_state_logging_enabled;
+        using CORE::ENGINE_BASE<T>::push_system_state_to_log;
+        using CORE::ENGINE_BASE<T>::serialize_system_state_log;
+        using CORE::ENGINE_BASE<T>::resumed_acceleration;
+        using CORE::ENGINE_BASE<T>::checkpoint_if_due;
+        using CORE::ENGINE_BASE<T>::integrator;
+        using CORE::ENGINE_BASE<T>::count_force_evaluations;
+
     private:
         size_t n_thread_;
         std::optional<THREAD_POOL> thread_pool_opt_ = std::nullopt;
+        std::optional<INTEGRATOR_BUFFERS> integrator_buffers_opt_;
     };
 
+    /// Use this type
+    using BASIC_ENGINE = BASIC_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class BASIC_ENGINE_BASE<float>;
+    extern template class BASIC_ENGINE_BASE<double>;
+
     /// Implementation
 
+    template <typename T>
     template <typename Function>
-    void BASIC_ENGINE::parallel_for_helper(size_t begin, size_t end, Function &&f)
+    void BASIC_ENGINE_BASE<T>::parallel_for_helper(size_t begin, size_t end, Function &&f, size_t grain_size)
     {
         if (n_thread_ == 1)
         {
@@ -57,12 +123,136 @@ namespace CPUSIM
         {
             if (thread_pool_opt_)
             {
-                parallel_for(*thread_pool_opt_, begin, end, std::forward<Function>(f));
+                parallel_for(*thread_pool_opt_, begin, end, std::forward<Function>(f), grain_size);
             }
             else
             {
-                parallel_for(n_thread_, begin, end, std::forward<Function>(f));
+                parallel_for(n_thread_, begin, end, std::forward<Function>(f), grain_size);
             }
         }
     }
-}
\ No newline at end of file
+
+    template <typename T>
+    template <typename Function>
+    void BASIC_ENGINE_BASE<T>::parallel_region_helper(Function &&f)
+    {
+        if (n_thread_ == 1)
+        {
+            f(0);
+        }
+        else if (thread_pool_opt_)
+        {
+            thread_pool_opt_->run(std::forward<Function>(f));
+        }
+        else
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(n_thread_);
+            for (size_t thread_id = 0; thread_id < n_thread_; thread_id++)
+            {
+                threads.emplace_back(std::ref(f), thread_id);
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+    }
+
+    template <typename T>
+    template <typename AccelerationFunction>
+    typename BASIC_ENGINE_BASE<T>::INTEGRATOR_BUFFERS &BASIC_ENGINE_BASE<T>::warm_start(CORE::TIMER &timer, AccelerationFunction &&compute_acceleration, bool &is_ic_logged)
+    {
+        if (integrator_buffers_opt_)
+        {
+            is_ic_logged = true;
+            return *integrator_buffers_opt_;
+        }
+        INTEGRATOR_BUFFERS &buffers = integrator_buffers_opt_.emplace(system_state_snapshot().size());
+        // Step 1: Prepare ic
+        set_system_state(system_state_snapshot(), buffers.bodies, buffers.mass);
+        timer.elapsed_previous("step1");
+
+        // Step 2: Prepare acceleration for ic, unless a checkpoint has it, or the integrator does not need it
+        is_ic_logged = resumed_acceleration().has_value();
+        if (resumed_acceleration())
+        {
+            buffers.bodies.acc = *resumed_acceleration();
+        }
+        else if (integrator().is_kick_first())
+        {
+            compute_acceleration(buffers.bodies.acc, buffers.bodies.pos, buffers.mass);
+        }
+        timer.elapsed_previous("step2");
+        return buffers;
+    }
+
+    template <typename T>
+    template <typename AccelerationFunction>
+    std::optional<typename BASIC_ENGINE_BASE<T>::system_state_type> BASIC_ENGINE_BASE<T>::execute_integrator(int n_iter, CORE::TIMER &timer, AccelerationFunction &&compute_acceleration)
+    {
+        const size_t n_body = system_state_snapshot().size();
+
+        // Step 1 and step 2 on the first execute() only
+        bool is_ic_logged = false;
+        INTEGRATOR_BUFFERS &buffers = warm_start(timer, compute_acceleration, is_ic_logged);
+        BUFFER_BASE<T> &bodies = buffers.bodies;
+        const std::vector<T> &mass = buffers.mass;
+
+        auto drift = [n_body, &bodies, this](T c_dt)
+        {
+            parallel_for_helper(0, n_body,
+                                [&bodies, c_dt](size_t i_target_body)
+                                {
+                                    bodies.pos[i_target_body] = {bodies.pos[i_target_body] + c_dt * bodies.vel[i_target_body]};
+                                });
+        };
+        auto kick = [n_body, &bodies, this](T d_dt)
+        {
+            parallel_for_helper(0, n_body,
+                                [&bodies, d_dt](size_t i_target_body)
+                                {
+                                    bodies.vel[i_target_body] = {bodies.vel[i_target_body] + d_dt * bodies.acc[i_target_body]};
+                                });
+        };
+        auto accelerate = [n_body, &bodies, &mass, &compute_acceleration, this]()
+        {
+            compute_acceleration(bodies.acc, bodies.pos, mass);
+            count_force_evaluations(n_body);
+        };
+
+        // Core iteration loop
+        for (int i_iter = 0; i_iter < n_iter; i_iter++)
+        {
+            // Write SYSTEM_STATE to log, unless it has the ic already
+            if (i_iter == 0 && !is_ic_logged)
+            {
+                push_system_state_to_log([&](system_state_type &system_state)
+                                         { generate_system_state(bodies, mass, system_state); });
+            }
+
+            // Steps 3 to 6, as the integrator orders them
+            integrator().step(dt(), drift, kick, accelerate);
+
+            push_system_state_to_log([&](system_state_type &system_state)
+                                     { generate_system_state(bodies, mass, system_state); });
+            if (i_iter % 10 == 0)
+            {
+                serialize_system_state_log();
+            }
+
+            timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
+
+            if (checkpoint_if_due(i_iter, [&](system_state_type &system_state, std::vector<CORE::ACC_BASE<T>> &acc)
+                                  { generate_system_state(bodies, mass, system_state); acc = bodies.acc; }))
+            {
+                break;
+            }
+        }
+
+        timer.elapsed_previous("all_iters");
+
+        // Kept in buffers for the next execute()
+        return std::nullopt;
+    }
+}
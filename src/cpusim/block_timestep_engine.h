@@ -0,0 +1,64 @@
+#pragma once
+
+#include "time_bin_engine.h"
+
+namespace CPUSIM
+{
+    /// Direct summation with hierarchical block time steps (see TIME_BIN_ENGINE_BASE), dt being the coarsest step.
+    /// Every body steps in kick-drift-kick leapfrog within its own time bin. At each tick ending the step of some bins,
+    /// all the bodies drift to it, and only the bodies of those bins get their acceleration evaluated and are kicked.
+    /// Their next bin follows CORE::aarseth_timestep(), with the jerk computed in the same pass over the sources as the
+    /// acceleration, from the velocities of the sources predicted to the tick to first order.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class BLOCK_TIMESTEP_ENGINE_BASE final : public TIME_BIN_ENGINE_BASE<T>
+    {
+    public:
+        using typename TIME_BIN_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~BLOCK_TIMESTEP_ENGINE_BASE() = default;
+
+        /// max_bin: the finest bin steps dt / 2^max_bin
+        /// eta: accuracy of the time step criterion, smaller for shorter steps
+        BLOCK_TIMESTEP_ENGINE_BASE(system_state_type system_state_ic,
+                                   T dt,
+                                   size_t n_thread,
+                                   bool use_thread_pool,
+                                   int max_bin,
+                                   T eta,
+                                   std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("BLOCK_TIMESTEP_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+
+    protected:
+        using typename TIME_BIN_ENGINE_BASE<T>::BODIES;
+
+        /// Opening kick of the bodies beginning their step at last_tick, then the drift of every body,
+        /// pos being at the current tick and vel at the beginning of the step
+        virtual void predict(BODIES &bodies, int64_t last_tick, int64_t tick) override;
+        virtual void evaluate(BODIES &bodies) override;
+        /// Closing kick
+        virtual void correct(BODIES &bodies, int64_t tick) override;
+        /// The bins are part of the state, the jerk is only needed to pick them
+        virtual size_t n_engine_value() const override { return 1; }
+        virtual void get_engine_values(const BODIES &bodies, size_t i_body, T *values) const override;
+        virtual void set_engine_values(BODIES &bodies, size_t i_body, const T *values) override;
+
+        using TIME_BIN_ENGINE_BASE<T>::block_timestep;
+        using TIME_BIN_ENGINE_BASE<T>::eta;
+        using TIME_BIN_ENGINE_BASE<T>::end_step;
+        using TIME_BIN_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        /// vel kicked by half a step, which pos drifts with
+        std::vector<CORE::VEL_BASE<T>> vel_drift_;
+        /// At the current tick, for the jerk
+        std::vector<CORE::VEL_BASE<T>> vel_predicted_;
+    };
+
+    /// Use this type
+    using BLOCK_TIMESTEP_ENGINE = BLOCK_TIMESTEP_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class BLOCK_TIMESTEP_ENGINE_BASE<float>;
+    extern template class BLOCK_TIMESTEP_ENGINE_BASE<double>;
+}
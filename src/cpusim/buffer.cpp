@@ -1,8 +1,11 @@
 #include "buffer.h"
 
+#include <algorithm>
+
 namespace CPUSIM
 {
-    std::ostream &operator<<(std::ostream &os, const BUFFER &buf)
+    template <typename T>
+    std::ostream &operator<<(std::ostream &os, const BUFFER_BASE<T> &buf)
     {
         int counter = 0;
         os << "POS: ";
@@ -34,18 +37,104 @@ namespace CPUSIM
         return os;
     }
 
-    CORE::SYSTEM_STATE generate_system_state(const BUFFER &buffer, const std::vector<CORE::MASS> &mass)
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass)
+    {
+        CORE::SOA_SYSTEM_STATE_BASE<T> system_state;
+        generate_system_state(buffer, mass, system_state);
+        return system_state;
+    }
+
+    template <typename T>
+    void generate_system_state(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state)
     {
-        CORE::SYSTEM_STATE system_state;
-        system_state.reserve(mass.size());
+        system_state.resize(mass.size());
         for (size_t i_body = 0; i_body < mass.size(); i_body++)
         {
-            system_state.emplace_back(buffer.pos[i_body], buffer.vel[i_body], mass[i_body]);
+            system_state.set_pos(i_body, buffer.pos[i_body]);
+            system_state.set_vel(i_body, buffer.vel[i_body]);
+        }
+        std::copy(mass.begin(), mass.end(), system_state.mass().begin());
+    }
+
+    template <typename T>
+    void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, BUFFER_BASE<T> &buffer, std::vector<T> &mass)
+    {
+        for (size_t i_body = 0; i_body < system_state.size(); i_body++)
+        {
+            buffer.pos[i_body] = system_state.pos(i_body);
+            buffer.vel[i_body] = system_state.vel(i_body);
         }
+        std::copy(system_state.mass().begin(), system_state.mass().end(), mass.begin());
+    }
+
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const SOA_BUFFER_BASE<T> &buffer, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body)
+    {
+        return generate_system_state(buffer.pos, buffer.vel, mass, n_body);
+    }
+
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const SOA_XYZ_BASE<T> &pos, const SOA_XYZ_BASE<T> &vel, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body)
+    {
+        CORE::SOA_SYSTEM_STATE_BASE<T> system_state;
+        generate_system_state(pos, vel, mass, n_body, system_state);
         return system_state;
     }
 
-    void debug_workspace(const BUFFER &buffer, const std::vector<CORE::MASS> &mass)
+    template <typename T>
+    void generate_system_state(const SOA_BUFFER_BASE<T> &buffer, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state)
+    {
+        generate_system_state(buffer.pos, buffer.vel, mass, n_body, system_state);
+    }
+
+    template <typename T>
+    void generate_system_state(const SOA_XYZ_BASE<T> &pos, const SOA_XYZ_BASE<T> &vel, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state)
+    {
+        system_state.resize(n_body);
+        std::copy_n(pos.x.begin(), n_body, system_state.pos_x().begin());
+        std::copy_n(pos.y.begin(), n_body, system_state.pos_y().begin());
+        std::copy_n(pos.z.begin(), n_body, system_state.pos_z().begin());
+        std::copy_n(vel.x.begin(), n_body, system_state.vel_x().begin());
+        std::copy_n(vel.y.begin(), n_body, system_state.vel_y().begin());
+        std::copy_n(vel.z.begin(), n_body, system_state.vel_z().begin());
+        std::copy_n(mass.begin(), n_body, system_state.mass().begin());
+    }
+
+    template <typename T>
+    void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, SOA_XYZ_BASE<T> &pos, SOA_XYZ_BASE<T> &vel, CORE::ALIGNED_VECTOR<T> &mass)
+    {
+        std::copy(system_state.pos_x().begin(), system_state.pos_x().end(), pos.x.begin());
+        std::copy(system_state.pos_y().begin(), system_state.pos_y().end(), pos.y.begin());
+        std::copy(system_state.pos_z().begin(), system_state.pos_z().end(), pos.z.begin());
+        std::copy(system_state.vel_x().begin(), system_state.vel_x().end(), vel.x.begin());
+        std::copy(system_state.vel_y().begin(), system_state.vel_y().end(), vel.y.begin());
+        std::copy(system_state.vel_z().begin(), system_state.vel_z().end(), vel.z.begin());
+        std::copy(system_state.mass().begin(), system_state.mass().end(), mass.begin());
+    }
+
+    template <typename T>
+    void generate_acceleration(const SOA_XYZ_BASE<T> &acc, size_t n_body, std::vector<CORE::ACC_BASE<T>> &accelerations)
+    {
+        accelerations.clear();
+        accelerations.reserve(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            accelerations.push_back(CORE::ACC_BASE<T>{acc.get(i_body)});
+        }
+    }
+
+    template <typename T>
+    void set_acceleration(const std::vector<CORE::ACC_BASE<T>> &accelerations, SOA_XYZ_BASE<T> &acc)
+    {
+        for (size_t i_body = 0; i_body < accelerations.size(); i_body++)
+        {
+            acc.set(i_body, accelerations[i_body]);
+        }
+    }
+
+    template <typename T>
+    void debug_workspace(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass)
     {
         int counter = 0;
         std::cout << "MASS: ";
@@ -60,4 +149,29 @@ namespace CPUSIM
 
         std::cout << std::endl;
     }
-}
\ No newline at end of file
+
+    template std::ostream &operator<<(std::ostream &, const BUFFER_BASE<float> &);
+    template std::ostream &operator<<(std::ostream &, const BUFFER_BASE<double> &);
+    template CORE::SOA_SYSTEM_STATE_BASE<float> generate_system_state(const BUFFER_BASE<float> &, const std::vector<float> &);
+    template CORE::SOA_SYSTEM_STATE_BASE<double> generate_system_state(const BUFFER_BASE<double> &, const std::vector<double> &);
+    template void generate_system_state(const BUFFER_BASE<float> &, const std::vector<float> &, CORE::SOA_SYSTEM_STATE_BASE<float> &);
+    template void generate_system_state(const BUFFER_BASE<double> &, const std::vector<double> &, CORE::SOA_SYSTEM_STATE_BASE<double> &);
+    template void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<float> &, BUFFER_BASE<float> &, std::vector<float> &);
+    template void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<double> &, BUFFER_BASE<double> &, std::vector<double> &);
+    template void debug_workspace(const BUFFER_BASE<float> &, const std::vector<float> &);
+    template void debug_workspace(const BUFFER_BASE<double> &, const std::vector<double> &);
+    template CORE::SOA_SYSTEM_STATE_BASE<float> generate_system_state(const SOA_BUFFER_BASE<float> &, const CORE::ALIGNED_VECTOR<float> &, size_t);
+    template CORE::SOA_SYSTEM_STATE_BASE<double> generate_system_state(const SOA_BUFFER_BASE<double> &, const CORE::ALIGNED_VECTOR<double> &, size_t);
+    template CORE::SOA_SYSTEM_STATE_BASE<float> generate_system_state(const SOA_XYZ_BASE<float> &, const SOA_XYZ_BASE<float> &, const CORE::ALIGNED_VECTOR<float> &, size_t);
+    template CORE::SOA_SYSTEM_STATE_BASE<double> generate_system_state(const SOA_XYZ_BASE<double> &, const SOA_XYZ_BASE<double> &, const CORE::ALIGNED_VECTOR<double> &, size_t);
+    template void generate_system_state(const SOA_BUFFER_BASE<float> &, const CORE::ALIGNED_VECTOR<float> &, size_t, CORE::SOA_SYSTEM_STATE_BASE<float> &);
+    template void generate_system_state(const SOA_BUFFER_BASE<double> &, const CORE::ALIGNED_VECTOR<double> &, size_t, CORE::SOA_SYSTEM_STATE_BASE<double> &);
+    template void generate_system_state(const SOA_XYZ_BASE<float> &, const SOA_XYZ_BASE<float> &, const CORE::ALIGNED_VECTOR<float> &, size_t, CORE::SOA_SYSTEM_STATE_BASE<float> &);
+    template void generate_system_state(const SOA_XYZ_BASE<double> &, const SOA_XYZ_BASE<double> &, const CORE::ALIGNED_VECTOR<double> &, size_t, CORE::SOA_SYSTEM_STATE_BASE<double> &);
+    template void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<float> &, SOA_XYZ_BASE<float> &, SOA_XYZ_BASE<float> &, CORE::ALIGNED_VECTOR<float> &);
+    template void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<double> &, SOA_XYZ_BASE<double> &, SOA_XYZ_BASE<double> &, CORE::ALIGNED_VECTOR<double> &);
+    template void generate_acceleration(const SOA_XYZ_BASE<float> &, size_t, std::vector<CORE::ACC_BASE<float>> &);
+    template void generate_acceleration(const SOA_XYZ_BASE<double> &, size_t, std::vector<CORE::ACC_BASE<double>> &);
+    template void set_acceleration(const std::vector<CORE::ACC_BASE<float>> &, SOA_XYZ_BASE<float> &);
+    template void set_acceleration(const std::vector<CORE::ACC_BASE<double>> &, SOA_XYZ_BASE<double> &);
+}
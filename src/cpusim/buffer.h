@@ -3,21 +3,101 @@
 #include <vector>
 #include <iostream>
 #include "core/physics.hpp"
+#include "core/aligned_allocator.hpp"
 
 namespace CPUSIM
 {
-    struct BUFFER
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    struct BUFFER_BASE
     {
-        std::vector<CORE::POS> pos;
-        std::vector<CORE::VEL> vel;
-        std::vector<CORE::ACC> acc;
+        std::vector<CORE::POS_BASE<T>> pos;
+        std::vector<CORE::VEL_BASE<T>> vel;
+        std::vector<CORE::ACC_BASE<T>> acc;
 
-        BUFFER(int n_body) : pos(n_body, {0, 0, 0}), vel(n_body, {0, 0, 0}), acc(n_body, {0, 0, 0}) {}
+        BUFFER_BASE(int n_body) : pos(n_body, {0, 0, 0}), vel(n_body, {0, 0, 0}), acc(n_body, {0, 0, 0}) {}
     };
 
-    std::ostream &operator<<(std::ostream &os, const BUFFER &buf);
+    /// Use this type
+    using BUFFER = BUFFER_BASE<CORE::UNIVERSE::floating_value_type>;
 
-    CORE::SYSTEM_STATE generate_system_state(const BUFFER &buffer, const std::vector<CORE::MASS> &mass);
+    template <typename T>
+    std::ostream &operator<<(std::ostream &os, const BUFFER_BASE<T> &buf);
 
-    void debug_workspace(const BUFFER &buffer, const std::vector<CORE::MASS> &mass);
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass);
+    /// Overwrites system_state, reusing its memory, e.g., a recycled log frame
+    template <typename T>
+    void generate_system_state(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state);
+    /// Reverse of generate_system_state(), buffer and mass having room for every body of system_state
+    template <typename T>
+    void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, BUFFER_BASE<T> &buffer, std::vector<T> &mass);
+
+    /// Structure-of-arrays counterpart of BUFFER, for SIMD kernels.
+    /// Every array is 64-byte aligned and padded with zeros up to a multiple of soa_padding,
+    /// so that kernels can run full vectors without remainder loops.
+    /// Padded bodies are expected to carry zero mass, so they never contribute any acceleration.
+    constexpr size_t soa_padding = 16; // Widest SIMD lane count in floats (AVX-512)
+
+    inline size_t soa_padded_size(size_t n_body)
+    {
+        return (n_body + soa_padding - 1) / soa_padding * soa_padding;
+    }
+
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    struct SOA_XYZ_BASE
+    {
+        CORE::ALIGNED_VECTOR<T> x;
+        CORE::ALIGNED_VECTOR<T> y;
+        CORE::ALIGNED_VECTOR<T> z;
+
+        explicit SOA_XYZ_BASE(size_t n_body) : x(soa_padded_size(n_body), 0), y(soa_padded_size(n_body), 0), z(soa_padded_size(n_body), 0) {}
+
+        CORE::XYZ_BASE<T> get(size_t i) const { return {x[i], y[i], z[i]}; }
+        void set(size_t i, const CORE::XYZ_BASE<T> &v)
+        {
+            x[i] = v.x;
+            y[i] = v.y;
+            z[i] = v.z;
+        }
+    };
+
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    struct SOA_BUFFER_BASE
+    {
+        SOA_XYZ_BASE<T> pos;
+        SOA_XYZ_BASE<T> vel;
+        SOA_XYZ_BASE<T> acc;
+
+        explicit SOA_BUFFER_BASE(size_t n_body) : pos(n_body), vel(n_body), acc(n_body) {}
+    };
+
+    /// Use these types
+    using SOA_XYZ = SOA_XYZ_BASE<CORE::UNIVERSE::floating_value_type>;
+    using SOA_BUFFER = SOA_BUFFER_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    /// Column by column, the SYSTEM_STATE being structure-of-arrays as well
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const SOA_BUFFER_BASE<T> &buffer, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body);
+    template <typename T>
+    CORE::SOA_SYSTEM_STATE_BASE<T> generate_system_state(const SOA_XYZ_BASE<T> &pos, const SOA_XYZ_BASE<T> &vel, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body);
+    /// Overwrites system_state, reusing its memory, e.g., a recycled log frame
+    template <typename T>
+    void generate_system_state(const SOA_BUFFER_BASE<T> &buffer, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state);
+    template <typename T>
+    void generate_system_state(const SOA_XYZ_BASE<T> &pos, const SOA_XYZ_BASE<T> &vel, const CORE::ALIGNED_VECTOR<T> &mass, size_t n_body, CORE::SOA_SYSTEM_STATE_BASE<T> &system_state);
+    /// Reverse of generate_system_state(), leaves the padding as it is
+    template <typename T>
+    void set_system_state(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, SOA_XYZ_BASE<T> &pos, SOA_XYZ_BASE<T> &vel, CORE::ALIGNED_VECTOR<T> &mass);
+    /// Overwrites accelerations with acc[0, n_body), e.g., for a checkpoint
+    template <typename T>
+    void generate_acceleration(const SOA_XYZ_BASE<T> &acc, size_t n_body, std::vector<CORE::ACC_BASE<T>> &accelerations);
+    /// Reverse of generate_acceleration()
+    template <typename T>
+    void set_acceleration(const std::vector<CORE::ACC_BASE<T>> &accelerations, SOA_XYZ_BASE<T> &acc);
+
+    template <typename T>
+    void debug_workspace(const BUFFER_BASE<T> &buffer, const std::vector<T> &mass);
 }
\ No newline at end of file
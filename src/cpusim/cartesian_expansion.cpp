@@ -0,0 +1,200 @@
+#include "cartesian_expansion.h"
+#include "core/macros.hpp"
+
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+namespace
+{
+    double factorial(int n)
+    {
+        double result = 1;
+        for (int i = 2; i <= n; i++)
+        {
+            result *= i;
+        }
+        return result;
+    }
+
+    double binomial(int n, int k)
+    {
+        return factorial(n) / (factorial(k) * factorial(n - k));
+    }
+}
+
+namespace CPUSIM
+{
+    CARTESIAN_EXPANSION::CARTESIAN_EXPANSION(int order) : order_(order)
+    {
+        ASSERT(order_ >= 0 && order_ <= max_order);
+
+        index_table_.assign((order_ + 1) * (order_ + 1) * (order_ + 1), -1);
+        for (int total = 0; total <= order_; total++)
+        {
+            for (int kx = total; kx >= 0; kx--)
+            {
+                for (int ky = total - kx; ky >= 0; ky--)
+                {
+                    const int kz = total - kx - ky;
+                    index_table_[(kx * (order_ + 1) + ky) * (order_ + 1) + kz] = static_cast<int>(multi_indices_.size());
+                    multi_indices_.push_back({kx, ky, kz});
+                }
+            }
+        }
+
+        for (const auto &[kx, ky, kz] : multi_indices_)
+        {
+            inverse_factorials_.push_back(1 / (factorial(kx) * factorial(ky) * factorial(kz)));
+        }
+
+        for (const auto &[kx, ky, kz] : multi_indices_)
+        {
+            const int k_total = kx + ky + kz;
+            for (const auto &[nx, ny, nz] : multi_indices_)
+            {
+                // M2M: M'_k += M_m * (-delta)^(k - m) / (k - m)!, for m <= k
+                if (nx <= kx && ny <= ky && nz <= kz)
+                {
+                    const int i_diff = index(kx - nx, ky - ny, kz - nz);
+                    m2m_terms_.push_back({static_cast<uint32_t>(index(kx, ky, kz)), static_cast<uint32_t>(index(nx, ny, nz)),
+                                          static_cast<uint32_t>(i_diff), inverse_factorials_[i_diff]});
+                }
+
+                // M2L: L_n += M_k * T_(k + n) * (k + n)! / n!, for |k| + |n| <= p
+                if (k_total + nx + ny + nz <= order_)
+                {
+                    const double coef = factorial(kx + nx) * factorial(ky + ny) * factorial(kz + nz) /
+                                        (factorial(nx) * factorial(ny) * factorial(nz));
+                    m2l_terms_.push_back({static_cast<uint32_t>(index(nx, ny, nz)), static_cast<uint32_t>(index(kx, ky, kz)),
+                                          static_cast<uint32_t>(index(kx + nx, ky + ny, kz + nz)), coef});
+                }
+
+                // L2L: L'_m += L_n * C(n, m) * delta^(n - m), for m <= n (here m = k)
+                if (kx <= nx && ky <= ny && kz <= nz)
+                {
+                    const double coef = binomial(nx, kx) * binomial(ny, ky) * binomial(nz, kz);
+                    l2l_terms_.push_back({static_cast<uint32_t>(index(kx, ky, kz)), static_cast<uint32_t>(index(nx, ny, nz)),
+                                          static_cast<uint32_t>(index(nx - kx, ny - ky, nz - kz)), coef});
+                }
+            }
+        }
+    }
+
+    void CARTESIAN_EXPANSION::compute_powers(const XYZ &v, COEFFICIENTS &powers) const
+    {
+        // Ordered by |k|, so every v^(k - e_i) is ready before v^k
+        powers[0] = 1;
+        for (size_t i = 1; i < multi_indices_.size(); i++)
+        {
+            const auto &[kx, ky, kz] = multi_indices_[i];
+            if (kx > 0)
+            {
+                powers[i] = powers[index(kx - 1, ky, kz)] * v.x;
+            }
+            else if (ky > 0)
+            {
+                powers[i] = powers[index(kx, ky - 1, kz)] * v.y;
+            }
+            else
+            {
+                powers[i] = powers[index(kx, ky, kz - 1)] * v.z;
+            }
+        }
+    }
+
+    void CARTESIAN_EXPANSION::compute_derivatives(const XYZ &r, COEFFICIENTS &derivatives) const
+    {
+        // Recurrence of the Taylor coefficients of 1 / |r|:
+        // |k| |r|^2 T_k + (2|k| - 1) Sum_i(r_i T_(k - e_i)) + (|k| - 1) Sum_i(T_(k - 2e_i)) = 0
+        const value_type r_square = r.norm_square();
+        const value_type r_component[3] = {r.x, r.y, r.z};
+        derivatives[0] = 1 / std::sqrt(r_square);
+        for (size_t i = 1; i < multi_indices_.size(); i++)
+        {
+            const auto &k = multi_indices_[i];
+            const int k_total = k[0] + k[1] + k[2];
+            value_type first_order_sum = 0;
+            value_type second_order_sum = 0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                auto k_prev = k;
+                if (k_prev[axis] >= 1)
+                {
+                    k_prev[axis] -= 1;
+                    first_order_sum += r_component[axis] * derivatives[index(k_prev[0], k_prev[1], k_prev[2])];
+                }
+                if (k_prev[axis] >= 1)
+                {
+                    k_prev[axis] -= 1;
+                    second_order_sum += derivatives[index(k_prev[0], k_prev[1], k_prev[2])];
+                }
+            }
+            derivatives[i] = -((2 * k_total - 1) * first_order_sum + (k_total - 1) * second_order_sum) / (k_total * r_square);
+        }
+    }
+
+    void CARTESIAN_EXPANSION::p2m(value_type mass, const XYZ &d, value_type *multipole) const
+    {
+        COEFFICIENTS powers;
+        compute_powers(-d, powers);
+        for (size_t i = 0; i < multi_indices_.size(); i++)
+        {
+            multipole[i] += mass * powers[i] * inverse_factorials_[i];
+        }
+    }
+
+    void CARTESIAN_EXPANSION::m2m(const value_type *child_multipole, const XYZ &delta, value_type *parent_multipole) const
+    {
+        COEFFICIENTS powers;
+        compute_powers(-delta, powers);
+        for (const auto &term : m2m_terms_)
+        {
+            parent_multipole[term.i_dst] += term.coef * child_multipole[term.i_src] * powers[term.i_table];
+        }
+    }
+
+    void CARTESIAN_EXPANSION::m2l(const value_type *multipole, const XYZ &r, value_type *local) const
+    {
+        COEFFICIENTS derivatives;
+        compute_derivatives(r, derivatives);
+        for (const auto &term : m2l_terms_)
+        {
+            local[term.i_dst] += term.coef * multipole[term.i_src] * derivatives[term.i_table];
+        }
+    }
+
+    void CARTESIAN_EXPANSION::l2l(const value_type *parent_local, const XYZ &delta, value_type *child_local) const
+    {
+        COEFFICIENTS powers;
+        compute_powers(delta, powers);
+        for (const auto &term : l2l_terms_)
+        {
+            child_local[term.i_dst] += term.coef * parent_local[term.i_src] * powers[term.i_table];
+        }
+    }
+
+    CARTESIAN_EXPANSION::XYZ CARTESIAN_EXPANSION::l2p(const value_type *local, const XYZ &e) const
+    {
+        COEFFICIENTS powers;
+        compute_powers(e, powers);
+        XYZ grad{0, 0, 0};
+        for (size_t i = 1; i < multi_indices_.size(); i++)
+        {
+            const auto &[nx, ny, nz] = multi_indices_[i];
+            if (nx > 0)
+            {
+                grad.x += local[i] * nx * powers[index(nx - 1, ny, nz)];
+            }
+            if (ny > 0)
+            {
+                grad.y += local[i] * ny * powers[index(nx, ny - 1, nz)];
+            }
+            if (nz > 0)
+            {
+                grad.z += local[i] * nz * powers[index(nx, ny, nz - 1)];
+            }
+        }
+        return grad;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "core/xyz.hpp"
+
+namespace CPUSIM
+{
+    /// Cartesian Taylor expansions of the potential phi(x) = Sum(m / |x - y|), truncated at total order p.
+    /// Coefficients are indexed by multi-index k = (kx, ky, kz) with |k| = kx + ky + kz <= p,
+    /// and powers are v^k = vx^kx * vy^ky * vz^kz.
+    /// - Multipole about a source center c: M_k = Sum(m * (c - y)^k / k!)
+    /// - Local about a target center c: phi(c + e) = Sum(L_n * e^n)
+    /// The acceleration is grad(phi), i.e., pointing towards the sources, as in CORE::universal_field.
+    class CARTESIAN_EXPANSION
+    {
+    public:
+        using value_type = double;
+        using XYZ = CORE::XYZ_BASE<value_type>;
+
+        static constexpr int max_order = 10;
+        static constexpr size_t max_n_coefficient = (max_order + 1) * (max_order + 2) * (max_order + 3) / 6;
+
+        explicit CARTESIAN_EXPANSION(int order);
+
+        int order() const { return order_; }
+        size_t n_coefficient() const { return multi_indices_.size(); }
+
+        /// multipole += a body of mass m at offset d = y - c from the center
+        void p2m(value_type mass, const XYZ &d, value_type *multipole) const;
+        /// parent_multipole += child_multipole shifted by delta = c_child - c_parent
+        void m2m(const value_type *child_multipole, const XYZ &delta, value_type *parent_multipole) const;
+        /// local += multipole translated by r = c_target - c_source
+        void m2l(const value_type *multipole, const XYZ &r, value_type *local) const;
+        /// child_local += parent_local shifted by delta = c_child - c_parent
+        void l2l(const value_type *parent_local, const XYZ &delta, value_type *child_local) const;
+        /// grad(phi) at offset e from the center of local
+        XYZ l2p(const value_type *local, const XYZ &e) const;
+
+    private:
+        using COEFFICIENTS = std::array<value_type, max_n_coefficient>;
+
+        int index(int kx, int ky, int kz) const { return index_table_[(kx * (order_ + 1) + ky) * (order_ + 1) + kz]; }
+        /// v^k for every k
+        void compute_powers(const XYZ &v, COEFFICIENTS &powers) const;
+        /// T_k(r) = D^k (1 / |r|) / k! for every k
+        void compute_derivatives(const XYZ &r, COEFFICIENTS &derivatives) const;
+
+    private:
+        /// dst[i_dst] += coef * src[i_src] * table[i_table]
+        struct TERM
+        {
+            uint32_t i_dst;
+            uint32_t i_src;
+            uint32_t i_table;
+            value_type coef;
+        };
+
+        int order_;
+        std::vector<std::array<int, 3>> multi_indices_; // Ordered by |k|
+        std::vector<int> index_table_;
+        std::vector<TERM> m2m_terms_;
+        std::vector<TERM> m2l_terms_;
+        std::vector<TERM> l2l_terms_;
+        std::vector<value_type> inverse_factorials_; // 1 / k!
+    };
+}
@@ -0,0 +1,70 @@
+#include "fft.h"
+#include "core/macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace CPUSIM
+{
+    FFT_3D::FFT_3D(size_t n, size_t n_thread)
+        : n_(n),
+          line_batch_size_(std::min<size_t>(n, 8)),
+          scratch_lines_(n * line_batch_size_ * std::max<size_t>(n_thread, 1))
+    {
+        ASSERT(n_ >= 1 && (n_ & (n_ - 1)) == 0);
+
+        size_t log2_n = 0;
+        while ((size_t(1) << log2_n) < n_)
+        {
+            log2_n++;
+        }
+        bit_reversal_.resize(n_);
+        for (size_t i = 0; i < n_; i++)
+        {
+            size_t reversed = 0;
+            for (size_t bit = 0; bit < log2_n; bit++)
+            {
+                reversed |= ((i >> bit) & 1) << (log2_n - 1 - bit);
+            }
+            bit_reversal_[i] = reversed;
+        }
+
+        const value_type pi = std::acos(static_cast<value_type>(-1));
+        twiddles_.resize(n_ / 2);
+        for (size_t k = 0; k < n_ / 2; k++)
+        {
+            twiddles_[k] = std::polar(static_cast<value_type>(1), -2 * pi * k / n_);
+        }
+    }
+
+    void FFT_3D::transform_line(complex_type *line, bool is_inverse) const
+    {
+        for (size_t i = 0; i < n_; i++)
+        {
+            if (i < bit_reversal_[i])
+            {
+                std::swap(line[i], line[bit_reversal_[i]]);
+            }
+        }
+
+        for (size_t half = 1; half < n_; half *= 2)
+        {
+            const size_t twiddle_stride = n_ / (2 * half);
+            for (size_t block = 0; block < n_; block += 2 * half)
+            {
+                for (size_t k = 0; k < half; k++)
+                {
+                    const complex_type &twiddle = twiddles_[k * twiddle_stride];
+                    const value_type w_real = twiddle.real();
+                    const value_type w_imag = is_inverse ? -twiddle.imag() : twiddle.imag();
+                    const complex_type &b = line[block + k + half];
+                    // Spelled out, since operator* of std::complex goes through __muldc3 for the NaN/inf rules
+                    const complex_type odd{w_real * b.real() - w_imag * b.imag(), w_real * b.imag() + w_imag * b.real()};
+                    line[block + k + half] = line[block + k] - odd;
+                    line[block + k] += odd;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+namespace CPUSIM
+{
+    /// Iterative radix-2 Cooley-Tukey FFT over a cubic grid of n^3 complex values, n a power of two,
+    /// stored row-major as data[(ix * n + iy) * n + iz].
+    /// The 3D transform is done as n^2 independent 1D transforms along each axis in turn,
+    /// which are spread over the threads by a caller-provided parallel for loop.
+    /// forward(): X_k = Sum(x_j * exp(-2 pi i j k / n)), inverse(): x_j = Sum(X_k * exp(2 pi i j k / n)) / n^3
+    class FFT_3D
+    {
+    public:
+        using value_type = double;
+        using complex_type = std::complex<value_type>;
+
+        FFT_3D(size_t n, size_t n_thread);
+
+        size_t n() const { return n_; }
+        size_t size() const { return n_ * n_ * n_; }
+
+        /// ParallelFor signature: void(size_t begin, size_t end, Function f),
+        ///     where Function signature: void(size_t i, size_t thread_id), and thread_id < n_thread
+        template <typename ParallelFor>
+        void forward(std::vector<complex_type> &data, ParallelFor &&parallel_for) { transform(data, false, parallel_for); }
+        template <typename ParallelFor>
+        void inverse(std::vector<complex_type> &data, ParallelFor &&parallel_for) { transform(data, true, parallel_for); }
+
+    private:
+        template <typename ParallelFor>
+        void transform(std::vector<complex_type> &data, bool is_inverse, ParallelFor &parallel_for);
+
+        /// In-place unnormalized 1D transform of n contiguous values
+        void transform_line(complex_type *line, bool is_inverse) const;
+
+    private:
+        size_t n_;
+        size_t line_batch_size_; // Lines per strided gather, a divisor of n
+        std::vector<size_t> bit_reversal_;
+        std::vector<complex_type> twiddles_; // exp(-2 pi i k / n), for k < n / 2
+        std::vector<complex_type> scratch_lines_; // line_batch_size_ lines per thread, for the strided axes
+    };
+
+    /// Implementation
+
+    template <typename ParallelFor>
+    void FFT_3D::transform(std::vector<complex_type> &data, bool is_inverse, ParallelFor &parallel_for)
+    {
+        const size_t n = n_;
+        const size_t n_line = n * n;
+
+        // z axis: lines are contiguous
+        parallel_for(0, n_line,
+                     [&data, is_inverse, n, this](size_t i_line, size_t)
+                     {
+                         transform_line(data.data() + i_line * n, is_inverse);
+                     });
+
+        // y and x axes: gather line_batch_size neighboring strided lines, which share cache lines,
+        // transform them contiguously, and scatter them back
+        for (const size_t stride : {n, n * n})
+        {
+            parallel_for(0, n_line / line_batch_size_,
+                         [&data, is_inverse, n, stride, this](size_t i_batch, size_t thread_id)
+                         {
+                             // Split the first line into the two indices orthogonal to the axis
+                             const size_t i_line = i_batch * line_batch_size_;
+                             const size_t outer = i_line / n;
+                             const size_t inner = i_line % n;
+                             const size_t base = (stride == n) ? (outer * n * n + inner) : (outer * n + inner);
+                             complex_type *lines = scratch_lines_.data() + thread_id * n * line_batch_size_;
+                             for (size_t i = 0; i < n; i++)
+                             {
+                                 for (size_t b = 0; b < line_batch_size_; b++)
+                                 {
+                                     lines[b * n + i] = data[base + i * stride + b];
+                                 }
+                             }
+                             for (size_t b = 0; b < line_batch_size_; b++)
+                             {
+                                 transform_line(lines + b * n, is_inverse);
+                             }
+                             for (size_t i = 0; i < n; i++)
+                             {
+                                 for (size_t b = 0; b < line_batch_size_; b++)
+                                 {
+                                     data[base + i * stride + b] = lines[b * n + i];
+                                 }
+                             }
+                         });
+        }
+
+        if (is_inverse)
+        {
+            const value_type normalization = 1 / static_cast<value_type>(size());
+            parallel_for(0, n_line,
+                         [&data, normalization, n](size_t i_line, size_t)
+                         {
+                             for (size_t i = i_line * n; i < (i_line + 1) * n; i++)
+                             {
+                                 data[i] *= normalization;
+                             }
+                         });
+        }
+    }
+}
@@ -0,0 +1,256 @@
+#include "fmm_engine.h"
+#include "core/timer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace CPUSIM
+{
+    namespace
+    {
+        template <typename T>
+        CARTESIAN_EXPANSION::XYZ to_expansion_xyz(const CORE::XYZ_BASE<T> &xyz)
+        {
+            return {xyz.x, xyz.y, xyz.z};
+        }
+    }
+
+    template <typename T>
+    FMM_ENGINE_BASE<T>::FMM_ENGINE_BASE(system_state_type system_state_ic,
+                                        T dt,
+                                        size_t n_thread,
+                                        bool use_thread_pool,
+                                        int order,
+                                        T theta,
+                                        size_t leaf_capacity,
+                                        std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt)),
+          expansion_(order),
+          theta_(theta),
+          octree_(leaf_capacity)
+    {
+        std::cout << "Using expansion order " << order << " with theta " << theta_ << " and leaf capacity " << leaf_capacity << std::endl;
+    }
+
+    template <typename T>
+    void FMM_ENGINE_BASE<T>::upward_pass(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+    {
+        const auto &nodes = octree_.nodes();
+        const auto &body_indices = octree_.body_indices();
+        const size_t n_node = nodes.size();
+        const size_t n_coefficient = expansion_.n_coefficient();
+
+        centers_.resize(n_node);
+        radii_.assign(n_node, 0);
+        multipoles_.assign(n_node * n_coefficient, 0);
+        locals_.assign(n_node * n_coefficient, 0);
+
+        for (auto &level : nodes_by_depth_)
+        {
+            level.clear();
+        }
+        n_depth_ = 0;
+        leaves_.clear();
+        for (int32_t node_id = 0; node_id < static_cast<int32_t>(n_node); node_id++)
+        {
+            const OCTREE_NODE_BASE<T> &node = nodes[node_id];
+            centers_[node_id] = to_expansion_xyz(node.com);
+            if (static_cast<size_t>(node.depth) >= nodes_by_depth_.size())
+            {
+                nodes_by_depth_.resize(node.depth + 1);
+            }
+            n_depth_ = std::max<size_t>(n_depth_, node.depth + 1);
+            nodes_by_depth_[node.depth].push_back(node_id);
+            if (node.is_leaf())
+            {
+                leaves_.push_back(node_id);
+            }
+        }
+
+        // P2M
+        parallel_for_helper(0, leaves_.size(),
+                            [&nodes, &body_indices, &pos, &mass, this](size_t i_leaf)
+                            {
+                                const int32_t node_id = leaves_[i_leaf];
+                                const OCTREE_NODE_BASE<T> &node = nodes[node_id];
+                                for (uint32_t k = node.body_begin; k < node.body_end; k++)
+                                {
+                                    const uint32_t i_body = body_indices[k];
+                                    const CARTESIAN_EXPANSION::XYZ d = to_expansion_xyz(pos[i_body]) - centers_[node_id];
+                                    expansion_.p2m(mass[i_body], d, multipole(node_id));
+                                    radii_[node_id] = std::max(radii_[node_id], std::sqrt(d.norm_square()));
+                                }
+                            });
+
+        // M2M, from the deepest level up
+        for (size_t depth = n_depth_; depth-- > 0;)
+        {
+            const auto &level = nodes_by_depth_[depth];
+            parallel_for_helper(0, level.size(),
+                                [&nodes, &level, this](size_t i_node)
+                                {
+                                    const int32_t node_id = level[i_node];
+                                    const OCTREE_NODE_BASE<T> &node = nodes[node_id];
+                                    for (int32_t child_id = node.first_child; child_id < node.first_child + node.n_child; child_id++)
+                                    {
+                                        const CARTESIAN_EXPANSION::XYZ delta = centers_[child_id] - centers_[node_id];
+                                        expansion_.m2m(multipole(child_id), delta, multipole(node_id));
+                                        radii_[node_id] = std::max(radii_[node_id], std::sqrt(delta.norm_square()) + radii_[child_id]);
+                                    }
+                                });
+        }
+    }
+
+    template <typename T>
+    void FMM_ENGINE_BASE<T>::dual_tree_traversal()
+    {
+        const auto &nodes = octree_.nodes();
+        const size_t n_node = nodes.size();
+        if (m2l_lists_.size() < n_node)
+        {
+            m2l_lists_.resize(n_node);
+            p2p_lists_.resize(n_node);
+        }
+        for (size_t node_id = 0; node_id < n_node; node_id++)
+        {
+            m2l_lists_[node_id].clear();
+            p2p_lists_[node_id].clear();
+        }
+
+        const auto theta_square = static_cast<CARTESIAN_EXPANSION::value_type>(theta_) * theta_;
+        std::vector<std::pair<int32_t, int32_t>> &stack = traversal_stack_;
+        stack.clear();
+        stack.emplace_back(0, 0);
+        while (!stack.empty())
+        {
+            const auto [target_id, source_id] = stack.back();
+            stack.pop_back();
+            const OCTREE_NODE_BASE<T> &target = nodes[target_id];
+            const OCTREE_NODE_BASE<T> &source = nodes[source_id];
+
+            const auto radius_sum = radii_[target_id] + radii_[source_id];
+            const auto distance_square = (centers_[target_id] - centers_[source_id]).norm_square();
+            if (target_id != source_id && radius_sum * radius_sum < theta_square * distance_square)
+            {
+                m2l_lists_[target_id].push_back(source_id);
+            }
+            else if (target.is_leaf() && source.is_leaf())
+            {
+                p2p_lists_[target_id].push_back(source_id);
+            }
+            else if (source.is_leaf() || (!target.is_leaf() && radii_[target_id] >= radii_[source_id]))
+            {
+                // Split the target
+                for (int32_t child_id = target.first_child; child_id < target.first_child + target.n_child; child_id++)
+                {
+                    stack.emplace_back(child_id, source_id);
+                }
+            }
+            else
+            {
+                // Split the source
+                for (int32_t child_id = source.first_child; child_id < source.first_child + source.n_child; child_id++)
+                {
+                    stack.emplace_back(target_id, child_id);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void FMM_ENGINE_BASE<T>::downward_pass(std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+    {
+        const auto &nodes = octree_.nodes();
+        const auto &body_indices = octree_.body_indices();
+
+        // M2L, each target only writes into its own local expansion
+        parallel_for_helper(0, nodes.size(),
+                            [this](size_t target_id)
+                            {
+                                for (const int32_t source_id : m2l_lists_[target_id])
+                                {
+                                    expansion_.m2l(multipole(source_id), centers_[target_id] - centers_[source_id], local(target_id));
+                                }
+                            });
+
+        // L2L, from the root down
+        for (size_t depth = 1; depth < n_depth_; depth++)
+        {
+            const auto &level = nodes_by_depth_[depth];
+            parallel_for_helper(0, level.size(),
+                                [&nodes, &level, this](size_t i_node)
+                                {
+                                    const int32_t node_id = level[i_node];
+                                    const int32_t parent_id = nodes[node_id].parent;
+                                    expansion_.l2l(local(parent_id), centers_[node_id] - centers_[parent_id], local(node_id));
+                                });
+        }
+
+        // L2P and P2P
+        parallel_for_helper(0, leaves_.size(),
+                            [&nodes, &body_indices, &acc, &pos, &mass, this](size_t i_leaf)
+                            {
+                                const int32_t target_id = leaves_[i_leaf];
+                                const OCTREE_NODE_BASE<T> &target = nodes[target_id];
+                                for (uint32_t k = target.body_begin; k < target.body_end; k++)
+                                {
+                                    const uint32_t i_target_body = body_indices[k];
+                                    const CARTESIAN_EXPANSION::XYZ far_field =
+                                        expansion_.l2p(local(target_id), to_expansion_xyz(pos[i_target_body]) - centers_[target_id]);
+                                    CORE::ACC_BASE<T> a{static_cast<T>(far_field.x), static_cast<T>(far_field.y), static_cast<T>(far_field.z)};
+                                    for (const int32_t source_id : p2p_lists_[target_id])
+                                    {
+                                        const OCTREE_NODE_BASE<T> &source = nodes[source_id];
+                                        for (uint32_t l = source.body_begin; l < source.body_end; l++)
+                                        {
+                                            const uint32_t j_source_body = body_indices[l];
+                                            a += CORE::ACC_BASE<T>::from_gravity(pos[j_source_body], mass[j_source_body], pos[i_target_body]);
+                                        }
+                                    }
+                                    acc[i_target_body] = a;
+                                }
+                            });
+    }
+
+    template <typename T>
+    void FMM_ENGINE_BASE<T>::compute_fmm_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                                      const std::vector<CORE::POS_BASE<T>> &pos,
+                                                      const std::vector<T> &mass)
+    {
+        if (pos.empty())
+        {
+            return;
+        }
+        octree_.build(pos, mass);
+        upward_pass(pos, mass);
+        dual_tree_traversal();
+        downward_pass(acc, pos, mass);
+    }
+
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> FMM_ENGINE_BASE<T>::compute_acceleration(const system_state_type &system_state)
+    {
+        const size_t n_body = system_state.size();
+        std::vector<CORE::POS_BASE<T>> pos(n_body);
+        std::vector<T> mass(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            pos[i_body] = system_state.pos(i_body);
+            mass[i_body] = system_state.mass()[i_body];
+        }
+        std::vector<CORE::ACC_BASE<T>> acc(n_body);
+        compute_fmm_acceleration(acc, pos, mass);
+        return acc;
+    }
+
+    template <typename T>
+    std::optional<typename FMM_ENGINE_BASE<T>::system_state_type> FMM_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        return execute_integrator(n_iter, timer,
+                                  [this](std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+                                  { compute_fmm_acceleration(acc, pos, mass); });
+    }
+
+    template class FMM_ENGINE_BASE<float>;
+    template class FMM_ENGINE_BASE<double>;
+}
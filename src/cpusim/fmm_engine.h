@@ -0,0 +1,82 @@
+#pragma once
+
+#include "basic_engine.h"
+#include "octree.h"
+#include "cartesian_expansion.h"
+#include "reference.h"
+
+namespace CPUSIM
+{
+    /// O(N) fast multipole method with Cartesian expansions of total order p.
+    /// Every step:
+    /// 1. Builds an OCTREE, and expands every node about its center of mass (P2M, M2M)
+    /// 2. Dual-tree traversal from (root, root): a cell pair is well separated when
+    ///    r_target + r_source < theta * |c_target - c_source|, where r is the radius of the cell about its center;
+    ///    such pairs go into the M2L list of the target, touching leaves go into its P2P list
+    /// 3. M2L in parallel over the target cells, then L2L down the tree level by level
+    /// 4. L2P and P2P in parallel over the leaves
+    /// The expansions are in CARTESIAN_EXPANSION::value_type, i.e., double, whatever T is.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class FMM_ENGINE_BASE final : public BASIC_ENGINE_BASE<T>, public APPROXIMATE_FORCE_ENGINE_BASE<T>
+    {
+    public:
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~FMM_ENGINE_BASE() = default;
+
+        FMM_ENGINE_BASE(system_state_type system_state_ic,
+                        T dt,
+                        size_t n_thread,
+                        bool use_thread_pool,
+                        int order,
+                        T theta,
+                        size_t leaf_capacity = 8,
+                        std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("FMM_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+
+        virtual std::vector<CORE::ACC_BASE<T>> compute_acceleration(const system_state_type &system_state) override;
+
+    private:
+        void compute_fmm_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                      const std::vector<CORE::POS_BASE<T>> &pos,
+                                      const std::vector<T> &mass);
+
+        void upward_pass(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass);
+        void dual_tree_traversal();
+        void downward_pass(std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass);
+
+        CARTESIAN_EXPANSION::value_type *multipole(int32_t node_id) { return multipoles_.data() + node_id * expansion_.n_coefficient(); }
+        CARTESIAN_EXPANSION::value_type *local(int32_t node_id) { return locals_.data() + node_id * expansion_.n_coefficient(); }
+
+        using BASIC_ENGINE_BASE<T>::execute_integrator;
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        CARTESIAN_EXPANSION expansion_;
+        T theta_;
+        OCTREE_BASE<T> octree_;
+
+        // Per node, indexed as OCTREE::nodes()
+        std::vector<CARTESIAN_EXPANSION::XYZ> centers_;
+        std::vector<CARTESIAN_EXPANSION::value_type> radii_;
+        std::vector<CARTESIAN_EXPANSION::value_type> multipoles_;
+        std::vector<CARTESIAN_EXPANSION::value_type> locals_;
+        // Never shrunk, so that the lists of a node keep their memory from one step to the next
+        std::vector<std::vector<int32_t>> m2l_lists_;
+        std::vector<std::vector<int32_t>> p2p_lists_;
+
+        std::vector<std::vector<int32_t>> nodes_by_depth_; // Never shrunk either, see n_depth_
+        size_t n_depth_ = 0;
+        std::vector<int32_t> leaves_;
+        std::vector<std::pair<int32_t, int32_t>> traversal_stack_; // (target, source)
+    };
+
+    /// Use this type
+    using FMM_ENGINE = FMM_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class FMM_ENGINE_BASE<float>;
+    extern template class FMM_ENGINE_BASE<double>;
+}
@@ -0,0 +1,106 @@
+#include "hermite_engine.h"
+#include "core/hermite.hpp"
+
+#include <iostream>
+
+namespace CPUSIM
+{
+    template <typename T>
+    HERMITE_ENGINE_BASE<T>::HERMITE_ENGINE_BASE(system_state_type system_state_ic,
+                                                T dt,
+                                                size_t n_thread,
+                                                bool use_thread_pool,
+                                                int max_bin,
+                                                T eta,
+                                                std::optional<std::string> system_state_log_dir_opt)
+        : TIME_BIN_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, max_bin, eta, std::move(system_state_log_dir_opt))
+    {
+        std::cout << "Using Hermite with " << max_bin + 1 << " time bins down to dt / " << block_timestep().n_tick() << " with eta " << eta << std::endl;
+    }
+
+    template <typename T>
+    void HERMITE_ENGINE_BASE<T>::predict(BODIES &bodies, int64_t, int64_t tick)
+    {
+        const size_t n_body = bodies.mass.size();
+        const T tick_dt = block_timestep().dt(block_timestep().max_bin());
+        pos_predicted_.resize(n_body, {0, 0, 0});
+        vel_predicted_.resize(n_body, {0, 0, 0});
+        acc_begin_.resize(n_body, {0, 0, 0});
+        jerk_begin_.resize(n_body, {0, 0, 0});
+
+        parallel_for_helper(0, n_body,
+                            [&bodies, tick, tick_dt, this](size_t i_body)
+                            {
+                                const T elapsed = static_cast<T>(tick - bodies.step_begin_tick[i_body]) * tick_dt;
+                                CORE::hermite_predict(bodies.pos[i_body], bodies.vel[i_body], bodies.acc[i_body], bodies.jerk[i_body], elapsed,
+                                                      pos_predicted_[i_body], vel_predicted_[i_body]);
+                            });
+    }
+
+    template <typename T>
+    void HERMITE_ENGINE_BASE<T>::evaluate(BODIES &bodies)
+    {
+        const size_t n_body = bodies.mass.size();
+
+        // Acceleration and jerk in one pass over the sources
+        parallel_for_helper(0, bodies.active.size(),
+                            [&bodies, n_body, this](size_t k)
+                            {
+                                const uint32_t i_target_body = bodies.active[k];
+                                const CORE::POS_BASE<T> &p_target = pos_predicted_[i_target_body];
+                                const CORE::VEL_BASE<T> &v_target = vel_predicted_[i_target_body];
+                                CORE::XYZ_BASE<T> acc{0, 0, 0};
+                                CORE::XYZ_BASE<T> jerk{0, 0, 0};
+                                for (size_t j_source_body = 0; j_source_body < n_body; j_source_body++)
+                                {
+                                    if (j_source_body == i_target_body)
+                                    {
+                                        continue;
+                                    }
+                                    const auto [pair_acc, pair_jerk] = CORE::gravity_and_jerk(pos_predicted_[j_source_body], vel_predicted_[j_source_body], bodies.mass[j_source_body], p_target, v_target);
+                                    acc += pair_acc;
+                                    jerk += pair_jerk;
+                                }
+                                acc_begin_[i_target_body] = bodies.acc[i_target_body];
+                                jerk_begin_[i_target_body] = bodies.jerk[i_target_body];
+                                bodies.acc[i_target_body] = {acc};
+                                bodies.jerk[i_target_body] = jerk;
+                            });
+    }
+
+    template <typename T>
+    void HERMITE_ENGINE_BASE<T>::correct(BODIES &bodies, int64_t tick)
+    {
+        parallel_for_helper(0, bodies.active.size(),
+                            [&bodies, tick, this](size_t k)
+                            {
+                                const uint32_t i_body = bodies.active[k];
+                                const CORE::HERMITE_CORRECTED_BASE<T> corrected =
+                                    CORE::hermite_correct(bodies.pos[i_body], bodies.vel[i_body], acc_begin_[i_body], jerk_begin_[i_body],
+                                                          bodies.acc[i_body], bodies.jerk[i_body], block_timestep().dt(bodies.bin[i_body]));
+                                bodies.pos[i_body] = corrected.pos;
+                                bodies.vel[i_body] = corrected.vel;
+                                end_step(bodies, i_body, tick, CORE::aarseth_timestep<T>(eta(), bodies.acc[i_body], bodies.jerk[i_body], corrected.snap, corrected.crackle));
+                            });
+    }
+
+    template <typename T>
+    void HERMITE_ENGINE_BASE<T>::get_engine_values(const BODIES &bodies, size_t i_body, T *values) const
+    {
+        const CORE::XYZ_BASE<T> &jerk = bodies.jerk[i_body];
+        values[0] = static_cast<T>(bodies.bin[i_body]);
+        values[1] = jerk.x;
+        values[2] = jerk.y;
+        values[3] = jerk.z;
+    }
+
+    template <typename T>
+    void HERMITE_ENGINE_BASE<T>::set_engine_values(BODIES &bodies, size_t i_body, const T *values)
+    {
+        bodies.bin[i_body] = static_cast<int>(values[0]);
+        bodies.jerk[i_body] = {values[1], values[2], values[3]};
+    }
+
+    template class HERMITE_ENGINE_BASE<float>;
+    template class HERMITE_ENGINE_BASE<double>;
+}
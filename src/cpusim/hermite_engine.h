@@ -0,0 +1,65 @@
+#pragma once
+
+#include "time_bin_engine.h"
+
+namespace CPUSIM
+{
+    /// Direct summation with the fourth-order Hermite predictor-corrector (see CORE::hermite_correct()), on the hierarchical
+    /// block time steps of TIME_BIN_ENGINE_BASE, dt being the coarsest step, i.e., a shared dt with max_bin 0.
+    /// At each tick ending the step of some bins, all the bodies are predicted to it, and only the bodies of those bins get
+    /// their acceleration and jerk evaluated, in one pass over the predicted sources, and are corrected.
+    /// Their next bin follows the four-derivative CORE::aarseth_timestep(), the first one the acceleration and jerk only.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class HERMITE_ENGINE_BASE final : public TIME_BIN_ENGINE_BASE<T>
+    {
+    public:
+        using typename TIME_BIN_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~HERMITE_ENGINE_BASE() = default;
+
+        /// max_bin: the finest bin steps dt / 2^max_bin
+        /// eta: accuracy of the time step criterion, smaller for shorter steps
+        HERMITE_ENGINE_BASE(system_state_type system_state_ic,
+                            T dt,
+                            size_t n_thread,
+                            bool use_thread_pool,
+                            int max_bin,
+                            T eta,
+                            std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("HERMITE_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+
+    protected:
+        using typename TIME_BIN_ENGINE_BASE<T>::BODIES;
+
+        /// Every body to tick, from the beginning of its step, pos and vel staying there
+        virtual void predict(BODIES &bodies, int64_t last_tick, int64_t tick) override;
+        /// Keeps the acceleration and jerk at the beginning of the step of the active bodies for correct()
+        virtual void evaluate(BODIES &bodies) override;
+        virtual void correct(BODIES &bodies, int64_t tick) override;
+        /// The predictor needs the jerk as much as the acceleration: bin, then jerk
+        virtual size_t n_engine_value() const override { return 4; }
+        virtual void get_engine_values(const BODIES &bodies, size_t i_body, T *values) const override;
+        virtual void set_engine_values(BODIES &bodies, size_t i_body, const T *values) override;
+
+        using TIME_BIN_ENGINE_BASE<T>::block_timestep;
+        using TIME_BIN_ENGINE_BASE<T>::eta;
+        using TIME_BIN_ENGINE_BASE<T>::end_step;
+        using TIME_BIN_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        /// At the current tick
+        std::vector<CORE::POS_BASE<T>> pos_predicted_;
+        std::vector<CORE::VEL_BASE<T>> vel_predicted_;
+        /// At the beginning of the step, of the active bodies only
+        std::vector<CORE::ACC_BASE<T>> acc_begin_;
+        std::vector<CORE::XYZ_BASE<T>> jerk_begin_;
+    };
+
+    /// Use this type
+    using HERMITE_ENGINE = HERMITE_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class HERMITE_ENGINE_BASE<float>;
+    extern template class HERMITE_ENGINE_BASE<double>;
+}
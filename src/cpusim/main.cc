@@ -1,15 +1,28 @@
+#include <algorithm>
+#include <csignal>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <type_traits>
 
 #include "core/macros.hpp"
 #include "core/serde.h"
+#include "core/checkpoint.h"
 #include "core/engine.h"
+#include "core/integrator.h"
 #include "core/timer.h"
 #include "core/cxxopts.hpp"
 #include "core/utility.hpp"
 #include "basic_engine.h"
 #include "shared_acc_engine.h"
+#include "simd_engine.h"
+#include "tiled_engine.h"
+#include "barnes_hut_engine.h"
+#include "fmm_engine.h"
+#include "pm_engine.h"
+#include "spmd_engine.h"
+#include "block_timestep_engine.h"
+#include "hermite_engine.h"
 #include "reference.h"
 
 namespace
@@ -17,7 +30,15 @@ namespace
     enum class VERSION
     {
         BASIC = 0,
-        SHARED_ACC
+        SHARED_ACC,
+        SIMD,
+        TILED,
+        BARNES_HUT,
+        FMM,
+        PM,
+        SPMD,
+        BLOCK_TIMESTEP,
+        HERMITE
     };
 }
 
@@ -31,15 +52,37 @@ auto parse_args(int argc, const char *argv[])
         .allow_unrecognised_options();
 
     auto option_group = options.add_options();
-    option_group("i,ic_file", "ic_file: .bin or .csv", cxxopts::value<std::string>());
+    option_group("i,ic_file", "ic_file: .bin, .csv, .traj, TIPSY or GADGET-2", cxxopts::value<std::string>());
     option_group("b,num_bodies", "max_n_bodies: optional (default -1), no effect if < 0 or >= n_body from ic_file", cxxopts::value<int>()->default_value("-1"));
-    option_group("d,dt", "dt", cxxopts::value<CORE::UNIVERSE::floating_value_type>());
+    option_group("subsample", "keep one body out of every subsample bodies of ic_file, before max_n_bodies: optional (default 1)", cxxopts::value<int>()->default_value("1"));
+    option_group("ic_body_types", "particle types of a TIPSY or GADGET-2 ic_file to keep, e.g. 1,2 (TIPSY: 0 gas, 1 dark, 2 star, GADGET-2: 0 to 5): optional (default all)", cxxopts::value<std::vector<int>>());
+    option_group("d,dt", "dt", cxxopts::value<double>());
     option_group("n,num_iterations", "num_iterations", cxxopts::value<int>());
+    option_group("precision", "floating type of the simulation, float or double: optional (default float)", cxxopts::value<std::string>()->default_value("float"));
     option_group("t,num_threads", "num_threads for CPU", cxxopts::value<int>()->default_value("1"));
     option_group("thread_pool", "use thread pool for multithreading: optional (default off)");
-    option_group("V,version", "version of optimization (0 - basic, 1 - shared acc edge): optional (default 1)",
+    option_group("V,version", "version of optimization (0 - basic, 1 - shared acc edge, 2 - simd, 3 - tiled, 4 - barnes hut, 5 - fmm, 6 - pm, 7 - spmd, 8 - block time steps, 9 - hermite): optional (default 1)",
                  cxxopts::value<int>()->default_value(std::to_string(static_cast<int>(VERSION::SHARED_ACC))));
+    option_group("tile_i", "number of target bodies per tile for tiled version", cxxopts::value<int>()->default_value("64"));
+    option_group("tile_j", "number of source bodies per tile for tiled version", cxxopts::value<int>()->default_value("1024"));
+    option_group("accumulation", "force accumulation for simd, tiled and spmd versions, float, double or kahan: optional (default float)", cxxopts::value<std::string>()->default_value("float"));
+    option_group("theta", "opening angle for tree versions, 0 for exact: optional (default 0.5)", cxxopts::value<CORE::UNIVERSE::floating_value_type>()->default_value("0.5"));
+    option_group("leaf_capacity", "max number of bodies per tree leaf: optional (default 8)", cxxopts::value<int>()->default_value("8"));
+    option_group("fmm_order", "expansion order p for fmm version: optional (default 4)", cxxopts::value<int>()->default_value("4"));
+    option_group("pm_grid", "mesh cells per axis for pm version, a power of two: optional (default 64)", cxxopts::value<int>()->default_value("64"));
+    option_group("pm_assignment", "mass assignment for pm version, cic or tsc: optional (default tsc)", cxxopts::value<std::string>()->default_value("tsc"));
+    option_group("pm_boundary", "boundary for pm version, isolated or periodic: optional (default isolated)", cxxopts::value<std::string>()->default_value("isolated"));
+    option_group("max_time_bin", "finest time bin for block time steps and hermite versions, stepping dt / 2^max_time_bin: optional (default 6)", cxxopts::value<int>()->default_value("6"));
+    option_group("timestep_eta", "accuracy of the block time steps, the fraction by which the acceleration may change over a step (its square for hermite): optional (default 0.02)", cxxopts::value<double>()->default_value("0.02"));
+    option_group("integrator", "integrator for versions 0 to 7, kdk, dkd, forest_ruth, yoshida4, yoshida6 or pefrl: optional (default kdk)", cxxopts::value<std::string>()->default_value("kdk"));
     option_group("o,out", "system_state_log_dir: optional (default null)", cxxopts::value<std::string>());
+    option_group("log_memory_budget", "memory in MB for the system_state_log frames waiting to be written: optional (default 256)", cxxopts::value<int>()->default_value("256"));
+    option_group("log_error_bound", "max absolute error of the logged positions, compresses the log if > 0: optional (default 0)", cxxopts::value<double>()->default_value("0"));
+    option_group("log_vel_error_bound", "max absolute error of the logged velocities: optional (default log_error_bound)", cxxopts::value<double>());
+    option_group("run_chunk", "iterations per ENGINE::run(), the engine continuing from one to the next as if run at once: optional (default 0, all at once)", cxxopts::value<int>()->default_value("0"));
+    option_group("checkpoint", "checkpoint_file: written every checkpoint_interval iterations, on SIGUSR1, and on SIGTERM before stopping: optional (default null)", cxxopts::value<std::string>());
+    option_group("checkpoint_interval", "iterations between checkpoints, 0 for signals only: optional (default 0)", cxxopts::value<int>()->default_value("0"));
+    option_group("resume", "checkpoint_file to continue from instead of ic_file, up to num_iterations since the ic: optional (default null)", cxxopts::value<std::string>());
     option_group("snapshot", "only dump out the final view, combined with --out: optional (default false)");
     option_group("verify", "verify 1 iteration result with reference algorithm: optional (default off)");
     option_group("v,verbose", "verbosity: can stack, optional (default off)");
@@ -62,18 +105,50 @@ int main(int argc, const char *argv[])
 
     // Load args
     auto arg_result = parse_args(argc, argv);
-    const std::string ic_file_path = arg_result["ic_file"].as<std::string>();
+    const std::string ic_file_path = arg_result.count("ic_file") ? arg_result["ic_file"].as<std::string>() : std::string();
     const int max_n_body = arg_result["num_bodies"].as<int>();
-    const CORE::DT dt = arg_result["dt"].as<CORE::UNIVERSE::floating_value_type>();
+    const int subsample = arg_result["subsample"].as<int>();
+    const std::vector<int> ic_body_types = arg_result.count("ic_body_types") ? arg_result["ic_body_types"].as<std::vector<int>>() : std::vector<int>();
+    const double dt = arg_result["dt"].as<double>();
+    const std::string precision = arg_result["precision"].as<std::string>();
     const int n_iteration = arg_result["num_iterations"].as<int>();
     const int n_thread = arg_result["num_threads"].as<int>();
     const bool use_thread_pool = static_cast<bool>(arg_result.count("thread_pool"));
     const VERSION version = static_cast<VERSION>(arg_result["version"].as<int>());
+    const int tile_i = arg_result["tile_i"].as<int>();
+    const int tile_j = arg_result["tile_j"].as<int>();
+    const std::string accumulation = arg_result["accumulation"].as<std::string>();
+    const CORE::UNIVERSE::floating_value_type theta = arg_result["theta"].as<CORE::UNIVERSE::floating_value_type>();
+    const int leaf_capacity = arg_result["leaf_capacity"].as<int>();
+    const int fmm_order = arg_result["fmm_order"].as<int>();
+    const int pm_grid = arg_result["pm_grid"].as<int>();
+    const std::string pm_assignment = arg_result["pm_assignment"].as<std::string>();
+    const std::string pm_boundary = arg_result["pm_boundary"].as<std::string>();
+    const int max_time_bin = arg_result["max_time_bin"].as<int>();
+    const double timestep_eta = arg_result["timestep_eta"].as<double>();
+    const std::string integrator_name = arg_result["integrator"].as<std::string>();
     std::optional<std::string> system_state_log_dir_opt = {};
     if (arg_result.count("out"))
     {
         system_state_log_dir_opt = arg_result["out"].as<std::string>();
     }
+    const int log_memory_budget = arg_result["log_memory_budget"].as<int>();
+    CORE::TRAJECTORY::COMPRESSION log_compression;
+    log_compression.pos_error_bound = arg_result["log_error_bound"].as<double>();
+    log_compression.vel_error_bound = arg_result.count("log_vel_error_bound") ? arg_result["log_vel_error_bound"].as<double>()
+                                                                               : log_compression.pos_error_bound;
+    const int run_chunk = arg_result["run_chunk"].as<int>();
+    std::optional<std::string> checkpoint_file_path_opt = {};
+    if (arg_result.count("checkpoint"))
+    {
+        checkpoint_file_path_opt = arg_result["checkpoint"].as<std::string>();
+    }
+    const int checkpoint_interval = arg_result["checkpoint_interval"].as<int>();
+    std::optional<std::string> resume_file_path_opt = {};
+    if (arg_result.count("resume"))
+    {
+        resume_file_path_opt = arg_result["resume"].as<std::string>();
+    }
     const bool snapshot = static_cast<bool>(arg_result.count("snapshot"));
     const bool verify = static_cast<bool>(arg_result.count("verify"));
     const int verbosity = arg_result.count("verbose");
@@ -82,12 +157,38 @@ int main(int argc, const char *argv[])
     std::cout << "Running.." << std::endl;
     std::cout << "ic_file: " << ic_file_path << std::endl;
     std::cout << "max_n_body: " << max_n_body << std::endl;
+    std::cout << "subsample: " << subsample << std::endl;
+    std::cout << "ic_body_types:";
+    for (const int ic_body_type : ic_body_types)
+    {
+        std::cout << " " << ic_body_type;
+    }
+    std::cout << (ic_body_types.empty() ? " all" : "") << std::endl;
     std::cout << "dt: " << dt << std::endl;
+    std::cout << "precision: " << precision << std::endl;
     std::cout << "n_iteration: " << n_iteration << std::endl;
     std::cout << "n_thread: " << n_thread << std::endl;
     std::cout << "use_thread_pool: " << use_thread_pool << std::endl;
     std::cout << "version: " << static_cast<int>(version) << std::endl;
+    std::cout << "tile_i: " << tile_i << std::endl;
+    std::cout << "tile_j: " << tile_j << std::endl;
+    std::cout << "accumulation: " << accumulation << std::endl;
+    std::cout << "theta: " << theta << std::endl;
+    std::cout << "leaf_capacity: " << leaf_capacity << std::endl;
+    std::cout << "fmm_order: " << fmm_order << std::endl;
+    std::cout << "pm_grid: " << pm_grid << std::endl;
+    std::cout << "pm_assignment: " << pm_assignment << std::endl;
+    std::cout << "pm_boundary: " << pm_boundary << std::endl;
+    std::cout << "max_time_bin: " << max_time_bin << std::endl;
+    std::cout << "timestep_eta: " << timestep_eta << std::endl;
+    std::cout << "integrator: " << integrator_name << std::endl;
     std::cout << "system_state_log_dir: " << (system_state_log_dir_opt ? *system_state_log_dir_opt : std::string("null")) << std::endl;
+    std::cout << "log_memory_budget: " << log_memory_budget << std::endl;
+    std::cout << "log_error_bound: " << log_compression.pos_error_bound << ", " << log_compression.vel_error_bound << std::endl;
+    std::cout << "run_chunk: " << run_chunk << std::endl;
+    std::cout << "checkpoint_file: " << (checkpoint_file_path_opt ? *checkpoint_file_path_opt : std::string("null")) << std::endl;
+    std::cout << "checkpoint_interval: " << checkpoint_interval << std::endl;
+    std::cout << "resume_file: " << (resume_file_path_opt ? *resume_file_path_opt : std::string("null")) << std::endl;
     std::cout << "snapshot: " << snapshot << std::endl;
     std::cout << "verify: " << verify << std::endl;
     std::cout << "verbosity: " << verbosity << std::endl;
@@ -103,61 +204,299 @@ int main(int argc, const char *argv[])
         std::cout << "--------------------" << std::endl;
     }
 
-    // Load ic
-    CORE::SYSTEM_STATE
-        system_state_ic = CORE::deserialize_system_state_from_file(ic_file_path);
-    if (max_n_body >= 0 && max_n_body < static_cast<int>(system_state_ic.size()))
+    if (precision != "float" && precision != "double")
     {
-        system_state_ic.resize(max_n_body);
-        std::cout << "Limiting number of bodies to " << max_n_body << std::endl;
+        std::cout << "INVALID PRECISION: " << precision << ", available: float/double" << std::endl;
+        exit(1);
     }
-    timer.elapsed_previous("loading_ic");
 
-    // Select engine here
-    const std::optional<std::string> system_state_engine_log_dir_opt = snapshot ? std::nullopt : system_state_log_dir_opt;
-    std::unique_ptr<CORE::ENGINE> engine;
-    if (version == VERSION::SHARED_ACC)
+    if (subsample < 1)
     {
-        engine.reset(new CPUSIM::SHARED_ACC_ENGINE(
-            system_state_ic, dt, n_thread, use_thread_pool, system_state_engine_log_dir_opt));
+        std::cout << "INVALID SUBSAMPLE: " << subsample << ", must be at least 1" << std::endl;
+        exit(1);
     }
-    else
+
+    for (const int ic_body_type : ic_body_types)
+    {
+        if (ic_body_type < 0 || ic_body_type >= 32)
+        {
+            std::cout << "INVALID IC BODY TYPE: " << ic_body_type << ", must be in [0, 32)" << std::endl;
+            exit(1);
+        }
+    }
+
+    if (ic_file_path.empty() && !resume_file_path_opt)
+    {
+        std::cout << "MISSING IC: either ic_file or resume is needed" << std::endl;
+        exit(1);
+    }
+
+    if (checkpoint_interval < 0)
     {
-        engine.reset(new CPUSIM::BASIC_ENGINE(
-            system_state_ic, dt, n_thread, use_thread_pool, system_state_engine_log_dir_opt));
+        std::cout << "INVALID CHECKPOINT INTERVAL: " << checkpoint_interval << ", must be at least 0" << std::endl;
+        exit(1);
     }
-    timer.elapsed_previous("initializing_engine");
 
-    // Execute engine
-    const CORE::SYSTEM_STATE &actual_system_state_result = engine->run(n_iteration);
-    timer.elapsed_previous("running_engine");
+    if ((version == VERSION::BLOCK_TIMESTEP || version == VERSION::HERMITE) && (max_time_bin < 0 || max_time_bin > CORE::BLOCK_TIMESTEP::max_max_bin || !(timestep_eta > 0)))
+    {
+        std::cout << "INVALID BLOCK TIME STEPS: " << max_time_bin << ", " << timestep_eta
+                  << ", max_time_bin must be in [0, " << CORE::BLOCK_TIMESTEP::max_max_bin << "] and timestep_eta above 0" << std::endl;
+        exit(1);
+    }
 
-    if (snapshot && system_state_log_dir_opt)
+    if (version == VERSION::FMM && (fmm_order < 0 || fmm_order > CPUSIM::CARTESIAN_EXPANSION::max_order))
     {
-        const std::string delim = "/";
-        const std::string snapshot_filename =
-            *system_state_log_dir_opt + delim + CORE::remove_extension(CORE::base_name(ic_file_path)) +
-            "_" + std::to_string(static_cast<size_t>(dt * n_iteration)) + ".bin";
-        CORE::serialize_system_state_to_bin(snapshot_filename, actual_system_state_result, true);
+        std::cout << "INVALID FMM ORDER: " << fmm_order << ", must be in [0, " << CPUSIM::CARTESIAN_EXPANSION::max_order << "]" << std::endl;
+        exit(1);
     }
 
-    if (verify)
+    if (version == VERSION::PM && (pm_grid < static_cast<int>(CPUSIM::PM_ENGINE::min_grid_size) || (pm_grid & (pm_grid - 1)) != 0))
     {
-        std::cout << "====================" << std::endl;
-        std::cout << "VERIFYING.." << std::endl;
-        const bool result = CPUSIM::run_verify_with_reference_engine(system_state_ic, actual_system_state_result, dt, n_iteration);
-        std::cout << "VERFICATION RESULT:" << std::endl;
-        if (result)
+        std::cout << "INVALID PM SETTING: " << pm_grid << ", pm_grid must be a power of two, at least " << CPUSIM::PM_ENGINE::min_grid_size << std::endl;
+        exit(1);
+    }
+
+    // Block time steps and Hermite integrate on their own
+    const std::optional<CORE::INTEGRATOR> integrator_opt = CORE::INTEGRATOR::from_name(integrator_name);
+    if (!integrator_opt || ((version == VERSION::BLOCK_TIMESTEP || version == VERSION::HERMITE) && integrator_opt->scheme() != CORE::INTEGRATOR::SCHEME::LEAPFROG_KDK))
+    {
+        std::cout << "INVALID INTEGRATOR: " << integrator_name << " for version " << static_cast<int>(version)
+                  << ", available: kdk/dkd/forest_ruth/yoshida4/yoshida6/pefrl, or kdk only for version 8 and 9" << std::endl;
+        exit(1);
+    }
+
+    if (run_chunk < 0)
+    {
+        std::cout << "INVALID RUN CHUNK: " << run_chunk << ", must be at least 0" << std::endl;
+        exit(1);
+    }
+
+    // Everything besides the engine name that the result depends on, to catch a resume with other settings
+    const std::string engine_config =
+        "n_thread=" + std::to_string(n_thread) + " tile=" + std::to_string(tile_i) + "x" + std::to_string(tile_j) +
+        " theta=" + std::to_string(theta) + " leaf_capacity=" + std::to_string(leaf_capacity) + " fmm_order=" + std::to_string(fmm_order) +
+        " pm_grid=" + std::to_string(pm_grid) + " pm_assignment=" + pm_assignment + " pm_boundary=" + pm_boundary +
+        " max_time_bin=" + std::to_string(max_time_bin) + " timestep_eta=" + std::to_string(timestep_eta) +
+        // Only if not the default, as the checkpoints before the integrators have it
+        (integrator_opt->scheme() != CORE::INTEGRATOR::SCHEME::LEAPFROG_KDK ? " integrator=" + integrator_opt->name() : std::string());
+
+    auto run = [&](auto floating_value)
+    {
+        using T = decltype(floating_value);
+
+        std::optional<CORE::CHECKPOINT_BASE<T>> checkpoint_opt;
+        CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic;
+        if (resume_file_path_opt)
         {
-            std::cout << "    SUCCESSFUL" << std::endl;
+            // The engine starts from the SYSTEM_STATE of the checkpoint, see ENGINE_BASE::resume()
+            checkpoint_opt = CORE::deserialize_checkpoint<T>(*resume_file_path_opt);
+            system_state_ic = std::move(checkpoint_opt->system_state);
+            std::cout << "Loaded " << system_state_ic.size() << " bodies at iteration " << checkpoint_opt->num_iterations << std::endl;
         }
         else
         {
-            std::cout << "    FAILED" << std::endl;
+            // Load ic, streamed so that the bodies left out are never materialized
+            CORE::INGESTION ingestion;
+            ingestion.stride = static_cast<size_t>(subsample);
+            if (!ic_body_types.empty())
+            {
+                ingestion.body_types = 0;
+                for (const int ic_body_type : ic_body_types)
+                {
+                    ingestion.body_types |= uint32_t{1} << ic_body_type;
+                }
+            }
+            if (max_n_body >= 0)
+            {
+                ingestion.max_n_body = static_cast<size_t>(max_n_body);
+            }
+            system_state_ic = CORE::deserialize_soa_system_state_from_file<T>(ic_file_path, ingestion);
+            std::cout << "Loaded " << system_state_ic.size() << " bodies" << std::endl;
         }
-        std::cout << "====================" << std::endl;
+        timer.elapsed_previous("loading_ic");
+        // The engine takes the ic over, unless verify needs it afterwards
+        auto engine_system_state_ic = [&]() -> CORE::SOA_SYSTEM_STATE_BASE<T>
+        {
+            if (verify)
+            {
+                return system_state_ic;
+            }
+            return std::move(system_state_ic);
+        };
+
+        // Select engine here
+        const std::optional<std::string> system_state_engine_log_dir_opt = snapshot ? std::nullopt : system_state_log_dir_opt;
+        std::unique_ptr<CORE::ENGINE_BASE<T>> engine;
+        CPUSIM::SIMD::ACCUMULATION simd_accumulation = CPUSIM::SIMD::ACCUMULATION::FLOAT;
+        if (version == VERSION::SIMD || version == VERSION::TILED || version == VERSION::SPMD)
+        {
+            if (accumulation == "double")
+            {
+                simd_accumulation = CPUSIM::SIMD::ACCUMULATION::DOUBLE;
+            }
+            else if (accumulation == "kahan" && CPUSIM::SIMD::is_kahan_available)
+            {
+                simd_accumulation = CPUSIM::SIMD::ACCUMULATION::KAHAN;
+            }
+            else if (accumulation != "float")
+            {
+                std::cout << "INVALID ACCUMULATION: " << accumulation << ", available: "
+                          << (CPUSIM::SIMD::is_kahan_available ? "float/double/kahan" : "float/double (no kahan under -ffast-math)") << std::endl;
+                exit(1);
+            }
+        }
+        if (version == VERSION::SHARED_ACC)
+        {
+            engine.reset(new CPUSIM::SHARED_ACC_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::BLOCK_TIMESTEP)
+        {
+            engine.reset(new CPUSIM::BLOCK_TIMESTEP_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, max_time_bin, static_cast<T>(timestep_eta), system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::HERMITE)
+        {
+            engine.reset(new CPUSIM::HERMITE_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, max_time_bin, static_cast<T>(timestep_eta), system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::SIMD)
+        {
+            engine.reset(new CPUSIM::SIMD_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, simd_accumulation, system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::SPMD)
+        {
+            engine.reset(new CPUSIM::SPMD_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, simd_accumulation, system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::TILED)
+        {
+            engine = CPUSIM::make_tiled_engine<T>(
+                tile_i, tile_j, engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, simd_accumulation, system_state_engine_log_dir_opt);
+            if (!engine)
+            {
+                std::cout << "INVALID TILE SIZE: " << tile_i << "x" << tile_j << ", available:";
+                for (const auto &[available_tile_i, available_tile_j] : CPUSIM::tiled_engine_tile_sizes())
+                {
+                    std::cout << " " << available_tile_i << "x" << available_tile_j;
+                }
+                std::cout << std::endl;
+                exit(1);
+            }
+        }
+        else if (version == VERSION::BARNES_HUT)
+        {
+            engine.reset(new CPUSIM::BARNES_HUT_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, static_cast<T>(theta), leaf_capacity, system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::FMM)
+        {
+            engine.reset(new CPUSIM::FMM_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, fmm_order, static_cast<T>(theta), leaf_capacity, system_state_engine_log_dir_opt));
+        }
+        else if (version == VERSION::PM)
+        {
+            if ((pm_assignment != "cic" && pm_assignment != "tsc") || (pm_boundary != "isolated" && pm_boundary != "periodic"))
+            {
+                std::cout << "INVALID PM SETTING: " << pm_assignment << ", " << pm_boundary
+                          << ", available: cic/tsc, isolated/periodic" << std::endl;
+                exit(1);
+            }
+            engine.reset(new CPUSIM::PM_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, pm_grid,
+                pm_assignment == "cic" ? CPUSIM::PM_ASSIGNMENT::CIC : CPUSIM::PM_ASSIGNMENT::TSC,
+                pm_boundary == "periodic" ? CPUSIM::PM_BOUNDARY::PERIODIC : CPUSIM::PM_BOUNDARY::ISOLATED,
+                system_state_engine_log_dir_opt));
+        }
+        else
+        {
+            engine.reset(new CPUSIM::BASIC_ENGINE_BASE<T>(
+                engine_system_state_ic(), static_cast<T>(dt), n_thread, use_thread_pool, system_state_engine_log_dir_opt));
+        }
+        engine->set_system_state_log_memory_budget(static_cast<size_t>(std::max(log_memory_budget, 0)) << 20);
+        engine->set_system_state_log_compression(log_compression);
+        engine->set_config(engine_config);
+        engine->set_integrator(*integrator_opt);
+        if (checkpoint_opt)
+        {
+            engine->resume(std::move(*checkpoint_opt));
+        }
+        if (checkpoint_file_path_opt)
+        {
+            engine->set_checkpoint(*checkpoint_file_path_opt, checkpoint_interval);
+            CORE::CHECKPOINT::install_signal_handlers();
+        }
+        if (engine->num_iterations() > static_cast<uint64_t>(n_iteration))
+        {
+            std::cout << "INVALID NUM_ITERATIONS: " << n_iteration << ", the checkpoint is at iteration " << engine->num_iterations() << std::endl;
+            exit(1);
+        }
+        const int n_run_iteration = n_iteration - static_cast<int>(engine->num_iterations());
+        timer.elapsed_previous("initializing_engine");
+
+        // Execute engine, in chunks of run_chunk iterations, each run() continuing from the state the previous one kept
+        int n_remaining_iteration = n_run_iteration;
+        do
+        {
+            const int n_chunk_iteration = run_chunk > 0 ? std::min(run_chunk, n_remaining_iteration) : n_remaining_iteration;
+            engine->run(n_chunk_iteration);
+            n_remaining_iteration -= n_chunk_iteration;
+        } while (n_remaining_iteration > 0 && !engine->is_stopped());
+        timer.elapsed_previous("running_engine");
+        std::cout << "Force evaluations: " << engine->num_force_evaluations() << ", "
+                  << static_cast<double>(engine->num_force_evaluations()) / std::max<double>(1, static_cast<double>(engine->system_state().size()) * n_run_iteration)
+                  << " per body per iteration" << std::endl;
+
+        if (engine->is_stopped())
+        {
+            std::cout << "Stopped at iteration " << engine->num_iterations() << ", to be continued with --resume " << *checkpoint_file_path_opt << std::endl;
+            // Closes the log
+            engine.reset();
+            // As if killed by SIGTERM
+            exit(128 + SIGTERM);
+        }
+
+        if (snapshot && system_state_log_dir_opt)
+        {
+            const std::string delim = "/";
+            const std::string snapshot_filename =
+                *system_state_log_dir_opt + delim + CORE::remove_extension(CORE::base_name(ic_file_path.empty() ? *resume_file_path_opt : ic_file_path)) +
+                "_" + std::to_string(static_cast<size_t>(static_cast<T>(dt) * n_iteration)) + ".bin";
+            const CORE::BIN::METADATA snapshot_metadata{dt, static_cast<uint64_t>(n_iteration), dt * n_iteration};
+            CORE::serialize_system_state_to_bin(snapshot_filename, engine->system_state(), true, snapshot_metadata);
+        }
+
+        if (verify)
+        {
+            std::cout << "====================" << std::endl;
+            std::cout << "VERIFYING.." << std::endl;
+            if (auto approximate_force_engine = dynamic_cast<CPUSIM::APPROXIMATE_FORCE_ENGINE_BASE<T> *>(engine.get()))
+            {
+                CPUSIM::report_force_error_with_reference_engine(system_state_ic, approximate_force_engine->compute_acceleration(system_state_ic));
+            }
+            const bool result = CPUSIM::run_verify_with_reference_engine(system_state_ic, engine->system_state(), static_cast<T>(dt), n_run_iteration, *integrator_opt);
+            std::cout << "VERFICATION RESULT:" << std::endl;
+            if (result)
+            {
+                std::cout << "    SUCCESSFUL" << std::endl;
+            }
+            else
+            {
+                std::cout << "    FAILED" << std::endl;
+            }
+            std::cout << "====================" << std::endl;
+        }
+        timer.elapsed_previous("verify");
+    };
+    if (precision == "double")
+    {
+        run(double{});
+    }
+    else
+    {
+        run(CORE::UNIVERSE::floating_value_type{});
     }
-    timer.elapsed_previous("verify");
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "octree.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace CPUSIM
+{
+    template <typename T>
+    void QUADRUPOLE_BASE<T>::reset()
+    {
+        xx = 0;
+        xy = 0;
+        xz = 0;
+        yy = 0;
+        yz = 0;
+        zz = 0;
+    }
+
+    template <typename T>
+    void QUADRUPOLE_BASE<T>::add(T m, const CORE::XYZ_BASE<T> &d)
+    {
+        const auto d_square = d.norm_square();
+        xx += m * (3 * d.x * d.x - d_square);
+        xy += m * (3 * d.x * d.y);
+        xz += m * (3 * d.x * d.z);
+        yy += m * (3 * d.y * d.y - d_square);
+        yz += m * (3 * d.y * d.z);
+        zz += m * (3 * d.z * d.z - d_square);
+    }
+
+    template <typename T>
+    CORE::XYZ_BASE<T> QUADRUPOLE_BASE<T>::multiply(const CORE::XYZ_BASE<T> &v) const
+    {
+        return {xx * v.x + xy * v.y + xz * v.z,
+                xy * v.x + yy * v.y + yz * v.z,
+                xz * v.x + yz * v.y + zz * v.z};
+    }
+
+    template <typename T>
+    bool OCTREE_NODE_BASE<T>::contains(const CORE::POS_BASE<T> &p) const
+    {
+        return std::abs(p.x - center.x) <= half_width &&
+               std::abs(p.y - center.y) <= half_width &&
+               std::abs(p.z - center.z) <= half_width;
+    }
+
+    template <typename T>
+    void OCTREE_BASE<T>::build(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+    {
+        const size_t n_body = pos.size();
+        ASSERT(mass.size() == n_body);
+        ASSERT(n_body <= std::numeric_limits<uint32_t>::max());
+
+        body_indices_.resize(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            body_indices_[i_body] = static_cast<uint32_t>(i_body);
+        }
+        scratch_indices_.resize(n_body);
+
+        // Bounding cube
+        CORE::XYZ_BASE<T> lower{0, 0, 0};
+        CORE::XYZ_BASE<T> upper{0, 0, 0};
+        if (n_body > 0)
+        {
+            lower = pos.front();
+            upper = pos.front();
+        }
+        for (const auto &p : pos)
+        {
+            lower = {std::min(lower.x, p.x), std::min(lower.y, p.y), std::min(lower.z, p.z)};
+            upper = {std::max(upper.x, p.x), std::max(upper.y, p.y), std::max(upper.z, p.z)};
+        }
+        const CORE::XYZ_BASE<T> extent = upper - lower;
+        // Slightly enlarged, so that bodies on the boundary are strictly inside
+        const auto half_width = std::max({extent.x, extent.y, extent.z, CORE::UNIVERSE::epislon_v<T>}) * static_cast<T>(0.5 * (1 + 1e-4));
+
+        nodes_.clear();
+        nodes_.reserve(2 * n_body / std::max<size_t>(leaf_capacity_, 1) + 1);
+        node_type root{};
+        root.center = {static_cast<T>(0.5) * (lower + upper)};
+        root.half_width = half_width;
+        root.parent = -1;
+        root.depth = 0;
+        root.first_child = -1;
+        root.n_child = 0;
+        root.body_begin = 0;
+        root.body_end = static_cast<uint32_t>(n_body);
+        nodes_.push_back(root);
+
+        build_node(0, pos, mass);
+    }
+
+    template <typename T>
+    void OCTREE_BASE<T>::build_node(int32_t node_id, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+    {
+        // nodes_ may reallocate while recursing, so never hold a reference across build_node()
+        const node_type node = nodes_[node_id];
+        if (node.n_body() <= leaf_capacity_ || node.depth >= max_depth)
+        {
+            compute_leaf_moments(nodes_[node_id], pos, mass);
+            return;
+        }
+
+        // Counting sort of the bodies into octants
+        auto octant_of = [&node, &pos](uint32_t i_body)
+        {
+            const auto &p = pos[i_body];
+            return (p.x > node.center.x ? 1 : 0) | (p.y > node.center.y ? 2 : 0) | (p.z > node.center.z ? 4 : 0);
+        };
+        std::array<uint32_t, 8> octant_count{};
+        for (uint32_t k = node.body_begin; k < node.body_end; k++)
+        {
+            octant_count[octant_of(body_indices_[k])]++;
+        }
+        std::array<uint32_t, 8> octant_begin{};
+        octant_begin[0] = node.body_begin;
+        for (int octant = 1; octant < 8; octant++)
+        {
+            octant_begin[octant] = octant_begin[octant - 1] + octant_count[octant - 1];
+        }
+        std::array<uint32_t, 8> octant_cursor = octant_begin;
+        for (uint32_t k = node.body_begin; k < node.body_end; k++)
+        {
+            const uint32_t i_body = body_indices_[k];
+            scratch_indices_[octant_cursor[octant_of(i_body)]++] = i_body;
+        }
+        std::copy(scratch_indices_.begin() + node.body_begin, scratch_indices_.begin() + node.body_end,
+                  body_indices_.begin() + node.body_begin);
+
+        // Allocate the non-empty children contiguously
+        const int32_t first_child = static_cast<int32_t>(nodes_.size());
+        int32_t n_child = 0;
+        const auto child_half_width = static_cast<T>(0.5) * node.half_width;
+        for (int octant = 0; octant < 8; octant++)
+        {
+            if (octant_count[octant] == 0)
+            {
+                continue;
+            }
+            node_type child{};
+            child.center = {CORE::XYZ_BASE<T>{node.center.x + ((octant & 1) ? child_half_width : -child_half_width),
+                                      node.center.y + ((octant & 2) ? child_half_width : -child_half_width),
+                                      node.center.z + ((octant & 4) ? child_half_width : -child_half_width)}};
+            child.half_width = child_half_width;
+            child.parent = node_id;
+            child.depth = node.depth + 1;
+            child.first_child = -1;
+            child.n_child = 0;
+            child.body_begin = octant_begin[octant];
+            child.body_end = octant_begin[octant] + octant_count[octant];
+            nodes_.push_back(child);
+            n_child++;
+        }
+        nodes_[node_id].first_child = first_child;
+        nodes_[node_id].n_child = n_child;
+
+        for (int32_t child_id = first_child; child_id < first_child + n_child; child_id++)
+        {
+            build_node(child_id, pos, mass);
+        }
+        compute_internal_moments(node_id);
+    }
+
+    template <typename T>
+    void OCTREE_BASE<T>::compute_leaf_moments(node_type &node, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass) const
+    {
+        node.mass = 0;
+        CORE::XYZ_BASE<T> weighted_pos{0, 0, 0};
+        for (uint32_t k = node.body_begin; k < node.body_end; k++)
+        {
+            const uint32_t i_body = body_indices_[k];
+            node.mass += mass[i_body];
+            weighted_pos += mass[i_body] * pos[i_body];
+        }
+        node.com = node.mass > 0 ? CORE::POS_BASE<T>{weighted_pos / node.mass} : node.center;
+
+        node.quadrupole.reset();
+        for (uint32_t k = node.body_begin; k < node.body_end; k++)
+        {
+            const uint32_t i_body = body_indices_[k];
+            node.quadrupole.add(mass[i_body], pos[i_body] - node.com);
+        }
+    }
+
+    template <typename T>
+    void OCTREE_BASE<T>::compute_internal_moments(int32_t node_id)
+    {
+        node_type &node = nodes_[node_id];
+        node.mass = 0;
+        CORE::XYZ_BASE<T> weighted_pos{0, 0, 0};
+        for (int32_t child_id = node.first_child; child_id < node.first_child + node.n_child; child_id++)
+        {
+            const node_type &child = nodes_[child_id];
+            node.mass += child.mass;
+            weighted_pos += child.mass * child.com;
+        }
+        node.com = node.mass > 0 ? CORE::POS_BASE<T>{weighted_pos / node.mass} : node.center;
+
+        // Parallel axis theorem
+        node.quadrupole.reset();
+        for (int32_t child_id = node.first_child; child_id < node.first_child + node.n_child; child_id++)
+        {
+            const node_type &child = nodes_[child_id];
+            node.quadrupole.xx += child.quadrupole.xx;
+            node.quadrupole.xy += child.quadrupole.xy;
+            node.quadrupole.xz += child.quadrupole.xz;
+            node.quadrupole.yy += child.quadrupole.yy;
+            node.quadrupole.yz += child.quadrupole.yz;
+            node.quadrupole.zz += child.quadrupole.zz;
+            node.quadrupole.add(child.mass, child.com - node.com);
+        }
+    }
+
+    template struct QUADRUPOLE_BASE<float>;
+    template struct QUADRUPOLE_BASE<double>;
+    template struct OCTREE_NODE_BASE<float>;
+    template struct OCTREE_NODE_BASE<double>;
+    template class OCTREE_BASE<float>;
+    template class OCTREE_BASE<double>;
+}
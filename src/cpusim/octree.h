@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "core/physics.hpp"
+
+namespace CPUSIM
+{
+    /// Symmetric traceless quadrupole moment about a center:
+    /// Sum(m * (3 * d_i * d_j - |d|^2 * delta_ij)), where d is the offset from the center
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    struct QUADRUPOLE_BASE
+    {
+        T xx;
+        T xy;
+        T xz;
+        T yy;
+        T yz;
+        T zz;
+
+        void reset();
+        /// Adds the contribution of a point mass m at offset d from the center
+        void add(T m, const CORE::XYZ_BASE<T> &d);
+        /// Q * v
+        CORE::XYZ_BASE<T> multiply(const CORE::XYZ_BASE<T> &v) const;
+    };
+
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    struct OCTREE_NODE_BASE
+    {
+        // Geometry: an axis-aligned cube
+        CORE::POS_BASE<T> center;
+        T half_width;
+        int32_t parent;
+        int32_t depth;
+
+        // Children are contiguous in OCTREE::nodes(), and only non-empty octants are kept
+        int32_t first_child; // -1 if leaf
+        int32_t n_child;
+
+        // Bodies covered: OCTREE::body_indices()[body_begin, body_end)
+        uint32_t body_begin;
+        uint32_t body_end;
+
+        // Moments
+        T mass;
+        CORE::POS_BASE<T> com; // Center of mass
+        QUADRUPOLE_BASE<T> quadrupole; // About com
+
+        bool is_leaf() const { return first_child < 0; }
+        size_t n_body() const { return body_end - body_begin; }
+        bool contains(const CORE::POS_BASE<T> &p) const;
+    };
+
+    /// Octree over a set of bodies, rebuilt from scratch by build().
+    /// A node is split until it holds at most leaf_capacity bodies (or max_depth is reached).
+    /// Node 0 is the root, and every parent comes before its children in nodes().
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class OCTREE_BASE
+    {
+    public:
+        using node_type = OCTREE_NODE_BASE<T>;
+
+        static constexpr int32_t max_depth = 32;
+
+        explicit OCTREE_BASE(size_t leaf_capacity = 8) : leaf_capacity_(leaf_capacity) {}
+
+        void build(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass);
+
+        const std::vector<node_type> &nodes() const { return nodes_; }
+        const node_type &root() const { return nodes_.front(); }
+        /// Body indices ordered such that every node covers a contiguous range
+        const std::vector<uint32_t> &body_indices() const { return body_indices_; }
+
+    private:
+        void build_node(int32_t node_id, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass);
+        void compute_leaf_moments(node_type &node, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass) const;
+        void compute_internal_moments(int32_t node_id);
+
+    private:
+        size_t leaf_capacity_;
+        std::vector<node_type> nodes_;
+        std::vector<uint32_t> body_indices_;
+        std::vector<uint32_t> scratch_indices_;
+    };
+
+    /// Use these types
+    using QUADRUPOLE = QUADRUPOLE_BASE<CORE::UNIVERSE::floating_value_type>;
+    using OCTREE_NODE = OCTREE_NODE_BASE<CORE::UNIVERSE::floating_value_type>;
+    using OCTREE = OCTREE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template struct QUADRUPOLE_BASE<float>;
+    extern template struct QUADRUPOLE_BASE<double>;
+    extern template struct OCTREE_NODE_BASE<float>;
+    extern template struct OCTREE_NODE_BASE<double>;
+    extern template class OCTREE_BASE<float>;
+    extern template class OCTREE_BASE<double>;
+}
@@ -0,0 +1,362 @@
+#include "pm_engine.h"
+#include "core/timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+namespace CPUSIM
+{
+    namespace
+    {
+        /// Cells kept empty around the bodies for ISOLATED,
+        /// so that neither the assignment stencil nor the difference stencil reaches the padding
+        constexpr int64_t isolated_margin = 3;
+
+        const char *to_string(PM_ASSIGNMENT assignment)
+        {
+            return assignment == PM_ASSIGNMENT::CIC ? "CIC" : "TSC";
+        }
+
+        const char *to_string(PM_BOUNDARY boundary)
+        {
+            return boundary == PM_BOUNDARY::PERIODIC ? "PERIODIC" : "ISOLATED";
+        }
+
+        /// Bounding cube of the bodies: (lower corner, width)
+        template <typename T>
+        std::pair<CORE::XYZ_BASE<double>, double> bounding_cube(const std::vector<CORE::POS_BASE<T>> &pos)
+        {
+            CORE::XYZ_BASE<double> lower{0, 0, 0};
+            CORE::XYZ_BASE<double> upper{0, 0, 0};
+            if (!pos.empty())
+            {
+                lower = {pos.front().x, pos.front().y, pos.front().z};
+                upper = lower;
+            }
+            for (const auto &p : pos)
+            {
+                lower = {std::min<double>(lower.x, p.x), std::min<double>(lower.y, p.y), std::min<double>(lower.z, p.z)};
+                upper = {std::max<double>(upper.x, p.x), std::max<double>(upper.y, p.y), std::max<double>(upper.z, p.z)};
+            }
+            const auto extent = upper - lower;
+            return {lower, std::max({extent.x, extent.y, extent.z, static_cast<double>(CORE::UNIVERSE::epislon_v<T>)})};
+        }
+    }
+
+    template <typename T>
+    PM_ENGINE_BASE<T>::PM_ENGINE_BASE(system_state_type system_state_ic,
+                                      T dt,
+                                      size_t n_thread,
+                                      bool use_thread_pool,
+                                      size_t grid_size,
+                                      PM_ASSIGNMENT assignment,
+                                      PM_BOUNDARY boundary,
+                                      std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt)),
+          grid_size_(grid_size),
+          assignment_(assignment),
+          boundary_(boundary),
+          lower_{0, 0, 0},
+          cell_width_(1),
+          fft_(boundary == PM_BOUNDARY::ISOLATED ? 2 * grid_size : grid_size, n_thread)
+    {
+        static_assert(min_grid_size >= 2 * isolated_margin + 2, "min_grid_size must leave room for isolated_margin");
+        ASSERT(grid_size_ >= min_grid_size && (grid_size_ & (grid_size_ - 1)) == 0);
+        std::cout << "Using " << grid_size_ << "^3 mesh with " << to_string(assignment_) << " assignment and "
+                  << to_string(boundary_) << " boundary" << std::endl;
+
+        const size_t n = fft_.n();
+        green_.assign(fft_.size(), 0);
+        if (boundary_ == PM_BOUNDARY::PERIODIC)
+        {
+            // The box is fixed to the bounding cube of the ic, and bodies leaving it wrap around
+            std::vector<CORE::POS_BASE<T>> pos_ic;
+            pos_ic.reserve(system_state_snapshot().size());
+            for (size_t i_body = 0; i_body < system_state_snapshot().size(); i_body++)
+            {
+                pos_ic.push_back(system_state_snapshot().pos(i_body));
+            }
+            const auto [lower, width] = bounding_cube(pos_ic);
+            cell_width_ = width * (1 + 1e-4) / grid_size_;
+            lower_ = lower;
+
+            // -4 pi / |k|^2, with k in units of 1 / cell_width
+            const value_type pi = std::acos(static_cast<value_type>(-1));
+            auto wave_number = [n, pi](size_t i)
+            {
+                const auto signed_i = static_cast<int64_t>(i) - (i < n / 2 ? 0 : static_cast<int64_t>(n));
+                return 2 * pi * static_cast<value_type>(signed_i) / static_cast<value_type>(n);
+            };
+            for (size_t ix = 0; ix < n; ix++)
+            {
+                for (size_t iy = 0; iy < n; iy++)
+                {
+                    for (size_t iz = 0; iz < n; iz++)
+                    {
+                        const value_type kx = wave_number(ix);
+                        const value_type ky = wave_number(iy);
+                        const value_type kz = wave_number(iz);
+                        const value_type k_square = kx * kx + ky * ky + kz * kz;
+                        green_[(ix * n + iy) * n + iz] = k_square > 0 ? -4 * pi / k_square : 0;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // -1 / r on the padded mesh, with r in cells and the images at negative offsets;
+            // the self cell takes -1, i.e., the mesh softens gravity at about a cell width
+            std::vector<FFT_3D::complex_type> green_real(fft_.size());
+            auto offset = [n](size_t i)
+            {
+                return static_cast<value_type>(std::min(i, n - i));
+            };
+            for (size_t ix = 0; ix < n; ix++)
+            {
+                for (size_t iy = 0; iy < n; iy++)
+                {
+                    for (size_t iz = 0; iz < n; iz++)
+                    {
+                        const value_type dx = offset(ix);
+                        const value_type dy = offset(iy);
+                        const value_type dz = offset(iz);
+                        const value_type r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                        green_real[(ix * n + iy) * n + iz] = r > 0 ? -1 / r : -1;
+                    }
+                }
+            }
+            // G is real and even, so is its transform
+            fft_.forward(green_real, fft_parallel_for());
+            for (size_t i = 0; i < fft_.size(); i++)
+            {
+                green_[i] = green_real[i].real();
+            }
+        }
+
+        mesh_.resize(fft_.size());
+        mesh_acc_.resize(grid_size_ * grid_size_ * grid_size_);
+    }
+
+    template <typename T>
+    typename PM_ENGINE_BASE<T>::STENCIL PM_ENGINE_BASE<T>::make_stencil(value_type u) const
+    {
+        STENCIL stencil{};
+        if (assignment_ == PM_ASSIGNMENT::CIC)
+        {
+            const value_type u_floor = std::floor(u);
+            const value_type f = u - u_floor;
+            stencil.first = static_cast<int64_t>(u_floor);
+            stencil.n_cell = 2;
+            stencil.weights[0] = 1 - f;
+            stencil.weights[1] = f;
+        }
+        else
+        {
+            const value_type u_nearest = std::floor(u + static_cast<value_type>(0.5));
+            const value_type d = u - u_nearest;
+            stencil.first = static_cast<int64_t>(u_nearest) - 1;
+            stencil.n_cell = 3;
+            stencil.weights[0] = static_cast<value_type>(0.5) * (static_cast<value_type>(0.5) - d) * (static_cast<value_type>(0.5) - d);
+            stencil.weights[1] = static_cast<value_type>(0.75) - d * d;
+            stencil.weights[2] = static_cast<value_type>(0.5) * (static_cast<value_type>(0.5) + d) * (static_cast<value_type>(0.5) + d);
+        }
+        return stencil;
+    }
+
+    template <typename T>
+    CORE::XYZ_BASE<typename PM_ENGINE_BASE<T>::value_type> PM_ENGINE_BASE<T>::to_mesh(const CORE::POS_BASE<T> &p) const
+    {
+        return {(p.x - lower_.x) / cell_width_, (p.y - lower_.y) / cell_width_, (p.z - lower_.z) / cell_width_};
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::update_geometry(const std::vector<CORE::POS_BASE<T>> &pos)
+    {
+        if (boundary_ == PM_BOUNDARY::ISOLATED)
+        {
+            // Bodies occupy cells [isolated_margin, grid_size_ - 1 - isolated_margin]
+            const auto [lower, width] = bounding_cube(pos);
+            cell_width_ = width / static_cast<value_type>(grid_size_ - 1 - 2 * isolated_margin);
+            const value_type margin_width = isolated_margin * cell_width_;
+            lower_ = {lower.x - margin_width, lower.y - margin_width, lower.z - margin_width};
+        }
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::deposit(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+    {
+        // A body whose stencil begins in a slab of n_cell - 1 x-cells only reaches the next slab,
+        // so the slabs of the same parity take their bodies in parallel without sharing a cell
+        const int64_t slab_width = assignment_ == PM_ASSIGNMENT::CIC ? 1 : 2;
+        const size_t n_slab = grid_size_ / slab_width;
+        const auto mask = static_cast<int64_t>(grid_size_ - 1);
+        const size_t n_body = pos.size();
+
+        // Bodies by slab, in their order within each, so that the sums do not depend on the threads
+        body_slabs_.resize(n_body);
+        slab_bodies_.resize(n_body);
+        parallel_for_helper(0, n_body,
+                            [&pos, slab_width, mask, this](size_t i_body)
+                            {
+                                const int64_t first_x = make_stencil(to_mesh(pos[i_body]).x).first & mask;
+                                body_slabs_[i_body] = static_cast<uint32_t>(first_x / slab_width);
+                            });
+        slab_offsets_.assign(n_slab + 1, 0);
+        for (const uint32_t i_slab : body_slabs_)
+        {
+            slab_offsets_[i_slab + 1]++;
+        }
+        std::partial_sum(slab_offsets_.begin(), slab_offsets_.end(), slab_offsets_.begin());
+        std::vector<size_t> slab_ends(slab_offsets_.begin(), slab_offsets_.end() - 1);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            slab_bodies_[slab_ends[body_slabs_[i_body]]++] = static_cast<uint32_t>(i_body);
+        }
+
+        // Straight into the (possibly padded) FFT mesh, wrapping around the unpadded one
+        const size_t n = fft_.n();
+        std::fill(mesh_.begin(), mesh_.end(), FFT_3D::complex_type{0, 0});
+        for (size_t parity = 0; parity < 2; parity++)
+        {
+            parallel_for_helper(0, n_slab / 2,
+                                [&pos, &mass, parity, mask, n, this](size_t i_pair)
+                                {
+                                    const size_t i_slab = 2 * i_pair + parity;
+                                    for (size_t k = slab_offsets_[i_slab]; k < slab_offsets_[i_slab + 1]; k++)
+                                    {
+                                        const uint32_t i_body = slab_bodies_[k];
+                                        const auto u = to_mesh(pos[i_body]);
+                                        const STENCIL sx = make_stencil(u.x);
+                                        const STENCIL sy = make_stencil(u.y);
+                                        const STENCIL sz = make_stencil(u.z);
+                                        for (int a = 0; a < sx.n_cell; a++)
+                                        {
+                                            for (int b = 0; b < sy.n_cell; b++)
+                                            {
+                                                const value_type w_xy = mass[i_body] * sx.weights[a] * sy.weights[b];
+                                                const size_t i_line = ((sx.first + a) & mask) * n + ((sy.first + b) & mask);
+                                                for (int c = 0; c < sz.n_cell; c++)
+                                                {
+                                                    mesh_[i_line * n + ((sz.first + c) & mask)] += w_xy * sz.weights[c];
+                                                }
+                                            }
+                                        }
+                                    }
+                                });
+        }
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::solve_potential()
+    {
+        fft_.forward(mesh_, fft_parallel_for());
+        const size_t n = fft_.n();
+        parallel_for_helper(0, n * n,
+                            [n, this](size_t i_line)
+                            {
+                                for (size_t i = i_line * n; i < (i_line + 1) * n; i++)
+                                {
+                                    mesh_[i] *= green_[i];
+                                }
+                            });
+        fft_.inverse(mesh_, fft_parallel_for());
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::differentiate()
+    {
+        // mesh_ holds phi for a unit cell width, and phi scales as 1 / cell_width_,
+        // so a = -grad(phi) picks up 1 / cell_width_^2
+        const size_t n = fft_.n();
+        const value_type scale = -1 / (12 * cell_width_ * cell_width_);
+        parallel_for_helper(0, grid_size_ * grid_size_,
+                            [n, scale, this](size_t i_line)
+                            {
+                                const auto ix = static_cast<int64_t>(i_line / grid_size_);
+                                const auto iy = static_cast<int64_t>(i_line % grid_size_);
+                                auto phi = [n, this](int64_t jx, int64_t jy, int64_t jz)
+                                {
+                                    return mesh_[cell_index(jx, jy, jz, n)].real();
+                                };
+                                for (int64_t iz = 0; iz < static_cast<int64_t>(grid_size_); iz++)
+                                {
+                                    // (-f(i + 2) + 8 f(i + 1) - 8 f(i - 1) + f(i - 2)) / 12
+                                    const value_type dx = -phi(ix + 2, iy, iz) + 8 * phi(ix + 1, iy, iz) - 8 * phi(ix - 1, iy, iz) + phi(ix - 2, iy, iz);
+                                    const value_type dy = -phi(ix, iy + 2, iz) + 8 * phi(ix, iy + 1, iz) - 8 * phi(ix, iy - 1, iz) + phi(ix, iy - 2, iz);
+                                    const value_type dz = -phi(ix, iy, iz + 2) + 8 * phi(ix, iy, iz + 1) - 8 * phi(ix, iy, iz - 1) + phi(ix, iy, iz - 2);
+                                    mesh_acc_[cell_index(ix, iy, iz, grid_size_)] = {scale * dx, scale * dy, scale * dz};
+                                }
+                            });
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::interpolate(std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos)
+    {
+        parallel_for_helper(0, pos.size(),
+                            [&acc, &pos, this](size_t i_body)
+                            {
+                                const auto u = to_mesh(pos[i_body]);
+                                const STENCIL sx = make_stencil(u.x);
+                                const STENCIL sy = make_stencil(u.y);
+                                const STENCIL sz = make_stencil(u.z);
+                                CORE::XYZ_BASE<value_type> a{0, 0, 0};
+                                for (int i = 0; i < sx.n_cell; i++)
+                                {
+                                    for (int j = 0; j < sy.n_cell; j++)
+                                    {
+                                        for (int k = 0; k < sz.n_cell; k++)
+                                        {
+                                            a += (sx.weights[i] * sy.weights[j] * sz.weights[k]) *
+                                                 mesh_acc_[cell_index(sx.first + i, sy.first + j, sz.first + k, grid_size_)];
+                                        }
+                                    }
+                                }
+                                acc[i_body] = {CORE::XYZ_BASE<T>{static_cast<T>(a.x), static_cast<T>(a.y), static_cast<T>(a.z)}};
+                            });
+    }
+
+    template <typename T>
+    void PM_ENGINE_BASE<T>::compute_pm_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                                    const std::vector<CORE::POS_BASE<T>> &pos,
+                                                    const std::vector<T> &mass)
+    {
+        if (pos.empty())
+        {
+            return;
+        }
+        update_geometry(pos);
+        deposit(pos, mass);
+        solve_potential();
+        differentiate();
+        interpolate(acc, pos);
+    }
+
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> PM_ENGINE_BASE<T>::compute_acceleration(const system_state_type &system_state)
+    {
+        const size_t n_body = system_state.size();
+        std::vector<CORE::POS_BASE<T>> pos(n_body);
+        std::vector<T> mass(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            pos[i_body] = system_state.pos(i_body);
+            mass[i_body] = system_state.mass()[i_body];
+        }
+        std::vector<CORE::ACC_BASE<T>> acc(n_body);
+        compute_pm_acceleration(acc, pos, mass);
+        return acc;
+    }
+
+    template <typename T>
+    std::optional<typename PM_ENGINE_BASE<T>::system_state_type> PM_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        return execute_integrator(n_iter, timer,
+                                  [this](std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+                                  { compute_pm_acceleration(acc, pos, mass); });
+    }
+
+    template class PM_ENGINE_BASE<float>;
+    template class PM_ENGINE_BASE<double>;
+}
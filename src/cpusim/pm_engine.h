@@ -0,0 +1,123 @@
+#pragma once
+
+#include "basic_engine.h"
+#include "fft.h"
+#include "reference.h"
+
+namespace CPUSIM
+{
+    /// Mass assignment scheme, i.e., how a body is spread over the mesh cells
+    enum class PM_ASSIGNMENT
+    {
+        CIC, // Cloud-in-cell: 2 cells per axis, linear weights
+        TSC  // Triangular-shaped cloud: 3 cells per axis, quadratic weights
+    };
+
+    enum class PM_BOUNDARY
+    {
+        PERIODIC, // The bounding cube of the ic, repeated infinitely
+        ISOLATED  // Vacuum boundary, by zero-padding the mesh to twice its size (Hockney-Eastwood)
+    };
+
+    /// O(N + M log M) particle-mesh solver, with M = grid_size^3 mesh cells.
+    /// Every step:
+    /// 1. Deposits the mass of the bodies onto the mesh, slab by slab of x-cells, the bodies being sorted by slab,
+    ///    so that the threads never write the same cell and the memory stays that of the mesh
+    /// 2. Solves Poisson's equation by FFT:
+    ///    - PERIODIC: phi_k = -4 pi rho_k / |k|^2, with the mean density removed
+    ///    - ISOLATED: phi = rho * G, with G = -1 / r on the padded mesh, transformed once at construction
+    /// 3. Differentiates phi on the mesh with a 4-point central difference
+    /// 4. Interpolates the mesh accelerations back to the bodies, with the same assignment scheme
+    /// Forces below a few cells are smoothed out, so the mesh resolves the long-range field only.
+    /// The mesh is in FFT_3D::value_type, i.e., double, whatever T is.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class PM_ENGINE_BASE final : public BASIC_ENGINE_BASE<T>, public APPROXIMATE_FORCE_ENGINE_BASE<T>
+    {
+    public:
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+        using value_type = FFT_3D::value_type;
+
+        /// grid_size must be a power of two, at least this to keep the ISOLATED margin around the bodies
+        static constexpr size_t min_grid_size = 8;
+
+        virtual ~PM_ENGINE_BASE() = default;
+
+        PM_ENGINE_BASE(system_state_type system_state_ic,
+                       T dt,
+                       size_t n_thread,
+                       bool use_thread_pool,
+                       size_t grid_size,
+                       PM_ASSIGNMENT assignment,
+                       PM_BOUNDARY boundary,
+                       std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override { return std::string("PM_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+
+        virtual std::vector<CORE::ACC_BASE<T>> compute_acceleration(const system_state_type &system_state) override;
+
+    private:
+        /// Weights of a body at mesh coordinate u along one axis:
+        /// cell (first + i) gets weights[i], for i < n_cell
+        struct STENCIL
+        {
+            int64_t first;
+            int n_cell;
+            value_type weights[3];
+        };
+        STENCIL make_stencil(value_type u) const;
+
+        void compute_pm_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                     const std::vector<CORE::POS_BASE<T>> &pos,
+                                     const std::vector<T> &mass);
+
+        void update_geometry(const std::vector<CORE::POS_BASE<T>> &pos);
+        void deposit(const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass);
+        void solve_potential();
+        void differentiate();
+        void interpolate(std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos);
+
+        /// Index into a mesh of n^3 cells, wrapping around periodically
+        static size_t cell_index(int64_t ix, int64_t iy, int64_t iz, size_t n)
+        {
+            const auto mask = static_cast<int64_t>(n - 1);
+            return ((ix & mask) * n + (iy & mask)) * n + (iz & mask);
+        }
+        CORE::XYZ_BASE<value_type> to_mesh(const CORE::POS_BASE<T> &p) const;
+
+        /// ParallelFor for FFT_3D
+        auto fft_parallel_for()
+        {
+            return [this](size_t begin, size_t end, auto &&f)
+            { parallel_for_helper(begin, end, f); };
+        }
+
+        using BASIC_ENGINE_BASE<T>::system_state_snapshot;
+        using BASIC_ENGINE_BASE<T>::execute_integrator;
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        size_t grid_size_;
+        PM_ASSIGNMENT assignment_;
+        PM_BOUNDARY boundary_;
+
+        // Cell i is centered at lower_ + i * cell_width_
+        CORE::XYZ_BASE<value_type> lower_;
+        value_type cell_width_;
+
+        FFT_3D fft_; // grid_size_, or 2 * grid_size_ if ISOLATED
+        std::vector<value_type> green_; // Green's function in Fourier space, for a unit cell width
+        std::vector<FFT_3D::complex_type> mesh_; // Mass, then potential
+        std::vector<uint32_t> body_slabs_; // Slab of every body
+        std::vector<uint32_t> slab_bodies_; // Bodies sorted by slab, slab i being [slab_offsets_[i], slab_offsets_[i + 1])
+        std::vector<size_t> slab_offsets_;
+        std::vector<CORE::XYZ_BASE<value_type>> mesh_acc_; // grid_size_^3
+    };
+
+    /// Use this type
+    using PM_ENGINE = PM_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class PM_ENGINE_BASE<float>;
+    extern template class PM_ENGINE_BASE<double>;
+}
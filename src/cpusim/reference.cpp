@@ -1,12 +1,90 @@
 #include "reference.h"
 #include "basic_engine.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
 namespace CPUSIM
 {
-    bool run_verify_with_reference_engine(CORE::SYSTEM_STATE system_state_ic, const CORE::SYSTEM_STATE &actual_system_state_result, CORE::DT dt, int num_iteration)
+    template <typename T>
+    bool run_verify_with_reference_engine(CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic, const CORE::SOA_SYSTEM_STATE_BASE<T> &actual_system_state_result, T dt, int num_iteration, const CORE::INTEGRATOR &integrator)
     {
-        BASIC_ENGINE basic_engine(std::move(system_state_ic), dt, 1, false);
-        const CORE::SYSTEM_STATE &reference_system_state_result = basic_engine.run(num_iteration);
+        BASIC_ENGINE_BASE<T> basic_engine(std::move(system_state_ic), dt, 1, false);
+        basic_engine.set_integrator(integrator);
+        basic_engine.run(num_iteration);
+        const CORE::SOA_SYSTEM_STATE_BASE<T> &reference_system_state_result = basic_engine.system_state();
         return CORE::verify(reference_system_state_result, actual_system_state_result);
     }
-}
\ No newline at end of file
+
+    template bool run_verify_with_reference_engine(CORE::SOA_SYSTEM_STATE_BASE<float>, const CORE::SOA_SYSTEM_STATE_BASE<float> &, float, int, const CORE::INTEGRATOR &);
+    template bool run_verify_with_reference_engine(CORE::SOA_SYSTEM_STATE_BASE<double>, const CORE::SOA_SYSTEM_STATE_BASE<double> &, double, int, const CORE::INTEGRATOR &);
+
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> compute_reference_acceleration(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state)
+    {
+        using XYZ_DOUBLE = CORE::XYZ_BASE<double>;
+        auto to_double = [](const CORE::XYZ_BASE<T> &xyz) -> XYZ_DOUBLE
+        { return {xyz.x, xyz.y, xyz.z}; };
+
+        const size_t n_body = system_state.size();
+        std::vector<CORE::ACC_BASE<T>> acc(n_body);
+        for (size_t i_target_body = 0; i_target_body < n_body; i_target_body++)
+        {
+            const XYZ_DOUBLE p_target = to_double(system_state.pos(i_target_body));
+            XYZ_DOUBLE a{0, 0, 0};
+            for (size_t j_source_body = 0; j_source_body < n_body; j_source_body++)
+            {
+                if (i_target_body != j_source_body)
+                {
+                    const XYZ_DOUBLE displacement = to_double(system_state.pos(j_source_body)) - p_target;
+                    const double denom_base = displacement.norm_square() + CORE::UNIVERSE::epislon_square_v<T>;
+                    a += (system_state.mass()[j_source_body] / (denom_base * std::sqrt(denom_base))) * displacement;
+                }
+            }
+            acc[i_target_body] = {CORE::XYZ_BASE<T>{static_cast<T>(a.x), static_cast<T>(a.y), static_cast<T>(a.z)}};
+        }
+        return acc;
+    }
+
+    template <typename T>
+    double report_force_error_with_reference_engine(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, const std::vector<CORE::ACC_BASE<T>> &actual_acc)
+    {
+        ASSERT(system_state.size() == actual_acc.size());
+        const std::vector<CORE::ACC_BASE<T>> expected_acc = compute_reference_acceleration(system_state);
+        const size_t n_body = expected_acc.size();
+
+        std::vector<double> relative_errors(n_body, 0);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            const double err_square = (actual_acc[i_body] - expected_acc[i_body]).norm_square();
+            const double ref_square = expected_acc[i_body].norm_square();
+            relative_errors[i_body] = ref_square > 0 ? std::sqrt(err_square / ref_square) : std::sqrt(err_square);
+        }
+
+        double sum = 0;
+        double sum_square = 0;
+        for (double err : relative_errors)
+        {
+            sum += err;
+            sum_square += err * err;
+        }
+        const double mean = n_body > 0 ? sum / n_body : 0;
+        const double rms = n_body > 0 ? std::sqrt(sum_square / n_body) : 0;
+        std::sort(relative_errors.begin(), relative_errors.end());
+        const double p99 = n_body > 0 ? relative_errors[std::min(n_body - 1, n_body * 99 / 100)] : 0;
+        const double max = n_body > 0 ? relative_errors.back() : 0;
+
+        std::cout << "Relative force error |a - a_ref| / |a_ref| over " << n_body << " bodies:" << std::endl;
+        std::cout << "    mean = " << mean << std::endl;
+        std::cout << "    rms = " << rms << std::endl;
+        std::cout << "    p99 = " << p99 << std::endl;
+        std::cout << "    max = " << max << std::endl;
+        return rms;
+    }
+
+    template std::vector<CORE::ACC_BASE<float>> compute_reference_acceleration(const CORE::SOA_SYSTEM_STATE_BASE<float> &);
+    template std::vector<CORE::ACC_BASE<double>> compute_reference_acceleration(const CORE::SOA_SYSTEM_STATE_BASE<double> &);
+    template double report_force_error_with_reference_engine(const CORE::SOA_SYSTEM_STATE_BASE<float> &, const std::vector<CORE::ACC_BASE<float>> &);
+    template double report_force_error_with_reference_engine(const CORE::SOA_SYSTEM_STATE_BASE<double> &, const std::vector<CORE::ACC_BASE<double>> &);
+}
@@ -1,9 +1,39 @@
 #pragma once
+#include <vector>
 #include "core/physics.hpp"
+#include "core/integrator.h"
 
 namespace CPUSIM
 {
     /// Verify with a reference result you can always trust on.
     /// It might be slow, but it will never lie to you.
-    bool run_verify_with_reference_engine(CORE::SYSTEM_STATE system_state_ic, const CORE::SYSTEM_STATE &actual_system_state_result, CORE::DT dt, int num_iteration);
-}
\ No newline at end of file
+    /// Instantiated for float and double, running the reference in the same precision
+    /// integrator: the one the actual run stepped with
+    template <typename T>
+    bool run_verify_with_reference_engine(CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic, const CORE::SOA_SYSTEM_STATE_BASE<T> &actual_system_state_result, T dt, int num_iteration, const CORE::INTEGRATOR &integrator);
+
+    /// Implemented by engines whose forces are approximated (e.g., tree codes),
+    /// so that their force error can be reported next to run_verify_with_reference_engine.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class APPROXIMATE_FORCE_ENGINE_BASE
+    {
+    public:
+        virtual ~APPROXIMATE_FORCE_ENGINE_BASE() = default;
+
+        /// Acceleration of every body in system_state, as evaluated by the engine
+        virtual std::vector<CORE::ACC_BASE<T>> compute_acceleration(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state) = 0;
+    };
+
+    /// Use this type
+    using APPROXIMATE_FORCE_ENGINE = APPROXIMATE_FORCE_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    /// Direct summation in double, single threaded
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> compute_reference_acceleration(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state);
+
+    /// Prints the statistics of the relative force error |a - a_ref| / |a_ref| over all the bodies
+    /// Returns the rms relative force error
+    template <typename T>
+    double report_force_error_with_reference_engine(const CORE::SOA_SYSTEM_STATE_BASE<T> &system_state, const std::vector<CORE::ACC_BASE<T>> &actual_acc);
+}
@@ -7,9 +7,26 @@
 
 namespace CPUSIM
 {
-    void SHARED_ACC_ENGINE::compute_acceleration(std::vector<CORE::ACC> &acc,
-                                                 const std::vector<CORE::POS> &pos,
-                                                 const std::vector<CORE::MASS> &mass)
+    template <typename T>
+    SHARED_ACC_ENGINE_BASE<T>::SHARED_ACC_ENGINE_BASE(system_state_type system_state_ic,
+                                                      T dt,
+                                                      size_t n_thread,
+                                                      bool use_thread_pool,
+                                                      std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt))
+    {
+        if (this->n_thread() != 1)
+        {
+            const size_t n_body = system_state_snapshot().size();
+            scratch_arena_.reserve(CORE::PER_THREAD_SCRATCH<CORE::ACC_BASE<T>>::footprint(this->n_thread(), n_body));
+            shared_accs_ = CORE::PER_THREAD_SCRATCH<CORE::ACC_BASE<T>>(scratch_arena_, this->n_thread(), n_body);
+        }
+    }
+
+    template <typename T>
+    void SHARED_ACC_ENGINE_BASE<T>::compute_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                                         const std::vector<CORE::POS_BASE<T>> &pos,
+                                                         const std::vector<T> &mass)
     {
         const size_t n_body = mass.size();
         ASSERT(acc.size() == n_body);
@@ -26,7 +43,7 @@ namespace CPUSIM
             {
                 for (size_t j_source_body = i_target_body + 1; j_source_body < n_body; j_source_body++)
                 {
-                    const CORE::ACC tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
+                    const CORE::ACC_BASE<T> tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
                     acc[i_target_body] += mass[j_source_body] * tgt_to_src;
                     acc[j_source_body] -= mass[i_target_body] * tgt_to_src;
                 }
@@ -34,29 +51,34 @@ namespace CPUSIM
         }
         else
         {
-            std::vector<std::vector<CORE::ACC> > shared_accs(nthread); // [thread_idx][i_body]
-            for (auto &shared_acc : shared_accs)
-            {
-                shared_acc.resize(n_body, {0, 0, 0});
-            }
+            ASSERT(shared_accs_.n_thread() == nthread && shared_accs_[0].size() == n_body);
+            const CORE::PER_THREAD_SCRATCH<CORE::ACC_BASE<T>> &shared_accs = shared_accs_;
 
-            parallel_for_helper(0, n_body, [n_body, &shared_accs, &mass, &pos](size_t i, size_t thread_id)
+            // Scratch i_block holds the pairs of the targets i_block, i_block + nthread, i_block + 2 * nthread, ...,
+            // so that the sums do not depend on which thread runs a block, and the cyclic split balances out the
+            // linearly falling cost of i_target_body
+            parallel_for_helper(0, nthread, [n_body, nthread, &shared_accs, &mass, &pos](size_t i_block)
                                 {
-                                    const size_t offset = i / 2;
-                                    const size_t i_target_body = (i % 2 == 0) ? offset : n_body - 1 - offset;
-                                    for (size_t j_source_body = i_target_body + 1; j_source_body < n_body; j_source_body++)
+                                    const CORE::SPAN<CORE::ACC_BASE<T>> shared_acc = shared_accs[i_block];
+                                    for (size_t i_target_body = i_block; i_target_body < n_body; i_target_body += nthread)
                                     {
-                                        const CORE::ACC tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
-                                        shared_accs[thread_id][i_target_body] += mass[j_source_body] * tgt_to_src;
-                                        shared_accs[thread_id][j_source_body] -= mass[i_target_body] * tgt_to_src;
+                                        for (size_t j_source_body = i_target_body + 1; j_source_body < n_body; j_source_body++)
+                                        {
+                                            const CORE::ACC_BASE<T> tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
+                                            shared_acc[i_target_body] += mass[j_source_body] * tgt_to_src;
+                                            shared_acc[j_source_body] -= mass[i_target_body] * tgt_to_src;
+                                        }
                                     }
-                                });
+                                },
+                                1);
 
+            // In block order, zeroing the scratch on the way, for the next call
             parallel_for_helper(0, n_body, [&shared_accs, &acc, nthread](size_t i_body)
                                 {
-                                    for (size_t i_thread = 0; i_thread < nthread; i_thread++)
+                                    for (size_t i_block = 0; i_block < nthread; i_block++)
                                     {
-                                        acc[i_body] += shared_accs[i_thread][i_body];
+                                        acc[i_body] += shared_accs[i_block][i_body];
+                                        shared_accs[i_block][i_body].reset();
                                     }
                                 });
         }
@@ -66,7 +88,7 @@ namespace CPUSIM
             // Useless shit
             // The savings on one less sqrt calculation for acceleration
             // is paid back by index calculation
-            std::vector<std::vector<CORE::ACC> > shared_accs(nthread); // [thread_idx][i_body]
+            std::vector<std::vector<CORE::ACC_BASE<T>>> shared_accs(nthread); // [thread_idx][i_body]
             for (auto &shared_acc : shared_accs)
             {
                 shared_acc.resize(n_body, {0, 0, 0});
@@ -75,7 +97,7 @@ namespace CPUSIM
             parallel_for_helper(0, num_pairs, [n_body, &shared_accs, &mass, &pos](size_t pair_id, size_t thread_id)
                                 {
                                     auto [i_target_body, j_source_body] = CORE::delinearize_upper_triangle_matrix_index(pair_id, n_body);
-                                    const CORE::ACC tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
+                                    const CORE::ACC_BASE<T> tgt_to_src{CORE::universal_field(pos[j_source_body], pos[i_target_body])};
                                     shared_accs[thread_id][i_target_body] += mass[j_source_body] * tgt_to_src;
                                     shared_accs[thread_id][j_source_body] -= mass[i_target_body] * tgt_to_src;
                                 });
@@ -90,109 +112,14 @@ namespace CPUSIM
 #endif
     }
 
-    CORE::SYSTEM_STATE SHARED_ACC_ENGINE::execute(int n_iter, CORE::TIMER &timer)
+    template <typename T>
+    std::optional<typename SHARED_ACC_ENGINE_BASE<T>::system_state_type> SHARED_ACC_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
     {
-        const size_t n_body = system_state_snapshot().size();
-
-        std::vector<CORE::MASS> mass(n_body, 0);
-        BUFFER buf_in(n_body);
-        // Step 1: Prepare ic
-        for (size_t i_body = 0; i_body < n_body; i_body++)
-        {
-            const auto &[body_pos, body_vel, body_mass] = system_state_snapshot()[i_body];
-            buf_in.pos[i_body] = body_pos;
-            buf_in.vel[i_body] = body_vel;
-            mass[i_body] = body_mass;
-        }
-        timer.elapsed_previous("step1");
-
-        // Step 2: Prepare acceleration for ic
-        compute_acceleration(buf_in.acc, buf_in.pos, mass);
-
-        // Verify
-        if (n_thread() != 1 && false)
-        {
-            std::cout << "Verifying IC acceleration" << std::endl;
-            std::vector<CORE::ACC> expected_acc(n_body);
-            for (auto &acc : expected_acc)
-            {
-                acc.reset();
-            }
-            for (size_t i_target_body = 0; i_target_body < n_body; i_target_body++)
-            {
-                for (size_t j_source_body = i_target_body + 1; j_source_body < n_body; j_source_body++)
-                {
-                    const CORE::ACC tgt_to_src{CORE::universal_field(buf_in.pos[j_source_body], buf_in.pos[i_target_body])};
-                    expected_acc[i_target_body] += mass[j_source_body] * tgt_to_src;
-                    expected_acc[j_source_body] -= mass[i_target_body] * tgt_to_src;
-                }
-            }
-            for (size_t i = 0; i < n_body; i++)
-            {
-                if (buf_in.acc[i] != expected_acc[i])
-                {
-                    std::cout << "buf_in.acc[" << i << "]: " << buf_in.acc[i] << std::endl;
-                    std::cout << "expected_acc[" << i << "]: " << expected_acc[i] << std::endl;
-                    ASSERT(false);
-                }
-            }
-        }
-        timer.elapsed_previous("step2");
-
-        BUFFER buf_out(n_body);
-        std::vector<CORE::VEL> vel_tmp(n_body);
-        // Core iteration loop
-        for (int i_iter = 0; i_iter < n_iter; i_iter++)
-        {
-            if (false)
-            {
-                debug_workspace(buf_in, mass);
-            }
-
-            parallel_for_helper(0, n_body,
-                                [&buf_out, &buf_in, &vel_tmp, this](size_t i_target_body)
-                                {
-                                    // Step 3: Compute temp velocity
-                                    vel_tmp[i_target_body] =
-                                        CORE::VEL::updated(buf_in.vel[i_target_body], buf_in.acc[i_target_body], dt());
-
-                                    // Step 4: Update position
-                                    buf_out.pos[i_target_body] =
-                                        CORE::POS::updated(buf_in.pos[i_target_body], buf_in.vel[i_target_body], buf_in.acc[i_target_body], dt());
-                                });
-
-            // Step 5: Compute acceleration
-            compute_acceleration(buf_out.acc, buf_out.pos, mass);
-
-            // Step 6: Update velocity
-            parallel_for_helper(0, n_body,
-                                [&buf_out, &vel_tmp, this](size_t i_target_body)
-                                {
-                                    // Step 6: Update velocity
-                                    buf_out.vel[i_target_body] = CORE::VEL::updated(vel_tmp[i_target_body], buf_out.acc[i_target_body], dt());
-                                });
-
-            // Write SYSTEM_STATE to log
-            if (i_iter == 0)
-            {
-                push_system_state_to_log([&]()
-                                         { return generate_system_state(buf_in, mass); });
-            }
-            push_system_state_to_log([&]()
-                                     { return generate_system_state(buf_out, mass); });
-            if (i_iter % 10 == 0)
-            {
-                serialize_system_state_log();
-            }
-
-            // Prepare for next iteration
-            std::swap(buf_in, buf_out);
-
-            timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
-        }
-
-        timer.elapsed_previous("all_iters");
-
-        return generate_system_state(buf_in, mass);
+        auto compute_acceleration_function = [this](std::vector<CORE::ACC_BASE<T>> &acc, const std::vector<CORE::POS_BASE<T>> &pos, const std::vector<T> &mass)
+        { compute_acceleration(acc, pos, mass); };
+        return execute_integrator(n_iter, timer, compute_acceleration_function);
     }
-}
\ No newline at end of file
+
+    template class SHARED_ACC_ENGINE_BASE<float>;
+    template class SHARED_ACC_ENGINE_BASE<double>;
+}
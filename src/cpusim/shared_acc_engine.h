@@ -1,21 +1,48 @@
 #pragma once
 
 #include "basic_engine.h"
+#include "core/arena.hpp"
+
 namespace CPUSIM
 {
-    class SHARED_ACC_ENGINE final : public BASIC_ENGINE
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class SHARED_ACC_ENGINE_BASE final : public BASIC_ENGINE_BASE<T>
     {
     public:
-        virtual ~SHARED_ACC_ENGINE() = default;
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~SHARED_ACC_ENGINE_BASE() = default;
 
-        using BASIC_ENGINE::BASIC_ENGINE;
+        /// Sets up the scratch of compute_acceleration() once, for every iteration to reuse
+        SHARED_ACC_ENGINE_BASE(system_state_type system_state_ic,
+                               T dt,
+                               size_t n_thread,
+                               bool use_thread_pool,
+                               std::optional<std::string> system_state_log_dir_opt = {});
 
-        virtual std::string name() override { return "SHARED_ACC_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::string name() override { return std::string("SHARED_ACC_ENGINE") + BASIC_ENGINE_BASE<T>::precision_suffix(); }
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
 
     private:
-        void compute_acceleration(std::vector<CORE::ACC> &acc,
-                                  const std::vector<CORE::POS> &pos,
-                                  const std::vector<CORE::MASS> &mass);
+        void compute_acceleration(std::vector<CORE::ACC_BASE<T>> &acc,
+                                  const std::vector<CORE::POS_BASE<T>> &pos,
+                                  const std::vector<T> &mass);
+
+        using BASIC_ENGINE_BASE<T>::system_state_snapshot;
+        using BASIC_ENGINE_BASE<T>::execute_integrator;
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+        using BASIC_ENGINE_BASE<T>::n_thread;
+
+    private:
+        CORE::ARENA scratch_arena_;
+        /// [i_block][i_body], one block of targets per thread, zero between two compute_acceleration()
+        CORE::PER_THREAD_SCRATCH<CORE::ACC_BASE<T>> shared_accs_;
     };
+
+    /// Use this type
+    using SHARED_ACC_ENGINE = SHARED_ACC_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class SHARED_ACC_ENGINE_BASE<float>;
+    extern template class SHARED_ACC_ENGINE_BASE<double>;
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "simd_engine.h"
+#include "simd_kernel.h"
+#include "core/timer.h"
+
+#include <iostream>
+
+namespace CPUSIM
+{
+    template <typename T>
+    SIMD_ENGINE_BASE<T>::SIMD_ENGINE_BASE(system_state_type system_state_ic,
+                                          T dt,
+                                          size_t n_thread,
+                                          bool use_thread_pool,
+                                          SIMD::ACCUMULATION accumulation,
+                                          std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt)),
+          accumulation_(accumulation)
+    {
+        ASSERT(accumulation_ != SIMD::ACCUMULATION::KAHAN || SIMD::is_kahan_available);
+        std::cout << "Using " << SIMD::to_string(accumulation_) << " accumulation" << std::endl;
+    }
+
+    template <typename T>
+    std::string SIMD_ENGINE_BASE<T>::accumulation_suffix() const
+    {
+        return accumulation_ == SIMD::ACCUMULATION::FLOAT ? std::string() : std::string("_") + SIMD::to_string(accumulation_);
+    }
+
+    template <typename T>
+    std::string SIMD_ENGINE_BASE<T>::name()
+    {
+        return std::string("SIMD_ENGINE_") + SIMD::isa_name + accumulation_suffix() + precision_suffix();
+    }
+
+    template <typename T>
+    void SIMD_ENGINE_BASE<T>::compute_acceleration(SOA_XYZ_BASE<T> &acc,
+                                                   const SOA_XYZ_BASE<T> &pos,
+                                                   const CORE::ALIGNED_VECTOR<T> &mass,
+                                                   size_t n_body)
+    {
+        const size_t n_padded = soa_padded_size(n_body);
+        SIMD::dispatch_accumulation(
+            accumulation_,
+            [this, n_body, n_padded, &acc, &pos, &mass](auto accumulation)
+            {
+                constexpr SIMD::ACCUMULATION A = decltype(accumulation)::value;
+                parallel_for_helper(0, n_body,
+                                    [n_padded, &acc, &pos, &mass](size_t i_target_body)
+                                    {
+                                        acc.set(i_target_body,
+                                                SIMD::narrow<T>(SIMD::accumulate_field<A>(pos.x[i_target_body], pos.y[i_target_body], pos.z[i_target_body],
+                                                                                       pos.x.data(), pos.y.data(), pos.z.data(), mass.data(),
+                                                                                       0, n_padded)));
+                                    });
+            });
+    }
+
+    template <typename T>
+    std::vector<CORE::ACC_BASE<T>> SIMD_ENGINE_BASE<T>::compute_acceleration(const system_state_type &system_state)
+    {
+        const size_t n_body = system_state.size();
+        CORE::ALIGNED_VECTOR<T> mass(soa_padded_size(n_body), 0);
+        SOA_XYZ_BASE<T> pos(n_body);
+        SOA_XYZ_BASE<T> vel(n_body);
+        set_system_state(system_state, pos, vel, mass);
+        SOA_XYZ_BASE<T> soa_acc(n_body);
+        compute_acceleration(soa_acc, pos, mass, n_body);
+
+        std::vector<CORE::ACC_BASE<T>> acc(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            acc[i_body] = CORE::ACC_BASE<T>{soa_acc.get(i_body)};
+        }
+        return acc;
+    }
+
+    template <typename T>
+    typename SIMD_ENGINE_BASE<T>::SOA_INTEGRATOR_BUFFERS &SIMD_ENGINE_BASE<T>::soa_integrator_buffers(CORE::TIMER &timer, bool &is_warm)
+    {
+        is_warm = soa_integrator_buffers_opt_.has_value();
+        if (is_warm)
+        {
+            return *soa_integrator_buffers_opt_;
+        }
+        SOA_INTEGRATOR_BUFFERS &buffers = soa_integrator_buffers_opt_.emplace(system_state_snapshot().size());
+        // Step 1: Prepare ic
+        set_system_state(system_state_snapshot(), buffers.bodies.pos, buffers.bodies.vel, buffers.mass);
+        timer.elapsed_previous("step1");
+        return buffers;
+    }
+
+    template <typename T>
+    void SIMD_ENGINE_BASE<T>::materialize_system_state(system_state_type &system_state)
+    {
+        generate_system_state(soa_integrator_buffers_opt_->bodies, soa_integrator_buffers_opt_->mass, system_state_snapshot().size(), system_state);
+    }
+
+    template <typename T>
+    std::optional<typename SIMD_ENGINE_BASE<T>::system_state_type> SIMD_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        const size_t n_body = system_state_snapshot().size();
+
+        bool is_warm = false;
+        SOA_INTEGRATOR_BUFFERS &buffers = soa_integrator_buffers(timer, is_warm);
+        SOA_BUFFER_BASE<T> &bodies = buffers.bodies;
+        const CORE::ALIGNED_VECTOR<T> &mass = buffers.mass;
+
+        // Step 2: Prepare acceleration for ic, unless a checkpoint or the previous execute() has it, or the integrator does not need it
+        if (!is_warm)
+        {
+            if (resumed_acceleration())
+            {
+                set_acceleration(*resumed_acceleration(), bodies.acc);
+            }
+            else if (integrator().is_kick_first())
+            {
+                compute_acceleration(bodies.acc, bodies.pos, mass, n_body);
+            }
+            timer.elapsed_previous("step2");
+        }
+        const bool is_ic_logged = is_warm || resumed_acceleration();
+
+        auto drift = [n_body, &bodies, this](T c_dt)
+        {
+            parallel_for_helper(0, n_body,
+                                [&bodies, c_dt](size_t i_target_body)
+                                {
+                                    bodies.pos.set(i_target_body, bodies.pos.get(i_target_body) + c_dt * bodies.vel.get(i_target_body));
+                                });
+        };
+        auto kick = [n_body, &bodies, this](T d_dt)
+        {
+            parallel_for_helper(0, n_body,
+                                [&bodies, d_dt](size_t i_target_body)
+                                {
+                                    bodies.vel.set(i_target_body, bodies.vel.get(i_target_body) + d_dt * bodies.acc.get(i_target_body));
+                                });
+        };
+        auto accelerate = [n_body, &bodies, &mass, this]()
+        {
+            compute_acceleration(bodies.acc, bodies.pos, mass, n_body);
+            count_force_evaluations(n_body);
+        };
+
+        // Core iteration loop
+        for (int i_iter = 0; i_iter < n_iter; i_iter++)
+        {
+            // Write SYSTEM_STATE to log, unless it has the ic already
+            if (i_iter == 0 && !is_ic_logged)
+            {
+                push_system_state_to_log([&](system_state_type &system_state)
+                                         { generate_system_state(bodies, mass, n_body, system_state); });
+            }
+
+            // Steps 3 to 6, as the integrator orders them
+            integrator().step(dt(), drift, kick, accelerate);
+
+            push_system_state_to_log([&](system_state_type &system_state)
+                                     { generate_system_state(bodies, mass, n_body, system_state); });
+            if (i_iter % 10 == 0)
+            {
+                serialize_system_state_log();
+            }
+
+            timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
+
+            if (checkpoint_if_due(i_iter, [&](system_state_type &system_state, std::vector<CORE::ACC_BASE<T>> &acc)
+                                  { generate_system_state(bodies, mass, n_body, system_state);
+                                    generate_acceleration(bodies.acc, n_body, acc); }))
+            {
+                break;
+            }
+        }
+
+        timer.elapsed_previous("all_iters");
+
+        // Kept in buffers for the next execute()
+        return std::nullopt;
+    }
+
+    template class SIMD_ENGINE_BASE<float>;
+    template class SIMD_ENGINE_BASE<double>;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "basic_engine.h"
+#include "buffer.h"
+#include "simd_kernel.h"
+#include "reference.h"
+
+namespace CPUSIM
+{
+    /// Same algorithm as BASIC_ENGINE, with any CORE::INTEGRATOR, but keeps the bodies in a SOA_BUFFER
+    /// and evaluates lane_width_v<T> sources per instruction (see simd_kernel.h).
+    /// The per-pair terms are summed under the given SIMD::ACCUMULATION,
+    /// whose rounding error is reported as an APPROXIMATE_FORCE_ENGINE.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class SIMD_ENGINE_BASE : public BASIC_ENGINE_BASE<T>, public APPROXIMATE_FORCE_ENGINE_BASE<T>
+    {
+    public:
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~SIMD_ENGINE_BASE() = default;
+
+        SIMD_ENGINE_BASE(system_state_type system_state_ic,
+                         T dt,
+                         size_t n_thread,
+                         bool use_thread_pool,
+                         SIMD::ACCUMULATION accumulation = SIMD::ACCUMULATION::FLOAT,
+                         std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::string name() override;
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::vector<CORE::ACC_BASE<T>> compute_acceleration(const system_state_type &system_state) override;
+
+    protected:
+        /// The bodies of the iteration loop, moved in place and kept from one execute() to the next (warm start).
+        /// Padded bodies keep zero mass and never move
+        struct SOA_INTEGRATOR_BUFFERS
+        {
+            /// The bodies reached and their acceleration
+            SOA_BUFFER_BASE<T> bodies;
+            /// For the engines drifting out of place, see SPMD_ENGINE
+            SOA_XYZ_BASE<T> pos_next;
+            CORE::ALIGNED_VECTOR<T> mass;
+
+            explicit SOA_INTEGRATOR_BUFFERS(size_t n_body) : bodies(n_body), pos_next(n_body), mass(soa_padded_size(n_body), 0) {}
+        };
+
+        /// Step 1 on the first execute(): the buffers with bodies and mass from system_state_snapshot().
+        /// Later execute()s take the buffers over as the previous one left them, which is_warm tells.
+        SOA_INTEGRATOR_BUFFERS &soa_integrator_buffers(CORE::TIMER &timer, bool &is_warm);
+        virtual void materialize_system_state(system_state_type &system_state) override;
+
+        /// Overwrites acc[0, n_body) with the acceleration caused by all the bodies
+        virtual void compute_acceleration(SOA_XYZ_BASE<T> &acc,
+                                          const SOA_XYZ_BASE<T> &pos,
+                                          const CORE::ALIGNED_VECTOR<T> &mass,
+                                          size_t n_body);
+
+        SIMD::ACCUMULATION accumulation() const { return accumulation_; }
+        /// "_DOUBLE" or "_KAHAN" to tell the accumulation apart in name(), "" for FLOAT
+        std::string accumulation_suffix() const;
+
+        using BASIC_ENGINE_BASE<T>::system_state_snapshot;
+        using BASIC_ENGINE_BASE<T>::dt;
+        using BASIC_ENGINE_BASE<T>::is_system_state_logging_enabled;
+        using BASIC_ENGINE_BASE<T>::push_system_state_to_log;
+        using BASIC_ENGINE_BASE<T>::serialize_system_state_log;
+        using BASIC_ENGINE_BASE<T>::resumed_acceleration;
+        using BASIC_ENGINE_BASE<T>::checkpoint_if_due;
+        using BASIC_ENGINE_BASE<T>::integrator;
+        using BASIC_ENGINE_BASE<T>::count_force_evaluations;
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+        using BASIC_ENGINE_BASE<T>::parallel_region_helper;
+        using BASIC_ENGINE_BASE<T>::n_thread;
+        using BASIC_ENGINE_BASE<T>::precision_suffix;
+
+    private:
+        SIMD::ACCUMULATION accumulation_;
+        std::optional<SOA_INTEGRATOR_BUFFERS> soa_integrator_buffers_opt_;
+    };
+
+    /// Use this type
+    using SIMD_ENGINE = SIMD_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class SIMD_ENGINE_BASE<float>;
+    extern template class SIMD_ENGINE_BASE<double>;
+}
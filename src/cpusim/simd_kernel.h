@@ -0,0 +1,514 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <type_traits>
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+#include "core/physics.hpp"
+#include "buffer.h"
+
+namespace CPUSIM::SIMD
+{
+    using value_type = CORE::UNIVERSE::floating_value_type;
+    static_assert(std::is_same_v<value_type, float>, "SIMD kernels are written for float lanes");
+
+    /// The instruction set is picked at compile time (-march=native),
+    /// with a plain scalar loop as the fallback.
+    /// lane_width counts float lanes, see lane_width_v for double ones.
+#if defined(__AVX512F__)
+    constexpr size_t lane_width = 16;
+    constexpr const char *isa_name = "AVX512";
+#elif defined(__AVX2__) && defined(__FMA__)
+    constexpr size_t lane_width = 8;
+    constexpr const char *isa_name = "AVX2";
+#else
+    constexpr size_t lane_width = 1;
+    constexpr const char *isa_name = "SCALAR";
+#endif
+    static_assert(soa_padding % lane_width == 0, "soa_padding must be a multiple of lane_width");
+
+    /// Lanes of T per instruction, a double lane being twice as wide as a float one
+    template <typename T>
+    constexpr size_t lane_width_v = std::is_same_v<T, double> ? (lane_width + 1) / 2 : lane_width;
+
+    /// How accumulate_field sums the per-pair contributions.
+    /// The pair terms themselves are always evaluated in lanes of the floating type of the bodies,
+    /// and the accumulators are never narrower than that, so FLOAT and DOUBLE are the same for double bodies.
+    enum class ACCUMULATION
+    {
+        FLOAT,  // Float accumulators
+        DOUBLE, // Every pair term widened to double, double accumulators (half the lanes per add)
+        KAHAN   // Float accumulators with Neumaier compensation, see is_kahan_available
+    };
+
+    /// -ffast-math (ENABLE_FFAST_MATH) lets the compiler fold the compensation of KAHAN away,
+    /// which would then silently sum as FLOAT, so it is not offered in such a build
+#ifdef __FAST_MATH__
+    constexpr bool is_kahan_available = false;
+#else
+    constexpr bool is_kahan_available = true;
+#endif
+
+    inline const char *to_string(ACCUMULATION accumulation)
+    {
+        switch (accumulation)
+        {
+        case ACCUMULATION::DOUBLE:
+            return "DOUBLE";
+        case ACCUMULATION::KAHAN:
+            return "KAHAN";
+        default:
+            return "FLOAT";
+        }
+    }
+
+    /// Calls f(std::integral_constant<ACCUMULATION, accumulation>{}),
+    /// i.e., turns the runtime policy into a template argument
+    template <typename Function>
+    void dispatch_accumulation(ACCUMULATION accumulation, Function &&f)
+    {
+        switch (accumulation)
+        {
+        case ACCUMULATION::DOUBLE:
+            f(std::integral_constant<ACCUMULATION, ACCUMULATION::DOUBLE>{});
+            break;
+        case ACCUMULATION::KAHAN:
+            f(std::integral_constant<ACCUMULATION, ACCUMULATION::KAHAN>{});
+            break;
+        default:
+            f(std::integral_constant<ACCUMULATION, ACCUMULATION::FLOAT>{});
+            break;
+        }
+    }
+
+    /// Result of accumulate_field for bodies of floating type T: the compensated and double sums are kept in double,
+    /// so that partial fields (e.g., over source tiles) can be added up without losing them
+    template <ACCUMULATION A, typename T = value_type>
+    using field_type = std::conditional_t<A == ACCUMULATION::FLOAT, CORE::XYZ_BASE<T>, CORE::XYZ_BASE<double>>;
+
+    /// Rounds a field_type back to CORE::XYZ_BASE<T>
+    template <typename T, typename F>
+    inline CORE::XYZ_BASE<T> narrow(const CORE::XYZ_BASE<F> &field)
+    {
+        return {static_cast<T>(field.x), static_cast<T>(field.y), static_cast<T>(field.z)};
+    }
+
+#if defined(__AVX512F__)
+    /// _mm512_reduce_add_ps trips -Wmaybe-uninitialized on GCC 12, so reduce through memory
+    inline value_type horizontal_add(__m512 v)
+    {
+        alignas(64) value_type lanes[lane_width];
+        _mm512_store_ps(lanes, v);
+        value_type sum = 0;
+        for (size_t i_lane = 0; i_lane < lane_width; i_lane++)
+        {
+            sum += lanes[i_lane];
+        }
+        return sum;
+    }
+
+    inline double horizontal_add(__m512d v)
+    {
+        alignas(64) double lanes[lane_width / 2];
+        _mm512_store_pd(lanes, v);
+        double sum = 0;
+        for (size_t i_lane = 0; i_lane < lane_width / 2; i_lane++)
+        {
+            sum += lanes[i_lane];
+        }
+        return sum;
+    }
+
+    /// Lanes of v as two double vectors
+    /// The unmasked extract and convert trip -Wmaybe-uninitialized on GCC 12 as well, hence the all-ones maskz
+    inline __m512d widen_low(__m512 v)
+    {
+        return _mm512_maskz_cvtps_pd(0xFF, _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(v), 0)));
+    }
+    inline __m512d widen_high(__m512 v)
+    {
+        return _mm512_maskz_cvtps_pd(0xFF, _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(v), 1)));
+    }
+
+    /// Per-lane running sums of a * b under the policy A, over lanes of T
+    template <ACCUMULATION A, typename T = value_type>
+    class LANE_SUM;
+
+    template <>
+    class LANE_SUM<ACCUMULATION::FLOAT>
+    {
+    public:
+        void add_product(__m512 a, __m512 b) { sum_ = _mm512_fmadd_ps(a, b, sum_); }
+        value_type total() const { return horizontal_add(sum_); }
+
+    private:
+        __m512 sum_ = _mm512_setzero_ps();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::DOUBLE>
+    {
+    public:
+        void add_product(__m512 a, __m512 b)
+        {
+            const __m512 term = _mm512_mul_ps(a, b);
+            sum_low_ = _mm512_add_pd(sum_low_, widen_low(term));
+            sum_high_ = _mm512_add_pd(sum_high_, widen_high(term));
+        }
+        double total() const { return horizontal_add(_mm512_add_pd(sum_low_, sum_high_)); }
+
+    private:
+        __m512d sum_low_ = _mm512_setzero_pd();
+        __m512d sum_high_ = _mm512_setzero_pd();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::KAHAN>
+    {
+    public:
+        void add_product(__m512 a, __m512 b)
+        {
+            // Neumaier: the rounding error of sum + term is recovered from whichever operand is larger
+            const __m512 term = _mm512_mul_ps(a, b);
+            const __m512 new_sum = _mm512_add_ps(sum_, term);
+            const __mmask16 is_sum_larger = _mm512_cmp_ps_mask(_mm512_abs_ps(sum_), _mm512_abs_ps(term), _CMP_GE_OQ);
+            const __m512 larger = _mm512_mask_blend_ps(is_sum_larger, term, sum_);
+            const __m512 smaller = _mm512_mask_blend_ps(is_sum_larger, sum_, term);
+            compensation_ = _mm512_add_ps(compensation_, _mm512_add_ps(_mm512_sub_ps(larger, new_sum), smaller));
+            sum_ = new_sum;
+        }
+        double total() const
+        {
+            return horizontal_add(_mm512_add_pd(_mm512_add_pd(widen_low(sum_), widen_low(compensation_)),
+                                                _mm512_add_pd(widen_high(sum_), widen_high(compensation_))));
+        }
+
+    private:
+        __m512 sum_ = _mm512_setzero_ps();
+        __m512 compensation_ = _mm512_setzero_ps();
+    };
+
+    /// Double lanes: FLOAT and DOUBLE are the same plain sum
+    template <ACCUMULATION A>
+    class LANE_SUM<A, double>
+    {
+    public:
+        void add_product(__m512d a, __m512d b) { sum_ = _mm512_fmadd_pd(a, b, sum_); }
+        double total() const { return horizontal_add(sum_); }
+
+    private:
+        __m512d sum_ = _mm512_setzero_pd();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::KAHAN, double>
+    {
+    public:
+        void add_product(__m512d a, __m512d b)
+        {
+            // Neumaier: the rounding error of sum + term is recovered from whichever operand is larger
+            const __m512d term = _mm512_mul_pd(a, b);
+            const __m512d new_sum = _mm512_add_pd(sum_, term);
+            const __mmask8 is_sum_larger = _mm512_cmp_pd_mask(_mm512_abs_pd(sum_), _mm512_abs_pd(term), _CMP_GE_OQ);
+            const __m512d larger = _mm512_mask_blend_pd(is_sum_larger, term, sum_);
+            const __m512d smaller = _mm512_mask_blend_pd(is_sum_larger, sum_, term);
+            compensation_ = _mm512_add_pd(compensation_, _mm512_add_pd(_mm512_sub_pd(larger, new_sum), smaller));
+            sum_ = new_sum;
+        }
+        double total() const { return horizontal_add(_mm512_add_pd(sum_, compensation_)); }
+
+    private:
+        __m512d sum_ = _mm512_setzero_pd();
+        __m512d compensation_ = _mm512_setzero_pd();
+    };
+#elif defined(__AVX2__) && defined(__FMA__)
+    inline value_type horizontal_add(__m256 v)
+    {
+        const __m128 v4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        const __m128 v2 = _mm_add_ps(v4, _mm_movehl_ps(v4, v4));
+        const __m128 v1 = _mm_add_ss(v2, _mm_movehdup_ps(v2));
+        return _mm_cvtss_f32(v1);
+    }
+
+    inline double horizontal_add(__m256d v)
+    {
+        const __m128d v2 = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(v2, _mm_unpackhi_pd(v2, v2)));
+    }
+
+    /// Lanes of v as two double vectors
+    inline __m256d widen_low(__m256 v) { return _mm256_cvtps_pd(_mm256_castps256_ps128(v)); }
+    inline __m256d widen_high(__m256 v) { return _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)); }
+
+    /// Per-lane running sums of a * b under the policy A, over lanes of T
+    template <ACCUMULATION A, typename T = value_type>
+    class LANE_SUM;
+
+    template <>
+    class LANE_SUM<ACCUMULATION::FLOAT>
+    {
+    public:
+        void add_product(__m256 a, __m256 b) { sum_ = _mm256_fmadd_ps(a, b, sum_); }
+        value_type total() const { return horizontal_add(sum_); }
+
+    private:
+        __m256 sum_ = _mm256_setzero_ps();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::DOUBLE>
+    {
+    public:
+        void add_product(__m256 a, __m256 b)
+        {
+            const __m256 term = _mm256_mul_ps(a, b);
+            sum_low_ = _mm256_add_pd(sum_low_, widen_low(term));
+            sum_high_ = _mm256_add_pd(sum_high_, widen_high(term));
+        }
+        double total() const { return horizontal_add(_mm256_add_pd(sum_low_, sum_high_)); }
+
+    private:
+        __m256d sum_low_ = _mm256_setzero_pd();
+        __m256d sum_high_ = _mm256_setzero_pd();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::KAHAN>
+    {
+    public:
+        void add_product(__m256 a, __m256 b)
+        {
+            // Neumaier: the rounding error of sum + term is recovered from whichever operand is larger
+            const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+            const __m256 term = _mm256_mul_ps(a, b);
+            const __m256 new_sum = _mm256_add_ps(sum_, term);
+            const __m256 is_sum_larger = _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, sum_), _mm256_andnot_ps(sign_mask, term), _CMP_GE_OQ);
+            const __m256 larger = _mm256_blendv_ps(term, sum_, is_sum_larger);
+            const __m256 smaller = _mm256_blendv_ps(sum_, term, is_sum_larger);
+            compensation_ = _mm256_add_ps(compensation_, _mm256_add_ps(_mm256_sub_ps(larger, new_sum), smaller));
+            sum_ = new_sum;
+        }
+        double total() const
+        {
+            return horizontal_add(_mm256_add_pd(_mm256_add_pd(widen_low(sum_), widen_low(compensation_)),
+                                                _mm256_add_pd(widen_high(sum_), widen_high(compensation_))));
+        }
+
+    private:
+        __m256 sum_ = _mm256_setzero_ps();
+        __m256 compensation_ = _mm256_setzero_ps();
+    };
+
+    /// Double lanes: FLOAT and DOUBLE are the same plain sum
+    template <ACCUMULATION A>
+    class LANE_SUM<A, double>
+    {
+    public:
+        void add_product(__m256d a, __m256d b) { sum_ = _mm256_fmadd_pd(a, b, sum_); }
+        double total() const { return horizontal_add(sum_); }
+
+    private:
+        __m256d sum_ = _mm256_setzero_pd();
+    };
+
+    template <>
+    class LANE_SUM<ACCUMULATION::KAHAN, double>
+    {
+    public:
+        void add_product(__m256d a, __m256d b)
+        {
+            // Neumaier: the rounding error of sum + term is recovered from whichever operand is larger
+            const __m256d sign_mask = _mm256_set1_pd(-0.0);
+            const __m256d term = _mm256_mul_pd(a, b);
+            const __m256d new_sum = _mm256_add_pd(sum_, term);
+            const __m256d is_sum_larger = _mm256_cmp_pd(_mm256_andnot_pd(sign_mask, sum_), _mm256_andnot_pd(sign_mask, term), _CMP_GE_OQ);
+            const __m256d larger = _mm256_blendv_pd(term, sum_, is_sum_larger);
+            const __m256d smaller = _mm256_blendv_pd(sum_, term, is_sum_larger);
+            compensation_ = _mm256_add_pd(compensation_, _mm256_add_pd(_mm256_sub_pd(larger, new_sum), smaller));
+            sum_ = new_sum;
+        }
+        double total() const { return horizontal_add(_mm256_add_pd(sum_, compensation_)); }
+
+    private:
+        __m256d sum_ = _mm256_setzero_pd();
+        __m256d compensation_ = _mm256_setzero_pd();
+    };
+#else
+    /// Running sum of a * b under the policy A
+    template <ACCUMULATION A, typename T = value_type>
+    class LANE_SUM;
+
+    template <typename T>
+    class LANE_SUM<ACCUMULATION::FLOAT, T>
+    {
+    public:
+        void add_product(T a, T b) { sum_ += a * b; }
+        T total() const { return sum_; }
+
+    private:
+        T sum_ = 0;
+    };
+
+    template <typename T>
+    class LANE_SUM<ACCUMULATION::DOUBLE, T>
+    {
+    public:
+        void add_product(T a, T b) { sum_ += static_cast<double>(a * b); }
+        double total() const { return sum_; }
+
+    private:
+        double sum_ = 0;
+    };
+
+    template <typename T>
+    class LANE_SUM<ACCUMULATION::KAHAN, T>
+    {
+    public:
+        void add_product(T a, T b)
+        {
+            // Neumaier: the rounding error of sum + term is recovered from whichever operand is larger
+            const T term = a * b;
+            const T new_sum = sum_ + term;
+            compensation_ += std::abs(sum_) >= std::abs(term) ? (sum_ - new_sum) + term : (term - new_sum) + sum_;
+            sum_ = new_sum;
+        }
+        double total() const { return static_cast<double>(sum_) + compensation_; }
+
+    private:
+        T sum_ = 0;
+        T compensation_ = 0;
+    };
+#endif
+
+    /// Field at (x_target, y_target, z_target) caused by sources [j_begin, j_end),
+    /// i.e., Sum(m[j] * universal_field(pos[j], pos_target)), summed under the policy A.
+    /// j_begin and j_end must be multiples of lane_width,
+    /// and the source arrays must be aligned as in SOA_XYZ.
+    /// The target itself may be one of the sources, since it then contributes exactly zero.
+    template <ACCUMULATION A = ACCUMULATION::FLOAT>
+    inline field_type<A> accumulate_field(value_type x_target, value_type y_target, value_type z_target,
+                                          const value_type *x, const value_type *y, const value_type *z, const value_type *m,
+                                          size_t j_begin, size_t j_end)
+    {
+        LANE_SUM<A> ax;
+        LANE_SUM<A> ay;
+        LANE_SUM<A> az;
+#if defined(__AVX512F__)
+        const __m512 xi = _mm512_set1_ps(x_target);
+        const __m512 yi = _mm512_set1_ps(y_target);
+        const __m512 zi = _mm512_set1_ps(z_target);
+        const __m512 eps_square = _mm512_set1_ps(CORE::UNIVERSE::epislon_square);
+        const __m512 half = _mm512_set1_ps(0.5f);
+        const __m512 three_half = _mm512_set1_ps(1.5f);
+        for (size_t j = j_begin; j < j_end; j += lane_width)
+        {
+            const __m512 dx = _mm512_sub_ps(_mm512_load_ps(x + j), xi);
+            const __m512 dy = _mm512_sub_ps(_mm512_load_ps(y + j), yi);
+            const __m512 dz = _mm512_sub_ps(_mm512_load_ps(z + j), zi);
+            const __m512 denom_base = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_fmadd_ps(dz, dz, eps_square)));
+            // 1/sqrt with one Newton-Raphson step: y' = y * (1.5 - 0.5 * d * y * y)
+            __m512 inv_dist = _mm512_maskz_rsqrt14_ps(0xFFFF, denom_base);
+            inv_dist = _mm512_mul_ps(inv_dist, _mm512_fnmadd_ps(_mm512_mul_ps(half, denom_base), _mm512_mul_ps(inv_dist, inv_dist), three_half));
+            const __m512 s = _mm512_mul_ps(_mm512_load_ps(m + j), _mm512_mul_ps(inv_dist, _mm512_mul_ps(inv_dist, inv_dist)));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#elif defined(__AVX2__) && defined(__FMA__)
+        const __m256 xi = _mm256_set1_ps(x_target);
+        const __m256 yi = _mm256_set1_ps(y_target);
+        const __m256 zi = _mm256_set1_ps(z_target);
+        const __m256 eps_square = _mm256_set1_ps(CORE::UNIVERSE::epislon_square);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 three_half = _mm256_set1_ps(1.5f);
+        for (size_t j = j_begin; j < j_end; j += lane_width)
+        {
+            const __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+            const __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+            const __m256 dz = _mm256_sub_ps(_mm256_load_ps(z + j), zi);
+            const __m256 denom_base = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, eps_square)));
+            // 1/sqrt with one Newton-Raphson step: y' = y * (1.5 - 0.5 * d * y * y)
+            __m256 inv_dist = _mm256_rsqrt_ps(denom_base);
+            inv_dist = _mm256_mul_ps(inv_dist, _mm256_fnmadd_ps(_mm256_mul_ps(half, denom_base), _mm256_mul_ps(inv_dist, inv_dist), three_half));
+            const __m256 s = _mm256_mul_ps(_mm256_load_ps(m + j), _mm256_mul_ps(inv_dist, _mm256_mul_ps(inv_dist, inv_dist)));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#else
+        for (size_t j = j_begin; j < j_end; j++)
+        {
+            const value_type dx = x[j] - x_target;
+            const value_type dy = y[j] - y_target;
+            const value_type dz = z[j] - z_target;
+            const value_type denom_base = dx * dx + dy * dy + dz * dz + CORE::UNIVERSE::epislon_square;
+            const value_type s = m[j] / (denom_base * std::sqrt(denom_base));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#endif
+        return {ax.total(), ay.total(), az.total()};
+    }
+
+    /// accumulate_field for double bodies, lane_width_v<double> sources per instruction.
+    /// The inverse distance is exact here, as a Newton-Raphson step on the float estimate would not reach double.
+    template <ACCUMULATION A = ACCUMULATION::FLOAT>
+    inline field_type<A, double> accumulate_field(double x_target, double y_target, double z_target,
+                                                  const double *x, const double *y, const double *z, const double *m,
+                                                  size_t j_begin, size_t j_end)
+    {
+        LANE_SUM<A, double> ax;
+        LANE_SUM<A, double> ay;
+        LANE_SUM<A, double> az;
+#if defined(__AVX512F__)
+        const __m512d xi = _mm512_set1_pd(x_target);
+        const __m512d yi = _mm512_set1_pd(y_target);
+        const __m512d zi = _mm512_set1_pd(z_target);
+        const __m512d eps_square = _mm512_set1_pd(CORE::UNIVERSE::epislon_square_v<double>);
+        for (size_t j = j_begin; j < j_end; j += lane_width_v<double>)
+        {
+            const __m512d dx = _mm512_sub_pd(_mm512_load_pd(x + j), xi);
+            const __m512d dy = _mm512_sub_pd(_mm512_load_pd(y + j), yi);
+            const __m512d dz = _mm512_sub_pd(_mm512_load_pd(z + j), zi);
+            const __m512d denom_base = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps_square)));
+            // The unmasked sqrt trips -Wmaybe-uninitialized on GCC 12, hence the all-ones maskz
+            const __m512d s = _mm512_div_pd(_mm512_load_pd(m + j), _mm512_mul_pd(denom_base, _mm512_maskz_sqrt_pd(0xFF, denom_base)));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#elif defined(__AVX2__) && defined(__FMA__)
+        const __m256d xi = _mm256_set1_pd(x_target);
+        const __m256d yi = _mm256_set1_pd(y_target);
+        const __m256d zi = _mm256_set1_pd(z_target);
+        const __m256d eps_square = _mm256_set1_pd(CORE::UNIVERSE::epislon_square_v<double>);
+        for (size_t j = j_begin; j < j_end; j += lane_width_v<double>)
+        {
+            const __m256d dx = _mm256_sub_pd(_mm256_load_pd(x + j), xi);
+            const __m256d dy = _mm256_sub_pd(_mm256_load_pd(y + j), yi);
+            const __m256d dz = _mm256_sub_pd(_mm256_load_pd(z + j), zi);
+            const __m256d denom_base = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps_square)));
+            const __m256d s = _mm256_div_pd(_mm256_load_pd(m + j), _mm256_mul_pd(denom_base, _mm256_sqrt_pd(denom_base)));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#else
+        for (size_t j = j_begin; j < j_end; j++)
+        {
+            const double dx = x[j] - x_target;
+            const double dy = y[j] - y_target;
+            const double dz = z[j] - z_target;
+            const double denom_base = dx * dx + dy * dy + dz * dz + CORE::UNIVERSE::epislon_square_v<double>;
+            const double s = m[j] / (denom_base * std::sqrt(denom_base));
+            ax.add_product(dx, s);
+            ay.add_product(dy, s);
+            az.add_product(dz, s);
+        }
+#endif
+        return {ax.total(), ay.total(), az.total()};
+    }
+}
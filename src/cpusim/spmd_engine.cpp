@@ -0,0 +1,174 @@
+#include "spmd_engine.h"
+#include "simd_kernel.h"
+#include "threading.h"
+#include "core/timer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace CPUSIM
+{
+    template <typename T>
+    std::string SPMD_ENGINE_BASE<T>::name()
+    {
+        return std::string("SPMD_ENGINE_") + SIMD::isa_name + accumulation_suffix() + precision_suffix();
+    }
+
+    template <typename T>
+    std::optional<typename SPMD_ENGINE_BASE<T>::system_state_type> SPMD_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        const size_t n_body = system_state_snapshot().size();
+        const size_t n_padded = soa_padded_size(n_body);
+
+        // Step 1 on the first execute() only, later ones continue from the bodies and the acceleration of the buffers
+        bool is_warm = false;
+        SOA_INTEGRATOR_BUFFERS &buffers = soa_integrator_buffers(timer, is_warm);
+        const CORE::ALIGNED_VECTOR<T> &mass = buffers.mass;
+        // Positions are double-buffered: a drift reads pos[i_pos] and writes pos[1 - i_pos], then flips i_pos
+        SOA_XYZ_BASE<T> *const pos[2] = {&buffers.bodies.pos, &buffers.pos_next};
+        SOA_XYZ_BASE<T> &vel = buffers.bodies.vel;
+        SOA_XYZ_BASE<T> &acc = buffers.bodies.acc;
+        // Unless the log has the ic already
+        if (n_iter > 0 && !is_warm && !resumed_acceleration())
+        {
+            push_system_state_to_log([&](system_state_type &system_state)
+                                     { generate_system_state(*pos[0], vel, mass, n_body, system_state); });
+        }
+
+        const size_t n_thread = this->n_thread();
+        const bool is_logging = is_system_state_logging_enabled();
+        const bool is_checkpointing = is_checkpointing_enabled();
+        // Iterations done, fewer than n_iter if a checkpoint stops the run
+        int n_iter_done = n_iter;
+        // Of the bodies reached, the same on every thread
+        size_t i_pos_done = 0;
+        const T dt = this->dt();
+        SENSE_REVERSING_BARRIER barrier(n_thread, default_spin_count(n_thread));
+
+        SIMD::dispatch_accumulation(
+            accumulation(),
+            [&](auto accumulation)
+            {
+                constexpr SIMD::ACCUMULATION A = decltype(accumulation)::value;
+                parallel_region_helper(
+                    [&](size_t thread_id)
+                    {
+                        const size_t count_per_thread = (n_body + n_thread - 1) / n_thread;
+                        const size_t i_begin = std::min(thread_id * count_per_thread, n_body);
+                        const size_t i_end = std::min(i_begin + count_per_thread, n_body);
+                        bool local_sense = false;
+                        size_t i_pos = 0;
+
+                        auto field = [&mass, n_padded](const SOA_XYZ_BASE<T> &p, size_t i_target_body)
+                        {
+                            return CORE::ACC_BASE<T>{SIMD::narrow<T>(SIMD::accumulate_field<A>(p.x[i_target_body], p.y[i_target_body], p.z[i_target_body],
+                                                                                    p.x.data(), p.y.data(), p.z.data(), mass.data(),
+                                                                                    0, n_padded))};
+                        };
+
+                        // Step 2: Prepare acceleration for ic, unless a checkpoint or the previous execute() has it, or the integrator does not need it
+                        if (!is_warm && (resumed_acceleration() || integrator().is_kick_first()))
+                        {
+                            for (size_t i_target_body = i_begin; i_target_body < i_end; i_target_body++)
+                            {
+                                acc.set(i_target_body, resumed_acceleration() ? (*resumed_acceleration())[i_target_body] : field(*pos[0], i_target_body));
+                            }
+                        }
+                        barrier.arrive_and_wait(local_sense);
+                        if (thread_id == 0)
+                        {
+                            timer.elapsed_previous("step2");
+                        }
+
+                        // Every thread moves its own bodies, only the acceleration reads the others.
+                        // The barrier after a drift completes the positions for it, and a drift never writes the positions
+                        // read by an acceleration on the other side of that barrier
+                        auto drift = [&](T c_dt)
+                        {
+                            const SOA_XYZ_BASE<T> &pos_current = *pos[i_pos];
+                            SOA_XYZ_BASE<T> &pos_next = *pos[1 - i_pos];
+                            for (size_t i_target_body = i_begin; i_target_body < i_end; i_target_body++)
+                            {
+                                pos_next.set(i_target_body, pos_current.get(i_target_body) + c_dt * vel.get(i_target_body));
+                            }
+                            i_pos = 1 - i_pos;
+                            barrier.arrive_and_wait(local_sense);
+                        };
+                        auto kick = [&](T d_dt)
+                        {
+                            for (size_t i_target_body = i_begin; i_target_body < i_end; i_target_body++)
+                            {
+                                vel.set(i_target_body, vel.get(i_target_body) + d_dt * acc.get(i_target_body));
+                            }
+                        };
+                        auto accelerate = [&]()
+                        {
+                            for (size_t i_target_body = i_begin; i_target_body < i_end; i_target_body++)
+                            {
+                                acc.set(i_target_body, field(*pos[i_pos], i_target_body));
+                            }
+                            if (thread_id == 0)
+                            {
+                                count_force_evaluations(n_body);
+                            }
+                        };
+
+                        // Core iteration loop
+                        for (int i_iter = 0; i_iter < n_iter; i_iter++)
+                        {
+                            // Steps 3 to 6, as the integrator orders them
+                            integrator().step(dt, drift, kick, accelerate);
+
+                            if (is_logging || is_checkpointing)
+                            {
+                                // Every body at the end of the step
+                                barrier.arrive_and_wait(local_sense);
+                            }
+                            if (thread_id == 0)
+                            {
+                                // Write SYSTEM_STATE to log
+                                push_system_state_to_log([&](system_state_type &system_state)
+                                                         { generate_system_state(*pos[i_pos], vel, mass, n_body, system_state); });
+                                if (i_iter % 10 == 0)
+                                {
+                                    serialize_system_state_log();
+                                }
+                                timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
+
+                                if (checkpoint_if_due(i_iter, [&](system_state_type &system_state, std::vector<CORE::ACC_BASE<T>> &checkpoint_acc)
+                                                      { generate_system_state(*pos[i_pos], vel, mass, n_body, system_state);
+                                                        generate_acceleration(acc, n_body, checkpoint_acc); }))
+                                {
+                                    n_iter_done = i_iter + 1;
+                                }
+                            }
+                            if (is_logging || is_checkpointing)
+                            {
+                                // Velocities must not move on before the log and the checkpoint are taken
+                                barrier.arrive_and_wait(local_sense);
+                                if (n_iter_done != n_iter)
+                                {
+                                    break;
+                                }
+                            }
+                        }
+                        if (thread_id == 0)
+                        {
+                            i_pos_done = i_pos;
+                        }
+                    });
+            });
+
+        timer.elapsed_previous("all_iters");
+
+        // Kept in buffers for the next execute(), with the bodies reached in bodies.pos
+        if (i_pos_done == 1)
+        {
+            std::swap(buffers.bodies.pos, buffers.pos_next);
+        }
+        return std::nullopt;
+    }
+
+    template class SPMD_ENGINE_BASE<float>;
+    template class SPMD_ENGINE_BASE<double>;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "simd_engine.h"
+
+namespace CPUSIM
+{
+    /// Same algorithm as SIMD_ENGINE, run as a single parallel region for all the iterations (SPMD).
+    /// Every thread owns a contiguous range of target bodies, which it drifts, kicks and accelerates as integrator() orders.
+    /// A drift writes into the other half of a double-buffered position array,
+    /// so a single barrier per drift is enough, i.e., one per iteration with leapfrog (plus two when logging, to hold the bodies still).
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class SPMD_ENGINE_BASE final : public SIMD_ENGINE_BASE<T>
+    {
+    public:
+        using typename SIMD_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~SPMD_ENGINE_BASE() = default;
+
+        using SIMD_ENGINE_BASE<T>::SIMD_ENGINE_BASE;
+
+        virtual std::string name() override;
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+
+    private:
+        using typename SIMD_ENGINE_BASE<T>::SOA_INTEGRATOR_BUFFERS;
+        using SIMD_ENGINE_BASE<T>::soa_integrator_buffers;
+        using SIMD_ENGINE_BASE<T>::accumulation;
+        using SIMD_ENGINE_BASE<T>::accumulation_suffix;
+        using SIMD_ENGINE_BASE<T>::precision_suffix;
+        using SIMD_ENGINE_BASE<T>::system_state_snapshot;
+        using SIMD_ENGINE_BASE<T>::is_system_state_logging_enabled;
+        using SIMD_ENGINE_BASE<T>::push_system_state_to_log;
+        using SIMD_ENGINE_BASE<T>::serialize_system_state_log;
+        using SIMD_ENGINE_BASE<T>::resumed_acceleration;
+        using SIMD_ENGINE_BASE<T>::checkpoint_if_due;
+        using SIMD_ENGINE_BASE<T>::integrator;
+        using SIMD_ENGINE_BASE<T>::count_force_evaluations;
+        using SIMD_ENGINE_BASE<T>::parallel_region_helper;
+        using CORE::ENGINE_BASE<T>::is_checkpointing_enabled;
+    };
+
+    /// Use this type
+    using SPMD_ENGINE = SPMD_ENGINE_BASE<CORE::UNIVERSE::floating_value_type>;
+
+    extern template class SPMD_ENGINE_BASE<float>;
+    extern template class SPMD_ENGINE_BASE<double>;
+}
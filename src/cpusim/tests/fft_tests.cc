@@ -0,0 +1,148 @@
+#include "core/utst.hpp"
+#include "fft.h"
+#include "threading.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace CPUSIM;
+
+UTST_MAIN();
+
+namespace
+{
+    using complex_type = FFT_3D::complex_type;
+    using value_type = FFT_3D::value_type;
+
+    constexpr size_t n_thread = 3;
+    constexpr value_type tolerance = 1e-9;
+
+    auto serial_for = [](size_t begin, size_t end, auto &&f)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            f(i, 0);
+        }
+    };
+
+    auto threaded_for = [](size_t begin, size_t end, auto &&f)
+    {
+        parallel_for(n_thread, begin, end, f, 1);
+    };
+
+    std::vector<complex_type> random_grid(size_t n, unsigned seed)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<value_type> dist(-1, 1);
+        std::vector<complex_type> data(n * n * n);
+        for (auto &value : data)
+        {
+            value = {dist(gen), dist(gen)};
+        }
+        return data;
+    }
+
+    value_type max_abs_diff(const std::vector<complex_type> &x, const std::vector<complex_type> &y)
+    {
+        UTST_ASSERT_EQUAL(x.size(), y.size());
+        value_type diff = 0;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            diff = std::max(diff, std::abs(x[i] - y[i]));
+        }
+        return diff;
+    }
+
+    /// X_k = Sum(x_j * exp(-2 pi i j.k / n)), summed term by term
+    std::vector<complex_type> naive_dft(const std::vector<complex_type> &data, size_t n)
+    {
+        const value_type pi = std::acos(static_cast<value_type>(-1));
+        std::vector<complex_type> result(data.size(), 0);
+        for (size_t k = 0; k < data.size(); k++)
+        {
+            const size_t kx = k / (n * n), ky = k / n % n, kz = k % n;
+            complex_type sum = 0;
+            for (size_t j = 0; j < data.size(); j++)
+            {
+                const size_t jx = j / (n * n), jy = j / n % n, jz = j % n;
+                const size_t phase = (jx * kx + jy * ky + jz * kz) % n;
+                sum += data[j] * std::polar(static_cast<value_type>(1), -2 * pi * phase / n);
+            }
+            result[k] = sum;
+        }
+        return result;
+    }
+}
+
+UTST_TEST(fft_round_trip)
+{
+    for (const size_t n : {1, 2, 4, 8, 16, 32})
+    {
+        const std::vector<complex_type> input = random_grid(n, static_cast<unsigned>(n));
+
+        FFT_3D fft(n, 1);
+        std::vector<complex_type> data = input;
+        fft.forward(data, serial_for);
+        fft.inverse(data, serial_for);
+        UTST_ASSERT(max_abs_diff(input, data) < tolerance);
+
+        FFT_3D threaded_fft(n, n_thread);
+        std::vector<complex_type> threaded_data = input;
+        threaded_fft.forward(threaded_data, threaded_for);
+        threaded_fft.inverse(threaded_data, threaded_for);
+        UTST_ASSERT(max_abs_diff(input, threaded_data) < tolerance);
+    }
+}
+
+UTST_TEST(fft_against_naive_dft)
+{
+    for (const size_t n : {2, 4, 8})
+    {
+        const std::vector<complex_type> input = random_grid(n, 42);
+        const std::vector<complex_type> expected = naive_dft(input, n);
+
+        FFT_3D fft(n, n_thread);
+        std::vector<complex_type> data = input;
+        fft.forward(data, threaded_for);
+        UTST_ASSERT(max_abs_diff(expected, data) < tolerance);
+
+        // The inverse is the conjugate transform scaled by 1 / n^3
+        std::vector<complex_type> conjugate_input(input.size());
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            conjugate_input[i] = std::conj(input[i]);
+        }
+        const std::vector<complex_type> conjugate_expected = naive_dft(conjugate_input, n);
+        data = input;
+        fft.inverse(data, threaded_for);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = std::conj(data[i]) * static_cast<value_type>(input.size());
+        }
+        UTST_ASSERT(max_abs_diff(conjugate_expected, data) < tolerance);
+    }
+}
+
+UTST_TEST(fft_plane_wave)
+{
+    // A single mode transforms to a single nonzero coefficient n^3, on grids with several line batches per axis
+    for (const size_t n : {16, 32})
+    {
+        const value_type pi = std::acos(static_cast<value_type>(-1));
+        const size_t mx = 3, my = n - 1, mz = 5;
+        std::vector<complex_type> data(n * n * n);
+        for (size_t j = 0; j < data.size(); j++)
+        {
+            const size_t jx = j / (n * n), jy = j / n % n, jz = j % n;
+            const size_t phase = (jx * mx + jy * my + jz * mz) % n;
+            data[j] = std::polar(static_cast<value_type>(1), 2 * pi * phase / n);
+        }
+
+        FFT_3D fft(n, n_thread);
+        fft.forward(data, threaded_for);
+        std::vector<complex_type> expected(data.size(), 0);
+        expected[(mx * n + my) * n + mz] = static_cast<value_type>(data.size());
+        UTST_ASSERT(max_abs_diff(expected, data) < tolerance * data.size());
+    }
+}
@@ -0,0 +1,192 @@
+#include "core/utst.hpp"
+#include "threading.h"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace CPUSIM;
+
+UTST_MAIN();
+
+namespace
+{
+    constexpr size_t n_thread = 4;
+
+    /// Work growing with i, so that the first static chunks finish early and the other threads steal
+    float skewed_work(size_t i)
+    {
+        float sum = 0;
+        for (size_t k = 0; k < i; k++)
+        {
+            sum += std::sqrt(static_cast<float>(k));
+        }
+        return sum;
+    }
+
+    /// Runs parallel_for over [begin, end) repeatedly, and checks that every index ran exactly once, on a valid thread
+    template <typename ParallelFor>
+    void check_every_index_once(ParallelFor &&parallel_for_helper, size_t begin, size_t end, size_t grain_size, int n_repetition)
+    {
+        std::vector<std::atomic<int>> n_run(end);
+        std::atomic<float> sink{0};
+        for (int i_repetition = 0; i_repetition < n_repetition; i_repetition++)
+        {
+            for (auto &n : n_run)
+            {
+                n.store(0, std::memory_order_relaxed);
+            }
+            std::atomic<bool> is_thread_id_valid{true};
+            auto f = [&](size_t i, size_t thread_id)
+            {
+                n_run[i].fetch_add(1, std::memory_order_relaxed);
+                if (thread_id >= n_thread)
+                {
+                    is_thread_id_valid = false;
+                }
+                sink.store(skewed_work(i), std::memory_order_relaxed);
+            };
+            parallel_for_helper(begin, end, f, grain_size);
+
+            UTST_ASSERT(is_thread_id_valid.load());
+            for (size_t i = 0; i < end; i++)
+            {
+                UTST_ASSERT_EQUAL(i < begin ? 0 : 1, n_run[i].load());
+            }
+        }
+    }
+}
+
+UTST_TEST(parallel_for_skewed)
+{
+    auto parallel_for_helper = [](size_t begin, size_t end, auto &&f, size_t grain_size)
+    {
+        parallel_for(n_thread, begin, end, f, grain_size);
+    };
+    check_every_index_once(parallel_for_helper, 0, 1000, 1, 200);
+    check_every_index_once(parallel_for_helper, 7, 1003, 3, 100);
+    // Fewer indices than threads
+    check_every_index_once(parallel_for_helper, 0, 3, 1, 100);
+    // Default grain size
+    check_every_index_once(parallel_for_helper, 0, 1000, 0, 100);
+}
+
+UTST_TEST(parallel_for_skewed_on_thread_pool)
+{
+    THREAD_POOL thread_pool(n_thread);
+    auto parallel_for_helper = [&thread_pool](size_t begin, size_t end, auto &&f, size_t grain_size)
+    {
+        parallel_for(thread_pool, begin, end, f, grain_size);
+    };
+    check_every_index_once(parallel_for_helper, 0, 1000, 1, 500);
+    check_every_index_once(parallel_for_helper, 7, 1003, 3, 200);
+    check_every_index_once(parallel_for_helper, 0, 3, 1, 200);
+    check_every_index_once(parallel_for_helper, 0, 1000, 0, 200);
+}
+
+UTST_TEST(thread_pool_reused)
+{
+    constexpr int n_launch = 5000;
+    THREAD_POOL thread_pool(n_thread);
+    UTST_ASSERT_EQUAL(n_thread, thread_pool.size());
+
+    // Plain counters: run() returns only after every worker is done, which publishes their writes
+    std::vector<int> n_run(n_thread, 0);
+    for (int i_launch = 0; i_launch < n_launch; i_launch++)
+    {
+        thread_pool.run([&n_run](size_t thread_id)
+                        { n_run[thread_id]++; });
+        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+        {
+            UTST_ASSERT_EQUAL(i_launch + 1, n_run[thread_id]);
+        }
+    }
+
+    // Again after a resize, with another number of workers
+    thread_pool.resize(2);
+    UTST_ASSERT_EQUAL(2, thread_pool.size());
+    std::vector<int> n_run_resized(2, 0);
+    for (int i_launch = 0; i_launch < n_launch; i_launch++)
+    {
+        thread_pool.run([&n_run_resized](size_t thread_id)
+                        { n_run_resized[thread_id]++; });
+    }
+    UTST_ASSERT_EQUAL(n_launch, n_run_resized[0]);
+    UTST_ASSERT_EQUAL(n_launch, n_run_resized[1]);
+
+    thread_pool.reset();
+    UTST_ASSERT_EQUAL(0, thread_pool.size());
+}
+
+UTST_TEST(sense_reversing_barrier_reused)
+{
+    constexpr int n_generation = 20000;
+    for (const int spin_count : {0, 1000})
+    {
+        SENSE_REVERSING_BARRIER barrier(n_thread, spin_count);
+        // Written by its thread before the barrier, read by every thread after it
+        std::vector<int> generations(n_thread, -1);
+        std::vector<int> n_mismatch(n_thread, 0);
+
+        std::vector<std::thread> threads;
+        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+        {
+            threads.emplace_back([&, thread_id]()
+                                 {
+                                     bool local_sense = false;
+                                     for (int generation = 0; generation < n_generation; generation++)
+                                     {
+                                         generations[thread_id] = generation;
+                                         barrier.arrive_and_wait(local_sense);
+                                         for (size_t other_thread_id = 0; other_thread_id < n_thread; other_thread_id++)
+                                         {
+                                             n_mismatch[thread_id] += generations[other_thread_id] != generation;
+                                         }
+                                         // Nobody writes the next generation before everybody has read this one
+                                         barrier.arrive_and_wait(local_sense);
+                                     }
+                                 });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+        {
+            UTST_ASSERT_EQUAL(0, n_mismatch[thread_id]);
+        }
+    }
+}
+
+UTST_TEST(futex_word_ping_pong)
+{
+    constexpr uint32_t n_generation = 20000;
+    for (const int spin_count : {0, 1000})
+    {
+        FUTEX_WORD ping;
+        FUTEX_WORD pong;
+        // Handed over from one thread to the other by the words
+        uint32_t payload = 0;
+        uint32_t n_mismatch = 0;
+
+        std::thread ponger([&]()
+                           {
+                               for (uint32_t generation = 0; generation < n_generation; generation++)
+                               {
+                                   ping.wait_while_equal(generation, spin_count);
+                                   n_mismatch += payload != generation + 1 || ping.load() != generation + 1;
+                                   pong.store_and_notify_all(generation + 1);
+                               }
+                           });
+        for (uint32_t generation = 0; generation < n_generation; generation++)
+        {
+            payload = generation + 1;
+            ping.store_and_notify_all(generation + 1);
+            pong.wait_while_equal(generation, spin_count);
+            UTST_ASSERT_EQUAL(generation + 1, pong.load());
+        }
+        ponger.join();
+        UTST_ASSERT_EQUAL(0, n_mismatch);
+    }
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+
+#include "core/cxxopts.hpp"
+#include "threading.h"
+
+/// Launch-to-completion latency of THREAD_POOL::run with an empty task,
+/// i.e., the dispatch and synchronization overhead paid by every parallel_for_helper call.
+/// parallel_for with one std::thread per launch is measured as a reference.
+
+namespace
+{
+    using CLOCK = std::chrono::steady_clock;
+
+    auto parse_args(int argc, const char *argv[])
+    {
+        cxxopts::Options options(argv[0]);
+        options
+            .positional_help("[optional args]")
+            .show_positional_help()
+            .set_tab_expansion()
+            .allow_unrecognised_options();
+
+        auto option_group = options.add_options();
+        option_group("t,num_threads", "num_threads in the pool: optional (default 4)", cxxopts::value<int>()->default_value("4"));
+        option_group("n,num_launches", "num_launches to measure: optional (default 100000)", cxxopts::value<int>()->default_value("100000"));
+        option_group("h,help", "Print usage");
+
+        auto result = options.parse(argc, argv);
+
+        if (result.count("help"))
+        {
+            std::cout << options.help() << std::endl;
+            exit(0);
+        }
+
+        return result;
+    }
+
+    /// Runs launch() n_launch times, and prints the latency distribution in nanoseconds
+    template <typename Launch>
+    void measure(const std::string &name, int n_launch, Launch &&launch)
+    {
+        // Warm up, e.g., to let the workers reach their wait loop
+        for (int i_launch = 0; i_launch < std::min(n_launch, 100); i_launch++)
+        {
+            launch();
+        }
+
+        std::vector<double> latencies_ns(n_launch);
+        for (int i_launch = 0; i_launch < n_launch; i_launch++)
+        {
+            const auto start = CLOCK::now();
+            launch();
+            latencies_ns[i_launch] = std::chrono::duration<double, std::nano>(CLOCK::now() - start).count();
+        }
+        std::sort(latencies_ns.begin(), latencies_ns.end());
+
+        double sum_ns = 0;
+        for (double latency_ns : latencies_ns)
+        {
+            sum_ns += latency_ns;
+        }
+        auto percentile = [&latencies_ns](double p)
+        {
+            return latencies_ns[static_cast<size_t>(p * (latencies_ns.size() - 1))];
+        };
+        std::cout << name << ": mean " << sum_ns / n_launch << " ns"
+                  << ", p50 " << percentile(0.5) << " ns"
+                  << ", p99 " << percentile(0.99) << " ns"
+                  << ", max " << latencies_ns.back() << " ns" << std::endl;
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    const auto arg_result = parse_args(argc, argv);
+    const int n_thread = arg_result["num_threads"].as<int>();
+    const int n_launch = arg_result["num_launches"].as<int>();
+
+    std::cout << "n_thread: " << n_thread << std::endl;
+    std::cout << "n_launch: " << n_launch << std::endl;
+    std::cout << "hardware_concurrency: " << std::thread::hardware_concurrency() << std::endl;
+
+    CPUSIM::THREAD_POOL thread_pool(n_thread);
+    std::atomic<size_t> n_run{0};
+
+    measure("THREAD_POOL::run", n_launch,
+            [&thread_pool, &n_run]()
+            {
+                thread_pool.run([&n_run](size_t)
+                                { n_run.fetch_add(1, std::memory_order_relaxed); });
+            });
+
+    measure("parallel_for(THREAD_POOL)", n_launch,
+            [&thread_pool, &n_run, n_thread]()
+            {
+                CPUSIM::parallel_for(thread_pool, 0, n_thread, [&n_run](size_t)
+                                     { n_run.fetch_add(1, std::memory_order_relaxed); });
+            });
+
+    // Spawning threads is much slower, so fewer launches are enough
+    measure("parallel_for(std::thread)", std::max(n_launch / 100, 1),
+            [&n_run, n_thread]()
+            {
+                CPUSIM::parallel_for(n_thread, 0, n_thread, [&n_run](size_t)
+                                     { n_run.fetch_add(1, std::memory_order_relaxed); });
+            });
+
+    std::cout << "n_run: " << n_run.load() << std::endl;
+    return 0;
+}
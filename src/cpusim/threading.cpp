@@ -1,27 +1,148 @@
 #include "threading.h"
 
+#include <limits>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace CPUSIM
 {
+    namespace
+    {
+        inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        /// Sleeps while *word == old_value, may wake up spuriously
+        void futex_wait(std::atomic<uint32_t> &word, uint32_t old_value)
+        {
+#if defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, old_value, nullptr, nullptr, 0);
+#else
+            (void)word;
+            (void)old_value;
+            std::this_thread::yield();
+#endif
+        }
+
+        void futex_wake_all(std::atomic<uint32_t> &word)
+        {
+#if defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, std::numeric_limits<int>::max(), nullptr, nullptr, 0);
+#else
+            (void)word;
+#endif
+        }
+    }
+
+    int default_spin_count(size_t n_busy_thread)
+    {
+        const size_t n_hardware_thread = std::thread::hardware_concurrency();
+        return (n_hardware_thread == 0 || n_busy_thread > n_hardware_thread) ? 0 : 4096;
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+                  "FUTEX_WORD needs std::atomic<uint32_t> to be a plain 32-bit word");
+
+    void FUTEX_WORD::store_and_notify_all(uint32_t value)
+    {
+        // seq_cst on both sides: either the waiter sees the new value, or the notifier sees the sleeper
+        value_.store(value, std::memory_order_seq_cst);
+        if (n_sleeper_.load(std::memory_order_seq_cst) > 0)
+        {
+            futex_wake_all(const_cast<std::atomic<uint32_t> &>(value_));
+        }
+    }
+
+    void FUTEX_WORD::wait_while_equal(uint32_t old_value, int spin_count) const
+    {
+        for (int i_spin = 0; i_spin < spin_count; i_spin++)
+        {
+            if (value_.load(std::memory_order_acquire) != old_value)
+            {
+                return;
+            }
+            cpu_relax();
+        }
+
+        while (value_.load(std::memory_order_acquire) == old_value)
+        {
+            n_sleeper_.fetch_add(1, std::memory_order_seq_cst);
+            if (value_.load(std::memory_order_seq_cst) == old_value)
+            {
+                futex_wait(const_cast<std::atomic<uint32_t> &>(value_), old_value);
+            }
+            n_sleeper_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void SENSE_REVERSING_BARRIER::arrive_and_wait(bool &local_sense)
+    {
+        local_sense = !local_sense;
+        if (n_remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // Last to arrive: re-arm before releasing, since the released ones may arrive again right away
+            n_remaining_.store(n_participant_, std::memory_order_relaxed);
+            sense_.store_and_notify_all(local_sense ? 1 : 0);
+        }
+        else
+        {
+            sense_.wait_while_equal(local_sense ? 0 : 1, spin_count_);
+        }
+    }
+
     THREAD_POOL::THREAD_POOL(size_t n_thread)
     {
         resize(n_thread);
     }
 
-    void THREAD_POOL::reset()
+    void THREAD_POOL::worker_loop(STATE &state, size_t thread_id)
+    {
+        uint32_t seen_generation = 0;
+        bool local_sense = false;
+        while (true)
+        {
+            state.generation.wait_while_equal(seen_generation, state.spin_count);
+            seen_generation = state.generation.load();
+            if (state.is_stopping)
+            {
+                break;
+            }
+            state.task_invoker(state.task, thread_id);
+            state.barrier.arrive_and_wait(local_sense);
+        }
+    }
+
+    void THREAD_POOL::launch(task_invoker_type task_invoker, void *task)
     {
-        auto thread_quit_event = []()
-        { return false; };
+        ASSERT(state_ptr_);
+        STATE &state = *state_ptr_;
+        // Published by the release in store_and_notify_all, and
+        // not touched again before every worker has passed the barrier
+        state.task_invoker = task_invoker;
+        state.task = task;
+        state.generation.store_and_notify_all(state.generation.load() + 1);
+        state.barrier.arrive_and_wait(state.launcher_sense);
+    }
 
-        const size_t n_thread = size();
-        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+    void THREAD_POOL::reset()
+    {
+        if (state_ptr_)
+        {
+            state_ptr_->is_stopping = true;
+            state_ptr_->generation.store_and_notify_all(state_ptr_->generation.load() + 1);
+        }
+        for (auto &thread : threads_)
         {
-            bool is_sent = threads_launch_channel_[thread_id]
-                               .try_send(thread_quit_event);
-            ASSERT(is_sent);
-            threads_[thread_id].join();
+            thread.join();
         }
         threads_.clear();
-        threads_launch_channel_.clear();
+        state_ptr_.reset();
     }
 
     void THREAD_POOL::resize(size_t n_thread)
@@ -33,25 +154,78 @@ namespace CPUSIM
             return;
         }
 
-        threads_launch_channel_.resize(n_thread);
+        state_ptr_ = std::make_unique<STATE>(n_thread, default_spin_count(n_thread + 1));
         threads_.reserve(n_thread);
         for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
         {
-            auto thread_worker = [&ch = threads_launch_channel_[thread_id]]()
+            threads_.emplace_back(worker_loop, std::ref(*state_ptr_), thread_id);
+        }
+    }
+
+    RANGE_DEQUE *acquire_range_deques(size_t n_thread)
+    {
+        thread_local std::vector<RANGE_DEQUE> deques;
+        if (deques.size() < n_thread)
+        {
+            deques = std::vector<RANGE_DEQUE>(n_thread);
+        }
+        return deques.data();
+    }
+
+    void RANGE_DEQUE::lock()
+    {
+        while (is_locked_.test_and_set(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void RANGE_DEQUE::push_bottom(INDEX_RANGE range)
+    {
+        lock();
+        if (bottom_ == capacity)
+        {
+            // Steals only advance top_, so compact the live ranges to the front
+            std::copy(ranges_ + top_, ranges_ + bottom_, ranges_);
+            bottom_ -= top_;
+            top_ = 0;
+        }
+        ASSERT(bottom_ < capacity);
+        ranges_[bottom_++] = range;
+        unlock();
+    }
+
+    bool RANGE_DEQUE::pop_bottom(INDEX_RANGE &range)
+    {
+        lock();
+        const bool is_popped = top_ < bottom_;
+        if (is_popped)
+        {
+            range = ranges_[--bottom_];
+            if (top_ == bottom_)
             {
-                while (true)
-                {
-                    thread_event_type event = ch.receive(); // Blocking wait
-                    bool should_continue = event();
-                    if (!should_continue)
-                    {
-                        break;
-                    }
-                }
-            };
-            threads_.emplace_back(std::move(thread_worker));
+                top_ = 0;
+                bottom_ = 0;
+            }
         }
-        ASSERT(threads_launch_channel_.size() == threads_.size());
+        unlock();
+        return is_popped;
     }
 
+    bool RANGE_DEQUE::steal_top(INDEX_RANGE &range)
+    {
+        lock();
+        const bool is_stolen = top_ < bottom_;
+        if (is_stolen)
+        {
+            range = ranges_[top_++];
+            if (top_ == bottom_)
+            {
+                top_ = 0;
+                bottom_ = 0;
+            }
+        }
+        unlock();
+        return is_stolen;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <thread>
+#include <atomic>
+#include <cstdint>
 #include <type_traits>
 #include <optional>
 #include <mutex>
@@ -7,43 +9,56 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <algorithm>
 #include "core/macros.hpp"
 
 namespace CPUSIM
 {
-    /// A channel with capacity 1 that supports backpressure.
-    /// 1. The channel has a capacity of 1, i.e., no buffering.
-    /// 2. A send call fulfills the channel, and holds the content until
-    ///    a receive call happens.
-    ///    The try_send call is non-blocking:
-    ///    If the channel is empty, it populates the channel right away;
-    ///    If the channel is full, it immediately fails.
-    /// 3. A receive call clears out the channel.
-    ///    The receive call is blocking:
-    ///    If the channel is full, it clears the channel right away;
-    ///    If the channel is empty, it blocks and waits until the channel is full.
-    /// 4. A single send call pairs with a single receive call.
-    /// std::condition_variable: https://en.cppreference.com/w/cpp/thread/condition_variable
-    template <typename T>
-    class CHANNEL_LITE
+    /// A 32-bit word that threads can block on until it changes:
+    /// waiters spin for a while first, then sleep in the kernel (a futex on Linux).
+    /// Waking is skipped entirely when nobody sleeps.
+    class FUTEX_WORD
     {
     public:
-        CHANNEL_LITE() : state_ptr_(std::make_unique<STATE>()) {}
+        uint32_t load() const { return value_.load(std::memory_order_acquire); }
+        /// Publishes value, and wakes up all the waiters
+        void store_and_notify_all(uint32_t value);
+        /// Blocks while the word equals old_value, spinning at most spin_count times before sleeping
+        void wait_while_equal(uint32_t old_value, int spin_count) const;
 
-        // False if the channel is already full; True if successfully sent
-        [[nodiscard]] bool try_send(T data);
-        T receive();
+    private:
+        std::atomic<uint32_t> value_{0};
+        mutable std::atomic<uint32_t> n_sleeper_{0};
+    };
+
+    /// Spin count for FUTEX_WORD waits among n_busy_thread threads:
+    /// spinning only pays off when every thread has a hardware thread of its own, otherwise 0
+    int default_spin_count(size_t n_busy_thread);
+
+    /// Barrier for a fixed number of participants.
+    /// The last one to arrive flips the shared sense, which releases the others.
+    /// Every participant keeps its own local sense, so the barrier is reusable right away, without a reset phase.
+    class SENSE_REVERSING_BARRIER
+    {
+    public:
+        explicit SENSE_REVERSING_BARRIER(size_t n_participant, int spin_count = 0)
+            : n_participant_(n_participant), spin_count_(spin_count), n_remaining_(n_participant) {}
+
+        /// local_sense: owned by the calling thread, false before its first arrival
+        void arrive_and_wait(bool &local_sense);
 
     private:
-        struct STATE
-        {
-            std::optional<T> parcel;
-            std::mutex mutex;
-            std::condition_variable cv_has_parcel;
-        };
-        std::unique_ptr<STATE> state_ptr_;
+        const size_t n_participant_;
+        const int spin_count_;
+        alignas(64) std::atomic<size_t> n_remaining_;
+        alignas(64) FUTEX_WORD sense_;
     };
 
+    /// Persistent worker threads, launched without any allocation or lock:
+    /// 1. run() publishes the task as a type-erased pointer, and bumps the launch generation
+    /// 2. Workers wait (spin, then futex) for the generation to change, then run the task
+    /// 3. Workers and the launching thread meet at a SENSE_REVERSING_BARRIER, after which run() returns
+    /// Spinning is disabled when the workers and the launching thread outnumber the hardware threads.
     class THREAD_POOL
     {
     public:
@@ -51,6 +66,9 @@ namespace CPUSIM
         explicit THREAD_POOL(size_t n_thread);
         ~THREAD_POOL() { reset(); }
 
+        THREAD_POOL(THREAD_POOL &&) = default;
+        THREAD_POOL &operator=(THREAD_POOL &&) = delete;
+
         // Function signature: void(size_t thread_id)
         template <typename Function>
         void run(Function &&f);
@@ -63,82 +81,101 @@ namespace CPUSIM
         void resize(size_t n_thread);
 
     private:
-        using thread_event_type = std::function<bool()>; // true to continue thread event loop; false to terminate
-        using thread_event_launch_channel = CHANNEL_LITE<thread_event_type>;
+        using task_invoker_type = void (*)(void *task, size_t thread_id);
+
+        /// Shared with the workers, so it stays put even if the pool is moved
+        struct STATE
+        {
+            STATE(size_t n_thread, int spin_count) : spin_count(spin_count), barrier(n_thread + 1, spin_count) {}
+
+            const int spin_count;
+            alignas(64) FUTEX_WORD generation; // Bumped once per launch
+            task_invoker_type task_invoker = nullptr;
+            void *task = nullptr;
+            bool is_stopping = false;
+            SENSE_REVERSING_BARRIER barrier; // Workers and the launching thread
+            bool launcher_sense = false;
+        };
+
+        static void worker_loop(STATE &state, size_t thread_id);
+        void launch(task_invoker_type task_invoker, void *task);
+
         std::vector<std::thread> threads_;
-        std::vector<thread_event_launch_channel> threads_launch_channel_;
+        std::unique_ptr<STATE> state_ptr_;
+    };
+
+    /// A range of loop indices [begin, end)
+    struct INDEX_RANGE
+    {
+        size_t begin;
+        size_t end;
+
+        size_t size() const { return end - begin; }
+    };
+
+    /// Per-worker double-ended queue of INDEX_RANGE for work stealing, guarded by a spinlock.
+    /// The owner pushes and pops at the bottom, i.e., the most recently split range, which is the smallest and cache-warm;
+    /// thieves steal from the top, i.e., the oldest range, which is the largest.
+    class alignas(64) RANGE_DEQUE
+    {
+    public:
+        /// Lazy binary splitting pushes at most one range per halving, so 64 levels always fit
+        static constexpr size_t capacity = 128;
+
+        void push_bottom(INDEX_RANGE range);
+        [[nodiscard]] bool pop_bottom(INDEX_RANGE &range);
+        [[nodiscard]] bool steal_top(INDEX_RANGE &range);
+
+    private:
+        void lock();
+        void unlock() { is_locked_.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag is_locked_ = ATOMIC_FLAG_INIT;
+        size_t top_ = 0;
+        size_t bottom_ = 0;
+        INDEX_RANGE ranges_[capacity];
     };
 
+    /// n_thread empty deques, cached per calling thread, so that a parallel_for does not allocate.
+    /// Every parallel_for drains all its deques before returning, so they are empty again for the next one.
+    RANGE_DEQUE *acquire_range_deques(size_t n_thread);
+
+    /// The grain size picked when 0 is passed: about 16 chunks per thread
+    inline size_t default_grain_size(size_t count, size_t n_thread)
+    {
+        return std::max<size_t>(count / (16 * std::max<size_t>(n_thread, 1)), 1);
+    }
+
     /// Function signature: void(size_t i)
     ///                     void(size_t i, size_t thread_id)
+    /// grain_size: the max number of consecutive indices run as one stealable chunk, 0 for default_grain_size()
     template <typename Function>
-    void parallel_for(THREAD_POOL &thread_pool, size_t begin, size_t end, Function &&f);
+    void parallel_for(THREAD_POOL &thread_pool, size_t begin, size_t end, Function &&f, size_t grain_size = 0);
 
     /// Function signature: void(size_t i)
     ///                     void(size_t i, size_t thread_id)
+    /// grain_size: the max number of consecutive indices run as one stealable chunk, 0 for default_grain_size()
     template <typename Function>
-    void parallel_for(size_t n_thread, size_t begin, size_t end, Function &&f);
+    void parallel_for(size_t n_thread, size_t begin, size_t end, Function &&f, size_t grain_size = 0);
 
     /// Implementation
 
-    template <typename T>
-    bool CHANNEL_LITE<T>::try_send(T data)
-    {
-        std::lock_guard<std::mutex> lock_guard(state_ptr_->mutex);
-        if (state_ptr_->parcel.has_value())
-        {
-            return false;
-        }
-        else
-        {
-            state_ptr_->parcel.emplace(std::move(data));
-        }
-        state_ptr_->cv_has_parcel.notify_one();
-        return true;
-    }
-
-    template <typename T>
-    T CHANNEL_LITE<T>::receive()
-    {
-        std::unique_lock<std::mutex> unique_lock(state_ptr_->mutex);
-        state_ptr_->cv_has_parcel
-            .wait(unique_lock, [this]()
-                  { return state_ptr_->parcel.has_value(); });
-        T data = std::move(state_ptr_->parcel.value());
-        state_ptr_->parcel.reset();
-        return data;
-    }
-
     template <typename Function>
     void THREAD_POOL::run(Function &&f)
     {
-        typename std::decay_t<Function> f_copy = std::forward<Function>(f);
-        const size_t n_thread = size();
-        std::vector<CHANNEL_LITE<int> > finish_synchs(n_thread); // The actual data does not matter
-
-        // Launch
-        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
-        {
-            bool is_sent =
-                threads_launch_channel_[thread_id]
-                    .try_send([f_copy, thread_id, &finish_synch = finish_synchs[thread_id]]
-                              {
-                                  f_copy(thread_id);
-                                  bool is_sent = finish_synch.try_send(1);
-                                  ASSERT(is_sent);
-                                  return true;
-                              });
-            ASSERT(is_sent);
-        }
-
-        // Synchronize
-        for (auto &finish_synch : finish_synchs)
-        {
-            finish_synch.receive(); // Blocking wait
-        }
+        using TASK = std::remove_reference_t<Function>;
+        // f outlives the launch, since launch() returns only after every worker is done
+        launch([](void *task, size_t thread_id)
+               { (*static_cast<TASK *>(task))(thread_id); },
+               const_cast<void *>(static_cast<const void *>(std::addressof(f))));
     }
 
-    /// Prepare the Function f to be ready to run on multiple threads.
+    /// Prepare the Function f to be ready to run on multiple threads, with work stealing.
+    /// Every thread starts with an equal static chunk of [begin, end) in its RANGE_DEQUE.
+    /// A thread splits the range it takes in halves down to grain_size, leaving the upper halves in its deque,
+    /// and once its deque is empty, it steals the largest range left in another thread's deque.
+    /// So balanced loops run as static chunks, while irregular ones (e.g., triangular loops, tree walks) balance out.
     /// Function signature: void(size_t i)
     ///                     void(size_t i, size_t thread_id)
     ///     The main body of the task to be run in a for loop.
@@ -147,40 +184,95 @@ namespace CPUSIM
     /// ThreadTask signature: void(size_t thread_id)
     ///     A task that can be run on a thread directly.
     template <typename Executor, typename Function>
-    void parallel_for_impl(Executor &&executor, size_t n_thread, size_t begin, size_t end, Function &&f)
+    void parallel_for_impl(Executor &&executor, size_t n_thread, size_t begin, size_t end, Function &&f, size_t grain_size)
     {
-        size_t count = end - begin;
-        size_t count_per_thread = (count - 1) / n_thread + 1;
+        if (begin >= end)
+        {
+            return;
+        }
+        const size_t count = end - begin;
+        if (grain_size == 0)
+        {
+            grain_size = default_grain_size(count, n_thread);
+        }
+
+        RANGE_DEQUE *deques = acquire_range_deques(n_thread);
+        const size_t count_per_thread = (count - 1) / n_thread + 1;
+        for (size_t thread_id = 0; thread_id < n_thread; thread_id++)
+        {
+            const size_t i_begin = std::min(begin + thread_id * count_per_thread, end);
+            const size_t i_end = std::min(i_begin + count_per_thread, end);
+            if (i_begin < i_end)
+            {
+                deques[thread_id].push_bottom({i_begin, i_end});
+            }
+        }
+        std::atomic<size_t> n_remaining{count};
 
         // Launch and synchronize
-        executor([f = std::forward<Function>(f), begin, end, n_thread, count_per_thread](size_t thread_id)
+        executor([&f, deques, &n_remaining, n_thread, grain_size](size_t thread_id)
                  {
-                     size_t i_begin = begin + thread_id * count_per_thread;
-                     size_t i_end = (thread_id == n_thread - 1) ? end : (i_begin + count_per_thread);
-                     for (size_t i = i_begin; i < i_end; i++)
+                     RANGE_DEQUE &own_deque = deques[thread_id];
+                     auto run_range = [&f, &own_deque, &n_remaining, grain_size, thread_id](INDEX_RANGE range)
+                     {
+                         while (range.size() > grain_size)
+                         {
+                             const size_t middle = range.begin + range.size() / 2;
+                             own_deque.push_bottom({middle, range.end});
+                             range.end = middle;
+                         }
+                         for (size_t i = range.begin; i < range.end; i++)
+                         {
+                             if constexpr (std::is_invocable_v<Function, size_t, size_t>)
+                             {
+                                 f(i, thread_id);
+                             }
+                             else
+                             {
+                                 f(i);
+                             }
+                         }
+                         n_remaining.fetch_sub(range.size(), std::memory_order_acq_rel);
+                     };
+
+                     INDEX_RANGE range{0, 0};
+                     while (true)
                      {
-                         if constexpr (std::is_invocable_v<Function, size_t, size_t>)
+                         if (own_deque.pop_bottom(range))
+                         {
+                             run_range(range);
+                             continue;
+                         }
+                         bool is_stolen = false;
+                         for (size_t k = 1; k < n_thread && !is_stolen; k++)
+                         {
+                             is_stolen = deques[(thread_id + k) % n_thread].steal_top(range);
+                         }
+                         if (is_stolen)
                          {
-                             f(i, thread_id);
+                             run_range(range);
+                             continue;
                          }
-                         else
+                         // Nothing to steal, but a range being run may still be split
+                         if (n_remaining.load(std::memory_order_acquire) == 0)
                          {
-                             f(i);
+                             break;
                          }
+                         std::this_thread::yield();
                      }
                  });
     }
 
     template <typename Function>
-    void parallel_for(THREAD_POOL &thread_pool, size_t begin, size_t end, Function &&f)
+    void parallel_for(THREAD_POOL &thread_pool, size_t begin, size_t end, Function &&f, size_t grain_size)
     {
         parallel_for_impl([&thread_pool](auto &&thread_task)
                           { thread_pool.run(thread_task); },
-                          thread_pool.size(), begin, end, std::forward<Function>(f));
+                          thread_pool.size(), begin, end, std::forward<Function>(f), grain_size);
     }
 
     template <typename Function>
-    void parallel_for(size_t n_thread, size_t begin, size_t end, Function &&f)
+    void parallel_for(size_t n_thread, size_t begin, size_t end, Function &&f, size_t grain_size)
     {
         // Define an executor
         auto executor = [n_thread](auto &&thread_task)
@@ -203,6 +295,6 @@ namespace CPUSIM
             }
         };
 
-        parallel_for_impl(std::move(executor), n_thread, begin, end, std::forward<Function>(f));
+        parallel_for_impl(std::move(executor), n_thread, begin, end, std::forward<Function>(f), grain_size);
     }
 }
\ No newline at end of file
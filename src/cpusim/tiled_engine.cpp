@@ -0,0 +1,145 @@
+#include "tiled_engine.h"
+#include "simd_kernel.h"
+
+#include <map>
+#include <algorithm>
+
+namespace CPUSIM
+{
+    template <typename T, size_t TILE_I, size_t TILE_J>
+    std::string TILED_ENGINE<T, TILE_I, TILE_J>::name()
+    {
+        return std::string("TILED_ENGINE_") + std::to_string(TILE_I) + "x" + std::to_string(TILE_J) + "_" + SIMD::isa_name + accumulation_suffix() + precision_suffix();
+    }
+
+    template <typename T, size_t TILE_I, size_t TILE_J>
+    void TILED_ENGINE<T, TILE_I, TILE_J>::compute_acceleration(SOA_XYZ_BASE<T> &acc,
+                                                               const SOA_XYZ_BASE<T> &pos,
+                                                               const CORE::ALIGNED_VECTOR<T> &mass,
+                                                               size_t n_body)
+    {
+        const size_t n_padded = soa_padded_size(n_body);
+        const size_t n_tile_i = (n_body + TILE_I - 1) / TILE_I;
+
+        SIMD::dispatch_accumulation(
+            accumulation(),
+            [this, n_body, n_padded, n_tile_i, &acc, &pos, &mass](auto accumulation)
+            {
+                constexpr SIMD::ACCUMULATION A = decltype(accumulation)::value;
+                parallel_for_helper(0, n_tile_i,
+                                    [n_body, n_padded, &acc, &pos, &mass](size_t i_tile)
+                                    {
+                                        const size_t i_begin = i_tile * TILE_I;
+                                        const size_t i_count = std::min(TILE_I, n_body - i_begin);
+
+                                        SIMD::field_type<A, T> tile_acc[TILE_I] = {};
+
+                                        // Full source tiles have a compile-time trip count
+                                        size_t j_begin = 0;
+                                        for (; j_begin + TILE_J <= n_padded; j_begin += TILE_J)
+                                        {
+                                            for (size_t i = 0; i < i_count; i++)
+                                            {
+                                                const size_t i_target_body = i_begin + i;
+                                                tile_acc[i] += SIMD::accumulate_field<A>(pos.x[i_target_body], pos.y[i_target_body], pos.z[i_target_body],
+                                                                                         pos.x.data(), pos.y.data(), pos.z.data(), mass.data(),
+                                                                                         j_begin, j_begin + TILE_J);
+                                            }
+                                        }
+                                        // Remainder source tile
+                                        if (j_begin < n_padded)
+                                        {
+                                            for (size_t i = 0; i < i_count; i++)
+                                            {
+                                                const size_t i_target_body = i_begin + i;
+                                                tile_acc[i] += SIMD::accumulate_field<A>(pos.x[i_target_body], pos.y[i_target_body], pos.z[i_target_body],
+                                                                                         pos.x.data(), pos.y.data(), pos.z.data(), mass.data(),
+                                                                                         j_begin, n_padded);
+                                            }
+                                        }
+
+                                        for (size_t i = 0; i < i_count; i++)
+                                        {
+                                            acc.set(i_begin + i, SIMD::narrow<T>(tile_acc[i]));
+                                        }
+                                    });
+            });
+    }
+
+    namespace
+    {
+        template <typename T>
+        using TILED_ENGINE_FACTORY = std::unique_ptr<CORE::ENGINE_BASE<T>> (*)(CORE::SOA_SYSTEM_STATE_BASE<T>, T, size_t, bool, SIMD::ACCUMULATION, std::optional<std::string>);
+        template <typename T>
+        using TILED_ENGINE_DISPATCH_TABLE = std::map<std::pair<size_t, size_t>, TILED_ENGINE_FACTORY<T>>;
+
+        template <typename T, size_t TILE_I, size_t TILE_J>
+        std::unique_ptr<CORE::ENGINE_BASE<T>> create_tiled_engine(CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic,
+                                                                  T dt,
+                                                                  size_t n_thread,
+                                                                  bool use_thread_pool,
+                                                                  SIMD::ACCUMULATION accumulation,
+                                                                  std::optional<std::string> system_state_log_dir_opt)
+        {
+            return std::make_unique<TILED_ENGINE<T, TILE_I, TILE_J>>(
+                std::move(system_state_ic), dt, n_thread, use_thread_pool, accumulation, std::move(system_state_log_dir_opt));
+        }
+
+        template <typename T, size_t TILE_I, size_t... TILE_JS>
+        void register_tiled_engines(TILED_ENGINE_DISPATCH_TABLE<T> &table)
+        {
+            (table.emplace(std::make_pair(TILE_I, TILE_JS), &create_tiled_engine<T, TILE_I, TILE_JS>), ...);
+        }
+
+        /// Precompiled specializations
+        /// A source tile of TILE_J float bodies takes 16 * TILE_J bytes (x, y, z, m), twice that for double:
+        /// 1024 fits in L1, 4096 and 16384 fit in L2.
+        template <typename T>
+        const TILED_ENGINE_DISPATCH_TABLE<T> &tiled_engine_dispatch_table()
+        {
+            static const TILED_ENGINE_DISPATCH_TABLE<T> table = []()
+            {
+                TILED_ENGINE_DISPATCH_TABLE<T> table;
+                register_tiled_engines<T, 1, 256, 1024, 4096, 16384>(table);
+                register_tiled_engines<T, 16, 256, 1024, 4096, 16384>(table);
+                register_tiled_engines<T, 64, 256, 1024, 4096, 16384>(table);
+                register_tiled_engines<T, 256, 256, 1024, 4096, 16384>(table);
+                return table;
+            }();
+            return table;
+        }
+    }
+
+    template <typename T>
+    std::unique_ptr<CORE::ENGINE_BASE<T>> make_tiled_engine(size_t tile_i,
+                                                            size_t tile_j,
+                                                            CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic,
+                                                            T dt,
+                                                            size_t n_thread,
+                                                            bool use_thread_pool,
+                                                            SIMD::ACCUMULATION accumulation,
+                                                            std::optional<std::string> system_state_log_dir_opt)
+    {
+        const auto &table = tiled_engine_dispatch_table<T>();
+        auto it = table.find({tile_i, tile_j});
+        if (it == table.end())
+        {
+            return nullptr;
+        }
+        return it->second(std::move(system_state_ic), dt, n_thread, use_thread_pool, accumulation, std::move(system_state_log_dir_opt));
+    }
+
+    std::vector<std::pair<size_t, size_t>> tiled_engine_tile_sizes()
+    {
+        std::vector<std::pair<size_t, size_t>> tile_sizes;
+        // The same for both precisions
+        for (const auto &[tile_size, factory] : tiled_engine_dispatch_table<CORE::UNIVERSE::floating_value_type>())
+        {
+            tile_sizes.push_back(tile_size);
+        }
+        return tile_sizes;
+    }
+
+    template std::unique_ptr<CORE::ENGINE_BASE<float>> make_tiled_engine(size_t, size_t, CORE::SOA_SYSTEM_STATE_BASE<float>, float, size_t, bool, SIMD::ACCUMULATION, std::optional<std::string>);
+    template std::unique_ptr<CORE::ENGINE_BASE<double>> make_tiled_engine(size_t, size_t, CORE::SOA_SYSTEM_STATE_BASE<double>, double, size_t, bool, SIMD::ACCUMULATION, std::optional<std::string>);
+}
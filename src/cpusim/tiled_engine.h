@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include "simd_engine.h"
+
+namespace CPUSIM
+{
+    /// SIMD_ENGINE with the i x j interaction space blocked into TILE_I targets x TILE_J sources,
+    /// so that a source tile is reused by all the targets of a target tile while it is hot in L1/L2,
+    /// instead of streaming all the source bodies from DRAM for every single target.
+    /// TILE_J must be a multiple of soa_padding.
+    /// T: floating type, instantiated for float and double
+    template <typename T, size_t TILE_I, size_t TILE_J>
+    class TILED_ENGINE final : public SIMD_ENGINE_BASE<T>
+    {
+        static_assert(TILE_I > 0, "TILE_I must be positive");
+        static_assert(TILE_J % soa_padding == 0, "TILE_J must be a multiple of soa_padding");
+
+    public:
+        virtual ~TILED_ENGINE() = default;
+
+        using SIMD_ENGINE_BASE<T>::SIMD_ENGINE_BASE;
+
+        virtual std::string name() override;
+
+    protected:
+        virtual void compute_acceleration(SOA_XYZ_BASE<T> &acc,
+                                          const SOA_XYZ_BASE<T> &pos,
+                                          const CORE::ALIGNED_VECTOR<T> &mass,
+                                          size_t n_body) override;
+
+        using SIMD_ENGINE_BASE<T>::accumulation;
+        using SIMD_ENGINE_BASE<T>::accumulation_suffix;
+        using SIMD_ENGINE_BASE<T>::precision_suffix;
+        using SIMD_ENGINE_BASE<T>::parallel_for_helper;
+    };
+
+    /// Runtime dispatch into the precompiled TILED_ENGINE specializations.
+    /// Returns nullptr if (tile_i, tile_j) is not precompiled.
+    /// Instantiated for float and double
+    template <typename T>
+    std::unique_ptr<CORE::ENGINE_BASE<T>> make_tiled_engine(size_t tile_i,
+                                                            size_t tile_j,
+                                                            CORE::SOA_SYSTEM_STATE_BASE<T> system_state_ic,
+                                                            T dt,
+                                                            size_t n_thread,
+                                                            bool use_thread_pool,
+                                                            SIMD::ACCUMULATION accumulation = SIMD::ACCUMULATION::FLOAT,
+                                                            std::optional<std::string> system_state_log_dir_opt = {});
+
+    /// All the (tile_i, tile_j) available to make_tiled_engine
+    std::vector<std::pair<size_t, size_t>> tiled_engine_tile_sizes();
+}
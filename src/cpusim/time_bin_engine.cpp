@@ -0,0 +1,212 @@
+#include "time_bin_engine.h"
+#include "core/timer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace CPUSIM
+{
+    template <typename T>
+    TIME_BIN_ENGINE_BASE<T>::BODIES::BODIES(size_t n_body)
+        : pos(n_body, {0, 0, 0}),
+          vel(n_body, {0, 0, 0}),
+          acc(n_body, {0, 0, 0}),
+          jerk(n_body, {0, 0, 0}),
+          mass(n_body, 0),
+          bin(n_body, 0),
+          step_begin_tick(n_body, 0)
+    {
+        active.reserve(n_body);
+    }
+
+    template <typename T>
+    TIME_BIN_ENGINE_BASE<T>::TIME_BIN_ENGINE_BASE(system_state_type system_state_ic,
+                                                  T dt,
+                                                  size_t n_thread,
+                                                  bool use_thread_pool,
+                                                  int max_bin,
+                                                  T eta,
+                                                  std::optional<std::string> system_state_log_dir_opt)
+        : BASIC_ENGINE_BASE<T>(std::move(system_state_ic), dt, n_thread, use_thread_pool, std::move(system_state_log_dir_opt)),
+          block_timestep_(dt, max_bin),
+          eta_(eta)
+    {
+        ASSERT(eta_ > 0);
+    }
+
+    template <typename T>
+    void TIME_BIN_ENGINE_BASE<T>::materialize_system_state(system_state_type &system_state)
+    {
+        const BODIES &bodies = *bodies_opt_;
+        system_state.resize(bodies.mass.size());
+        for (size_t i_body = 0; i_body < bodies.mass.size(); i_body++)
+        {
+            system_state.set_pos(i_body, bodies.pos[i_body]);
+            system_state.set_vel(i_body, bodies.vel[i_body]);
+        }
+        std::copy(bodies.mass.begin(), bodies.mass.end(), system_state.mass().begin());
+    }
+
+    template <typename T>
+    void TIME_BIN_ENGINE_BASE<T>::end_step(BODIES &bodies, size_t i_body, int64_t tick, T dt_wanted) const
+    {
+        bodies.bin[i_body] = block_timestep_.next_bin(bodies.bin[i_body], tick, dt_wanted);
+        bodies.step_begin_tick[i_body] = tick;
+    }
+
+    template <typename T>
+    typename TIME_BIN_ENGINE_BASE<T>::BODIES &TIME_BIN_ENGINE_BASE<T>::warm_start(CORE::TIMER &timer, bool &is_ic_logged)
+    {
+        if (bodies_opt_)
+        {
+            is_ic_logged = true;
+            return *bodies_opt_;
+        }
+        const system_state_type &system_state_ic = system_state_snapshot();
+        const size_t n_body = system_state_ic.size();
+        BODIES &bodies = bodies_opt_.emplace(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            bodies.pos[i_body] = system_state_ic.pos(i_body);
+            bodies.vel[i_body] = system_state_ic.vel(i_body);
+            bodies.mass[i_body] = system_state_ic.mass()[i_body];
+        }
+        timer.elapsed_previous("step1");
+
+        // The acceleration and the bins of the ic, unless a checkpoint has them
+        is_ic_logged = resumed_acceleration().has_value();
+        if (resumed_acceleration())
+        {
+            bodies.acc = *resumed_acceleration();
+            const size_t n_value = n_engine_value();
+            ASSERT(resumed_engine_values() && resumed_engine_values()->size() == n_body * n_value);
+            const std::vector<T> &engine_values = *resumed_engine_values();
+            for (size_t i_body = 0; i_body < n_body; i_body++)
+            {
+                set_engine_values(bodies, i_body, &engine_values[i_body * n_value]);
+            }
+        }
+        else
+        {
+            for (size_t i_body = 0; i_body < n_body; i_body++)
+            {
+                bodies.active.push_back(static_cast<uint32_t>(i_body));
+            }
+            // Predicted by 0, i.e., as they are
+            predict(bodies, 0, 0);
+            evaluate(bodies);
+            for (size_t i_body = 0; i_body < n_body; i_body++)
+            {
+                bodies.bin[i_body] = block_timestep_.bin_of(CORE::aarseth_timestep<T>(eta_, bodies.acc[i_body], bodies.jerk[i_body]));
+            }
+        }
+        timer.elapsed_previous("step2");
+        return bodies;
+    }
+
+    template <typename T>
+    void TIME_BIN_ENGINE_BASE<T>::step(BODIES &bodies)
+    {
+        const size_t n_body = bodies.mass.size();
+        const int64_t n_tick = block_timestep_.n_tick();
+
+        // Every body begins a step at tick 0
+        std::fill(bodies.step_begin_tick.begin(), bodies.step_begin_tick.end(), 0);
+
+        int64_t tick = 0;
+        while (tick < n_tick)
+        {
+            // To the end of the shortest step
+            const int finest_bin = n_body > 0 ? *std::max_element(bodies.bin.begin(), bodies.bin.end()) : 0;
+            const int64_t next_tick = block_timestep_.next_tick(finest_bin, tick);
+            predict(bodies, tick, next_tick);
+            tick = next_tick;
+
+            // Only the bodies ending their step
+            bodies.active.clear();
+            for (size_t i_body = 0; i_body < n_body; i_body++)
+            {
+                if (block_timestep_.is_active(bodies.bin[i_body], tick))
+                {
+                    bodies.active.push_back(static_cast<uint32_t>(i_body));
+                }
+            }
+            evaluate(bodies);
+            count_force_evaluations(bodies.active.size());
+            correct(bodies, tick);
+        }
+    }
+
+    template <typename T>
+    void TIME_BIN_ENGINE_BASE<T>::print_bins(const BODIES &bodies) const
+    {
+        std::vector<size_t> n_body_per_bin(block_timestep_.max_bin() + 1, 0);
+        for (const int bin : bodies.bin)
+        {
+            n_body_per_bin[bin]++;
+        }
+        std::cout << "Bodies per time bin:";
+        for (size_t bin = 0; bin < n_body_per_bin.size(); bin++)
+        {
+            std::cout << " " << n_body_per_bin[bin];
+        }
+        std::cout << std::endl;
+    }
+
+    template <typename T>
+    std::optional<typename TIME_BIN_ENGINE_BASE<T>::system_state_type> TIME_BIN_ENGINE_BASE<T>::execute(int n_iter, CORE::TIMER &timer)
+    {
+        // Step 1 and step 2 on the first execute() only
+        bool is_ic_logged = false;
+        BODIES &bodies = warm_start(timer, is_ic_logged);
+
+        auto generate_system_state = [this](system_state_type &system_state)
+        {
+            materialize_system_state(system_state);
+        };
+
+        // Core iteration loop
+        for (int i_iter = 0; i_iter < n_iter; i_iter++)
+        {
+            // Write SYSTEM_STATE to log, unless it has the ic already
+            if (i_iter == 0 && !is_ic_logged)
+            {
+                push_system_state_to_log(generate_system_state);
+            }
+
+            step(bodies);
+
+            push_system_state_to_log(generate_system_state);
+            if (i_iter % 10 == 0)
+            {
+                serialize_system_state_log();
+            }
+
+            timer.elapsed_previous(std::string("iter") + std::to_string(i_iter), CORE::TIMER::TRIGGER_LEVEL::INFO);
+
+            if (checkpoint_if_due(i_iter, [&](system_state_type &system_state, std::vector<CORE::ACC_BASE<T>> &acc, std::vector<T> &engine_values)
+                                  {
+                                      generate_system_state(system_state);
+                                      acc = bodies.acc;
+                                      const size_t n_value = n_engine_value();
+                                      engine_values.resize(bodies.mass.size() * n_value);
+                                      for (size_t i_body = 0; i_body < bodies.mass.size(); i_body++)
+                                      {
+                                          get_engine_values(bodies, i_body, &engine_values[i_body * n_value]);
+                                      }
+                                  }))
+            {
+                break;
+            }
+        }
+
+        timer.elapsed_previous("all_iters");
+        print_bins(bodies);
+
+        // Kept in bodies_opt_ for the next execute()
+        return std::nullopt;
+    }
+
+    template class TIME_BIN_ENGINE_BASE<float>;
+    template class TIME_BIN_ENGINE_BASE<double>;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "basic_engine.h"
+#include "core/block_timestep.h"
+
+namespace CPUSIM
+{
+    /// Direct summation on the hierarchical block time steps of CORE::BLOCK_TIMESTEP_BASE, dt being the coarsest step,
+    /// for any scheme stepping a body from its acceleration and jerk.
+    /// At each tick ending the step of some bins, all the bodies are predicted to it, and only the bodies of those bins get
+    /// their acceleration and jerk evaluated, then are corrected and take their next bin. The first bins follow
+    /// CORE::aarseth_timestep() from the acceleration and jerk of the ic.
+    /// The SYSTEM_STATE is logged and checkpointed at the end of every iteration, when all the bodies are synchronized.
+    /// A scheme defines predict(), evaluate() and correct(), and what a checkpoint keeps of a body.
+    /// T: floating type, instantiated for float and double
+    template <typename T>
+    class TIME_BIN_ENGINE_BASE : public BASIC_ENGINE_BASE<T>
+    {
+    public:
+        using typename BASIC_ENGINE_BASE<T>::system_state_type;
+
+        virtual ~TIME_BIN_ENGINE_BASE() = default;
+
+        /// max_bin: the finest bin steps dt / 2^max_bin
+        /// eta: accuracy of the time step criterion, smaller for shorter steps
+        TIME_BIN_ENGINE_BASE(system_state_type system_state_ic,
+                             T dt,
+                             size_t n_thread,
+                             bool use_thread_pool,
+                             int max_bin,
+                             T eta,
+                             std::optional<std::string> system_state_log_dir_opt = {});
+
+        virtual std::optional<system_state_type> execute(int n_iter, CORE::TIMER &timer) override;
+
+    protected:
+        /// Kept from one execute() to the next (warm start), along with whatever a scheme adds
+        struct BODIES
+        {
+            /// At the beginning of the current step, but pos for a scheme drifting every body at every tick
+            std::vector<CORE::POS_BASE<T>> pos;
+            std::vector<CORE::VEL_BASE<T>> vel;
+            /// Of the last evaluation
+            std::vector<CORE::ACC_BASE<T>> acc;
+            std::vector<CORE::XYZ_BASE<T>> jerk;
+            std::vector<T> mass;
+            std::vector<int> bin;
+            std::vector<int64_t> step_begin_tick;
+            /// Bodies ending their step at the current tick
+            std::vector<uint32_t> active;
+
+            explicit BODIES(size_t n_body);
+        };
+
+        virtual void materialize_system_state(system_state_type &system_state) override;
+        /// The schemes step on their own, taking the default integrator only
+        virtual bool supports_integrator(const CORE::INTEGRATOR &integrator) const override { return CORE::ENGINE_BASE<T>::supports_integrator(integrator); }
+
+        /// To be defined by the scheme
+        /// Every body from last_tick to tick, as the sources of evaluate()
+        virtual void predict(BODIES &bodies, int64_t last_tick, int64_t tick) = 0;
+        /// Overwrites acc and jerk of every body in bodies.active, from all the predicted bodies
+        virtual void evaluate(BODIES &bodies) = 0;
+        /// Ends the step of every body in bodies.active at tick, with end_step()
+        virtual void correct(BODIES &bodies, int64_t tick) = 0;
+        /// Values per body in a checkpoint, the bin among them, which the scheme needs to continue
+        virtual size_t n_engine_value() const = 0;
+        virtual void get_engine_values(const BODIES &bodies, size_t i_body, T *values) const = 0;
+        virtual void set_engine_values(BODIES &bodies, size_t i_body, const T *values) = 0;
+
+        /// The next bin of a body ending its step at tick, dt_wanted being its step from the time step criterion
+        void end_step(BODIES &bodies, size_t i_body, int64_t tick, T dt_wanted) const;
+
+        const CORE::BLOCK_TIMESTEP_BASE<T> &block_timestep() const { return block_timestep_; }
+        T eta() const { return eta_; }
+
+        using BASIC_ENGINE_BASE<T>::parallel_for_helper;
+
+    private:
+        /// Bodies, with bins, from system_state_snapshot() on the first execute(), and the engine values from the checkpoint if resumed
+        BODIES &warm_start(CORE::TIMER &timer, bool &is_ic_logged);
+        /// One iteration, i.e., dt, from the synchronized bodies to the synchronized bodies
+        void step(BODIES &bodies);
+        void print_bins(const BODIES &bodies) const;
+
+        using BASIC_ENGINE_BASE<T>::system_state_snapshot;
+        using BASIC_ENGINE_BASE<T>::push_system_state_to_log;
+        using BASIC_ENGINE_BASE<T>::serialize_system_state_log;
+        using BASIC_ENGINE_BASE<T>::resumed_acceleration;
+        using BASIC_ENGINE_BASE<T>::resumed_engine_values;
+        using BASIC_ENGINE_BASE<T>::count_force_evaluations;
+        using BASIC_ENGINE_BASE<T>::checkpoint_if_due;
+
+    private:
+        CORE::BLOCK_TIMESTEP_BASE<T> block_timestep_;
+        T eta_;
+        std::optional<BODIES> bodies_opt_;
+    };
+
+    extern template class TIME_BIN_ENGINE_BASE<float>;
+    extern template class TIME_BIN_ENGINE_BASE<double>;
+}
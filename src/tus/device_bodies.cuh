@@ -0,0 +1,119 @@
+#pragma once
+
+#include "helper.cuh"
+#include "data_t.cuh"
+
+#include <cstring>
+#include <type_traits>
+
+namespace TUS
+{
+    /// The bodies of a TUS engine in device memory, double buffered.
+    /// Allocated by the first execute() and freed with the engine, so that the next execute() continues from them (warm start)
+    /// and the SYSTEM_STATE is only copied back to the host when it is read (see CORE::ENGINE_BASE::materialize_system_state()).
+    /// Position: data_t_3d, the masses being in d_M, or float4, the mass being in w
+    /// Acceleration: data_t_3d or float4, as the kernels of the engine take it
+    template <typename Position, typename Acceleration>
+    struct DEVICE_BODIES
+    {
+        size_t n_body;
+        /// Buffers of the bodies reached, the others being written by the next iteration
+        unsigned src_index = 0;
+        unsigned dest_index = 1;
+        Position *d_X[2] = {nullptr, nullptr};
+        data_t_3d *d_V[2] = {nullptr, nullptr};
+        Acceleration *d_A[2] = {nullptr, nullptr};
+        data_t_3d *d_V_half = nullptr;
+        /// With data_t_3d positions only
+        data_t *d_M = nullptr;
+
+        /// n_position: ic.size() or more, the positions beyond being zero for the kernels reading them by whole tiles
+        DEVICE_BODIES(const CORE::SOA_SYSTEM_STATE &ic, size_t n_position);
+        ~DEVICE_BODIES();
+        DEVICE_BODIES(const DEVICE_BODIES &) = delete;
+        DEVICE_BODIES &operator=(const DEVICE_BODIES &) = delete;
+
+        /// Overwrites system_state with the bodies of buffer i_buffer, reusing its memory
+        void copy_to_host(unsigned i_buffer, CORE::SOA_SYSTEM_STATE &system_state);
+
+    private:
+        /// Pinned, for the copies between host and device
+        Position *h_X = nullptr;
+        data_t_3d *h_V = nullptr;
+        data_t *h_M = nullptr;
+    };
+
+    /// Implementation
+
+    template <typename Position, typename Acceleration>
+    DEVICE_BODIES<Position, Acceleration>::DEVICE_BODIES(const CORE::SOA_SYSTEM_STATE &ic, size_t n_position) : n_body(ic.size())
+    {
+        ASSERT(n_position >= n_body);
+        const size_t position_size = sizeof(Position) * n_position;
+        const size_t vector_size = sizeof(data_t_3d) * n_body;
+        const size_t data_size = sizeof(data_t) * n_body;
+
+        host_malloc_helper((void **)&h_X, position_size);
+        host_malloc_helper((void **)&h_V, vector_size);
+        std::memset(h_X, 0, position_size);
+        if constexpr (std::is_same_v<Position, float4>)
+        {
+            parse_ic_f4(h_X, h_V, ic);
+        }
+        else
+        {
+            host_malloc_helper((void **)&h_M, data_size);
+            parse_ic(h_X, h_V, h_M, ic);
+            gpuErrchk(cudaMalloc((void **)&d_M, data_size));
+            gpuErrchk(cudaMemcpy(d_M, h_M, data_size, cudaMemcpyHostToDevice));
+        }
+
+        for (const unsigned i : {src_index, dest_index})
+        {
+            gpuErrchk(cudaMalloc((void **)&d_X[i], position_size));
+            gpuErrchk(cudaMalloc((void **)&d_V[i], vector_size));
+            gpuErrchk(cudaMalloc((void **)&d_A[i], sizeof(Acceleration) * n_body));
+            // The padding of both buffers stays zero, only the bodies being written
+            gpuErrchk(cudaMemcpy(d_X[i], h_X, position_size, cudaMemcpyHostToDevice));
+        }
+        gpuErrchk(cudaMalloc((void **)&d_V_half, vector_size));
+        gpuErrchk(cudaMemcpy(d_V[src_index], h_V, vector_size, cudaMemcpyHostToDevice));
+    }
+
+    template <typename Position, typename Acceleration>
+    DEVICE_BODIES<Position, Acceleration>::~DEVICE_BODIES()
+    {
+        for (const unsigned i : {src_index, dest_index})
+        {
+            cudaFree(d_X[i]);
+            cudaFree(d_V[i]);
+            cudaFree(d_A[i]);
+        }
+        cudaFree(d_V_half);
+        cudaFree(d_M);
+        cudaFreeHost(h_X);
+        cudaFreeHost(h_V);
+        cudaFreeHost(h_M);
+    }
+
+    template <typename Position, typename Acceleration>
+    void DEVICE_BODIES<Position, Acceleration>::copy_to_host(unsigned i_buffer, CORE::SOA_SYSTEM_STATE &system_state)
+    {
+        gpuErrchk(cudaMemcpy(h_X, d_X[i_buffer], sizeof(Position) * n_body, cudaMemcpyDeviceToHost));
+        gpuErrchk(cudaMemcpy(h_V, d_V[i_buffer], sizeof(data_t_3d) * n_body, cudaMemcpyDeviceToHost));
+        system_state.resize(n_body);
+        for (size_t i_body = 0; i_body < n_body; i_body++)
+        {
+            system_state.set_pos(i_body, {h_X[i_body].x, h_X[i_body].y, h_X[i_body].z});
+            system_state.set_vel(i_body, {h_V[i_body].x, h_V[i_body].y, h_V[i_body].z});
+            if constexpr (std::is_same_v<Position, float4>)
+            {
+                system_state.mass()[i_body] = h_X[i_body].w;
+            }
+            else
+            {
+                system_state.mass()[i_body] = h_M[i_body];
+            }
+        }
+    }
+}
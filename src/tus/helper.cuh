@@ -53,30 +53,30 @@ inline __host__ bool IsPowerOfTwo(unsigned x)
     return (x & (x - 1)) == 0;
 }
 
-inline __host__ void parse_ic(data_t_3d *input_x, data_t_3d *input_v, data_t *input_m, const CORE::SYSTEM_STATE &ic)
+inline __host__ void parse_ic(data_t_3d *input_x, data_t_3d *input_v, data_t *input_m, const CORE::SOA_SYSTEM_STATE &ic)
 {
     size_t length_to_parse = ic.size();
     std::cout << "parsing " << length_to_parse << " bodies\n";
     for (size_t i = 0; i < length_to_parse; i++)
     {
-        CORE::POS p = std::get<CORE::POS>(ic[i]);
-        CORE::VEL v = std::get<CORE::VEL>(ic[i]);
-        CORE::MASS m = std::get<CORE::MASS>(ic[i]);
+        CORE::POS p = ic.pos(i);
+        CORE::VEL v = ic.vel(i);
+        CORE::MASS m = ic.mass()[i];
         input_x[i] = make_data_t_3d((data_t)p.x, (data_t)p.y, (data_t)p.z);
         input_v[i] = make_data_t_3d((data_t)v.x, (data_t)v.y, (data_t)v.z);
         input_m[i] = (data_t)m;
     }
 }
 
-inline __host__ void parse_ic_f4(float4 *input_x, data_t_3d *input_v, const CORE::SYSTEM_STATE &ic)
+inline __host__ void parse_ic_f4(float4 *input_x, data_t_3d *input_v, const CORE::SOA_SYSTEM_STATE &ic)
 {
     size_t length_to_parse = ic.size();
     std::cout << "parsing " << length_to_parse << " bodies\n";
     for (size_t i = 0; i < length_to_parse; i++)
     {
-        CORE::POS p = std::get<CORE::POS>(ic[i]);
-        CORE::VEL v = std::get<CORE::VEL>(ic[i]);
-        CORE::MASS m = std::get<CORE::MASS>(ic[i]);
+        CORE::POS p = ic.pos(i);
+        CORE::VEL v = ic.vel(i);
+        CORE::MASS m = ic.mass()[i];
         input_x[i] = make_float4(p.x, p.y, p.z, m);
         input_v[i] = make_data_t_3d((data_t)v.x, (data_t)v.y, (data_t)v.z);
     }
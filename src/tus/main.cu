@@ -45,8 +45,10 @@ auto parse_args(int argc, const char *argv[])
         .allow_unrecognised_options();
 
     auto option_group = options.add_options();
-    option_group("i,ic_file", "ic_file: .bin or .csv", cxxopts::value<std::string>());
+    option_group("i,ic_file", "ic_file: .bin, .csv, .traj, TIPSY or GADGET-2", cxxopts::value<std::string>());
     option_group("b,num_bodies", "max_n_bodies: optional (default -1), no effect if < 0 or >= n_body from ic_file", cxxopts::value<int>()->default_value("-1"));
+    option_group("subsample", "keep one body out of every subsample bodies of ic_file, before max_n_bodies: optional (default 1)", cxxopts::value<int>()->default_value("1"));
+    option_group("ic_body_types", "particle types of a TIPSY or GADGET-2 ic_file to keep, e.g. 1,2 (TIPSY: 0 gas, 1 dark, 2 star, GADGET-2: 0 to 5): optional (default all)", cxxopts::value<std::vector<int>>());
     option_group("d,dt", "dt", cxxopts::value<CORE::UNIVERSE::floating_value_type>());
     option_group("n,num_iterations", "num_iterations", cxxopts::value<int>());
     option_group("t,block_size", "num_threads_per_block for CUDA", cxxopts::value<int>()->default_value(std::to_string(::default_block_size)));
@@ -81,6 +83,8 @@ int main(int argc, const char *argv[])
     auto arg_result = parse_args(argc, argv);
     const std::string ic_file_path = arg_result["ic_file"].as<std::string>();
     const int max_n_body = arg_result["num_bodies"].as<int>();
+    const int subsample = arg_result["subsample"].as<int>();
+    const std::vector<int> ic_body_types = arg_result.count("ic_body_types") ? arg_result["ic_body_types"].as<std::vector<int>>() : std::vector<int>();
     const CORE::DT dt = arg_result["dt"].as<CORE::UNIVERSE::floating_value_type>();
     const int n_iteration = arg_result["num_iterations"].as<int>();
     const int block_size = arg_result["block_size"].as<int>();
@@ -107,6 +111,13 @@ int main(int argc, const char *argv[])
     std::cout << "Running.." << std::endl;
     std::cout << "ic_file: " << ic_file_path << std::endl;
     std::cout << "max_n_body: " << max_n_body << std::endl;
+    std::cout << "subsample: " << subsample << std::endl;
+    std::cout << "ic_body_types:";
+    for (const int ic_body_type : ic_body_types)
+    {
+        std::cout << " " << ic_body_type;
+    }
+    std::cout << (ic_body_types.empty() ? " all" : "") << std::endl;
     std::cout << "dt: " << dt << std::endl;
     std::cout << "n_iteration: " << n_iteration << std::endl;
     std::cout << "block_size: " << block_size << std::endl;
@@ -131,14 +142,38 @@ int main(int argc, const char *argv[])
         std::cout << "--------------------" << std::endl;
     }
 
-    /* BIN file of initial conditions */
-    CORE::SYSTEM_STATE
-        system_state_ic = CORE::deserialize_system_state_from_file(ic_file_path);
-    if (max_n_body >= 0 && max_n_body < static_cast<int>(system_state_ic.size()))
+    /* BIN file of initial conditions, streamed so that the bodies left out are never materialized */
+    if (subsample < 1)
+    {
+        std::cout << "INVALID SUBSAMPLE: " << subsample << ", must be at least 1" << std::endl;
+        exit(1);
+    }
+
+    for (const int ic_body_type : ic_body_types)
+    {
+        if (ic_body_type < 0 || ic_body_type >= 32)
+        {
+            std::cout << "INVALID IC BODY TYPE: " << ic_body_type << ", must be in [0, 32)" << std::endl;
+            exit(1);
+        }
+    }
+
+    CORE::INGESTION ingestion;
+    ingestion.stride = static_cast<size_t>(subsample);
+    if (!ic_body_types.empty())
+    {
+        ingestion.body_types = 0;
+        for (const int ic_body_type : ic_body_types)
+        {
+            ingestion.body_types |= uint32_t{1} << ic_body_type;
+        }
+    }
+    if (max_n_body >= 0)
     {
-        system_state_ic.resize(max_n_body);
-        std::cout << "Limiting number of bodies to " << max_n_body << std::endl;
+        ingestion.max_n_body = static_cast<size_t>(max_n_body);
     }
+    CORE::SOA_SYSTEM_STATE system_state_ic = CORE::deserialize_soa_system_state_from_file(ic_file_path, ingestion);
+    std::cout << "Loaded " << system_state_ic.size() << " bodies" << std::endl;
     timer.elapsed_previous("loading_ic");
 
     // Select engine here
@@ -188,7 +223,7 @@ int main(int argc, const char *argv[])
     timer.elapsed_previous("initializing_engine");
 
     // Execute engine
-    const CORE::SYSTEM_STATE &actual_system_state_result = engine->run(n_iteration);
+    engine->run(n_iteration);
     timer.elapsed_previous("running_engine");
 
     if (snapshot && system_state_log_dir_opt)
@@ -197,14 +232,15 @@ int main(int argc, const char *argv[])
         const std::string snapshot_filename =
             *system_state_log_dir_opt + delim + CORE::remove_extension(CORE::base_name(ic_file_path)) +
             "_" + std::to_string(static_cast<size_t>(dt * n_iteration)) + ".bin";
-        CORE::serialize_system_state_to_bin(snapshot_filename, actual_system_state_result, true);
+        const CORE::BIN::METADATA snapshot_metadata{dt, static_cast<uint64_t>(n_iteration), dt * n_iteration};
+        CORE::serialize_system_state_to_bin(snapshot_filename, engine->system_state(), true, snapshot_metadata);
     }
 
     if (verify)
     {
         std::cout << "====================" << std::endl;
         std::cout << "VERIFYING.." << std::endl;
-        const bool result = CPUSIM::run_verify_with_reference_engine(system_state_ic, actual_system_state_result, dt, n_iteration);
+        const bool result = CPUSIM::run_verify_with_reference_engine(system_state_ic, engine->system_state(), dt, n_iteration);
         std::cout << "VERFICATION RESULT:" << std::endl;
         if (result)
         {
@@ -1,23 +1,29 @@
 #pragma once
 
 #include "core/engine.h"
+#include "device_bodies.cuh"
 
 namespace TUS
 {
     class MAT_MUL_ENGINE final : public CORE::ENGINE
     {
     public:
-        virtual ~MAT_MUL_ENGINE() = default;
+        virtual ~MAT_MUL_ENGINE();
 
-        MAT_MUL_ENGINE(CORE::SYSTEM_STATE system_state_ic,
+        MAT_MUL_ENGINE(CORE::SOA_SYSTEM_STATE system_state_ic,
                       CORE::DT dt,
                       int block_size,
                       std::optional<std::string> system_state_log_dir_opt = {});
 
         virtual std::string name() override { return "MAT_MUL_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::optional<CORE::SOA_SYSTEM_STATE> execute(int n_iter, CORE::TIMER &timer) override;
+
+    protected:
+        virtual void materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state) override;
 
     private:
         int block_size_;
+        std::optional<DEVICE_BODIES<data_t_3d, data_t_3d>> bodies_opt_;
+        data_t *d_Field_ = nullptr;
     };
 }
\ No newline at end of file
@@ -146,107 +146,52 @@ calculate_forces_improved(int N, void *devX, void *devA, int p)
     globalA[gtid] = acc4;
 }
 
-namespace
-{
-    CORE::SYSTEM_STATE generate_system_state(const float4 *h_X, const data_t_3d *h_V, const size_t nbody)
-    {
-        CORE::SYSTEM_STATE system_state;
-        system_state.reserve(nbody);
-        for (size_t i_body = 0; i_body < nbody; i_body++)
-        {
-            CORE::POS pos_temp{h_X[i_body].x, h_X[i_body].y, h_X[i_body].z};
-            CORE::VEL vel_temp{h_V[i_body].x, h_V[i_body].y, h_V[i_body].z};
-            system_state.emplace_back(pos_temp, vel_temp, h_X[i_body].w);
-        }
-        return system_state;
-    }
-}
-
 namespace TUS
 {
-    NVDA_IMPROVED_ENGINE::NVDA_IMPROVED_ENGINE(CORE::SYSTEM_STATE system_state_ic,
+    NVDA_IMPROVED_ENGINE::NVDA_IMPROVED_ENGINE(CORE::SOA_SYSTEM_STATE system_state_ic,
                                                CORE::DT dt,
                                                int block_size,
-                                               std::optional<std::string> system_state_log_dir_opt) : ENGINE(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
+                                               std::optional<std::string> system_state_log_dir_opt) : CORE::ENGINE(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
                                                                                                       block_size_(block_size)
     {
     }
 
-    CORE::SYSTEM_STATE NVDA_IMPROVED_ENGINE::execute(int n_iter, CORE::TIMER &timer)
+    void NVDA_IMPROVED_ENGINE::materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state)
     {
-        size_t nBody = system_state_snapshot().size();
-
-        /* BIN file of initial conditions */
-        const auto &ic = system_state_snapshot();
-
-        // random initializer just for now
-        size_t vector_size_3d = sizeof(data_t_3d) * nBody;
-        size_t vector_size_4d = sizeof(float4) * nBody;
-        size_t vector_size_4dx = sizeof(float4) * ((nBody + (block_size_ - 1)) / block_size_) * block_size_;
-        /*
-     *   host side memory allocation
-     */
-        data_t_3d *h_V, *h_output_V;
-        float4 *h_X, *h_A, *h_output_X;
-
-        host_malloc_helper((void **)&h_V, vector_size_3d);
-        host_malloc_helper((void **)&h_output_V, vector_size_3d);
-
-        host_malloc_helper((void **)&h_X, vector_size_4dx);
-        host_malloc_helper((void **)&h_A, vector_size_4d);
-        host_malloc_helper((void **)&h_output_X, vector_size_4d);
-
-        timer.elapsed_previous("allocated host side memory");
-        /*
-     *   input randome initialize
-     */
+        bodies_opt_->copy_to_host(bodies_opt_->src_index, system_state);
+    }
 
-        for (int i = 0; i < ((nBody + (block_size_ - 1)) / block_size_) * block_size_; i++)
+    std::optional<CORE::SOA_SYSTEM_STATE> NVDA_IMPROVED_ENGINE::execute(int n_iter, CORE::TIMER &timer)
+    {
+        // Device memory, the ic and its acceleration on the first execute() only
+        const bool is_warm = bodies_opt_.has_value();
+        if (!is_warm)
         {
-            h_X[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+            bodies_opt_.emplace(system_state_snapshot(), (system_state_snapshot().size() + block_size_ - 1) / block_size_ * block_size_);
+            timer.elapsed_previous("copied input data from host to device");
         }
-
-        parse_ic_f4(h_X, h_V, ic);
-        timer.elapsed_previous("deserialize_body_state_vec_from_csv");
-
-        /*
-         * create double buffer on device side
-         */
-        float4 **d_X, **d_A;
-        unsigned src_index = 0;
-        unsigned dest_index = 1;
-        d_X = (float4 **)malloc(2 * sizeof(float4 *));
-        gpuErrchk(cudaMalloc((void **)&d_X[src_index], vector_size_4dx));
-        gpuErrchk(cudaMalloc((void **)&d_X[dest_index], vector_size_4dx));
-
-        d_A = (float4 **)malloc(2 * sizeof(float4 *));
-        gpuErrchk(cudaMalloc((void **)&d_A[src_index], vector_size_4d));
-        gpuErrchk(cudaMalloc((void **)&d_A[dest_index], vector_size_4d));
-
-        data_t_3d **d_V;
-        d_V = (data_t_3d **)malloc(2 * sizeof(data_t_3d *));
-        gpuErrchk(cudaMalloc((void **)&d_V[src_index], vector_size_3d));
-        gpuErrchk(cudaMalloc((void **)&d_V[dest_index], vector_size_3d));
-
-        data_t_3d *d_V_half;
-        gpuErrchk(cudaMalloc((void **)&d_V_half, vector_size_3d));
-
-        timer.elapsed_previous("allocated device memory");
-        /*
-         *   create double buffer on device side
-         */
-        // cudaMemcpy(d_A[0], h_A, vector_size, cudaMemcpyHostToDevice);
-        cudaMemcpy(d_X[src_index], h_X, vector_size_4dx, cudaMemcpyHostToDevice);
-        cudaMemcpy(d_V[src_index], h_V, vector_size_3d, cudaMemcpyHostToDevice);
-        timer.elapsed_previous("copied input data from host to device");
+        DEVICE_BODIES<float4, float4> &bodies = *bodies_opt_;
+        const size_t nBody = bodies.n_body;
+        auto &d_X = bodies.d_X;
+        auto &d_V = bodies.d_V;
+        auto &d_A = bodies.d_A;
+        data_t_3d *d_V_half = bodies.d_V_half;
+        unsigned &src_index = bodies.src_index;
+        unsigned &dest_index = bodies.dest_index;
 
         // nthread is assigned to either 32 by default or set to a custom power of 2 by user
         std::cout << "Set thread_per_block to " << block_size_ << std::endl;
         unsigned nblocks = (nBody + block_size_ - 1) / block_size_;
 
-        // calculate the initialia acceleration
-        calculate_forces_improved<<<nblocks, block_size_, block_size_ * sizeof(float4)>>>(nBody, d_X[src_index], d_A[src_index], block_size_);
-        timer.elapsed_previous("Calculated initial acceleration");
+        if (!is_warm)
+        {
+            // calculate the initialia acceleration
+            calculate_forces_improved<<<nblocks, block_size_, block_size_ * sizeof(float4)>>>(nBody, d_X[src_index], d_A[src_index], block_size_);
+            timer.elapsed_previous("Calculated initial acceleration");
+
+            push_system_state_to_log([&bodies](CORE::SOA_SYSTEM_STATE &system_state)
+                                     { bodies.copy_to_host(bodies.src_index, system_state); });
+        }
 
         {
             CORE::TIMER core_timer("all_iters");
@@ -270,14 +215,8 @@ namespace TUS
 
                 if (is_system_state_logging_enabled())
                 {
-                    cudaMemcpy(h_output_X, d_X[dest_index], vector_size_4d, cudaMemcpyDeviceToHost);
-                    cudaMemcpy(h_output_V, d_V[dest_index], vector_size_4d, cudaMemcpyDeviceToHost);
-
-                    if (i_iter == 0)
-                    {
-                        push_system_state_to_log(generate_system_state(h_X, h_V, nBody));
-                    }
-                    push_system_state_to_log(generate_system_state(h_output_X, h_output_V, nBody));
+                    push_system_state_to_log([&bodies](CORE::SOA_SYSTEM_STATE &system_state)
+                                             { bodies.copy_to_host(bodies.dest_index, system_state); });
 
                     if (i_iter % 10 == 0)
                     {
@@ -292,40 +231,7 @@ namespace TUS
             cudaDeviceSynchronize();
         }
 
-        // at end, the final data is actually at src_index because the last swap
-        cudaMemcpy(h_output_X, d_X[src_index], vector_size_4d, cudaMemcpyDeviceToHost);
-        cudaMemcpy(h_output_V, d_V[src_index], vector_size_3d, cudaMemcpyDeviceToHost);
-
-        // Hack Hack Hack. dump out the data
-        cudaMemcpy(h_A, d_A[src_index], vector_size_4d, cudaMemcpyDeviceToHost);
-
-        write_debug_output(name(), h_output_X, h_output_V, h_A, nBody);
-
-        timer.elapsed_previous("copied output back to host");
-
-        //Just for debug purpose on small inputs
-        // for (unsigned i = 0; i < nBody; i++)
-        // {
-        //    printf("object = %d, %f, %f, %f\n", i, h_output_X[i].x, h_output_X[i].y, h_output_X[i].z);
-        // }
-
-        auto system_state_result = generate_system_state(h_output_X, h_output_V, nBody);
-
-        cudaFreeHost(h_X);
-        cudaFreeHost(h_A);
-        cudaFreeHost(h_V);
-        cudaFreeHost(h_output_X);
-        cudaFreeHost(h_output_V);
-
-        for (const auto i : {src_index, dest_index})
-        {
-            cudaFree(d_X[i]);
-            cudaFree(d_V[i]);
-            cudaFree(d_A[i]);
-        }
-        cudaFree(d_V_half);
-        cudaDeviceReset();
-
-        return system_state_result;
+        // Kept on the device for the next execute(), the bodies reached being at src_index because of the last swap
+        return std::nullopt;
     }
 }
\ No newline at end of file
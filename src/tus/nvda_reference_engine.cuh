@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/engine.h"
+#include "device_bodies.cuh"
 
 namespace TUS
 {
@@ -9,15 +10,19 @@ namespace TUS
     public:
         virtual ~NVDA_REFERENCE_ENGINE() = default;
 
-        NVDA_REFERENCE_ENGINE(CORE::SYSTEM_STATE body_states_ic,
+        NVDA_REFERENCE_ENGINE(CORE::SOA_SYSTEM_STATE body_states_ic,
                               CORE::DT dt,
                               int block_size,
                               std::optional<std::string> system_state_log_dir_opt = {});
 
         virtual std::string name() override { return "NVDA_REFERENCE_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::optional<CORE::SOA_SYSTEM_STATE> execute(int n_iter, CORE::TIMER &timer) override;
+
+    protected:
+        virtual void materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state) override;
 
     private:
         int block_size_;
+        std::optional<DEVICE_BODIES<float4, float4>> bodies_opt_;
     };
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/engine.h"
+#include "device_bodies.cuh"
 
 namespace TUS
 {
@@ -9,15 +10,19 @@ namespace TUS
     public:
         virtual ~TILED_SIMPLE_ENGINE() = default;
 
-        TILED_SIMPLE_ENGINE(CORE::SYSTEM_STATE body_states_ic,
+        TILED_SIMPLE_ENGINE(CORE::SOA_SYSTEM_STATE body_states_ic,
                             CORE::DT dt,
                             int block_size,
                             std::optional<std::string> system_state_log_dir_opt = {});
 
         virtual std::string name() override { return "TILED_SIMPLE_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::optional<CORE::SOA_SYSTEM_STATE> execute(int n_iter, CORE::TIMER &timer) override;
+
+    protected:
+        virtual void materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state) override;
 
     private:
         int block_size_;
+        std::optional<DEVICE_BODIES<data_t_3d, data_t_3d>> bodies_opt_;
     };
 }
\ No newline at end of file
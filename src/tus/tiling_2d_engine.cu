@@ -254,42 +254,43 @@ calculate_forces_1d(int N, void *devX, void *devA, int p)
     }
 }
 
-namespace
-{
-    CORE::SYSTEM_STATE generate_system_state(const float4 *h_X, const data_t_3d *h_V, const size_t nbody)
-    {
-        CORE::SYSTEM_STATE system_state;
-        system_state.reserve(nbody);
-        for (size_t i_body = 0; i_body < nbody; i_body++)
-        {
-            CORE::POS pos_temp{h_X[i_body].x, h_X[i_body].y, h_X[i_body].z};
-            CORE::VEL vel_temp{h_V[i_body].x, h_V[i_body].y, h_V[i_body].z};
-            system_state.emplace_back(pos_temp, vel_temp, h_X[i_body].w);
-        }
-        return system_state;
-    }
-}
-
 namespace TUS
 {
-    TILING_2D_ENGINE::TILING_2D_ENGINE(CORE::SYSTEM_STATE system_state_ic,
+    TILING_2D_ENGINE::TILING_2D_ENGINE(CORE::SOA_SYSTEM_STATE system_state_ic,
                                    CORE::DT dt,
                                    int block_size,
                                    int tb_len,
                                    int tb_wid,
                                    int unroll_factor,
                                    int tpb,
-                                   std::optional<std::string> system_state_log_dir_opt) : ENGINE(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
+                                   std::optional<std::string> system_state_log_dir_opt) : CORE::ENGINE(std::move(system_state_ic), dt, std::move(system_state_log_dir_opt)),
                                                                                           block_size_(block_size), tb_len_(tb_len), tb_wid_(tb_wid),
                                                                                           unroll_factor_(unroll_factor), tpb_(tpb)
     {
     }
 
-    CORE::SYSTEM_STATE TILING_2D_ENGINE::execute(int n_iter, CORE::TIMER &timer)
+    TILING_2D_ENGINE::~TILING_2D_ENGINE()
+    {
+        if (handle_)
+        {
+            cublasDestroy(handle_);
+        }
+        cudaFree(d_intermidiate_A_);
+        cudaFree(d_column_one_matrix_);
+    }
+
+    void TILING_2D_ENGINE::materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state)
+    {
+        bodies_opt_->copy_to_host(bodies_opt_->src_index, system_state);
+    }
+
+    std::optional<CORE::SOA_SYSTEM_STATE> TILING_2D_ENGINE::execute(int n_iter, CORE::TIMER &timer)
     {
+        // Device memory, the ic and its acceleration on the first execute() only
+        const bool is_warm = bodies_opt_.has_value();
 
         // number of body for the problem
-        size_t nBody = system_state_snapshot().size();
+        size_t nBody = is_warm ? bodies_opt_->n_body : system_state_snapshot().size();
 
         // number of body to accumulate field for each kernel call.
         // each kernel call accumluate AccumBody's acceleration for all Nbodies.
@@ -298,8 +299,6 @@ namespace TUS
         {
             AccumBody = 100000;
         }
-        /* BIN file of initial conditions */
-        const auto &ic = system_state_snapshot();
 
         dim3 block(tb_len_, tb_wid_);
         int column_per_block = (tb_len_ * unroll_factor_);
@@ -314,80 +313,56 @@ namespace TUS
 
         // size
         size_t vector_size_3d = sizeof(data_t_3d) * nBody;
-        size_t vector_size_4d = sizeof(float4) * nBody;
 
         // to make boundary check not so painful, pre allocated extra memory so each thread doesn't need to worry about
         // boundary checking
         size_t position_quantized_element = (nBody + column_per_block - 1) / column_per_block * column_per_block;
         size_t quantized_accum_body = (nBody + (AccumBody - 1)) / AccumBody * AccumBody;
         size_t gter = get_max(position_quantized_element, quantized_accum_body);
-        size_t vector_size_4d_qtzed = sizeof(float4) * gter;
         size_t num_loop = quantized_accum_body / AccumBody;
         std::cout << "quantize to " << gter << std::endl;
         printf("summation expects to take %d / %d = %d iteration\n", quantized_accum_body, AccumBody, num_loop);
-        /*
-         *   host side memory allocation
-         */
-        data_t_3d *h_V, *h_output_V;
-        float4 *h_X, *h_output_X;
-        float3 *h_A;
-
-        host_malloc_helper((void **)&h_V, vector_size_3d);
-        host_malloc_helper((void **)&h_output_V, vector_size_3d);
-
-        host_malloc_helper((void **)&h_X, vector_size_4d_qtzed);
-        host_malloc_helper((void **)&h_A, vector_size_3d);
-        host_malloc_helper((void **)&h_output_X, vector_size_4d);
-
-        timer.elapsed_previous("allocated host side memory");
-        /*
-         *   input randome initialize
-         */
-        for (int i = 0; i < num_block_x_dim * column_per_block; i++)
-        {
-            h_X[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
-        }
-
-        parse_ic_f4(h_X, h_V, ic);
-        timer.elapsed_previous("deserialize_body_state_vec_from_csv");
-
-        /*
-         * create double buffer on device side
-         */
-        float4 **d_X;
-        float3 **d_A;
-        unsigned src_index = 0;
-        unsigned dest_index = 1;
 
         // for each kernel call, how many intermidate sum should we cache in global memory
         int summation_result_per_body = (AccumBody + unroll_factor_ - 1) / unroll_factor_;
         std::cout << "summation result per body is " << summation_result_per_body << std::endl;
-        float4 *d_intermidiate_A;
-        gpuErrchk(cudaMalloc((void **)&d_intermidiate_A, sizeof(float3) * nBody * summation_result_per_body));
-
-        d_X = (float4 **)malloc(2 * sizeof(float4 *));
-        gpuErrchk(cudaMalloc((void **)&d_X[src_index], vector_size_4d_qtzed));
-        gpuErrchk(cudaMalloc((void **)&d_X[dest_index], vector_size_4d_qtzed));
 
-        d_A = (float3 **)malloc(2 * sizeof(float3 *));
-        gpuErrchk(cudaMalloc((void **)&d_A[src_index], vector_size_3d));
-        gpuErrchk(cudaMalloc((void **)&d_A[dest_index], vector_size_3d));
+        /***************/
+        /* The idea is taken from https://stackoverflow.com/questions/17862078/reduce-matrix-rows-with-cuda 
+        /* with necessary modifications to make it work for float3
+        /***************/
+        int Nrows = nBody * 3;
+        int Ncols = summation_result_per_body;
+        float alpha = 1.f;
+        float beta  = 1.f;
 
-        data_t_3d **d_V;
-        d_V = (data_t_3d **)malloc(2 * sizeof(data_t_3d *));
-        gpuErrchk(cudaMalloc((void **)&d_V[src_index], vector_size_3d));
-        gpuErrchk(cudaMalloc((void **)&d_V[dest_index], vector_size_3d));
+        if (!is_warm)
+        {
+            bodies_opt_.emplace(system_state_snapshot(), gter);
 
-        data_t_3d *d_V_half;
-        gpuErrchk(cudaMalloc((void **)&d_V_half, vector_size_3d));
+            gpuErrchk(cudaMalloc((void **)&d_intermidiate_A_, sizeof(float3) * nBody * summation_result_per_body));
 
-        timer.elapsed_previous("allocated device memory");
-        /*
-         *   create double buffer on device side
-         */
-        cudaMemcpy(d_X[src_index], h_X, vector_size_4d_qtzed, cudaMemcpyHostToDevice);
-        cudaMemcpy(d_V[src_index], h_V, vector_size_3d, cudaMemcpyHostToDevice);
-        timer.elapsed_previous("copied input data from host to device");
+            cublasCreate(&handle_);
+            float *h_column_one_matrix;
+            host_malloc_helper((void **)&h_column_one_matrix, sizeof(float) * Ncols);
+            for(int i = 0; i < Ncols; i++) {
+                h_column_one_matrix[i] = 1.0f;
+            }
+            gpuErrchk(cudaMalloc((void **)&d_column_one_matrix_, sizeof(float) * Ncols));
+            cudaMemcpy(d_column_one_matrix_, h_column_one_matrix, sizeof(float) * Ncols, cudaMemcpyHostToDevice);
+            cudaFreeHost(h_column_one_matrix);
+            timer.elapsed_previous("copied input data from host to device");
+        }
+        DEVICE_BODIES<float4, float3> &bodies = *bodies_opt_;
+        auto &d_X = bodies.d_X;
+        auto &d_V = bodies.d_V;
+        auto &d_A = bodies.d_A;
+        data_t_3d *d_V_half = bodies.d_V_half;
+        unsigned &src_index = bodies.src_index;
+        unsigned &dest_index = bodies.dest_index;
+        float4 *d_intermidiate_A = d_intermidiate_A_;
+        float *d_column_one_matrix = d_column_one_matrix_;
+        cublasHandle_t handle = handle_;
 
         // nthread is assigned to either 32 by default or set to a custom power of 2 by user
         std::cout << "Set thread_per_block to " << block_size_ << std::endl;
@@ -397,44 +372,33 @@ namespace TUS
         std::cout << "using " << column_per_block * sizeof(float4) << " bytes per block" << std::endl;
         // I would highly recommend be careful about setting shared mem > 16384
         assert(column_per_block * sizeof(float4) <= 16384);
-        // calculate the initialia acceleration
-        cudaMemset(d_A[src_index], 0, vector_size_3d);
 
-        /***************/
-        /* The idea is taken from https://stackoverflow.com/questions/17862078/reduce-matrix-rows-with-cuda 
-        /* with necessary modifications to make it work for float3
-        /***************/
-        cublasHandle_t handle;
-        cublasCreate(&handle);
-        int Nrows = nBody * 3;
-        int Ncols = summation_result_per_body;
-        float alpha = 1.f;
-        float beta  = 1.f;
-        float *d_column_one_matrix, *h_column_one_matrix;
-        host_malloc_helper((void **)&h_column_one_matrix, sizeof(float) * Ncols);
-        for(int i = 0; i < Ncols; i++) {
-            h_column_one_matrix[i] = 1.0f;
-        }
-        gpuErrchk(cudaMalloc((void **)&d_column_one_matrix, sizeof(float) * Ncols));
-        cudaMemcpy(d_column_one_matrix, h_column_one_matrix, sizeof(float) * Ncols, cudaMemcpyHostToDevice);
-
-        for (int i = 0; i < num_loop; i++)
+        if (!is_warm)
         {
-            size_t offset = i * AccumBody;
-            if (block.x == 1)
-            {
-                calculate_forces_2d<<<grid, block, column_per_block * sizeof(float4)>>>(nBody, offset, d_X[src_index], d_intermidiate_A, unroll_factor_, summation_result_per_body);
-            }
-            else
+            // calculate the initialia acceleration
+            cudaMemset(d_A[src_index], 0, vector_size_3d);
+
+            for (int i = 0; i < num_loop; i++)
             {
-                calculate_forces_2d_no_conflict<<<grid, block, column_per_block * sizeof(float4)>>>(nBody, offset, d_X[src_index], d_intermidiate_A, unroll_factor_, summation_result_per_body);
+                size_t offset = i * AccumBody;
+                if (block.x == 1)
+                {
+                    calculate_forces_2d<<<grid, block, column_per_block * sizeof(float4)>>>(nBody, offset, d_X[src_index], d_intermidiate_A, unroll_factor_, summation_result_per_body);
+                }
+                else
+                {
+                    calculate_forces_2d_no_conflict<<<grid, block, column_per_block * sizeof(float4)>>>(nBody, offset, d_X[src_index], d_intermidiate_A, unroll_factor_, summation_result_per_body);
+                }
+
+                cublasSgemv(handle, CUBLAS_OP_T, Ncols, Nrows, &alpha, (float *)d_intermidiate_A, Ncols, 
+                                   (float *)d_column_one_matrix, 1, &beta, (float *) d_A[src_index], 1);
             }
+            cudaDeviceSynchronize();
+            timer.elapsed_previous("Calculated initial acceleration");
 
-            cublasSgemv(handle, CUBLAS_OP_T, Ncols, Nrows, &alpha, (float *)d_intermidiate_A, Ncols, 
-                               (float *)d_column_one_matrix, 1, &beta, (float *) d_A[src_index], 1);
+            push_system_state_to_log([&bodies](CORE::SOA_SYSTEM_STATE &system_state)
+                                     { bodies.copy_to_host(bodies.src_index, system_state); });
         }
-        cudaDeviceSynchronize();
-        timer.elapsed_previous("Calculated initial acceleration");
 
         {
             CORE::TIMER core_timer("all_iters");
@@ -469,14 +433,8 @@ namespace TUS
 
                 if (is_system_state_logging_enabled())
                 {
-                    cudaMemcpy(h_output_X, d_X[dest_index], vector_size_4d, cudaMemcpyDeviceToHost);
-                    cudaMemcpy(h_output_V, d_V[dest_index], vector_size_4d, cudaMemcpyDeviceToHost);
-
-                    if (i_iter == 0)
-                    {
-                        push_system_state_to_log(generate_system_state(h_X, h_V, nBody));
-                    }
-                    push_system_state_to_log(generate_system_state(h_output_X, h_output_V, nBody));
+                    push_system_state_to_log([&bodies](CORE::SOA_SYSTEM_STATE &system_state)
+                                             { bodies.copy_to_host(bodies.dest_index, system_state); });
 
                     if (i_iter % 10 == 0)
                     {
@@ -491,40 +449,7 @@ namespace TUS
             cudaDeviceSynchronize();
         }
 
-        // at end, the final data is actually at src_index because the last swap
-        cudaMemcpy(h_output_X, d_X[src_index], vector_size_4d, cudaMemcpyDeviceToHost);
-        cudaMemcpy(h_output_V, d_V[src_index], vector_size_3d, cudaMemcpyDeviceToHost);
-
-        // Hack Hack Hack. dump out the data
-        cudaMemcpy(h_A, d_A[src_index], vector_size_3d, cudaMemcpyDeviceToHost);
-
-        //write_debug_output(name(), h_output_X, h_output_V, h_A, nBody);
-
-        timer.elapsed_previous("copied output back to host");
-
-        //Just for debug purpose on small inputs
-        // for (unsigned i = 0; i < nBody; i++)
-        // {
-        //    printf("object = %d, %f, %f, %f\n", i, h_output_X[i].x, h_output_X[i].y, h_output_X[i].z);
-        // }
-
-        auto system_state_result = generate_system_state(h_output_X, h_output_V, nBody);
-
-        cudaFreeHost(h_X);
-        cudaFreeHost(h_A);
-        cudaFreeHost(h_V);
-        cudaFreeHost(h_output_X);
-        cudaFreeHost(h_output_V);
-
-        for (const auto i : {src_index, dest_index})
-        {
-            cudaFree(d_X[i]);
-            cudaFree(d_V[i]);
-            cudaFree(d_A[i]);
-        }
-        cudaFree(d_V_half);
-        cudaDeviceReset();
-
-        return system_state_result;
+        // Kept on the device for the next execute(), the bodies reached being at src_index because of the last swap
+        return std::nullopt;
     }
 }
\ No newline at end of file
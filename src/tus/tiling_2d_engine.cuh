@@ -1,15 +1,18 @@
 #pragma once
 
 #include "core/engine.h"
+#include "device_bodies.cuh"
+
+#include <cublas_v2.h>
 
 namespace TUS
 {
     class TILING_2D_ENGINE final : public CORE::ENGINE
     {
     public:
-        virtual ~TILING_2D_ENGINE() = default;
+        virtual ~TILING_2D_ENGINE();
 
-        TILING_2D_ENGINE(CORE::SYSTEM_STATE body_states_ic,
+        TILING_2D_ENGINE(CORE::SOA_SYSTEM_STATE body_states_ic,
                               CORE::DT dt,
                               int block_size,
                               int tb_len,
@@ -19,7 +22,10 @@ namespace TUS
                               std::optional<std::string> system_state_log_dir_opt = {});
 
         virtual std::string name() override { return "TILING_2D_ENGINE"; }
-        virtual CORE::SYSTEM_STATE execute(int n_iter, CORE::TIMER &timer) override;
+        virtual std::optional<CORE::SOA_SYSTEM_STATE> execute(int n_iter, CORE::TIMER &timer) override;
+
+    protected:
+        virtual void materialize_system_state(CORE::SOA_SYSTEM_STATE &system_state) override;
 
     private:
         int block_size_;
@@ -27,5 +33,10 @@ namespace TUS
         int tb_wid_;
         int unroll_factor_;
         int tpb_;
+        std::optional<DEVICE_BODIES<float4, float3>> bodies_opt_;
+        /// Partial sums of the accelerations, summed by cublasSgemv() with a column of ones
+        float4 *d_intermidiate_A_ = nullptr;
+        float *d_column_one_matrix_ = nullptr;
+        cublasHandle_t handle_ = nullptr;
     };
 }
\ No newline at end of file